@@ -0,0 +1,88 @@
+// Decoder for the compressed power log blocks (/log/<sequence>.bin), the
+// counterpart of lib/logCodec: a 12 byte header (magic "PLB1", version,
+// field count, reserved, start epoch; little endian) followed by records of
+// a delta of delta time stamp and one difference per field. Each is a
+// zig-zag value behind a prefix: 0, 10 + 7 bits, 110 + 12, 1110 + 20,
+// 1111 + 32; MSB first. The stream ends in 1 bits.
+
+const LOG_BLOCK_MAGIC = 0x31424C50;
+const LOG_BLOCK_HEADER_SIZE = 12;
+const LOG_CODE_WIDTHS = [0, 7, 12, 20, 32];
+
+function decodeLogBlock(buffer) {
+    var view = new DataView(buffer);
+    var records = [];
+
+    if ((buffer.byteLength < LOG_BLOCK_HEADER_SIZE) || (view.getUint32(0, true) != LOG_BLOCK_MAGIC) || (view.getUint8(4) != 1))
+        return records;
+
+    var fieldCount = view.getUint8(5);
+    var epoch = view.getUint32(8, true);
+    var delta = 0;
+    var values = new Array(fieldCount).fill(0);
+    var bytes = new Uint8Array(buffer, LOG_BLOCK_HEADER_SIZE);
+    var bitLength = bytes.length * 8;
+    var position = 0;
+
+    function readBits(count) {
+        var value = 0;
+
+        if ((position + count) > bitLength)
+            return null;
+
+        for (var i = 0; i < count; i++) {
+            value = (value * 2) + ((bytes[position >> 3] >> (7 - (position & 7))) & 1);
+            position++;
+        }
+
+        return value;
+    }
+
+    function readCode() {
+        var codeClass = 0;
+
+        while (codeClass < 4) {
+            var bit = readBits(1);
+
+            if (bit === null)
+                return null;
+
+            if (bit == 0)
+                break;
+
+            codeClass++;
+        }
+
+        var zigZag = readBits(LOG_CODE_WIDTHS[codeClass]);
+
+        if (zigZag === null)
+            return null;
+
+        return (zigZag >>> 1) ^ -(zigZag & 1);
+    }
+
+    while (true) {
+        var deltaOfDelta = readCode();
+        var record = [];
+
+        if (deltaOfDelta === null)
+            break;
+
+        for (var i = 0; i < fieldCount; i++) {
+            var difference = readCode();
+
+            if (difference === null)
+                return records;
+
+            record.push((values[i] + difference) | 0);
+        }
+
+        // 32 bit arithmetic like the encoder
+        delta = (delta + deltaOfDelta) | 0;
+        epoch = (epoch + delta) >>> 0;
+        values = record;
+        records.push([epoch].concat(record));
+    }
+
+    return records;
+}
@@ -1,26 +1,55 @@
 var dataArray = [];
+var totalPulses = 0;
 
-loadCSV(); // Download the CSV data, load Google Charts, parse the data, and draw the chart
+const PULSES_PER_KILOWATT_HOUR = 10000;
 
-function loadCSV() {
+loadLog(); // Download the compressed log blocks, load Google Charts, decode the data, and draw the chart
+
+function loadLog() {
     var xmlhttp = new XMLHttpRequest();
     xmlhttp.onreadystatechange = function() {
         if (this.readyState == 4 && this.status == 200) {
-            var lines = this.responseText.split("\n");
+            var blocks = JSON.parse(this.responseText).blocks;
+            loadBlocks(blocks, 0);
+        }
+    };
+    xmlhttp.open("GET", "log/index", true);
+    xmlhttp.send();
+}
+
+// Blocks are fetched one after the other so the records stay in time order
+function loadBlocks(blocks, index) {
+    if (index >= blocks.length) {
+        document.getElementById("elements").innerText = dataArray.length + " (" + (totalPulses / PULSES_PER_KILOWATT_HOUR).toFixed(3) + " kWh)";
+        google.charts.load('current', { 'packages': ['line', 'corechart'] });
+        google.charts.setOnLoadCallback(drawChart);
+        return;
+    }
+
+    var xmlhttp = new XMLHttpRequest();
+    xmlhttp.responseType = "arraybuffer";
+    xmlhttp.onreadystatechange = function() {
+        if (this.readyState == 4) {
+            if (this.status == 200) {
+                // epoch, then mean, pulses, min, max per channel; the chart shows the first
+                var records = decodeLogBlock(this.response);
+
+                for (var i = 0; i < records.length; i++) {
+                    var data = [];
+                    data[0] = new Date(records[i][0] * 1000);
+                    data[1] = records[i][1];
+                    data[2] = records[i][3];
+                    data[3] = records[i][4];
+                    dataArray.push(data);
 
-            for (var i = 0; i < lines.length; i++) {
-                var data = lines[i].split(",", 2);
-                data[0] = new Date(parseInt(data[0]) * 1000);
-                data[1] = parseFloat(data[1]);
-                dataArray.push(data);    
+                    totalPulses += records[i][2];
+                }
             }
 
-            document.getElementById("elements").innerText = dataArray.length;
-            google.charts.load('current', { 'packages': ['line', 'corechart'] });
-            google.charts.setOnLoadCallback(drawChart);
+            loadBlocks(blocks, index + 1);
         }
     };
-    xmlhttp.open("GET", "log.csv", true);
+    xmlhttp.open("GET", blocks[index].path.substring(1), true);
     xmlhttp.send();
 }
 
@@ -28,6 +57,8 @@ function drawChart() {
     var data = new google.visualization.DataTable();
     data.addColumn('datetime', 'unix');
     data.addColumn('number', 'Watts');
+    data.addColumn('number', 'Min');
+    data.addColumn('number', 'Max');
 
     data.addRows(dataArray);
 
@@ -0,0 +1,16 @@
+#ifndef UI_FRAME_TARIFF
+#define UI_FRAME_TARIFF
+
+#include "Arduino.h"
+
+#include <OLEDDisplay.h>
+#include <OLEDDisplayFonts.h>
+#include <OLEDDisplayUi.h>
+
+//=============================================================================
+// Prototypes
+//=============================================================================
+
+void uiFrameTariff(OLEDDisplay *display, OLEDDisplayUiState* state, int16_t x, int16_t y);
+
+#endif // UI_FRAME_TARIFF
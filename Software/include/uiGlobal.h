@@ -7,9 +7,11 @@
 #include <OLEDDisplayFonts.h>
 #include <OLEDDisplayUi.h>
 
-#include <DHTesp.h>
 #include <batteryHistogram.h>
 #include <impulseCapture.h>
+#include <sensorCache.h>
+#include <tariffLedger.h>
+#include <timeService.h>
 
 //=============================================================================
 // Types
@@ -23,10 +25,12 @@ typedef enum {
 
 typedef struct {
 
-    TempAndHumidity *dhtTempAndHumidity_p;
+    SensorCache *sensor_p;
     BatteryHistogram *battery_p;
     ImpulseCapture *impulse_p;
     bool *logUpdate_p;
+    TariffLedger *tariff_p;
+    TimeService *time_p;
 
 } uiGlobalObject_s;
 
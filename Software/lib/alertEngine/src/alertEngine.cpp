@@ -0,0 +1,187 @@
+#include "alertEngine.h"
+
+//=============================================================================
+// Object constructors
+//=============================================================================
+
+AlertEngine::AlertEngine(void) {
+    memset(_rules, 0, sizeof(_rules));
+    memset(_states, 0, sizeof(_states));
+    memset(_events, 0, sizeof(_events));
+    _sequence = 0;
+}
+
+//=============================================================================
+// Private functions
+//=============================================================================
+
+void AlertEngine::_Raise(uint8_t index, uint32_t epoch, int32_t watts, bool raised) {
+    alertEvent_s *event = &_events[_sequence % ALERT_EVENTS_MAX];
+
+    event->sequence = _sequence;
+    event->epoch = epoch;
+    event->watts = watts;
+    event->rule = index;
+    event->type = _rules[index].type;
+    event->raised = raised;
+    event->reserved = 0;
+
+    _sequence++;
+}
+
+// The window may wrap midnight, 22 to 5 covers 22:00 until 04:59; the epoch
+// already includes the UTC offset
+bool AlertEngine::_InNightWindow(const alertRule_s *rule, uint32_t epoch) {
+    uint8_t hour = (epoch % ALERT_SECONDS_PER_DAY) / ALERT_SECONDS_PER_HOUR;
+
+    if (rule->startHour <= rule->endHour)
+        return (hour >= rule->startHour) && (hour < rule->endHour);
+
+    return (hour >= rule->startHour) || (hour < rule->endHour);
+}
+
+// True once the condition held on every update for ALERT_CONFIRM_MS
+bool AlertEngine::_Confirmed(_ruleState_s *state, bool condition, uint32_t now) {
+    if (condition == false) {
+        state->confirming = false;
+        return false;
+    }
+
+    if (state->confirming == false) {
+        state->confirming = true;
+        state->confirmSince = now;
+    }
+
+    if ((now - state->confirmSince) < ALERT_CONFIRM_MS)
+        return false;
+
+    state->confirming = false;
+
+    return true;
+}
+
+//=============================================================================
+// Public functions
+//=============================================================================
+
+// A changed rule starts over, latched state of the previous one is dropped
+void AlertEngine::SetRule(uint8_t index, const alertRule_s *rule) {
+    if (index >= ALERT_RULES_MAX)
+        return;
+
+    _rules[index] = *rule;
+    memset(&_states[index], 0, sizeof(_states[index]));
+}
+
+const alertRule_s *AlertEngine::GetRule(uint8_t index) {
+    return (index < ALERT_RULES_MAX) ? &_rules[index] : NULL;
+}
+
+bool AlertEngine::IsActive(uint8_t index) {
+    return (index < ALERT_RULES_MAX) && _states[index].active;
+}
+
+// Evaluates every rule against one power update, now in milli-seconds and
+// epoch 0 while the time is unknown. Returns the beeps of the loudest rule
+// raised by this update, 0 when none was.
+uint8_t AlertEngine::Update(uint32_t now, uint32_t epoch, uint32_t watts) {
+    uint8_t beeps = 0;
+
+    for (uint8_t i = 0; i < ALERT_RULES_MAX; i++) {
+        const alertRule_s *rule = &_rules[i];
+        _ruleState_s *state = &_states[i];
+        uint32_t clearWatts = rule->watts - ((rule->watts * ALERT_HYSTERESIS_PERCENT) / 100);
+        bool raised = false;
+
+        switch (rule->type) {
+            case alertRuleAbove:
+                if (_Confirmed(state, (state->active == false) ? (watts >= rule->watts) : (watts < clearWatts), now) == true) {
+                    state->active = !state->active;
+                    raised = state->active;
+                    _Raise(i, epoch, watts, state->active);
+                }
+                break;
+
+            case alertRuleSustained:
+                if (_Confirmed(state, watts < clearWatts, now) == true) {
+                    if (state->active == true)
+                        _Raise(i, epoch, watts, false);
+
+                    state->active = false;
+                    state->seeded = false;
+                } else if (watts >= rule->watts) {
+                    // Only a confirmed dip below the hysteresis restarts the
+                    // duration
+                    if (state->seeded == false) {
+                        state->seeded = true;
+                        state->since = now;
+                    }
+
+                    if ((state->active == false) && ((now - state->since) >= (rule->duration * 1000UL))) {
+                        state->active = true;
+                        raised = true;
+                        _Raise(i, epoch, watts, true);
+                    }
+                }
+                break;
+
+            case alertRuleStep:
+                // The reference follows drifts of less than half a step per
+                // update, so a step spread over a few averaged pulses still
+                // counts as one
+                if (state->seeded == false) {
+                    state->seeded = true;
+                    state->reference = watts;
+                } else if ((uint32_t)abs((int32_t)(watts - state->reference)) >= rule->watts) {
+                    raised = true;
+                    _Raise(i, epoch, (int32_t)(watts - state->reference), true);
+                    state->reference = watts;
+                } else if ((uint32_t)abs((int32_t)(watts - state->reference)) < (rule->watts / 2)) {
+                    state->reference = watts;
+                }
+                break;
+
+            case alertRuleNightBaseload:
+                if (epoch == 0)
+                    break;
+
+                // Lowest watts of the window, reported once it has passed
+                if (_InNightWindow(rule, epoch) == true) {
+                    if (state->inWindow == false) {
+                        state->inWindow = true;
+                        state->reference = watts;
+                    }
+
+                    state->reference = min(state->reference, watts);
+                } else if (state->inWindow == true) {
+                    state->inWindow = false;
+
+                    if (state->reference > rule->watts) {
+                        raised = true;
+                        _Raise(i, epoch, state->reference, true);
+                    }
+                }
+                break;
+
+            default:
+                break;
+        }
+
+        if (raised == true)
+            beeps = max(beeps, rule->beeps);
+    }
+
+    return beeps;
+}
+
+uint32_t AlertEngine::GetSequence(void) {
+    return _sequence;
+}
+
+// Events older than the last ALERT_EVENTS_MAX are gone, NULL then
+const alertEvent_s *AlertEngine::GetEvent(uint32_t sequence) {
+    if ((sequence >= _sequence) || ((_sequence - sequence) > ALERT_EVENTS_MAX))
+        return NULL;
+
+    return &_events[sequence % ALERT_EVENTS_MAX];
+}
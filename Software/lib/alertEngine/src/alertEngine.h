@@ -0,0 +1,102 @@
+#ifndef ALERT_ENGINE_H
+#define ALERT_ENGINE_H
+
+#include "Arduino.h"
+
+//=============================================================================
+// Defines
+//=============================================================================
+
+#define ALERT_RULES_MAX                     8
+#define ALERT_EVENTS_MAX                    8       // most recent events kept for clients
+#define ALERT_HYSTERESIS_PERCENT            5       // a raised limit clears this far below it
+#define ALERT_CONFIRM_MS                    5000    // a limit rule changes state once its condition held this long
+#define ALERT_SECONDS_PER_DAY               86400
+#define ALERT_SECONDS_PER_HOUR              3600
+
+//=============================================================================
+// Types
+//=============================================================================
+
+typedef enum {
+
+    alertRuleNone = 0,                  // slot unused
+    alertRuleAbove,                     // watts at or above the limit
+    alertRuleSustained,                 // above the limit for the duration
+    alertRuleStep,                      // watts moved by the limit from the settled level
+    alertRuleNightBaseload,             // lowest watts of the night window above the limit
+
+} alertRuleType_e;
+
+typedef struct {
+
+    uint8_t type;                       // alertRuleType_e
+    uint8_t beeps;                      // beeper pattern on raise, 0 = silent
+    uint8_t startHour;                  // night window, local time
+    uint8_t endHour;
+    uint16_t duration;                  // seconds, sustained rules
+    uint16_t reserved;
+    uint32_t watts;                     // limit, step size or baseload
+
+} alertRule_s;
+
+typedef struct {
+
+    uint32_t sequence;
+    uint32_t epoch;                     // 0 while the time is not known
+    int32_t watts;                      // watts, signed step or night minimum
+    uint8_t rule;
+    uint8_t type;                       // alertRuleType_e
+    uint8_t raised;                     // 0 when a latched rule clears
+    uint8_t reserved;
+
+} alertEvent_s;
+
+//=============================================================================
+// Classes
+//=============================================================================
+
+// Rules are evaluated against each power update with a fixed amount of state
+// per rule, so an update costs O(rules) and never looks back at history.
+// Limit rules latch until the watts drop below the hysteresis, and only change
+// state once the condition held for ALERT_CONFIRM_MS so a single noisy reading
+// can't flip them; step and night rules report single events.
+class AlertEngine
+{
+    public:
+        AlertEngine(void);
+
+        void SetRule(uint8_t index, const alertRule_s *rule);
+        const alertRule_s *GetRule(uint8_t index);
+        bool IsActive(uint8_t index);
+
+        uint8_t Update(uint32_t now, uint32_t epoch, uint32_t watts);
+
+        uint32_t GetSequence(void);
+        const alertEvent_s *GetEvent(uint32_t sequence);
+
+    private:
+        typedef struct {
+
+            bool active;
+            bool seeded;                // reference holds a value
+            bool inWindow;
+            bool confirming;
+            uint32_t since;             // milli-seconds, first update over the limit
+            uint32_t confirmSince;      // milli-seconds, first update meeting the change
+            uint32_t reference;         // settled watts, or the night minimum
+
+        } _ruleState_s;
+
+        void _Raise(uint8_t index, uint32_t epoch, int32_t watts, bool raised);
+        bool _InNightWindow(const alertRule_s *rule, uint32_t epoch);
+        bool _Confirmed(_ruleState_s *state, bool condition, uint32_t now);
+
+        alertRule_s _rules[ALERT_RULES_MAX];
+        _ruleState_s _states[ALERT_RULES_MAX];
+
+        alertEvent_s _events[ALERT_EVENTS_MAX];
+        uint32_t _sequence;             // of the next event
+};
+
+#endif // ALERT_ENGINE_H
@@ -0,0 +1,328 @@
+#include "applianceDetector.h"
+
+#include <coredecls.h>
+
+//=============================================================================
+// Object constructors
+//=============================================================================
+
+ApplianceDetector::ApplianceDetector(void) {
+    _minimumStep = APPLIANCE_DEFAULT_MINIMUM_STEP;
+    _seeded = false;
+    _level = 0;
+    _levelCount = 0;
+    _cusumUp = 0;
+    _cusumDown = 0;
+    _upSum = 0;
+    _upCount = 0;
+    _upLevelCount = 0;
+    _upStart = 0;
+    _downSum = 0;
+    _downCount = 0;
+    _downLevelCount = 0;
+    _downStart = 0;
+    _runningCount = 0;
+    _sequence = 0;
+
+    memset(_signatures, 0, sizeof(_signatures));
+    memset(_running, 0, sizeof(_running));
+    memset(_events, 0, sizeof(_events));
+}
+
+//=============================================================================
+// Private functions
+//=============================================================================
+
+bool ApplianceDetector::_Matches(uint32_t reference, uint32_t watts) {
+    uint32_t tolerance = max<uint32_t>(APPLIANCE_MATCH_WATTS, (reference * APPLIANCE_MATCH_PERCENT) / 100);
+
+    return ((watts > reference) ? (watts - reference) : (reference - watts)) <= tolerance;
+}
+
+// Closest signature of the step, a new one when none is close; the least
+// seen signature makes room when the table is full
+uint8_t ApplianceDetector::_Classify(uint32_t step, uint32_t epoch) {
+    uint8_t best = APPLIANCE_SIGNATURE_NONE;
+    uint32_t bestDistance = UINT32_MAX;
+    uint8_t spare = 0;
+
+    for (uint8_t i = 0; i < APPLIANCE_SIGNATURES_MAX; i++) {
+        applianceSignature_s *signature = &_signatures[i];
+        uint32_t distance = (step > signature->watts) ? (step - signature->watts) : (signature->watts - step);
+
+        if (signature->count < _signatures[spare].count)
+            spare = i;
+
+        if ((signature->count > 0) && (_Matches(signature->watts, step) == true) && (distance < bestDistance)) {
+            best = i;
+            bestDistance = distance;
+        }
+    }
+
+    if (best == APPLIANCE_SIGNATURE_NONE) {
+        best = spare;
+        memset(&_signatures[best], 0, sizeof(_signatures[best]));
+        _signatures[best].watts = step;
+    }
+
+    applianceSignature_s *signature = &_signatures[best];
+
+    signature->count++;
+    signature->watts += ((int32_t)(step - signature->watts)) / (int32_t)min<uint32_t>(signature->count, APPLIANCE_LEVEL_SAMPLES);
+    signature->lastEpoch = epoch;
+
+    return best;
+}
+
+// A switch on is classified and waits for its off; an off is paired with the
+// running appliance of the closest step
+void ApplianceDetector::_AddEvent(uint32_t now, uint32_t epoch, int32_t step) {
+    applianceEvent_s *event = &_events[_sequence % APPLIANCE_EVENTS_MAX];
+
+    memset(event, 0, sizeof(*event));
+    event->sequence = _sequence;
+    event->epoch = epoch;
+    event->step = step;
+    event->level = _level;
+    event->signature = APPLIANCE_SIGNATURE_NONE;
+
+    if (step > 0) {
+        event->signature = _Classify(step, epoch);
+
+        // The oldest is forgotten when more are running than tracked
+        if (_runningCount >= APPLIANCE_RUNNING_MAX) {
+            memmove(&_running[0], &_running[1], sizeof(_running[0]) * (APPLIANCE_RUNNING_MAX - 1));
+            _runningCount--;
+        }
+
+        _running[_runningCount].signature = event->signature;
+        _running[_runningCount].step = step;
+        _running[_runningCount].startTime = now;
+        _runningCount++;
+    } else {
+        uint32_t drop = -step;
+        uint8_t best = APPLIANCE_RUNNING_MAX;
+        uint32_t bestDistance = UINT32_MAX;
+
+        for (uint8_t i = 0; i < _runningCount; i++) {
+            uint32_t distance = (drop > _running[i].step) ? (drop - _running[i].step) : (_running[i].step - drop);
+
+            if ((_Matches(_running[i].step, drop) == true) && (distance < bestDistance)) {
+                best = i;
+                bestDistance = distance;
+            }
+        }
+
+        if (best < _runningCount) {
+            event->signature = _running[best].signature;
+            event->duration = (now - _running[best].startTime) / 1000;
+
+            if (event->signature != APPLIANCE_SIGNATURE_NONE)
+                _signatures[event->signature].onSeconds += event->duration;
+
+            memmove(&_running[best], &_running[best + 1], sizeof(_running[0]) * (_runningCount - best - 1));
+            _runningCount--;
+        }
+    }
+
+    _sequence++;
+
+    _Save();
+}
+
+bool ApplianceDetector::_Save(void) {
+    applianceSignatureFile_s signatureFile;
+
+    signatureFile.magic = APPLIANCE_SIGNATURE_MAGIC;
+    memcpy(signatureFile.signatures, _signatures, sizeof(_signatures));
+    signatureFile.crc = crc32(signatureFile.signatures, sizeof(signatureFile.signatures));
+
+    File file = LittleFS.open(APPLIANCE_SIGNATURE_PATH, "w");
+
+    if (!file)
+        return false;
+
+    size_t written = file.write((const uint8_t *)&signatureFile, sizeof(signatureFile));
+    file.close();
+
+    return (written == sizeof(signatureFile));
+}
+
+//=============================================================================
+// Public functions
+//=============================================================================
+
+void ApplianceDetector::SetMinimumStep(uint32_t watts) {
+    _minimumStep = max<uint32_t>(watts, 1);
+}
+
+// Signatures learnt before the reset, they are saved with every event
+bool ApplianceDetector::Begin(void) {
+    applianceSignatureFile_s signatureFile;
+
+    File file = LittleFS.open(APPLIANCE_SIGNATURE_PATH, "r");
+
+    if (!file)
+        return false;
+
+    bool valid = (file.read((uint8_t *)&signatureFile, sizeof(signatureFile)) == sizeof(signatureFile)) &&
+                 (signatureFile.magic == APPLIANCE_SIGNATURE_MAGIC) &&
+                 (crc32(signatureFile.signatures, sizeof(signatureFile.signatures)) == signatureFile.crc);
+
+    file.close();
+
+    if (valid == false)
+        return false;
+
+    memcpy(_signatures, signatureFile.signatures, sizeof(_signatures));
+
+    for (uint8_t i = 0; i < APPLIANCE_SIGNATURES_MAX; i++) {
+        _signatures[i].name[APPLIANCE_NAME_MAX - 1] = '\0';
+    }
+
+    return true;
+}
+
+// One pulse interval worth of watts, now in milli-seconds and epoch 0 while
+// the time is unknown. Returns true when it completed a step.
+bool ApplianceDetector::Update(uint32_t now, uint32_t epoch, uint32_t watts) {
+    if (_seeded == false) {
+        _seeded = true;
+        _level = watts;
+        _levelCount = 1;
+        return false;
+    }
+
+    // Deviations within half a minimum step are noise; beyond it they add up
+    // on their side until a step is certain
+    int32_t slack = _minimumStep / 2;
+    int32_t deviation = (int32_t)watts - (int32_t)_level;
+
+    _cusumUp = max<int32_t>(0, _cusumUp + deviation - slack);
+    _cusumDown = max<int32_t>(0, _cusumDown - deviation - slack);
+
+    // The first interval straddles the switch and one still within the slack
+    // of the old level is a transition, the pulse filter may have merged two
+    // intervals while it adapts to the faster rate; neither is part of the
+    // new level
+    if (_cusumUp == 0) {
+        _upSum = 0;
+        _upCount = 0;
+        _upLevelCount = 0;
+    } else {
+        if (_upCount == 0) {
+            _upStart = now;
+        } else if (deviation > slack) {
+            _upSum += watts;
+            _upLevelCount++;
+        }
+
+        _upCount++;
+    }
+
+    if (_cusumDown == 0) {
+        _downSum = 0;
+        _downCount = 0;
+        _downLevelCount = 0;
+    } else {
+        if (_downCount == 0) {
+            _downStart = now;
+        } else if (-deviation > slack) {
+            _downSum += watts;
+            _downLevelCount++;
+        }
+
+        _downCount++;
+    }
+
+    // Only a settled level follows drift, a change in progress would pull it along
+    if ((_cusumUp == 0) && (_cusumDown == 0)) {
+        _levelCount = min<uint32_t>(_levelCount + 1, APPLIANCE_LEVEL_SAMPLES);
+        _level += deviation / (int32_t)_levelCount;
+        return false;
+    }
+
+    int32_t threshold = _minimumStep * 2;
+    uint32_t newLevel;
+    uint32_t count;
+    uint32_t start;
+
+    if ((_cusumUp > threshold) && (_upLevelCount >= APPLIANCE_CONFIRM_SAMPLES - 1)) {
+        newLevel = _upSum / _upLevelCount;
+        count = _upCount;
+        start = _upStart;
+    } else if ((_cusumDown > threshold) && (_downLevelCount >= APPLIANCE_CONFIRM_SAMPLES - 1)) {
+        newLevel = _downSum / _downLevelCount;
+        count = _downCount;
+        start = _downStart;
+    } else {
+        return false;
+    }
+
+    // The level moves either way, a drift too small for a step just settles
+    int32_t step = (int32_t)newLevel - (int32_t)_level;
+
+    _level = newLevel;
+    _levelCount = min<uint32_t>(count, APPLIANCE_LEVEL_SAMPLES);
+    _cusumUp = 0;
+    _cusumDown = 0;
+    _upSum = 0;
+    _upCount = 0;
+    _upLevelCount = 0;
+    _downSum = 0;
+    _downCount = 0;
+    _downLevelCount = 0;
+
+    if ((uint32_t)abs(step) < _minimumStep)
+        return false;
+
+    // Stamped with the first interval at the new level
+    _AddEvent(start, (epoch != 0) ? (epoch - ((now - start) / 1000)) : 0, step);
+
+    return true;
+}
+
+uint32_t ApplianceDetector::GetLevel(void) {
+    return _level;
+}
+
+uint32_t ApplianceDetector::GetRunningCount(void) {
+    return _runningCount;
+}
+
+const applianceSignature_s *ApplianceDetector::GetSignature(uint8_t index) {
+    return (index < APPLIANCE_SIGNATURES_MAX) ? &_signatures[index] : NULL;
+}
+
+bool ApplianceDetector::SetSignatureName(uint8_t index, const char *name) {
+    if ((index >= APPLIANCE_SIGNATURES_MAX) || (_signatures[index].count == 0))
+        return false;
+
+    strncpy(_signatures[index].name, name, APPLIANCE_NAME_MAX - 1);
+    _signatures[index].name[APPLIANCE_NAME_MAX - 1] = '\0';
+
+    return _Save();
+}
+
+bool ApplianceDetector::ClearSignatures(void) {
+    memset(_signatures, 0, sizeof(_signatures));
+
+    // Running appliances no longer have a signature to book their time to
+    for (uint8_t i = 0; i < _runningCount; i++) {
+        _running[i].signature = APPLIANCE_SIGNATURE_NONE;
+    }
+
+    return _Save();
+}
+
+uint32_t ApplianceDetector::GetSequence(void) {
+    return _sequence;
+}
+
+// Events older than the last APPLIANCE_EVENTS_MAX are gone, NULL then
+const applianceEvent_s *ApplianceDetector::GetEvent(uint32_t sequence) {
+    if ((sequence >= _sequence) || ((_sequence - sequence) > APPLIANCE_EVENTS_MAX))
+        return NULL;
+
+    return &_events[sequence % APPLIANCE_EVENTS_MAX];
+}
@@ -0,0 +1,135 @@
+#ifndef APPLIANCE_DETECTOR_H
+#define APPLIANCE_DETECTOR_H
+
+#include "Arduino.h"
+
+#include <FS.h>
+#include <LittleFS.h>
+
+//=============================================================================
+// Defines
+//=============================================================================
+
+#define APPLIANCE_EVENTS_MAX                16      // most recent events kept for clients
+#define APPLIANCE_SIGNATURES_MAX            8
+#define APPLIANCE_RUNNING_MAX               8       // switched on, waiting for the matching off
+#define APPLIANCE_NAME_MAX                  12
+#define APPLIANCE_SIGNATURE_NONE            0xFF
+
+// A change needs this many pulse intervals at the new level before it counts,
+// a single odd interval is not an appliance
+#define APPLIANCE_CONFIRM_SAMPLES           3
+
+// The steady level follows slow drift as a running mean over this many
+// intervals
+#define APPLIANCE_LEVEL_SAMPLES             32
+
+// A step matches a signature or a running appliance within this many watts
+// or percent of it, whichever is larger
+#define APPLIANCE_MATCH_WATTS               20
+#define APPLIANCE_MATCH_PERCENT             8
+
+#define APPLIANCE_DEFAULT_MINIMUM_STEP      50
+
+#define APPLIANCE_SIGNATURE_PATH            "/appliances.bin"
+#define APPLIANCE_SIGNATURE_MAGIC           0x41505031  // "APP1"
+
+//=============================================================================
+// Types
+//=============================================================================
+
+typedef struct {
+
+    uint32_t sequence;
+    uint32_t epoch;                     // 0 while the time is not known
+    int32_t step;                       // watts, negative when switched off
+    uint32_t level;                     // watts after the step
+    uint32_t duration;                  // seconds on, off events matched to their on event
+    uint8_t signature;                  // APPLIANCE_SIGNATURE_NONE when not recognised
+    uint8_t reserved[3];
+
+} applianceEvent_s;
+
+typedef struct {
+
+    char name[APPLIANCE_NAME_MAX];      // empty until named
+    uint32_t watts;                     // mean switch on step
+    uint32_t count;                     // switch ons seen
+    uint32_t onSeconds;                 // summed over matched off events
+    uint32_t lastEpoch;
+
+} applianceSignature_s;
+
+typedef struct {
+
+    uint32_t magic;
+    uint32_t crc;
+    applianceSignature_s signatures[APPLIANCE_SIGNATURES_MAX];
+
+} applianceSignatureFile_s;
+
+//=============================================================================
+// Classes
+//=============================================================================
+
+// Streaming change point detection on the pulse interval series. A two sided
+// CUSUM against the steady level finds switch on and off steps; ons are
+// clustered by step size into a signature table and paired with the off of
+// similar size for their duration. All state is fixed size.
+class ApplianceDetector
+{
+    public:
+        ApplianceDetector(void);
+
+        void SetMinimumStep(uint32_t watts);
+        bool Begin(void);
+        bool Update(uint32_t now, uint32_t epoch, uint32_t watts);
+
+        uint32_t GetLevel(void);
+        uint32_t GetRunningCount(void);
+        const applianceSignature_s *GetSignature(uint8_t index);
+        bool SetSignatureName(uint8_t index, const char *name);
+        bool ClearSignatures(void);
+
+        uint32_t GetSequence(void);
+        const applianceEvent_s *GetEvent(uint32_t sequence);
+
+    private:
+        typedef struct {
+
+            uint8_t signature;
+            uint32_t step;
+            uint32_t startTime;         // milli-seconds
+
+        } _running_s;
+
+        bool _Matches(uint32_t reference, uint32_t watts);
+        uint8_t _Classify(uint32_t step, uint32_t epoch);
+        void _AddEvent(uint32_t now, uint32_t epoch, int32_t step);
+        bool _Save(void);
+
+        uint32_t _minimumStep;
+
+        bool _seeded;
+        uint32_t _level;
+        uint32_t _levelCount;
+        int32_t _cusumUp;
+        int32_t _cusumDown;
+        uint32_t _upSum;
+        uint32_t _upCount;
+        uint32_t _upLevelCount;
+        uint32_t _upStart;
+        uint32_t _downSum;
+        uint32_t _downCount;
+        uint32_t _downLevelCount;
+        uint32_t _downStart;
+
+        applianceSignature_s _signatures[APPLIANCE_SIGNATURES_MAX];
+        _running_s _running[APPLIANCE_RUNNING_MAX];
+        uint8_t _runningCount;
+
+        applianceEvent_s _events[APPLIANCE_EVENTS_MAX];
+        uint32_t _sequence;
+};
+
+#endif // APPLIANCE_DETECTOR_H
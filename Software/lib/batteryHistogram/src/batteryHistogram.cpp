@@ -76,3 +76,8 @@ void BatteryHistogram::Update() {
 uint16_t * BatteryHistogram::GetBatteryHistogram(void) {
     return (this->_batteryVoltageSamples);
 }
+
+// Latest ADC reading, low pass filtered when enabled
+uint16_t BatteryHistogram::GetBatteryLevel(void) {
+    return (_filterVoltage == true) ? (uint16_t)_filteredVoltage : _lastSampleValue;
+}
@@ -27,6 +27,7 @@ class BatteryHistogram
         void Init(void);
         void Update();
         uint16_t *GetBatteryHistogram(void);
+        uint16_t GetBatteryLevel(void);
 
     private:
         uint16_t _batteryVoltageSamples[BATTERY_VOLTAGE_SAMPLES_MAX];
@@ -39,6 +39,7 @@ NOTE!
  Contact: raronzen@gmail.com
 
  History:
+ 2026.10.19 - Added edge interrupt mode with a time stamped edge queue
  2020.01.22 - Added support for ESP8266
  2019.11.05 - Added support for ATTiny85 DigiSpark-Tiny USB
  2013.08.29 - Some small clean-up of code, more sensible variable names etc.
@@ -66,6 +67,11 @@ ClickButton::ClickButton(uint8_t buttonPin)
   debounceTime   = 20;            // Debounce timer in ms
   multiclickTime = 250;           // Time limit for multi clicks
   longClickTime  = 1000;          // time until long clicks register
+  _interruptMode = false;
+  _edgeHead      = 0;
+  _edgeTail      = 0;
+  _edgeOverflow  = false;
+  _resultCount   = 0;
   pinMode(_pin, INPUT);
 }
 
@@ -83,6 +89,11 @@ ClickButton::ClickButton(uint8_t buttonPin, boolean activeType)
   debounceTime   = 20;            // Debounce timer in ms
   multiclickTime = 250;           // Time limit for multi clicks
   longClickTime  = 1000;          // time until long clicks register
+  _interruptMode = false;
+  _edgeHead      = 0;
+  _edgeTail      = 0;
+  _edgeOverflow  = false;
+  _resultCount   = 0;
   pinMode(_pin, INPUT);
 }
 
@@ -99,6 +110,11 @@ ClickButton::ClickButton(uint8_t buttonPin, boolean activeType, boolean internal
   debounceTime   = 20;            // Debounce timer in ms
   multiclickTime = 250;           // Time limit for multi clicks
   longClickTime  = 1000;          // time until "long" click register
+  _interruptMode = false;
+  _edgeHead      = 0;
+  _edgeTail      = 0;
+  _edgeOverflow  = false;
+  _resultCount   = 0;
 
   // Turn on internal pullup resistor if applicable
   if (_activeHigh == LOW && internalPullup == CLICKBTN_PULLUP)
@@ -116,6 +132,62 @@ ClickButton::ClickButton(uint8_t buttonPin, boolean activeType, boolean internal
 void ClickButton::Update()
 {
   long now = (long)millis();      // get current time
+
+  if (_interruptMode)
+  {
+    // Replay the queued edges at their own time, then the time since the last
+    uint8_t tail = _edgeTail;
+
+    clicks = 0;
+
+    while (tail != _edgeHead)
+    {
+      boolean level = _edges[tail].level;
+      long edgeTime = (long)_edges[tail].time;
+
+      if (!_activeHigh) level = !level;
+
+      if (level != _lastState)
+      {
+        _Settle(edgeTime);
+        _lastBounceTime = edgeTime;
+        _lastState = level;
+        _btnState = level;
+      }
+
+      tail = (tail + 1) % CLICKBTN_EDGE_QUEUE;
+      _edgeTail = tail;
+    }
+
+    // Edges were lost, carry on from the level the pin has now
+    if (_edgeOverflow)
+    {
+      boolean level = digitalRead(_pin);
+
+      _edgeOverflow = false;
+      if (!_activeHigh) level = !level;
+
+      if (level != _lastState)
+      {
+        _Settle(now);
+        _lastBounceTime = now;
+        _lastState = level;
+        _btnState = level;
+      }
+    }
+
+    _Settle(now);
+
+    if (_resultCount > 0)
+    {
+      clicks = _results[0];
+      _resultCount--;
+      memmove(&_results[0], &_results[1], _resultCount * sizeof(_results[0]));
+    }
+
+    return;
+  }
+
   _btnState = digitalRead(_pin);  // current appearant button state
 
   // Make the button logic active-high in code
@@ -150,3 +222,78 @@ void ClickButton::Update()
 
   _lastState = _btnState;
 }
+
+
+
+void ClickButton::EnableInterrupt()
+{
+  // Start from the level the pin has, there is no edge to learn it from
+  _btnState = digitalRead(_pin);
+  if (!_activeHigh) _btnState = !_btnState;
+  _lastState = _btnState;
+  depressed = _btnState;
+  _clickCount = 0;
+  _lastBounceTime = (long)millis();
+
+  _edgeHead = 0;
+  _edgeTail = 0;
+  _edgeOverflow = false;
+  _resultCount = 0;
+  _interruptMode = true;
+  attachInterruptArg(_pin, _EdgeInterrupt, this, CHANGE);
+}
+
+
+void IRAM_ATTR ClickButton::_EdgeInterrupt(void *button)
+{
+  ClickButton *self = (ClickButton *)button;
+  uint8_t head = self->_edgeHead;
+  uint8_t next = (head + 1) % CLICKBTN_EDGE_QUEUE;
+
+  // A full queue keeps the older edges, Update() resynchronises from the pin
+  if (next == self->_edgeTail)
+  {
+    self->_edgeOverflow = true;
+    return;
+  }
+
+  self->_edges[head].time = millis();
+  self->_edges[head].level = digitalRead(self->_pin);
+  self->_edgeHead = next;
+}
+
+
+// Same decoding as the polled Update(), for the stable state since the last
+// edge up to the given time
+void ClickButton::_Settle(long now)
+{
+  // debounce the button (Check if a stable, changed state has occured)
+  if (now - _lastBounceTime > debounceTime && _btnState != depressed)
+  {
+    depressed = _btnState;
+    if (depressed) _clickCount++;
+  }
+
+  // If the button released state is stable, report nr of clicks and start new cycle
+  if (!depressed && (now - _lastBounceTime) > multiclickTime && _clickCount != 0)
+  {
+    _Report(_clickCount);
+    _clickCount = 0;
+  }
+
+  // Check for "long click"
+  if (depressed && (now - _lastBounceTime > longClickTime) && _clickCount != 0)
+  {
+    _Report(0 - _clickCount);
+    _clickCount = 0;
+  }
+}
+
+
+void ClickButton::_Report(int clickCount)
+{
+  // Beyond the queue the newest result replaces the last one
+  if (_resultCount == CLICKBTN_RESULT_QUEUE) _resultCount--;
+
+  _results[_resultCount++] = clickCount;
+}
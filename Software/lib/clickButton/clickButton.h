@@ -8,6 +8,11 @@
   where LOW/HIGH denotes active LOW or HIGH button (default is LOW)
   CLICKBTN_PULLUP is only possible with active low buttons.
 
+ Interrupt mode: call EnableInterrupt() once after construction. Pin changes
+ are then time stamped in an interrupt and queued; Update() decodes the
+ queued edges by their time stamps, so clicks come out the same however
+ late Update() runs.
+
  Returned click counts:
 
    A positive number denotes the number of (short) clicks after a released button
@@ -39,6 +44,7 @@ NOTE!
  Contact: raronzen@gmail.com
 
  History:
+ 2026.10.19 - Added edge interrupt mode with a time stamped edge queue
  2013.08.29 - Some small clean-up of code, more sensible variable names etc.
                 Added another example code for multiple buttons in an object array
  2013.04.23 - A "minor" debugging: active-high buttons now work (wops)!
@@ -56,6 +62,9 @@ NOTE!
 
 #define CLICKBTN_PULLUP HIGH
 
+#define CLICKBTN_EDGE_QUEUE   32  // edges kept between two Update() calls, bounces included
+#define CLICKBTN_RESULT_QUEUE 4   // click results decoded in one Update(), reported one per call
+
 class ClickButton
 {
   public:
@@ -63,6 +72,7 @@ class ClickButton
     ClickButton(uint8_t buttonPin, boolean active);
     ClickButton(uint8_t buttonPin, boolean active, boolean internalPullup);
     void Update();
+    void EnableInterrupt();
     int clicks;                   // button click counts to return
     boolean depressed;            // the currently debounced button (press) state (presumably it is not sad :)
     long debounceTime;
@@ -75,6 +85,24 @@ class ClickButton
     boolean _lastState;           // previous button reading
     int _clickCount;              // Number of button clicks within multiclickTime milliseconds
     long _lastBounceTime;         // the last time the button input pin was toggled, due to noise or a press
+
+    // Interrupt mode
+    typedef struct {
+      uint32_t time;              // millis() of the edge
+      uint8_t level;              // pin level after the edge
+    } _edge_s;
+
+    static void _EdgeInterrupt(void *button);
+    void _Settle(long now);
+    void _Report(int clickCount);
+
+    boolean _interruptMode;
+    _edge_s _edges[CLICKBTN_EDGE_QUEUE];
+    volatile uint8_t _edgeHead;   // written by the interrupt
+    volatile uint8_t _edgeTail;
+    volatile boolean _edgeOverflow;
+    int _results[CLICKBTN_RESULT_QUEUE];
+    uint8_t _resultCount;
 };
 
 #endif // CLICK_BUTTON_H
@@ -0,0 +1,279 @@
+#include "configStore.h"
+
+#include <LittleFS.h>
+#include <coredecls.h>
+
+static const char *_slotPaths[CONFIG_STORE_SLOTS] = {CONFIG_STORE_SLOT_PATH_0, CONFIG_STORE_SLOT_PATH_1};
+
+//=============================================================================
+// Object constructors
+//=============================================================================
+
+ConfigStore::ConfigStore(void) {
+    _loaded = false;
+    _migrated = false;
+    _activeSlot = 0;
+    _sequence = 0;
+
+    SetDefaults();
+}
+
+//=============================================================================
+// Private functions
+//=============================================================================
+
+bool ConfigStore::_ReadSlot(uint8_t slot, configHeader_s *header, deviceConfig_s *config) {
+    File configFile = LittleFS.open(_slotPaths[slot], "r");
+
+    if (!configFile) {
+        return false;
+    }
+
+    bool valid = (configFile.read((uint8_t *)header, sizeof(*header)) == sizeof(*header)) &&
+                 (header->magic == CONFIG_STORE_MAGIC) &&
+                 (header->version <= CONFIG_STORE_VERSION) &&
+                 (header->size <= sizeof(*config)) &&
+                 (configFile.read((uint8_t *)config, header->size) == header->size);
+
+    configFile.close();
+
+    return (valid == true) && (crc32(config, header->size) == header->crc);
+}
+
+bool ConfigStore::_MigrateLegacy(bool importMeter) {
+    bool migrated = false;
+
+    // Meter block of the first configuration store, a bare header and struct
+    File meterFile = LittleFS.open(CONFIG_STORE_LEGACY_METER_PATH, "r");
+
+    if (meterFile && (importMeter == true)) {
+        struct {
+            uint32_t magic;
+            uint16_t version;
+            uint16_t size;
+        } legacyHeader;
+
+        meterConfig_s meterConfig;
+
+        if ((meterFile.read((uint8_t *)&legacyHeader, sizeof(legacyHeader)) == sizeof(legacyHeader)) &&
+            (legacyHeader.magic == CONFIG_STORE_MAGIC) &&
+            (legacyHeader.version == CONFIG_STORE_LEGACY_METER_VERSION) &&
+            (legacyHeader.size == sizeof(meterConfig)) &&
+            (meterFile.read((uint8_t *)&meterConfig, sizeof(meterConfig)) == sizeof(meterConfig)) &&
+            (meterConfig.channelCount >= 1) && (meterConfig.channelCount <= IMPULSE_CHANNELS_MAX)) {
+            _config.meter = meterConfig;
+            migrated = true;
+        }
+    }
+
+    if (meterFile)
+        meterFile.close();
+
+    // "ssid,password," as uploaded for station mode, still accepted through
+    // /upload so a device in access point mode can be provisioned
+    File wifiFile = LittleFS.open(CONFIG_STORE_LEGACY_WIFI_PATH, "r");
+
+    if (wifiFile) {
+        String ssid = wifiFile.readStringUntil(',');
+        String password = wifiFile.readStringUntil(',');
+
+        memset(_config.network.ssid, 0, CONFIG_SSID_MAX);
+        memset(_config.network.password, 0, CONFIG_PASSWORD_MAX);
+        strncpy(_config.network.ssid, ssid.c_str(), CONFIG_SSID_MAX - 1);
+        strncpy(_config.network.password, password.c_str(), CONFIG_PASSWORD_MAX - 1);
+        wifiFile.close();
+        migrated = true;
+    }
+
+    if ((migrated == true) && (Save() == true)) {
+        LittleFS.remove(CONFIG_STORE_LEGACY_METER_PATH);
+        LittleFS.remove(CONFIG_STORE_LEGACY_WIFI_PATH);
+    }
+
+    return migrated;
+}
+
+//=============================================================================
+// Public functions
+//=============================================================================
+
+void ConfigStore::SetDefaults(void) {
+    memset(&_config, 0, sizeof(_config));
+
+    strncpy(_config.network.hostname, CONFIG_DEFAULT_HOSTNAME, CONFIG_HOSTNAME_MAX - 1);
+    strncpy(_config.network.ntpServer, CONFIG_DEFAULT_NTP_SERVER, CONFIG_NTP_SERVER_MAX - 1);
+    _config.network.utcOffset = CONFIG_DEFAULT_UTC_OFFSET;
+
+    _config.meter.logInterval = CONFIG_DEFAULT_LOG_INTERVAL;
+    _config.meter.minimumWatt = MINIMUM_WATT_SUPPORTED;
+    _config.meter.maximumWatt = MAXIMUM_WATT_SUPPORTED;
+    _config.meter.estimator = impulseEstimatorAverage;
+    _config.meter.averagePulses = IMPULSE_AVERAGE_PULSES_DEFAULT;
+    _config.meter.decay = true;
+    _config.meter.channelCount = 1;
+
+    for (uint8_t i = 0; i < IMPULSE_CHANNELS_MAX; i++) {
+        _config.meter.channels[i].pin = IMPULSE_PIN_NONE;
+        _config.meter.channels[i].pulsesPerKilowattHour = PULSES_PER_KILOWATT_HOUR;
+        snprintf(_config.meter.channels[i].name, CONFIG_CHANNEL_NAME_MAX, "channel%u", i);
+    }
+
+    _config.meter.channels[0].pin = CONFIG_DEFAULT_SENSOR_PIN;
+    strncpy(_config.meter.channels[0].name, CONFIG_DEFAULT_CHANNEL_NAME, CONFIG_CHANNEL_NAME_MAX - 1);
+
+    _config.power.batchMode = false;
+    _config.power.sampleInterval = CONFIG_DEFAULT_SAMPLE_INTERVAL;
+    _config.power.flushInterval = CONFIG_DEFAULT_FLUSH_INTERVAL;
+    _config.power.awakeWindow = CONFIG_DEFAULT_AWAKE_WINDOW;
+
+    _config.mqtt.enabled = false;
+    _config.mqtt.qos = CONFIG_DEFAULT_MQTT_QOS;
+    _config.mqtt.batchSize = CONFIG_DEFAULT_MQTT_BATCH;
+    _config.mqtt.port = CONFIG_DEFAULT_MQTT_PORT;
+    strncpy(_config.mqtt.topic, CONFIG_DEFAULT_MQTT_TOPIC, CONFIG_MQTT_TOPIC_MAX - 1);
+
+    // One rate all week until a schedule is set
+    for (uint8_t i = 0; i < TARIFF_RATES_MAX; i++) {
+        snprintf(_config.tariff.rates[i].name, TARIFF_RATE_NAME_MAX, "rate%u", i);
+    }
+
+    strncpy(_config.tariff.rates[0].name, CONFIG_DEFAULT_TARIFF_RATE_NAME, TARIFF_RATE_NAME_MAX - 1);
+
+    _config.appliance.minimumStep = APPLIANCE_DEFAULT_MINIMUM_STEP;
+}
+
+bool ConfigStore::Load(void) {
+    configHeader_s header;
+    deviceConfig_s slotConfig;
+    bool slotFound = false;
+
+    _loaded = false;
+    _migrated = false;
+
+    // Newest slot with a valid CRC wins; a slot torn by a reset mid-write
+    // fails its CRC and the previous generation is used instead
+    for (uint8_t slot = 0; slot < CONFIG_STORE_SLOTS; slot++) {
+        SetDefaults();
+
+        if (_ReadSlot(slot, &header, &_config) == false) {
+            continue;
+        }
+
+        if ((slotFound == false) || ((int32_t)(header.sequence - _sequence) > 0)) {
+            slotConfig = _config;
+            _sequence = header.sequence;
+            _activeSlot = slot;
+            slotFound = true;
+        }
+    }
+
+    SetDefaults();
+
+    if (slotFound == true) {
+        _config = slotConfig;
+
+        // Strings and counts come from flash, never trust them unterminated
+        _config.network.ssid[CONFIG_SSID_MAX - 1] = '\0';
+        _config.network.password[CONFIG_PASSWORD_MAX - 1] = '\0';
+        _config.network.hostname[CONFIG_HOSTNAME_MAX - 1] = '\0';
+        _config.network.ntpServer[CONFIG_NTP_SERVER_MAX - 1] = '\0';
+
+        _config.mqtt.host[CONFIG_MQTT_HOST_MAX - 1] = '\0';
+        _config.mqtt.username[CONFIG_MQTT_USERNAME_MAX - 1] = '\0';
+        _config.mqtt.password[CONFIG_MQTT_PASSWORD_MAX - 1] = '\0';
+        _config.mqtt.topic[CONFIG_MQTT_TOPIC_MAX - 1] = '\0';
+        _config.mqtt.batchSize = constrain(_config.mqtt.batchSize, 1, CONFIG_MAXIMUM_MQTT_BATCH);
+
+        for (uint8_t i = 0; i < IMPULSE_CHANNELS_MAX; i++) {
+            _config.meter.channels[i].name[CONFIG_CHANNEL_NAME_MAX - 1] = '\0';
+        }
+
+        for (uint8_t i = 0; i < TARIFF_RATES_MAX; i++) {
+            _config.tariff.rates[i].name[TARIFF_RATE_NAME_MAX - 1] = '\0';
+        }
+
+        _config.meter.channelCount = constrain(_config.meter.channelCount, 1, IMPULSE_CHANNELS_MAX);
+        _loaded = true;
+    }
+
+    // A legacy meter block only matters before the first block is written
+    _migrated = _MigrateLegacy(slotFound == false);
+
+    return _loaded;
+}
+
+bool ConfigStore::Save(void) {
+    configHeader_s header;
+    uint8_t slot = (_loaded == true) ? (_activeSlot + 1) % CONFIG_STORE_SLOTS : _activeSlot;
+
+    header.magic = CONFIG_STORE_MAGIC;
+    header.version = CONFIG_STORE_VERSION;
+    header.size = sizeof(_config);
+    header.sequence = _sequence + 1;
+    header.crc = crc32(&_config, sizeof(_config));
+
+    File configFile = LittleFS.open(_slotPaths[slot], "w");
+
+    if (!configFile) {
+        return false;
+    }
+
+    size_t written = configFile.write((const uint8_t *)&header, sizeof(header));
+    written += configFile.write((const uint8_t *)&_config, sizeof(_config));
+    configFile.close();
+
+    if (written != (sizeof(header) + sizeof(_config))) {
+        return false;
+    }
+
+    // Only now does the new generation become the active one
+    _activeSlot = slot;
+    _sequence = header.sequence;
+    _loaded = true;
+
+    return true;
+}
+
+bool ConfigStore::IsLoaded(void) {
+    return _loaded;
+}
+
+bool ConfigStore::WasMigrated(void) {
+    return _migrated;
+}
+
+uint32_t ConfigStore::GetSequence(void) {
+    return _sequence;
+}
+
+deviceConfig_s * ConfigStore::GetDeviceConfig(void) {
+    return &_config;
+}
+
+meterConfig_s * ConfigStore::GetMeterConfig(void) {
+    return &_config.meter;
+}
+
+networkConfig_s * ConfigStore::GetNetworkConfig(void) {
+    return &_config.network;
+}
+
+powerConfig_s * ConfigStore::GetPowerConfig(void) {
+    return &_config.power;
+}
+
+mqttConfig_s * ConfigStore::GetMqttConfig(void) {
+    return &_config.mqtt;
+}
+
+alertConfig_s * ConfigStore::GetAlertConfig(void) {
+    return &_config.alert;
+}
+
+tariffSchedule_s * ConfigStore::GetTariffConfig(void) {
+    return &_config.tariff;
+}
+
+applianceConfig_s * ConfigStore::GetApplianceConfig(void) {
+    return &_config.appliance;
+}
@@ -0,0 +1,199 @@
+#ifndef CONFIG_STORE_H
+#define CONFIG_STORE_H
+
+#include "Arduino.h"
+
+#include <impulseCapture.h>
+#include <alertEngine.h>
+#include <tariffLedger.h>
+#include <applianceDetector.h>
+
+//=============================================================================
+// Defines
+//=============================================================================
+
+// Two slots hold alternate generations of the configuration block, a write
+// always goes to the older slot so a torn write never loses the last good copy.
+#define CONFIG_STORE_SLOT_PATH_0            "/config0.bin"
+#define CONFIG_STORE_SLOT_PATH_1            "/config1.bin"
+#define CONFIG_STORE_SLOTS                  2
+#define CONFIG_STORE_MAGIC                  0x4D434647  // "MCFG"
+#define CONFIG_STORE_VERSION                7
+
+// Pre-block formats, imported once and then removed
+#define CONFIG_STORE_LEGACY_METER_PATH      "/meter.cfg"
+#define CONFIG_STORE_LEGACY_METER_VERSION   1
+#define CONFIG_STORE_LEGACY_WIFI_PATH       "/wifi.conf"
+
+#define CONFIG_CHANNEL_NAME_MAX             16
+#define CONFIG_SSID_MAX                     33
+#define CONFIG_PASSWORD_MAX                 65
+#define CONFIG_HOSTNAME_MAX                 33
+#define CONFIG_NTP_SERVER_MAX               48
+#define CONFIG_MQTT_HOST_MAX                48
+#define CONFIG_MQTT_USERNAME_MAX            33
+#define CONFIG_MQTT_PASSWORD_MAX            65
+#define CONFIG_MQTT_TOPIC_MAX               33
+
+#define CONFIG_DEFAULT_SENSOR_PIN           2
+#define CONFIG_DEFAULT_CHANNEL_NAME         "import"
+#define CONFIG_DEFAULT_LOG_INTERVAL         10000   // 10 seconds in milli-seconds
+#define CONFIG_MINIMUM_LOG_INTERVAL         1000
+#define CONFIG_DEFAULT_HOSTNAME             "PowerMeter"
+#define CONFIG_DEFAULT_NTP_SERVER           "pool.ntp.org"
+#define CONFIG_DEFAULT_UTC_OFFSET           3600
+
+#define CONFIG_DEFAULT_SAMPLE_INTERVAL      60      // seconds between deep sleep samples
+#define CONFIG_DEFAULT_FLUSH_INTERVAL       30      // minutes between radio on flushes
+#define CONFIG_DEFAULT_AWAKE_WINDOW         30      // seconds served after a flush
+#define CONFIG_MINIMUM_SAMPLE_INTERVAL      15
+#define CONFIG_MINIMUM_AWAKE_WINDOW         10
+
+#define CONFIG_DEFAULT_MQTT_PORT            1883
+#define CONFIG_DEFAULT_MQTT_TOPIC           "powermeter"
+#define CONFIG_DEFAULT_MQTT_QOS             1
+#define CONFIG_DEFAULT_MQTT_BATCH           6       // samples per publish, one minute at the default log interval
+#define CONFIG_MAXIMUM_MQTT_BATCH           10
+
+#define CONFIG_MAXIMUM_ALERT_BEEPS          10
+
+#define CONFIG_DEFAULT_TARIFF_RATE_NAME     "standard"
+
+//=============================================================================
+// Types
+//=============================================================================
+
+typedef struct {
+
+    uint8_t pin;
+    uint32_t pulsesPerKilowattHour;
+    char name[CONFIG_CHANNEL_NAME_MAX];
+
+} configChannel_s;
+
+typedef struct {
+
+    uint32_t logInterval;               // milli-seconds
+    uint32_t minimumWatt;               // sets the longest valid pulse interval
+    uint32_t maximumWatt;               // sets the shortest valid pulse interval
+    uint8_t estimator;                  // impulseEstimator_e
+    uint8_t averagePulses;
+    uint8_t decay;
+    uint8_t channelCount;
+    configChannel_s channels[IMPULSE_CHANNELS_MAX];
+
+} meterConfig_s;
+
+typedef struct {
+
+    char ssid[CONFIG_SSID_MAX];         // empty selects access point mode
+    char password[CONFIG_PASSWORD_MAX];
+    char hostname[CONFIG_HOSTNAME_MAX];
+    char ntpServer[CONFIG_NTP_SERVER_MAX];
+    int32_t utcOffset;                  // seconds
+    uint8_t staticIp;                   // 0 = DHCP
+    uint32_t ipAddress;                 // IPAddress as uint32_t, network order
+    uint32_t gateway;
+    uint32_t netmask;
+    uint32_t dns;
+
+} networkConfig_s;
+
+typedef struct {
+
+    uint8_t batchMode;                  // deep sleep between samples, radio only for flushes
+    uint8_t reserved;
+    uint16_t sampleInterval;            // seconds
+    uint16_t flushInterval;             // minutes
+    uint16_t awakeWindow;               // seconds
+
+} powerConfig_s;
+
+typedef struct {
+
+    uint8_t enabled;
+    uint8_t qos;                        // 0 or 1
+    uint8_t batchSize;                  // samples per publish
+    uint8_t reserved;
+    uint16_t port;
+    char host[CONFIG_MQTT_HOST_MAX];    // empty disables publishing
+    char username[CONFIG_MQTT_USERNAME_MAX];
+    char password[CONFIG_MQTT_PASSWORD_MAX];
+    char topic[CONFIG_MQTT_TOPIC_MAX];  // base topic, <topic>/samples and <topic>/status
+
+} mqttConfig_s;
+
+typedef struct {
+
+    alertRule_s rules[ALERT_RULES_MAX]; // type none leaves a slot unused
+
+} alertConfig_s;
+
+typedef struct {
+
+    uint16_t minimumStep;               // watts, smaller changes are not appliances
+    uint16_t reserved;
+
+} applianceConfig_s;
+
+// New fields are appended only; a block of an older version is read over the
+// defaults, so whatever it does not carry keeps its default value.
+typedef struct {
+
+    networkConfig_s network;
+    meterConfig_s meter;
+    powerConfig_s power;                // since version 3
+    mqttConfig_s mqtt;                  // since version 4
+    alertConfig_s alert;                // since version 5
+    tariffSchedule_s tariff;            // since version 6
+    applianceConfig_s appliance;        // since version 7
+
+} deviceConfig_s;
+
+typedef struct {
+
+    uint32_t magic;
+    uint16_t version;
+    uint16_t size;                      // of the payload following the header
+    uint32_t sequence;                  // generation, the higher valid slot wins
+    uint32_t crc;                       // over the payload
+
+} configHeader_s;
+
+//=============================================================================
+// Classes
+//=============================================================================
+
+class ConfigStore
+{
+    public:
+        ConfigStore(void);
+
+        void SetDefaults(void);
+        bool Load(void);
+        bool Save(void);
+        bool IsLoaded(void);
+        bool WasMigrated(void);
+        uint32_t GetSequence(void);
+
+        deviceConfig_s *GetDeviceConfig(void);
+        meterConfig_s *GetMeterConfig(void);
+        networkConfig_s *GetNetworkConfig(void);
+        powerConfig_s *GetPowerConfig(void);
+        mqttConfig_s *GetMqttConfig(void);
+        alertConfig_s *GetAlertConfig(void);
+        tariffSchedule_s *GetTariffConfig(void);
+        applianceConfig_s *GetApplianceConfig(void);
+
+    private:
+        bool _ReadSlot(uint8_t slot, configHeader_s *header, deviceConfig_s *config);
+        bool _MigrateLegacy(bool importMeter);
+
+        bool _loaded;
+        bool _migrated;
+        uint8_t _activeSlot;
+        uint32_t _sequence;
+        deviceConfig_s _config;
+};
+
+#endif // CONFIG_STORE_H
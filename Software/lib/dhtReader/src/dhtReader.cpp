@@ -0,0 +1,157 @@
+#include "dhtReader.h"
+
+//=============================================================================
+// Object constructors
+//=============================================================================
+
+DhtReader::DhtReader(uint8_t pin) {
+    _pin = pin;
+    _state = dhtReaderIdle;
+    _stateTime = 0;
+    _lastResult = dhtReaderNoResponse;
+    _reading.temperature = NAN;
+    _reading.humidity = NAN;
+    _readCount = 0;
+    _errorCount = 0;
+    _edgeCount = 0;
+}
+
+//=============================================================================
+// Private functions
+//=============================================================================
+
+void IRAM_ATTR DhtReader::_EdgeInterrupt(void *reader) {
+    DhtReader *dhtReader = (DhtReader *)reader;
+
+    if (dhtReader->_edgeCount < DHT_READER_EDGES) {
+        dhtReader->_edgeTimes[dhtReader->_edgeCount++] = micros();
+    }
+}
+
+dhtReaderResult_e DhtReader::_Decode(void) {
+    uint8_t data[DHT_READER_BYTES] = {0, 0, 0, 0, 0};
+
+    if (_edgeCount < DHT_READER_EDGES) {
+        return dhtReaderNoResponse;
+    }
+
+    uint32_t response = _edgeTimes[1] - _edgeTimes[0];
+
+    if ((response < DHT_READER_RESPONSE_MINIMUM_US) || (response > DHT_READER_RESPONSE_MAXIMUM_US)) {
+        return dhtReaderFrameError;
+    }
+
+    // Bit n spans from its own falling edge to the next one, MSB first
+    for (uint8_t bit = 0; bit < DHT_READER_BITS; bit++) {
+        uint32_t period = _edgeTimes[bit + 2] - _edgeTimes[bit + 1];
+
+        if (period > DHT_READER_RESPONSE_MAXIMUM_US) {
+            return dhtReaderFrameError;
+        }
+
+        data[bit / 8] <<= 1;
+
+        if (period > DHT_READER_BIT_THRESHOLD_US) {
+            data[bit / 8] |= 1;
+        }
+    }
+
+    if ((uint8_t)(data[0] + data[1] + data[2] + data[3]) != data[4]) {
+        return dhtReaderChecksumError;
+    }
+
+    // DHT11: integral and decimal bytes, sign in bit 7 of the temperature decimal
+    _reading.humidity = data[0] + (data[1] * 0.1f);
+    _reading.temperature = data[2] + ((data[3] & 0x7F) * 0.1f);
+
+    if (data[3] & 0x80) {
+        _reading.temperature = -_reading.temperature;
+    }
+
+    return dhtReaderOk;
+}
+
+//=============================================================================
+// Public functions
+//=============================================================================
+
+void DhtReader::Init(void) {
+    pinMode(_pin, INPUT_PULLUP);
+    _state = dhtReaderIdle;
+}
+
+bool DhtReader::StartRead(void) {
+    if (_state != dhtReaderIdle) {
+        return false;
+    }
+
+    pinMode(_pin, OUTPUT);
+    digitalWrite(_pin, LOW);
+
+    _state = dhtReaderStartSignal;
+    _stateTime = millis();
+
+    return true;
+}
+
+// Returns the milli-seconds until the next call is needed, 0 once idle
+uint32_t DhtReader::Update(void) {
+    uint32_t stateDuration = millis() - _stateTime;
+
+    switch (_state) {
+        case dhtReaderStartSignal:
+            if (stateDuration < DHT_READER_START_SIGNAL_MS) {
+                return DHT_READER_START_SIGNAL_MS - stateDuration;
+            }
+
+            // Listen before releasing the bus, the response follows within 40 us
+            _edgeCount = 0;
+            attachInterruptArg(_pin, _EdgeInterrupt, this, FALLING);
+            pinMode(_pin, INPUT_PULLUP);
+
+            _state = dhtReaderCapture;
+            _stateTime = millis();
+
+            return DHT_READER_CAPTURE_MS;
+
+        case dhtReaderCapture:
+            if ((_edgeCount < DHT_READER_EDGES) && (stateDuration < DHT_READER_CAPTURE_TIMEOUT_MS)) {
+                return 1;
+            }
+
+            detachInterrupt(_pin);
+
+            _lastResult = _Decode();
+            _readCount++;
+
+            if (_lastResult != dhtReaderOk) {
+                _errorCount++;
+            }
+
+            _state = dhtReaderIdle;
+            return 0;
+
+        default:
+            return 0;
+    }
+}
+
+bool DhtReader::IsBusy(void) {
+    return (_state != dhtReaderIdle);
+}
+
+dhtReaderResult_e DhtReader::GetLastResult(void) {
+    return _lastResult;
+}
+
+const dhtReading_s * DhtReader::GetReading(void) {
+    return &_reading;
+}
+
+uint32_t DhtReader::GetReadCount(void) {
+    return _readCount;
+}
+
+uint32_t DhtReader::GetErrorCount(void) {
+    return _errorCount;
+}
@@ -0,0 +1,89 @@
+#ifndef DHT_READER_H
+#define DHT_READER_H
+
+#include "Arduino.h"
+
+//=============================================================================
+// Defines
+//=============================================================================
+
+#define DHT_READER_START_SIGNAL_MS          20      // host holds the bus low, DHT11 needs >= 18 ms
+#define DHT_READER_CAPTURE_MS               6       // response and 40 bits take < 5.5 ms
+#define DHT_READER_CAPTURE_TIMEOUT_MS       20
+#define DHT_READER_EDGES                    42      // response, one per bit, end of frame
+#define DHT_READER_BITS                     40
+#define DHT_READER_BYTES                    5
+
+// Falling edge to falling edge: 50 us low plus 26-28 us high for a 0, 70 us for a 1
+#define DHT_READER_BIT_THRESHOLD_US         100
+#define DHT_READER_RESPONSE_MINIMUM_US      120     // 80 us low plus 80 us high
+#define DHT_READER_RESPONSE_MAXIMUM_US      220
+
+//=============================================================================
+// Types
+//=============================================================================
+
+typedef enum {
+
+    dhtReaderIdle = 0,
+    dhtReaderStartSignal,
+    dhtReaderCapture
+
+} dhtReaderState_e;
+
+typedef enum {
+
+    dhtReaderOk = 0,
+    dhtReaderNoResponse,    // fewer edges than a full frame
+    dhtReaderFrameError,    // response or bit timing out of range
+    dhtReaderChecksumError
+
+} dhtReaderResult_e;
+
+typedef struct {
+
+    float temperature;
+    float humidity;
+
+} dhtReading_s;
+
+//=============================================================================
+// Classes
+//=============================================================================
+
+// DHT11 reader which never blocks and never disables interrupts: the start
+// signal and the capture are states advanced by Update(), an interrupt only
+// time stamps the falling edges and the frame is decoded afterwards.
+class DhtReader
+{
+    public:
+        DhtReader(uint8_t pin);
+
+        void Init(void);
+        bool StartRead(void);
+        uint32_t Update(void);
+        bool IsBusy(void);
+
+        dhtReaderResult_e GetLastResult(void);
+        const dhtReading_s *GetReading(void);
+        uint32_t GetReadCount(void);
+        uint32_t GetErrorCount(void);
+
+    private:
+        static void _EdgeInterrupt(void *reader);
+        dhtReaderResult_e _Decode(void);
+
+        uint8_t _pin;
+        dhtReaderState_e _state;
+        uint32_t _stateTime;
+        dhtReaderResult_e _lastResult;
+        dhtReading_s _reading;
+        uint32_t _readCount;
+        uint32_t _errorCount;
+
+        // Shared with the interrupt handler, micro-seconds
+        volatile uint32_t _edgeTimes[DHT_READER_EDGES];
+        volatile uint8_t _edgeCount;
+};
+
+#endif // DHT_READER_H
@@ -0,0 +1,410 @@
+#include "flashMonitor.h"
+
+#include <coredecls.h>
+
+// The wrappers below book to the one monitor of the firmware
+static FlashMonitor *_monitor = NULL;
+
+//=============================================================================
+// Link time wrappers
+//=============================================================================
+
+// With -Wl,--wrap=<symbol> every call to <symbol> outside its own object
+// lands in __wrap_<symbol>, which reaches the original as __real_<symbol>.
+// The LittleFS types are opaque here, the sizes are those of lfs.h and
+// flash_hal.h.
+extern "C" {
+
+int __real_lfs_file_open(void *lfs, void *file, const char *path, int flags);
+int __real_lfs_file_opencfg(void *lfs, void *file, const char *path, int flags, const void *config);
+int32_t __real_lfs_file_write(void *lfs, void *file, const void *buffer, uint32_t size);
+int __real_lfs_file_close(void *lfs, void *file);
+int32_t __real_flash_hal_write(uint32_t address, uint32_t size, const uint8_t *source);
+int32_t __real_flash_hal_erase(uint32_t address, uint32_t size);
+
+// LFS_O_WRONLY and LFS_O_RDWR, files opened read only are of no interest
+#define FLASH_MONITOR_LFS_WRITE_FLAGS   0x3
+
+int __wrap_lfs_file_open(void *lfs, void *file, const char *path, int flags) {
+    int result = __real_lfs_file_open(lfs, file, path, flags);
+
+    if ((result == 0) && ((flags & FLASH_MONITOR_LFS_WRITE_FLAGS) != 0) && (_monitor != NULL))
+        _monitor->RecordOpen(file, path);
+
+    return result;
+}
+
+int __wrap_lfs_file_opencfg(void *lfs, void *file, const char *path, int flags, const void *config) {
+    int result = __real_lfs_file_opencfg(lfs, file, path, flags, config);
+
+    if ((result == 0) && ((flags & FLASH_MONITOR_LFS_WRITE_FLAGS) != 0) && (_monitor != NULL))
+        _monitor->RecordOpen(file, path);
+
+    return result;
+}
+
+int32_t __wrap_lfs_file_write(void *lfs, void *file, const void *buffer, uint32_t size) {
+    int32_t result = __real_lfs_file_write(lfs, file, buffer, size);
+
+    if ((result > 0) && (_monitor != NULL))
+        _monitor->RecordWrite(file, result);
+
+    return result;
+}
+
+int __wrap_lfs_file_close(void *lfs, void *file) {
+    if (_monitor != NULL)
+        _monitor->RecordClose(file);
+
+    return __real_lfs_file_close(lfs, file);
+}
+
+int32_t __wrap_flash_hal_write(uint32_t address, uint32_t size, const uint8_t *source) {
+    int32_t result = __real_flash_hal_write(address, size, source);
+
+    if ((result == 0) && (_monitor != NULL))
+        _monitor->RecordProgram(size);
+
+    return result;
+}
+
+int32_t __wrap_flash_hal_erase(uint32_t address, uint32_t size) {
+    int32_t result = __real_flash_hal_erase(address, size);
+
+    if ((result == 0) && (_monitor != NULL))
+        _monitor->RecordErase(size);
+
+    return result;
+}
+
+}
+
+//=============================================================================
+// Object constructors
+//=============================================================================
+
+FlashMonitor::FlashMonitor(void) {
+    memset(&_data, 0, sizeof(_data));
+    memset(_open, 0, sizeof(_open));
+    _reserve = 0;
+    _totalBytes = 0;
+    _savedEpoch = 0;
+    _nextOpen = 0;
+    _loaded = false;
+    _dirty = false;
+
+    _monitor = this;
+}
+
+//=============================================================================
+// Private functions
+//=============================================================================
+
+// Entry of the first path component, "/log/00000012.bin" is booked to "/log/"
+uint8_t FlashMonitor::_GetFileIndex(const char *path) {
+    char name[FLASH_MONITOR_NAME_MAX];
+    const char *separator = strchr(path + ((path[0] == '/') ? 1 : 0), '/');
+    size_t length = (separator != NULL) ? (size_t)(separator - path) + 1 : strlen(path);
+
+    length = min<size_t>(length, FLASH_MONITOR_NAME_MAX - 1);
+    memcpy(name, path, length);
+    name[length] = '\0';
+
+    for (uint8_t i = 0; i < (FLASH_MONITOR_FILES_MAX - 1); i++) {
+        if (_data.files[i].name[0] == '\0') {
+            strcpy(_data.files[i].name, name);
+            return i;
+        }
+
+        if (strcmp(_data.files[i].name, name) == 0)
+            return i;
+    }
+
+    strcpy(_data.files[FLASH_MONITOR_FILES_MAX - 1].name, FLASH_MONITOR_OTHER_NAME);
+
+    return FLASH_MONITOR_FILES_MAX - 1;
+}
+
+uint32_t FlashMonitor::_GetTotalBytes(void) {
+    if (_totalBytes == 0) {
+        FSInfo fsInfo;
+
+        LittleFS.info(fsInfo);
+        _totalBytes = fsInfo.totalBytes;
+    }
+
+    return _totalBytes;
+}
+
+// Least squares slope of the used bytes over the hourly samples, false while
+// they span less than two hours
+bool FlashMonitor::_GetTrend(float *bytesPerDay) {
+    if (_data.sampleCount < 3)
+        return false;
+
+    uint8_t first = (_data.sampleHead + FLASH_MONITOR_SAMPLES_MAX - _data.sampleCount) % FLASH_MONITOR_SAMPLES_MAX;
+    uint8_t last = (_data.sampleHead + FLASH_MONITOR_SAMPLES_MAX - 1) % FLASH_MONITOR_SAMPLES_MAX;
+    uint32_t firstEpoch = _data.samples[first].epoch;
+
+    if ((_data.samples[last].epoch - firstEpoch) < (2 * FLASH_MONITOR_SAMPLE_SECONDS))
+        return false;
+
+    // Centred on the means, single precision would lose the slope otherwise
+    float meanDays = 0;
+    float meanBytes = 0;
+
+    for (uint8_t i = 0; i < _data.sampleCount; i++) {
+        const flashMonitorSample_s *sample = &_data.samples[(first + i) % FLASH_MONITOR_SAMPLES_MAX];
+
+        meanDays += (sample->epoch - firstEpoch) / 86400.0f;
+        meanBytes += sample->usedBytes;
+    }
+
+    meanDays /= _data.sampleCount;
+    meanBytes /= _data.sampleCount;
+
+    float covariance = 0;
+    float variance = 0;
+
+    for (uint8_t i = 0; i < _data.sampleCount; i++) {
+        const flashMonitorSample_s *sample = &_data.samples[(first + i) % FLASH_MONITOR_SAMPLES_MAX];
+        float days = ((sample->epoch - firstEpoch) / 86400.0f) - meanDays;
+
+        covariance += days * (sample->usedBytes - meanBytes);
+        variance += days * days;
+    }
+
+    *bytesPerDay = covariance / variance;
+
+    return true;
+}
+
+//=============================================================================
+// Public functions
+//=============================================================================
+
+// Totals of the previous boots; writes booked since power on, as by a format,
+// are added to them
+bool FlashMonitor::Begin(void) {
+    flashMonitorStore_s store;
+
+    _loaded = true;
+
+    File file = LittleFS.open(FLASH_MONITOR_PATH, "r");
+
+    if (!file)
+        return false;
+
+    bool valid = (file.read((uint8_t *)&store, sizeof(store)) == sizeof(store)) &&
+                 (store.magic == FLASH_MONITOR_MAGIC) &&
+                 (crc32(&store.data, sizeof(store.data)) == store.crc);
+
+    file.close();
+
+    if (valid == false)
+        return false;
+
+    flashMonitorData_s session = _data;
+
+    _data = store.data;
+    _data.appBytes += session.appBytes;
+    _data.programmedBytes += session.programmedBytes;
+    _data.erasedBytes += session.erasedBytes;
+
+    for (uint8_t i = 0; i < FLASH_MONITOR_FILES_MAX; i++) {
+        _data.files[i].name[FLASH_MONITOR_NAME_MAX - 1] = '\0';
+    }
+
+    for (uint8_t i = 0; i < FLASH_MONITOR_FILES_MAX; i++) {
+        if (session.files[i].name[0] != '\0')
+            _data.files[_GetFileIndex(session.files[i].name)].bytes += session.files[i].bytes;
+    }
+
+    // Entries of files open across Begin may have moved, their writes go to
+    // the shared entry
+    memset(_open, 0, sizeof(_open));
+
+    return true;
+}
+
+// Bytes kept free by the caller, the file system counts as full beyond them
+void FlashMonitor::SetReserve(uint32_t bytes) {
+    _reserve = bytes;
+}
+
+// Local epoch, called with every log record while the time is known
+void FlashMonitor::Update(uint32_t epoch) {
+    if (epoch == 0)
+        return;
+
+    if (_data.startEpoch == 0)
+        _data.startEpoch = epoch;
+
+    if (_savedEpoch == 0)
+        _savedEpoch = epoch;
+
+    _data.lastEpoch = epoch;
+
+    uint8_t last = (_data.sampleHead + FLASH_MONITOR_SAMPLES_MAX - 1) % FLASH_MONITOR_SAMPLES_MAX;
+
+    if ((_data.sampleCount == 0) || ((epoch / FLASH_MONITOR_SAMPLE_SECONDS) != (_data.samples[last].epoch / FLASH_MONITOR_SAMPLE_SECONDS))) {
+        FSInfo fsInfo;
+
+        LittleFS.info(fsInfo);
+        _totalBytes = fsInfo.totalBytes;
+
+        _data.samples[_data.sampleHead].epoch = epoch;
+        _data.samples[_data.sampleHead].usedBytes = fsInfo.usedBytes;
+        _data.sampleHead = (_data.sampleHead + 1) % FLASH_MONITOR_SAMPLES_MAX;
+        _data.sampleCount = min<uint8_t>(_data.sampleCount + 1, FLASH_MONITOR_SAMPLES_MAX);
+        _dirty = true;
+    }
+
+    if ((epoch - _savedEpoch) >= FLASH_MONITOR_SAVE_SECONDS)
+        Save();
+}
+
+// Nothing before Begin, the saved totals would be lost. The writes of the
+// save itself go into the next one.
+bool FlashMonitor::Save(void) {
+    flashMonitorStore_s store;
+
+    if ((_loaded == false) || (_dirty == false))
+        return true;
+
+    store.magic = FLASH_MONITOR_MAGIC;
+    store.data = _data;
+    store.crc = crc32(&store.data, sizeof(store.data));
+
+    File file = LittleFS.open(FLASH_MONITOR_PATH, "w");
+
+    if (!file)
+        return false;
+
+    size_t written = file.write((const uint8_t *)&store, sizeof(store));
+    file.close();
+
+    if (written != sizeof(store))
+        return false;
+
+    _savedEpoch = _data.lastEpoch;
+    _dirty = false;
+
+    return true;
+}
+
+uint64_t FlashMonitor::GetAppBytes(void) {
+    return _data.appBytes;
+}
+
+uint64_t FlashMonitor::GetProgrammedBytes(void) {
+    return _data.programmedBytes;
+}
+
+uint64_t FlashMonitor::GetErasedBytes(void) {
+    return _data.erasedBytes;
+}
+
+// Bytes erased per byte the application wrote, 0 before the first write
+float FlashMonitor::GetWriteAmplification(void) {
+    return (_data.appBytes > 0) ? (float)_data.erasedBytes / (float)_data.appBytes : 0;
+}
+
+// LittleFS spreads its erases over all blocks, so the mean is the wear
+float FlashMonitor::GetEraseCyclesPerBlock(void) {
+    uint32_t totalBytes = _GetTotalBytes();
+
+    return (totalBytes > 0) ? (float)_data.erasedBytes / (float)totalBytes : 0;
+}
+
+// Seconds since the first known time, the base of the rates
+uint32_t FlashMonitor::GetSeconds(void) {
+    return _data.lastEpoch - _data.startEpoch;
+}
+
+// NULL past the end or for an unused entry
+const flashMonitorFile_s *FlashMonitor::GetFile(uint8_t index) {
+    if ((index >= FLASH_MONITOR_FILES_MAX) || (_data.files[index].name[0] == '\0'))
+        return NULL;
+
+    return &_data.files[index];
+}
+
+int32_t FlashMonitor::GetUsedBytesPerDay(void) {
+    float bytesPerDay;
+
+    return (_GetTrend(&bytesPerDay) == true) ? (int32_t)bytesPerDay : 0;
+}
+
+// Days until the used bytes reach the reserve at the present trend, -1 while
+// unknown or not growing
+int32_t FlashMonitor::GetDaysUntilFull(void) {
+    float bytesPerDay;
+
+    if ((_GetTrend(&bytesPerDay) == false) || (bytesPerDay < 1))
+        return -1;
+
+    uint8_t last = (_data.sampleHead + FLASH_MONITOR_SAMPLES_MAX - 1) % FLASH_MONITOR_SAMPLES_MAX;
+    uint32_t usedBytes = _data.samples[last].usedBytes;
+    uint32_t totalBytes = _GetTotalBytes();
+    uint32_t usableBytes = (totalBytes > _reserve) ? totalBytes - _reserve : 0;
+
+    if (usedBytes >= usableBytes)
+        return 0;
+
+    return (int32_t)min<float>((usableBytes - usedBytes) / bytesPerDay, INT32_MAX);
+}
+
+// A handle closed without being seen, or reused, simply takes a new entry;
+// beyond FLASH_MONITOR_OPEN_MAX the oldest is forgotten
+void FlashMonitor::RecordOpen(void *handle, const char *path) {
+    uint8_t entry = _nextOpen;
+
+    for (uint8_t i = 0; i < FLASH_MONITOR_OPEN_MAX; i++) {
+        if (_open[i].handle == handle) {
+            entry = i;
+            break;
+        }
+    }
+
+    if (entry == _nextOpen)
+        _nextOpen = (_nextOpen + 1) % FLASH_MONITOR_OPEN_MAX;
+
+    _open[entry].handle = handle;
+    _open[entry].file = _GetFileIndex(path);
+}
+
+void FlashMonitor::RecordWrite(void *handle, uint32_t bytes) {
+    uint8_t file = FLASH_MONITOR_FILES_MAX - 1;
+
+    for (uint8_t i = 0; i < FLASH_MONITOR_OPEN_MAX; i++) {
+        if ((_open[i].handle == handle) && (handle != NULL)) {
+            file = _open[i].file;
+            break;
+        }
+    }
+
+    if (file == (FLASH_MONITOR_FILES_MAX - 1))
+        strcpy(_data.files[file].name, FLASH_MONITOR_OTHER_NAME);
+
+    _data.files[file].bytes += bytes;
+    _data.appBytes += bytes;
+    _dirty = true;
+}
+
+void FlashMonitor::RecordClose(void *handle) {
+    for (uint8_t i = 0; i < FLASH_MONITOR_OPEN_MAX; i++) {
+        if (_open[i].handle == handle)
+            _open[i].handle = NULL;
+    }
+}
+
+void FlashMonitor::RecordProgram(uint32_t bytes) {
+    _data.programmedBytes += bytes;
+    _dirty = true;
+}
+
+void FlashMonitor::RecordErase(uint32_t bytes) {
+    _data.erasedBytes += bytes;
+    _dirty = true;
+}
@@ -0,0 +1,131 @@
+#ifndef FLASH_MONITOR_H
+#define FLASH_MONITOR_H
+
+#include "Arduino.h"
+
+#include <FS.h>
+#include <LittleFS.h>
+
+//=============================================================================
+// Defines
+//=============================================================================
+
+// Writes are booked to the first path component, "/log/" for all log blocks;
+// beyond this many the rest share the last entry
+#define FLASH_MONITOR_FILES_MAX             12
+#define FLASH_MONITOR_NAME_MAX              16
+#define FLASH_MONITOR_OTHER_NAME            "*"
+#define FLASH_MONITOR_OPEN_MAX              8       // files open for writing at once
+
+// Used bytes sampled once an hour for two days give the free space trend
+#define FLASH_MONITOR_SAMPLES_MAX           48
+#define FLASH_MONITOR_SAMPLE_SECONDS        3600
+
+// NOR flash sectors are rated for this many erase cycles
+#define FLASH_MONITOR_RATED_CYCLES          100000
+
+// Totals survive resets in a small file, written every 6 hours and before a
+// planned reset or deep sleep
+#define FLASH_MONITOR_PATH                  "/flash.bin"
+#define FLASH_MONITOR_MAGIC                 0x464C4D31  // "FLM1"
+#define FLASH_MONITOR_SAVE_SECONDS          21600
+
+//=============================================================================
+// Types
+//=============================================================================
+
+typedef struct {
+
+    char name[FLASH_MONITOR_NAME_MAX];  // first path component, empty when unused
+    uint32_t bytes;                     // written by the application
+
+} flashMonitorFile_s;
+
+typedef struct {
+
+    uint32_t epoch;
+    uint32_t usedBytes;
+
+} flashMonitorSample_s;
+
+typedef struct {
+
+    uint64_t appBytes;                  // handed to LittleFS by the application
+    uint64_t programmedBytes;           // programmed into flash by LittleFS, metadata included
+    uint64_t erasedBytes;
+    uint32_t startEpoch;                // first time known, start of the rates
+    uint32_t lastEpoch;
+    flashMonitorFile_s files[FLASH_MONITOR_FILES_MAX];
+    flashMonitorSample_s samples[FLASH_MONITOR_SAMPLES_MAX];
+    uint8_t sampleHead;
+    uint8_t sampleCount;
+    uint16_t reserved;
+
+} flashMonitorData_s;
+
+typedef struct {
+
+    uint32_t magic;
+    uint32_t crc;
+    flashMonitorData_s data;
+
+} flashMonitorStore_s;
+
+//=============================================================================
+// Classes
+//=============================================================================
+
+// Flash wear and file system health. The LittleFS file and flash HAL calls
+// are wrapped at link time (-Wl,--wrap, see platformio.ini) so every byte
+// the application writes is booked to its file and every program and erase
+// of the flash is counted, without touching the callers.
+class FlashMonitor
+{
+    public:
+        FlashMonitor(void);
+
+        bool Begin(void);
+        void SetReserve(uint32_t bytes);
+        void Update(uint32_t epoch);
+        bool Save(void);
+
+        uint64_t GetAppBytes(void);
+        uint64_t GetProgrammedBytes(void);
+        uint64_t GetErasedBytes(void);
+        float GetWriteAmplification(void);
+        float GetEraseCyclesPerBlock(void);
+        uint32_t GetSeconds(void);
+        const flashMonitorFile_s *GetFile(uint8_t index);
+        int32_t GetUsedBytesPerDay(void);
+        int32_t GetDaysUntilFull(void);
+
+        // Called by the link time wrappers
+        void RecordOpen(void *handle, const char *path);
+        void RecordWrite(void *handle, uint32_t bytes);
+        void RecordClose(void *handle);
+        void RecordProgram(uint32_t bytes);
+        void RecordErase(uint32_t bytes);
+
+    private:
+        typedef struct {
+
+            void *handle;
+            uint8_t file;
+
+        } _open_s;
+
+        uint8_t _GetFileIndex(const char *path);
+        uint32_t _GetTotalBytes(void);
+        bool _GetTrend(float *bytesPerDay);
+
+        flashMonitorData_s _data;
+        _open_s _open[FLASH_MONITOR_OPEN_MAX];
+        uint32_t _reserve;
+        uint32_t _totalBytes;
+        uint32_t _savedEpoch;
+        uint8_t _nextOpen;
+        bool _loaded;
+        bool _dirty;
+};
+
+#endif // FLASH_MONITOR_H
@@ -0,0 +1,188 @@
+#include "heapMonitor.h"
+
+#include <coredecls.h>
+
+//=============================================================================
+// Object constructors
+//=============================================================================
+
+HeapMonitor::HeapMonitor(uint32_t rtcOffset) {
+    _rtcOffset = rtcOffset;
+    _resetReason = 0;
+    _previousSnapshotValid = false;
+    _subsystemCount = 0;
+    _sampleHead = 0;
+    _sampleCount = 0;
+    _sampleTimer = 0;
+}
+
+//=============================================================================
+// Private functions
+//=============================================================================
+
+void HeapMonitor::_PersistSnapshot(void) {
+    for (uint8_t i = 0; i < HEAP_MONITOR_SUBSYSTEMS_MAX; i++) {
+        _snapshot.subsystemRetained[i] = (i < _subsystemCount) ? _subsystems[i].totalRetained : 0;
+    }
+
+    _snapshot.crc = crc32(&_snapshot, offsetof(heapSnapshot_s, crc));
+    ESP.rtcUserMemoryWrite(_rtcOffset, (uint32_t *)&_snapshot, sizeof(_snapshot));
+}
+
+//=============================================================================
+// Public functions
+//=============================================================================
+
+void HeapMonitor::Init(void) {
+    _resetReason = ESP.getResetInfoPtr()->reason;
+
+    // RTC user memory survives every reset except power loss, a matching CRC
+    // means the snapshot was written by the previous boot of this firmware.
+    if (ESP.rtcUserMemoryRead(_rtcOffset, (uint32_t *)&_previousSnapshot, sizeof(_previousSnapshot))) {
+        _previousSnapshotValid = (_previousSnapshot.magic == HEAP_MONITOR_RTC_MAGIC) &&
+                                 (_previousSnapshot.crc == crc32(&_previousSnapshot, offsetof(heapSnapshot_s, crc)));
+    }
+
+    memset(&_snapshot, 0, sizeof(_snapshot));
+    _snapshot.magic = HEAP_MONITOR_RTC_MAGIC;
+    _snapshot.bootCount = _previousSnapshotValid ? (_previousSnapshot.bootCount + 1) : 1;
+    _snapshot.minFreeHeap = UINT32_MAX;
+
+    _sampleHead = 0;
+    _sampleCount = 0;
+    _sampleTimer = millis() - HEAP_MONITOR_SAMPLE_INTERVAL_M_SECONDS;
+
+    Update();
+}
+
+void HeapMonitor::Update(void) {
+
+    uint32_t currentTime = millis();
+    uint32_t freeHeap;
+    uint32_t maxFreeBlock;
+    uint8_t fragmentation;
+
+    ESP.getHeapStats(&freeHeap, &maxFreeBlock, &fragmentation);
+
+    _snapshot.uptime = currentTime / 1000;
+    _snapshot.freeHeap = freeHeap;
+    _snapshot.maxFreeBlock = maxFreeBlock;
+    _snapshot.fragmentation = fragmentation;
+
+    if (freeHeap < _snapshot.minFreeHeap) {
+        _snapshot.minFreeHeap = freeHeap;
+    }
+
+    if (fragmentation > _snapshot.maxFragmentation) {
+        _snapshot.maxFragmentation = fragmentation;
+    }
+
+    if ((currentTime - _sampleTimer) >= HEAP_MONITOR_SAMPLE_INTERVAL_M_SECONDS) {
+        _sampleTimer = currentTime;
+
+        heapSample_s *sample = &_samples[_sampleHead];
+        sample->timestamp = _snapshot.uptime;
+        sample->freeHeap = freeHeap;
+        sample->maxFreeBlock = maxFreeBlock;
+        sample->fragmentation = fragmentation;
+
+        _sampleHead = (_sampleHead + 1) % HEAP_MONITOR_SAMPLES_MAX;
+
+        if (_sampleCount < HEAP_MONITOR_SAMPLES_MAX) {
+            _sampleCount++;
+        }
+    }
+
+    _PersistSnapshot();
+}
+
+uint8_t HeapMonitor::AddSubsystem(const char *name) {
+
+    if (_subsystemCount >= HEAP_MONITOR_SUBSYSTEMS_MAX) {
+        return HEAP_MONITOR_INVALID_SUBSYSTEM;
+    }
+
+    heapSubsystem_s *subsystem = &_subsystems[_subsystemCount];
+
+    subsystem->name = name;
+    subsystem->freeHeapAtBegin = 0;
+    subsystem->calls = 0;
+    subsystem->growthCalls = 0;
+    subsystem->lastRetained = 0;
+    subsystem->totalRetained = 0;
+    subsystem->maxRetained = 0;
+
+    return _subsystemCount++;
+}
+
+void HeapMonitor::Begin(uint8_t subsystemId) {
+    if (subsystemId < _subsystemCount) {
+        _subsystems[subsystemId].freeHeapAtBegin = ESP.getFreeHeap();
+    }
+}
+
+void HeapMonitor::End(uint8_t subsystemId) {
+
+    if (subsystemId >= _subsystemCount) {
+        return;
+    }
+
+    // Attribution by free heap delta: whatever a subsystem leaves allocated
+    // (buffers, String growth, leaks) is charged to it.
+    heapSubsystem_s *subsystem = &_subsystems[subsystemId];
+    int32_t retained = (int32_t)subsystem->freeHeapAtBegin - (int32_t)ESP.getFreeHeap();
+
+    subsystem->calls++;
+    subsystem->lastRetained = retained;
+    subsystem->totalRetained += retained;
+
+    if (retained > 0) {
+        subsystem->growthCalls++;
+    }
+
+    if (retained > subsystem->maxRetained) {
+        subsystem->maxRetained = retained;
+    }
+}
+
+bool HeapMonitor::HasPreviousSnapshot(void) {
+    return _previousSnapshotValid;
+}
+
+const heapSnapshot_s * HeapMonitor::GetPreviousSnapshot(void) {
+    return _previousSnapshotValid ? &_previousSnapshot : NULL;
+}
+
+const heapSnapshot_s * HeapMonitor::GetSnapshot(void) {
+    return &_snapshot;
+}
+
+uint32_t HeapMonitor::GetResetReason(void) {
+    return _resetReason;
+}
+
+uint8_t HeapMonitor::GetSubsystemCount(void) {
+    return _subsystemCount;
+}
+
+const heapSubsystem_s * HeapMonitor::GetSubsystem(uint8_t subsystemId) {
+    if (subsystemId >= _subsystemCount) {
+        return NULL;
+    }
+
+    return &_subsystems[subsystemId];
+}
+
+uint8_t HeapMonitor::GetSampleCount(void) {
+    return _sampleCount;
+}
+
+const heapSample_s * HeapMonitor::GetSample(uint8_t index) {
+    if (index >= _sampleCount) {
+        return NULL;
+    }
+
+    uint8_t oldest = (_sampleHead + HEAP_MONITOR_SAMPLES_MAX - _sampleCount) % HEAP_MONITOR_SAMPLES_MAX;
+
+    return &_samples[(oldest + index) % HEAP_MONITOR_SAMPLES_MAX];
+}
@@ -0,0 +1,102 @@
+#ifndef HEAP_MONITOR_H
+#define HEAP_MONITOR_H
+
+#include "Arduino.h"
+
+//=============================================================================
+// Defines
+//=============================================================================
+
+#define HEAP_MONITOR_SAMPLES_MAX                32
+#define HEAP_MONITOR_SAMPLE_INTERVAL_M_SECONDS  60000L  // 32 samples, ~30 minutes of history
+#define HEAP_MONITOR_SUBSYSTEMS_MAX             6
+#define HEAP_MONITOR_INVALID_SUBSYSTEM          0xFF
+
+#define HEAP_MONITOR_RTC_MAGIC                  0x48504D31  // "HPM1"
+
+//=============================================================================
+// Types
+//=============================================================================
+
+typedef struct {
+
+    uint32_t timestamp;                 // seconds since boot
+    uint32_t freeHeap;
+    uint32_t maxFreeBlock;
+    uint8_t fragmentation;              // percent
+
+} heapSample_s;
+
+typedef struct {
+
+    const char *name;
+    uint32_t freeHeapAtBegin;
+    uint32_t calls;
+    uint32_t growthCalls;               // calls which returned with less free heap than they started
+    int32_t lastRetained;               // bytes, positive means heap was consumed
+    int32_t totalRetained;
+    int32_t maxRetained;
+
+} heapSubsystem_s;
+
+// Persisted in RTC user memory so the state before a crash survives the reset
+typedef struct {
+
+    uint32_t magic;
+    uint32_t bootCount;
+    uint32_t uptime;                    // seconds since boot
+    uint32_t freeHeap;
+    uint32_t minFreeHeap;
+    uint32_t maxFreeBlock;
+    uint8_t fragmentation;
+    uint8_t maxFragmentation;
+    uint16_t reserved;
+    int32_t subsystemRetained[HEAP_MONITOR_SUBSYSTEMS_MAX];
+    uint32_t crc;
+
+} heapSnapshot_s;
+
+//=============================================================================
+// Classes
+//=============================================================================
+
+class HeapMonitor
+{
+    public:
+        HeapMonitor(uint32_t rtcOffset);
+
+        void Init(void);
+        void Update(void);
+        uint8_t AddSubsystem(const char *name);
+        void Begin(uint8_t subsystemId);
+        void End(uint8_t subsystemId);
+
+        bool HasPreviousSnapshot(void);
+        const heapSnapshot_s *GetPreviousSnapshot(void);
+        const heapSnapshot_s *GetSnapshot(void);
+        uint32_t GetResetReason(void);
+
+        uint8_t GetSubsystemCount(void);
+        const heapSubsystem_s *GetSubsystem(uint8_t subsystemId);
+        uint8_t GetSampleCount(void);
+        const heapSample_s *GetSample(uint8_t index);     // 0 = oldest
+
+    private:
+        void _PersistSnapshot(void);
+
+        uint32_t _rtcOffset;
+        uint32_t _resetReason;
+        bool _previousSnapshotValid;
+        heapSnapshot_s _previousSnapshot;
+        heapSnapshot_s _snapshot;
+
+        heapSubsystem_s _subsystems[HEAP_MONITOR_SUBSYSTEMS_MAX];
+        uint8_t _subsystemCount;
+
+        heapSample_s _samples[HEAP_MONITOR_SAMPLES_MAX];
+        uint8_t _sampleHead;
+        uint8_t _sampleCount;
+        uint32_t _sampleTimer;
+};
+
+#endif // HEAP_MONITOR_H
@@ -1,54 +1,357 @@
 #include "impulseCapture.h"
 
-static uint32_t _impulseCount;
-static uint32_t _lastImpulseTime;
-static uint32_t _instantenousWatt;
-
 //=============================================================================
 // Object constructors
 //=============================================================================
 
-ImpulseCapture::ImpulseCapture(uint8_t impulsePin) {
+ImpulseCapture::ImpulseCapture(uint8_t impulsePin, uint32_t pulsesPerKilowattHour, const char *name) {
     _pin = impulsePin;
+    _name = name;
+    _lastInterval = 0;
+    _minimumInterval = 0;
+    _medianCount = 0;
+    _edgeCount = 0;
+
+    SetMeterConstants(pulsesPerKilowattHour, MINIMUM_WATT_SUPPORTED, MAXIMUM_WATT_SUPPORTED);
+}
+
+//=============================================================================
+// Private functions
+//=============================================================================
+
+uint32_t ImpulseCapture::_IntervalToWatt(uint32_t interval) {
+    if (interval == 0) {
+        return 0;
+    }
+
+    return (uint32_t)(_wattMicroSecondsPerPulse / interval);
 }
 
 //=============================================================================
 // Interrupt handler
 //=============================================================================
 
-void IRAM_ATTR ImpulseSensorInterrupt(void) {
-    
-    uint32_t currentImpulseTime = millis();
-    uint32_t intervalImpulseTime = currentImpulseTime - _lastImpulseTime;
+void IRAM_ATTR ImpulseCapture::_SensorInterrupt(void *channel) {
+    ((ImpulseCapture *)channel)->_HandleEdge();
+}
+
+uint32_t IRAM_ATTR ImpulseCapture::_MedianInterval(void) {
+    uint32_t sorted[IMPULSE_MEDIAN_INTERVALS];
+
+    // Insertion sort of a fixed, tiny window keeps the ISR constant time
+    for (uint8_t i = 0; i < IMPULSE_MEDIAN_INTERVALS; i++) {
+        uint32_t interval = _medianIntervals[i];
+        int8_t j = i - 1;
+
+        while ((j >= 0) && (sorted[j] > interval)) {
+            sorted[j + 1] = sorted[j];
+            j--;
+        }
+
+        sorted[j + 1] = interval;
+    }
+
+    return sorted[IMPULSE_MEDIAN_INTERVALS / 2];
+}
+
+void IRAM_ATTR ImpulseCapture::_SetMinimumInterval(void) {
+    if (_medianCount < IMPULSE_MEDIAN_INTERVALS) {
+        _minimumInterval = _minimumIntervalFloor;
+        return;
+    }
+
+    // Adaptive debounce, never below the fastest interval the meter can produce
+    uint32_t adaptiveInterval = _MedianInterval() / IMPULSE_MEDIAN_DIVISOR;
+
+    _minimumInterval = (adaptiveInterval > _minimumIntervalFloor) ? adaptiveInterval : _minimumIntervalFloor;
+}
+
+void IRAM_ATTR ImpulseCapture::_AddMedianInterval(uint32_t interval) {
+    // A much longer interval is the load dropping, waiting for the median to
+    // follow would leave the threshold low and open to glitches meanwhile
+    if ((_medianCount == IMPULSE_MEDIAN_INTERVALS) && ((interval / IMPULSE_RESEED_FACTOR) >= _MedianInterval())) {
+        _SeedMedianIntervals(interval);
+        return;
+    }
+
+    _medianIntervals[_medianIndex] = interval;
+    _medianIndex = (_medianIndex + 1) % IMPULSE_MEDIAN_INTERVALS;
+
+    if (_medianCount < IMPULSE_MEDIAN_INTERVALS) {
+        _medianCount++;
+    }
+
+    _SetMinimumInterval();
+}
+
+void IRAM_ATTR ImpulseCapture::_SeedMedianIntervals(uint32_t interval) {
+    for (uint8_t i = 0; i < IMPULSE_MEDIAN_INTERVALS; i++) {
+        _medianIntervals[i] = interval;
+    }
+
+    _medianIndex = 0;
+    _medianCount = IMPULSE_MEDIAN_INTERVALS;
+    _SetMinimumInterval();
+}
+
+// Mean interval of the latest edges when they are evenly spaced and too early
+// for the threshold, 0 otherwise. Glitches are random, a meter that went to a
+// higher load is regular.
+uint32_t IRAM_ATTR ImpulseCapture::_GetRunInterval(void) {
+    if (_edgeCount < (IMPULSE_RUN_INTERVALS + 1)) {
+        return 0;
+    }
+
+    uint32_t shortest = UINT32_MAX;
+    uint32_t longest = 0;
+
+    for (uint8_t i = 0; i < IMPULSE_RUN_INTERVALS; i++) {
+        uint32_t interval = _edgeTimes[i + 1] - _edgeTimes[i];
+
+        shortest = min(shortest, interval);
+        longest = max(longest, interval);
+    }
+
+    uint32_t mean = (_edgeTimes[IMPULSE_RUN_INTERVALS] - _edgeTimes[0]) / IMPULSE_RUN_INTERVALS;
+
+    if ((longest >= _minimumInterval) || ((longest - shortest) > (mean / IMPULSE_RUN_TOLERANCE))) {
+        return 0;
+    }
+
+    return mean;
+}
+
+void IRAM_ATTR ImpulseCapture::_AddPulseTime(uint32_t pulseTime) {
+    _pulseTimes[_pulseTimeIndex] = pulseTime;
+    _pulseTimeIndex = (_pulseTimeIndex + 1) % (IMPULSE_AVERAGE_PULSES_MAX + 1);
+
+    if (_pulseTimeCount < (IMPULSE_AVERAGE_PULSES_MAX + 1)) {
+        _pulseTimeCount++;
+    }
+}
+
+void IRAM_ATTR ImpulseCapture::_AddIntervalStatistics(uint32_t interval) {
+    if (interval == 0) {
+        return;
+    }
+
+    if (interval < _intervalMinimumInterval) {
+        _intervalMinimumInterval = interval;
+    }
+
+    if (interval > _intervalMaximumInterval) {
+        _intervalMaximumInterval = interval;
+    }
+}
+
+void IRAM_ATTR ImpulseCapture::_HandleEdge(void) {
+
+    uint32_t currentEdgeTime = micros();
+
+    if (digitalRead(_pin) == HIGH) {
+        _risingEdgeTime = currentEdgeTime;
+        _risingEdgeSeen = true;
+        return;
+    }
+
+    // Falling edge completes a pulse, which is time stamped at its rising edge
+    if (_risingEdgeSeen == false) {
+        return;
+    }
+
+    _risingEdgeSeen = false;
+
+    uint32_t risingEdgeTime = _risingEdgeTime;
+    uint32_t pulseWidth = currentEdgeTime - risingEdgeTime;
+
+    if ((pulseWidth < IMPULSE_MINIMUM_WIDTH_MICRO_SECONDS) || (pulseWidth > IMPULSE_MAXIMUM_WIDTH_MICRO_SECONDS)) {
+        _rejectedWidthCount++;
+        return;
+    }
+
+    // Every well formed pulse shifts into the run history, not yet counted
+    for (uint8_t i = 0; i < IMPULSE_RUN_INTERVALS; i++) {
+        _edgeTimes[i] = _edgeTimes[i + 1];
+    }
+
+    _edgeTimes[IMPULSE_RUN_INTERVALS] = risingEdgeTime;
+    _edgeCounted >>= 1;
+
+    if (_edgeCount < (IMPULSE_RUN_INTERVALS + 1)) {
+        _edgeCount++;
+    }
+
+    // Intervals are measured from the last accepted pulse, so a spurious pulse
+    // in between does not shorten the interval of the genuine one after it.
+    uint32_t intervalImpulseTime = risingEdgeTime - _lastImpulseTime;
+    uint32_t runInterval = (_lastImpulseValid == true) ? _GetRunInterval() : 0;
+
+    if (runInterval > 0) {
+        // The load went up faster than the median could follow; every
+        // pulse of the run is genuine, count those rejected so far
+        uint8_t missed = 0;
+
+        for (uint8_t i = 0; i <= IMPULSE_RUN_INTERVALS; i++) {
+            if ((_edgeCounted & (1 << i)) == 0)
+                missed++;
+        }
+
+        _impulseCount += missed;
+        _intervalPulses += missed;
+
+        // They were rejected before, all but this one
+        uint32_t rejected = _rejectedIntervalCount;
+
+        _rejectedIntervalCount = (rejected > (uint32_t)(missed - 1)) ? (rejected - (missed - 1)) : 0;
+        _edgeCounted = (1 << (IMPULSE_RUN_INTERVALS + 1)) - 1;
+
+        _pulseTimeCount = 0;
+
+        for (uint8_t i = 0; i <= IMPULSE_RUN_INTERVALS; i++) {
+            _AddPulseTime(_edgeTimes[i]);
+        }
+
+        _AddIntervalStatistics(_lastInterval);
+        _AddIntervalStatistics(runInterval);
+        _SeedMedianIntervals(runInterval);
+
+        _previousImpulseTime = _edgeTimes[IMPULSE_RUN_INTERVALS - 1];
+        _previousImpulseValid = true;
+        _lastImpulseTime = risingEdgeTime;
+        _lastInterval = runInterval;
+        return;
+    }
+
+    if ((_lastImpulseValid == true) && (intervalImpulseTime < _minimumInterval)) {
+        _rejectedIntervalCount++;
+
+        // Of this pulse and the last accepted one, only one belongs to the
+        // meter; keep the one whose interval fits the median better. Only the
+        // newest accepted pulse is open to this, so its interval is not in
+        // the statistics yet.
+        if ((_previousImpulseValid == false) || (_medianCount < IMPULSE_MEDIAN_INTERVALS) || (_lastInterval == 0)) {
+            return;
+        }
+
+        uint32_t median = _MedianInterval();
+        uint32_t interval = risingEdgeTime - _previousImpulseTime;
+        uint32_t intervalError = (interval > median) ? (interval - median) : (median - interval);
+        uint32_t lastError = (_lastInterval > median) ? (_lastInterval - median) : (median - _lastInterval);
+
+        if (intervalError >= lastError) {
+            return;
+        }
+
+        for (uint8_t i = 0; i < IMPULSE_RUN_INTERVALS; i++) {
+            if (_edgeTimes[i] == _lastImpulseTime)
+                _edgeCounted &= ~(1 << i);
+        }
+
+        _edgeCounted |= (1 << IMPULSE_RUN_INTERVALS);
+
+        _medianIntervals[(_medianIndex + IMPULSE_MEDIAN_INTERVALS - 1) % IMPULSE_MEDIAN_INTERVALS] = interval;
+        _SetMinimumInterval();
+
+        _pulseTimes[(_pulseTimeIndex + IMPULSE_AVERAGE_PULSES_MAX) % (IMPULSE_AVERAGE_PULSES_MAX + 1)] = risingEdgeTime;
 
-    if ((intervalImpulseTime < MAXIMUM_MILLI_SECOND_BTWN_IMPULSES) && (intervalImpulseTime >= MIMIMUM_MILLI_SECOND_BTWN_IMPULSES)) {
-        _instantenousWatt = 3600000.0 / ((intervalImpulseTime / 1000.0) * 10000.0);
-        //(float)(PULSES_PER_WATT_SECOND * 1000.0) / (float)intervalImpulseTime;
+        _lastImpulseTime = risingEdgeTime;
+        _lastInterval = interval;
+        return;
+    }
+
+    // Only the interval is kept here, watts are derived outside interrupt
+    // context where the division does not lengthen the ISR. The previous
+    // interval can no longer be swapped, it goes into the statistics.
+    _AddIntervalStatistics(_lastInterval);
+
+    if ((_lastImpulseValid == true) && (intervalImpulseTime < _maximumInterval)) {
+        _lastInterval = intervalImpulseTime;
+        _AddMedianInterval(intervalImpulseTime);
     }
     else {
-        _instantenousWatt = 0;
+        _lastInterval = 0;
     }
 
-    _lastImpulseTime = currentImpulseTime;
+    _previousImpulseTime = _lastImpulseTime;
+    _previousImpulseValid = (_lastInterval != 0);
+    _lastImpulseTime = risingEdgeTime;
+    _lastImpulseValid = true;
     _impulseCount++;
+    _intervalPulses++;
+    _edgeCounted |= (1 << IMPULSE_RUN_INTERVALS);
+
+    _AddPulseTime(risingEdgeTime);
 }
 
 //=============================================================================
 // Public functions
 //=============================================================================
 
+void ImpulseCapture::Configure(uint8_t impulsePin, const char *name) {
+    _pin = impulsePin;
+    _name = name;
+}
+
+void ImpulseCapture::SetMeterConstants(uint32_t pulsesPerKilowattHour, uint32_t minimumWatt, uint32_t maximumWatt) {
+    uint32_t pulses = (pulsesPerKilowattHour > 0) ? pulsesPerKilowattHour : PULSES_PER_KILOWATT_HOUR;
+    uint64_t wattMicroSecondsPerPulse = WATT_MICRO_SECONDS_PER_KILOWATT_HOUR / pulses;
+
+    minimumWatt = max<uint32_t>(minimumWatt, 1);
+    maximumWatt = max<uint32_t>(maximumWatt, minimumWatt);
+
+    // Energy of one pulse in watt micro-seconds and the interval limits it
+    // implies, shortest at the maximum and longest at the minimum load
+    noInterrupts();
+    _pulsesPerKilowattHour = pulses;
+    _wattMicroSecondsPerPulse = wattMicroSecondsPerPulse;
+    _minimumIntervalFloor = (uint32_t)(wattMicroSecondsPerPulse / maximumWatt);
+    _maximumInterval = (uint32_t)min<uint64_t>(wattMicroSecondsPerPulse / minimumWatt, MAXIMUM_MICRO_SECOND_BTWN_IMPULSES);
+
+    // Intervals learnt under the previous constants no longer apply
+    _lastInterval = 0;
+    _medianCount = 0;
+    _edgeCount = 0;
+    _minimumInterval = _minimumIntervalFloor;
+    interrupts();
+}
+
 void ImpulseCapture::Init(void) {
+    if (_pin == IMPULSE_PIN_NONE) {
+        return;
+    }
+
     pinMode(_pin, INPUT_PULLUP);
 
     _impulseCount = 0;
-    _lastImpulseTime = 0;
-    _instantenousWatt = 0;
+    _lastInterval = 0;
+
+    _risingEdgeSeen = false;
+    _lastImpulseValid = false;
+    _previousImpulseValid = false;
+    _medianIndex = 0;
+    _medianCount = 0;
+    _edgeCounted = 0;
+    _edgeCount = 0;
+    _minimumInterval = _minimumIntervalFloor;
+    _rejectedWidthCount = 0;
+    _rejectedIntervalCount = 0;
+    _pulseTimeIndex = 0;
+    _pulseTimeCount = 0;
+    _intervalPulses = 0;
+    _intervalMinimumInterval = UINT32_MAX;
+    _intervalMaximumInterval = 0;
 
-    attachInterrupt(_pin, ImpulseSensorInterrupt, RISING);
+    attachInterruptArg(_pin, _SensorInterrupt, this, CHANGE);
 
     _lastUpdateTime = millis();
     _uiImpulseStatus = false;
     _lastImpulseCount = 0;
+
+    _estimator = impulseEstimatorInstant;
+    _averagePulses = IMPULSE_AVERAGE_PULSES_DEFAULT;
+    _decay = false;
+
+    _intervalStartTime = millis();
 }
 
 void ImpulseCapture::Update(void) {
@@ -66,6 +369,25 @@ void ImpulseCapture::Update(void) {
             _uiImpulseStatus = false;
         }
     }
+
+    // Forget time stamps older than the longest valid interval before micros()
+    // rolls over and makes them look recent again.
+    uint32_t currentMicros = micros();
+
+    noInterrupts();
+
+    if ((_lastImpulseValid == true) && ((currentMicros - _lastImpulseTime) > _maximumInterval)) {
+        _lastImpulseValid = false;
+        _previousImpulseValid = false;
+        _lastInterval = 0;
+        _pulseTimeCount = 0;
+    }
+
+    if ((_edgeCount > 0) && ((currentMicros - _edgeTimes[IMPULSE_RUN_INTERVALS]) > _maximumInterval)) {
+        _edgeCount = 0;
+    }
+
+    interrupts();
 }
 
 bool ImpulseCapture::GetUIImpulseStatus(void) {
@@ -83,20 +405,170 @@ uint32_t ImpulseCapture::GetImpulseCount(void) {
 }
 
 uint32_t ImpulseCapture::GetInstantWattUsgage(void) {
-    uint32_t instantenousWatt;
-    
+    uint32_t lastInterval;
+
     noInterrupts();
-    instantenousWatt = _instantenousWatt; 
+    lastInterval = _lastInterval;
     interrupts();
 
-    return instantenousWatt;
+    return _IntervalToWatt(lastInterval);
 }
 
 void ImpulseCapture::ClearInstantWattUsage(void) {
 
     noInterrupts();
-    _instantenousWatt = 0;
+    _lastInterval = 0;
     _impulseCount = 0;
     _lastImpulseCount = 0;
-    interrupts();  
-}
\ No newline at end of file
+    _rejectedWidthCount = 0;
+    _rejectedIntervalCount = 0;
+    interrupts();
+}
+
+void ImpulseCapture::SetEstimator(impulseEstimator_e estimator, uint8_t averagePulses, bool decay) {
+    _estimator = estimator;
+    _averagePulses = constrain(averagePulses, 1, IMPULSE_AVERAGE_PULSES_MAX);
+    _decay = decay;
+}
+
+impulseEstimator_e ImpulseCapture::GetEstimator(void) {
+    return _estimator;
+}
+
+uint8_t ImpulseCapture::GetAveragePulses(void) {
+    return _averagePulses;
+}
+
+bool ImpulseCapture::GetDecay(void) {
+    return _decay;
+}
+
+uint32_t ImpulseCapture::GetWattUsage(void) {
+    uint32_t currentTime = micros();
+    uint32_t lastInterval;
+    uint32_t lastPulseTime;
+    uint32_t windowStartTime = 0;
+    uint8_t windowPulses = 0;
+
+    noInterrupts();
+    lastInterval = _lastInterval;
+    lastPulseTime = _lastImpulseTime;
+
+    if ((_estimator == impulseEstimatorAverage) && (_pulseTimeCount > 1)) {
+        windowPulses = min((uint8_t)(_pulseTimeCount - 1), _averagePulses);
+        windowStartTime = _pulseTimes[(_pulseTimeIndex + IMPULSE_AVERAGE_PULSES_MAX - windowPulses) % (IMPULSE_AVERAGE_PULSES_MAX + 1)];
+    }
+
+    interrupts();
+
+    // Without a valid interval there is nothing to estimate from
+    if (lastInterval == 0) {
+        return 0;
+    }
+
+    uint32_t wattUsage = _IntervalToWatt(lastInterval);
+    uint32_t windowEndTime = lastPulseTime;
+
+    if (windowPulses > 0) {
+        wattUsage = (uint32_t)((windowPulses * _wattMicroSecondsPerPulse) / (windowEndTime - windowStartTime));
+    }
+
+    // Only once the next pulse is overdue, the load can at most be what one
+    // more pulse arriving right now would indicate, so decay towards that
+    // bound. It equals the estimate when the pulse is just due, so a steady
+    // load is never read low.
+    if ((_decay == true) && ((currentTime - lastPulseTime) > lastInterval)) {
+        uint32_t decayWatt;
+
+        if (windowPulses > 0)
+            decayWatt = (uint32_t)(((windowPulses + 1) * _wattMicroSecondsPerPulse) / (currentTime - windowStartTime));
+        else
+            decayWatt = (uint32_t)(_wattMicroSecondsPerPulse / (currentTime - lastPulseTime));
+
+        if (decayWatt < wattUsage) {
+            wattUsage = decayWatt;
+        }
+    }
+
+    return wattUsage;
+}
+
+void ImpulseCapture::GetIntervalStatistics(impulseInterval_s *interval) {
+    uint32_t currentTime = millis();
+
+    // Snapshot and restart the aggregate atomically so no pulse is lost or
+    // counted twice between two intervals
+    uint32_t minimumInterval;
+    uint32_t maximumInterval;
+
+    noInterrupts();
+    interval->pulses = _intervalPulses;
+    minimumInterval = _intervalMinimumInterval;
+    maximumInterval = _intervalMaximumInterval;
+    _intervalPulses = 0;
+    _intervalMinimumInterval = UINT32_MAX;
+    _intervalMaximumInterval = 0;
+    interrupts();
+
+    interval->duration = currentTime - _intervalStartTime;
+    _intervalStartTime = currentTime;
+
+    // Mean power from the energy metered over the interval
+    if (interval->duration > 0) {
+        interval->meanWatt = (uint32_t)((interval->pulses * _wattMicroSecondsPerPulse) / ((uint64_t)interval->duration * MICRO_SECONDS_PER_MILLI_SECOND));
+    } else {
+        interval->meanWatt = 0;
+    }
+
+    // The longest interval is the lowest load; without a complete pulse
+    // interval in this period the mean is all that is known
+    if (minimumInterval <= maximumInterval) {
+        interval->minimumWatt = _IntervalToWatt(maximumInterval);
+        interval->maximumWatt = _IntervalToWatt(minimumInterval);
+    } else {
+        interval->minimumWatt = interval->meanWatt;
+        interval->maximumWatt = interval->meanWatt;
+    }
+}
+
+uint32_t ImpulseCapture::GetRejectedWidthCount(void) {
+    uint32_t rejectedWidthCount;
+
+    noInterrupts();
+    rejectedWidthCount = _rejectedWidthCount;
+    interrupts();
+
+    return rejectedWidthCount;
+}
+
+uint32_t ImpulseCapture::GetRejectedIntervalCount(void) {
+    uint32_t rejectedIntervalCount;
+
+    noInterrupts();
+    rejectedIntervalCount = _rejectedIntervalCount;
+    interrupts();
+
+    return rejectedIntervalCount;
+}
+
+uint32_t ImpulseCapture::GetMinimumInterval(void) {
+    uint32_t minimumInterval;
+
+    noInterrupts();
+    minimumInterval = _minimumInterval;
+    interrupts();
+
+    return minimumInterval;
+}
+
+const char * ImpulseCapture::GetName(void) {
+    return _name;
+}
+
+uint8_t ImpulseCapture::GetPin(void) {
+    return _pin;
+}
+
+uint32_t ImpulseCapture::GetPulsesPerKilowattHour(void) {
+    return _pulsesPerKilowattHour;
+}
@@ -14,22 +14,69 @@
 #define WATTS_PER_KILOWATT                  1000
 
 #define SECONDS_PER_HOUR                    3600
-#define PULSES_PER_WATT_SECOND              SECONDS_PER_HOUR * (WATTS_PER_KILOWATT / PULSES_PER_KILOWATT_HOUR)
+#define MICRO_SECONDS_PER_MILLI_SECOND      1000
+#define WATT_MICRO_SECONDS_PER_KILOWATT_HOUR 3600000000000ULL
 
-#define MAXIMUM_WATT_SUPPORTED              15000
-#define MINIMUM_WATT_SUPPORTED              1
-#define MIMIMUM_MILLI_SECOND_BTWN_IMPULSES  25      // (1 / (MAXIMUM_WATT_SUPPORTED / 360)) * 1000
-#define MAXIMUM_MILLI_SECOND_BTWN_IMPULSES  360000  // (1 / (MINIMUM_WATT_SUPPORTED / 360)) * 1000
+#define MAXIMUM_WATT_SUPPORTED              15000   // shortest valid interval, 25 ms at 10000 pulses per kWh
+#define MINIMUM_WATT_SUPPORTED              1       // longest valid interval, 360 s at 10000 pulses per kWh
+#define MAXIMUM_MICRO_SECOND_BTWN_IMPULSES  3600000000UL    // capped well inside the micros() roll over
+
+// Glitch filter, a pulse is only counted when its width (rising to falling
+// edge) is plausible for the meter LED and it does not arrive much earlier than
+// the rolling median of the recently accepted intervals predicts. Of two
+// pulses within one expected interval the one that fits the median better is
+// kept. A pulse this many medians late restarts the median at the lower load,
+// and a run of evenly spaced pulses too early for it is a higher load whose
+// pulses all count.
+#define IMPULSE_MINIMUM_WIDTH_MICRO_SECONDS 2000
+#define IMPULSE_MAXIMUM_WIDTH_MICRO_SECONDS 200000
+#define IMPULSE_MEDIAN_INTERVALS            5       // odd, rolling window of accepted intervals
+#define IMPULSE_MEDIAN_DIVISOR              2       // reject intervals shorter than median / divisor
+#define IMPULSE_RESEED_FACTOR               4
+#define IMPULSE_RUN_INTERVALS               4       // at most 7, edges are flagged in a byte
+#define IMPULSE_RUN_TOLERANCE               8       // spread of the run within 1/8 of its mean
+
+#define IMPULSE_AVERAGE_PULSES_MAX          16
+#define IMPULSE_AVERAGE_PULSES_DEFAULT      4
+
+#define IMPULSE_CHANNELS_MAX                4
+#define IMPULSE_PIN_NONE                    0xFF
+
+//=============================================================================
+// Types
+//=============================================================================
+
+typedef enum {
+
+    impulseEstimatorInstant = 0,    // last interval only
+    impulseEstimatorAverage,        // mean over the last N intervals
+
+} impulseEstimator_e;
+
+// Aggregate over one reporting interval, e.g. a log record
+typedef struct {
+
+    uint32_t pulses;
+    uint32_t duration;      // milli-seconds
+    uint32_t meanWatt;      // from the energy metered
+    uint32_t minimumWatt;   // over the pulse intervals confirmed in this interval
+    uint32_t maximumWatt;
+
+} impulseInterval_s;
 
 //=============================================================================
 // Classes
 //=============================================================================
 
+// One meter per instance; every instance registers its own pin and receives
+// its edges through a shared interrupt trampoline with the instance as argument.
 class ImpulseCapture
 {
     public:
-        ImpulseCapture(uint8_t impulsePin);
+        ImpulseCapture(uint8_t impulsePin = IMPULSE_PIN_NONE, uint32_t pulsesPerKilowattHour = PULSES_PER_KILOWATT_HOUR, const char *name = "import");
 
+        void Configure(uint8_t impulsePin, const char *name);
+        void SetMeterConstants(uint32_t pulsesPerKilowattHour, uint32_t minimumWatt, uint32_t maximumWatt);
         void Init(void);
         void Update(void);
         bool GetUIImpulseStatus(void);
@@ -37,11 +84,83 @@ class ImpulseCapture
         uint32_t GetInstantWattUsgage(void);
         void ClearInstantWattUsage(void);
 
+        void SetEstimator(impulseEstimator_e estimator, uint8_t averagePulses, bool decay);
+        impulseEstimator_e GetEstimator(void);
+        uint8_t GetAveragePulses(void);
+        bool GetDecay(void);
+        uint32_t GetWattUsage(void);
+        void GetIntervalStatistics(impulseInterval_s *interval);
+
+        uint32_t GetRejectedWidthCount(void);
+        uint32_t GetRejectedIntervalCount(void);
+        uint32_t GetMinimumInterval(void);
+
+        const char *GetName(void);
+        uint8_t GetPin(void);
+        uint32_t GetPulsesPerKilowattHour(void);
+
     private:
+        static void _SensorInterrupt(void *channel);
+        void _HandleEdge(void);
+        uint32_t _MedianInterval(void);
+        void _SetMinimumInterval(void);
+        void _AddMedianInterval(uint32_t interval);
+        void _SeedMedianIntervals(uint32_t interval);
+        uint32_t _GetRunInterval(void);
+        void _AddPulseTime(uint32_t pulseTime);
+        void _AddIntervalStatistics(uint32_t interval);
+        uint32_t _IntervalToWatt(uint32_t interval);
+
         uint8_t _pin;
+        const char *_name;
         bool _uiImpulseStatus;
         uint32_t _lastImpulseCount;
         uint32_t _lastUpdateTime;
+
+        // Meter constants, derived once from the pulses per kWh so the
+        // interrupt handler only compares and never divides
+        uint32_t _pulsesPerKilowattHour;
+        uint64_t _wattMicroSecondsPerPulse;
+        uint32_t _minimumIntervalFloor;
+        uint32_t _maximumInterval;
+
+        impulseEstimator_e _estimator;
+        uint8_t _averagePulses;
+        bool _decay;
+
+        uint32_t _intervalStartTime;
+
+        // Shared with the interrupt handler, all times in micro-seconds
+        volatile uint32_t _impulseCount;
+        volatile uint32_t _lastInterval;    // 0 while no valid interval is known
+
+        volatile uint32_t _risingEdgeTime;
+        volatile bool _risingEdgeSeen;
+        volatile uint32_t _lastImpulseTime;
+        volatile bool _lastImpulseValid;
+        volatile uint32_t _previousImpulseTime;
+        volatile bool _previousImpulseValid;
+        uint32_t _medianIntervals[IMPULSE_MEDIAN_INTERVALS];
+        uint8_t _medianIndex;
+        uint8_t _medianCount;
+        volatile uint32_t _minimumInterval;
+        volatile uint32_t _rejectedWidthCount;
+        volatile uint32_t _rejectedIntervalCount;
+
+        // Well formed pulses, accepted or not, oldest first, for the run check
+        uint32_t _edgeTimes[IMPULSE_RUN_INTERVALS + 1];
+        uint8_t _edgeCounted;               // bit per entry of _edgeTimes
+        volatile uint8_t _edgeCount;
+
+        // Time stamps of the most recent accepted pulses for the averaging estimator
+        uint32_t _pulseTimes[IMPULSE_AVERAGE_PULSES_MAX + 1];
+        uint8_t _pulseTimeIndex;
+        volatile uint8_t _pulseTimeCount;
+
+        // Running aggregate of the current reporting interval
+        volatile uint32_t _intervalPulses;
+        volatile uint32_t _intervalMinimumInterval;
+        volatile uint32_t _intervalMaximumInterval;
 };
 
 #endif // IMPULSE_CAPTURE_H
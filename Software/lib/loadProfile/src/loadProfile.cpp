@@ -0,0 +1,250 @@
+#include "loadProfile.h"
+
+#include <coredecls.h>
+
+static const char *_slotPaths[LOAD_PROFILE_SLOTS] = {LOAD_PROFILE_SLOT_PATH_0, LOAD_PROFILE_SLOT_PATH_1};
+static const uint8_t _quantilePercents[LOAD_PROFILE_QUANTILES] = {10, 50, 90};
+
+//=============================================================================
+// Object constructors
+//=============================================================================
+
+LoadProfile::LoadProfile(void) {
+    memset(&_data, 0, sizeof(_data));
+    _sequence = 0;
+    _activeSlot = 0;
+    _block = 0;
+    _blockSum = 0;
+    _blockCount = 0;
+    _blockFirst = 0;
+    _blockLast = 0;
+    _dirty = false;
+    _savedHour = 0;
+}
+
+//=============================================================================
+// Private functions
+//=============================================================================
+
+// A finished 15 minute block before the end of the night lowers the minimum of
+// that night
+void LoadProfile::_AddBlock(uint32_t block, uint32_t watts) {
+    uint32_t epoch = block * LOAD_PROFILE_BLOCK_SECONDS;
+    uint32_t day = epoch / LOAD_PROFILE_SECONDS_PER_DAY;
+
+    if (((epoch % LOAD_PROFILE_SECONDS_PER_DAY) / LOAD_PROFILE_SECONDS_PER_HOUR) >= LOAD_PROFILE_NIGHT_END_HOUR)
+        return;
+
+    loadProfileNight_s *night = &_data.nights[day % LOAD_PROFILE_NIGHTS_KEPT];
+
+    if (night->day != day) {
+        night->day = day;
+        night->minimum = UINT16_MAX;
+        night->blocks = 0;
+    }
+
+    night->minimum = min<uint32_t>(night->minimum, min<uint32_t>(watts, UINT16_MAX));
+    night->blocks++;
+}
+
+//=============================================================================
+// Public functions
+//=============================================================================
+
+bool LoadProfile::Begin(void) {
+    loadProfileHeader_s headers[LOAD_PROFILE_SLOTS];
+    bool slotValid[LOAD_PROFILE_SLOTS];
+
+    // The payload is read straight into place, so the newer slot is tried first
+    for (uint8_t slot = 0; slot < LOAD_PROFILE_SLOTS; slot++) {
+        File profileFile = LittleFS.open(_slotPaths[slot], "r");
+
+        slotValid[slot] = profileFile &&
+                          (profileFile.read((uint8_t *)&headers[slot], sizeof(headers[slot])) == sizeof(headers[slot])) &&
+                          (headers[slot].magic == LOAD_PROFILE_MAGIC) &&
+                          (headers[slot].version == LOAD_PROFILE_VERSION) &&
+                          (headers[slot].size == sizeof(_data));
+
+        if (profileFile)
+            profileFile.close();
+    }
+
+    uint8_t newest = ((slotValid[0] == true) && ((slotValid[1] == false) || ((int32_t)(headers[0].sequence - headers[1].sequence) > 0))) ? 0 : 1;
+
+    for (uint8_t i = 0; i < LOAD_PROFILE_SLOTS; i++) {
+        uint8_t slot = (newest + i) % LOAD_PROFILE_SLOTS;
+
+        if (slotValid[slot] == false)
+            continue;
+
+        File profileFile = LittleFS.open(_slotPaths[slot], "r");
+
+        profileFile.seek(sizeof(loadProfileHeader_s));
+        bool valid = (profileFile.read((uint8_t *)&_data, sizeof(_data)) == sizeof(_data)) &&
+                     (crc32(&_data, sizeof(_data)) == headers[slot].crc);
+
+        profileFile.close();
+
+        if (valid == true) {
+            _sequence = headers[slot].sequence;
+            _activeSlot = slot;
+            return true;
+        }
+    }
+
+    memset(&_data, 0, sizeof(_data));
+
+    return false;
+}
+
+// One log record at its local epoch, watts averaged over the log interval
+void LoadProfile::Add(uint32_t epoch, uint32_t watts) {
+    if (epoch == 0)
+        return;
+
+    loadProfileBin_s *bin = &_data.bins[GetHourOfWeek(epoch)];
+    uint32_t scaledWatts = min<uint32_t>(watts * LOAD_PROFILE_QUANTILE_SCALE, UINT16_MAX);
+
+    if (bin->count == 0) {
+        bin->mean = watts * LOAD_PROFILE_MEAN_SCALE;
+
+        for (uint8_t i = 0; i < LOAD_PROFILE_QUANTILES; i++) {
+            bin->quantiles[i] = scaledWatts;
+        }
+    } else {
+        uint32_t samples = min<uint32_t>(bin->count + 1, LOAD_PROFILE_MEAN_SAMPLES);
+
+        bin->mean += ((int32_t)(watts * LOAD_PROFILE_MEAN_SCALE) - (int32_t)bin->mean) / (int32_t)samples;
+
+        // Above the estimate it moves up by p of a step, below down by 1 - p,
+        // so it settles where a fraction p of the samples is below it
+        uint32_t step = max<uint32_t>(LOAD_PROFILE_QUANTILE_STEP_MIN,
+                                      ((bin->mean / (LOAD_PROFILE_MEAN_SCALE / LOAD_PROFILE_QUANTILE_SCALE)) * LOAD_PROFILE_QUANTILE_GAIN) / samples);
+
+        for (uint8_t i = 0; i < LOAD_PROFILE_QUANTILES; i++) {
+            uint32_t quantile = bin->quantiles[i];
+
+            if (scaledWatts > quantile)
+                quantile = min(quantile + ((step * _quantilePercents[i]) + 50) / 100, scaledWatts);
+            else if (scaledWatts < quantile)
+                quantile = max(quantile - min(quantile, ((step * (100 - _quantilePercents[i])) + 50) / 100), scaledWatts);
+
+            bin->quantiles[i] = quantile;
+        }
+    }
+
+    if (bin->count < UINT16_MAX)
+        bin->count++;
+
+    // Baseload from 15 minute means, single log intervals at low load are
+    // too coarse
+    uint32_t block = epoch / LOAD_PROFILE_BLOCK_SECONDS;
+
+    if ((block != _block) && (_blockCount > 0) && ((_blockLast - _blockFirst) >= LOAD_PROFILE_BLOCK_MINIMUM_SECONDS))
+        _AddBlock(_block, _blockSum / _blockCount);
+
+    if (block != _block) {
+        _block = block;
+        _blockSum = 0;
+        _blockCount = 0;
+        _blockFirst = epoch;
+    }
+
+    _blockSum += watts;
+    _blockCount++;
+    _blockLast = epoch;
+
+    if (_dirty == false)
+        _savedHour = GetHourOfWeek(epoch);
+
+    _dirty = true;
+}
+
+// Saves once the hour of week changed since the first unsaved sample
+void LoadProfile::Update(void) {
+    if ((_dirty == true) && (_block != 0) && (GetHourOfWeek(_block * LOAD_PROFILE_BLOCK_SECONDS) != _savedHour))
+        Save();
+}
+
+bool LoadProfile::Save(void) {
+    loadProfileHeader_s header;
+    uint8_t slot = (_sequence != 0) ? (_activeSlot + 1) % LOAD_PROFILE_SLOTS : _activeSlot;
+
+    if (_dirty == false)
+        return true;
+
+    header.magic = LOAD_PROFILE_MAGIC;
+    header.version = LOAD_PROFILE_VERSION;
+    header.size = sizeof(_data);
+    header.sequence = _sequence + 1;
+    header.crc = crc32(&_data, sizeof(_data));
+
+    File profileFile = LittleFS.open(_slotPaths[slot], "w");
+
+    if (!profileFile)
+        return false;
+
+    size_t written = profileFile.write((const uint8_t *)&header, sizeof(header));
+    written += profileFile.write((const uint8_t *)&_data, sizeof(_data));
+    profileFile.close();
+
+    if (written != (sizeof(header) + sizeof(_data)))
+        return false;
+
+    _activeSlot = slot;
+    _sequence = header.sequence;
+    _dirty = false;
+
+    return true;
+}
+
+const loadProfileBin_s *LoadProfile::GetBin(uint8_t hourOfWeek) {
+    return (hourOfWeek < LOAD_PROFILE_HOURS) ? &_data.bins[hourOfWeek] : NULL;
+}
+
+// NULL when the night is not in the ring any more or had no sample
+const loadProfileNight_s *LoadProfile::GetNight(uint32_t day) {
+    const loadProfileNight_s *night = &_data.nights[day % LOAD_PROFILE_NIGHTS_KEPT];
+
+    return ((night->day == day) && (night->blocks > 0)) ? night : NULL;
+}
+
+// Median of the nightly minima of the nights kept up to the given day, 0
+// without any
+uint32_t LoadProfile::GetBaseload(uint32_t day) {
+    uint16_t minima[LOAD_PROFILE_NIGHTS_KEPT];
+    uint8_t count = 0;
+
+    for (uint32_t i = 0; (i < LOAD_PROFILE_NIGHTS_KEPT) && (i <= day); i++) {
+        const loadProfileNight_s *night = GetNight(day - i);
+
+        if (night == NULL)
+            continue;
+
+        // Insertion sort, there are at most 14
+        uint8_t position = count++;
+
+        while ((position > 0) && (minima[position - 1] > night->minimum)) {
+            minima[position] = minima[position - 1];
+            position--;
+        }
+
+        minima[position] = night->minimum;
+    }
+
+    if (count == 0)
+        return 0;
+
+    return ((count % 2) == 1) ? minima[count / 2] : (minima[(count / 2) - 1] + minima[count / 2]) / 2;
+}
+
+uint8_t LoadProfile::GetQuantilePercent(uint8_t quantile) {
+    return (quantile < LOAD_PROFILE_QUANTILES) ? _quantilePercents[quantile] : 0;
+}
+
+// Epochs include the UTC offset; 1970-01-01 was a Thursday, Monday is 0
+uint8_t LoadProfile::GetHourOfWeek(uint32_t epoch) {
+    uint32_t day = epoch / LOAD_PROFILE_SECONDS_PER_DAY;
+
+    return (((day + 3) % 7) * 24) + ((epoch % LOAD_PROFILE_SECONDS_PER_DAY) / LOAD_PROFILE_SECONDS_PER_HOUR);
+}
@@ -0,0 +1,126 @@
+#ifndef LOAD_PROFILE_H
+#define LOAD_PROFILE_H
+
+#include "Arduino.h"
+
+#include <FS.h>
+#include <LittleFS.h>
+
+//=============================================================================
+// Defines
+//=============================================================================
+
+#define LOAD_PROFILE_HOURS                  168     // hours of the week, Monday 00:00 first
+#define LOAD_PROFILE_QUANTILES              3       // 10th, 50th and 90th percentile
+#define LOAD_PROFILE_SECONDS_PER_DAY        86400
+#define LOAD_PROFILE_SECONDS_PER_HOUR       3600
+
+// The mean of an hour follows the last this many samples of it, about three
+// weeks at the default 10 s log interval
+#define LOAD_PROFILE_MEAN_SAMPLES           1024
+#define LOAD_PROFILE_MEAN_SCALE             1024    // mean is kept in 1/1024 W
+
+// Quantile estimates step by twice the mean of their hour over the samples
+// seen, capped like the mean, so they settle within the first hour and then
+// weigh recent weeks. Steps never go below 5 W, where the scale keeps the
+// 10/90 split of a step exact.
+#define LOAD_PROFILE_QUANTILE_SCALE         4       // quantiles are kept in 1/4 W
+#define LOAD_PROFILE_QUANTILE_STEP_MIN      20      // 1/4 W
+#define LOAD_PROFILE_QUANTILE_GAIN          2
+
+// Baseload is the lowest 15 minute mean between midnight and 05:00 local
+// time, the median over the nights kept. Blocks seen for less than half of
+// their time, as after a boot, do not count.
+#define LOAD_PROFILE_BLOCK_SECONDS          900
+#define LOAD_PROFILE_BLOCK_MINIMUM_SECONDS  450
+#define LOAD_PROFILE_NIGHT_END_HOUR         5
+#define LOAD_PROFILE_NIGHTS_KEPT            14
+
+// Saved alternately to two slots like the tariff totals, once an hour and
+// before a planned reset or deep sleep
+#define LOAD_PROFILE_SLOT_PATH_0            "/profile0.bin"
+#define LOAD_PROFILE_SLOT_PATH_1            "/profile1.bin"
+#define LOAD_PROFILE_SLOTS                  2
+#define LOAD_PROFILE_MAGIC                  0x4C505246  // "LPRF"
+#define LOAD_PROFILE_VERSION                1
+
+//=============================================================================
+// Types
+//=============================================================================
+
+typedef struct {
+
+    uint32_t mean;                      // 1/LOAD_PROFILE_MEAN_SCALE W
+    uint16_t count;                     // samples, saturating
+    uint16_t quantiles[LOAD_PROFILE_QUANTILES];  // 1/LOAD_PROFILE_QUANTILE_SCALE W
+
+} loadProfileBin_s;
+
+typedef struct {
+
+    uint32_t day;                       // local day number of the night, 0 when unused
+    uint16_t minimum;                   // lowest 15 minute mean, watts
+    uint16_t blocks;                    // 15 minute blocks seen that night
+
+} loadProfileNight_s;
+
+typedef struct {
+
+    uint32_t magic;
+    uint16_t version;
+    uint16_t size;                      // of the payload following the header
+    uint32_t sequence;
+    uint32_t crc;
+
+} loadProfileHeader_s;
+
+typedef struct {
+
+    loadProfileBin_s bins[LOAD_PROFILE_HOURS];
+    loadProfileNight_s nights[LOAD_PROFILE_NIGHTS_KEPT];    // indexed by day number modulo
+
+} loadProfileData_s;
+
+//=============================================================================
+// Classes
+//=============================================================================
+
+// Hour of week load profile and nightly baseload, updated with every log
+// record in constant time. Each hour keeps a running mean and three
+// percentiles as frugal streaming estimates, which step up or down by a
+// weighted amount per sample instead of keeping the samples.
+class LoadProfile
+{
+    public:
+        LoadProfile(void);
+
+        bool Begin(void);
+        void Add(uint32_t epoch, uint32_t watts);
+        void Update(void);
+        bool Save(void);
+
+        const loadProfileBin_s *GetBin(uint8_t hourOfWeek);
+        const loadProfileNight_s *GetNight(uint32_t day);
+        uint32_t GetBaseload(uint32_t day);
+
+        static uint8_t GetQuantilePercent(uint8_t quantile);
+        static uint8_t GetHourOfWeek(uint32_t epoch);
+
+    private:
+        void _AddBlock(uint32_t block, uint32_t watts);
+
+        loadProfileData_s _data;
+        uint32_t _sequence;
+        uint8_t _activeSlot;
+
+        uint32_t _block;                // 15 minute block being averaged
+        uint32_t _blockSum;
+        uint32_t _blockCount;
+        uint32_t _blockFirst;           // epochs of the first and last sample
+        uint32_t _blockLast;
+
+        bool _dirty;
+        uint8_t _savedHour;
+};
+
+#endif // LOAD_PROFILE_H
@@ -0,0 +1,142 @@
+#include "logCodec.h"
+
+//=============================================================================
+// Defines
+//=============================================================================
+
+// Prefix of 1 to 4 bits, then the zig-zag value in the class width
+static const uint8_t codeWidths[] = {0, 7, 12, 20, 32};
+
+//=============================================================================
+// Private functions
+//=============================================================================
+
+uint32_t LogCodec::_WriteBits(uint8_t *buffer, uint32_t bitPosition, uint32_t value, uint8_t bits) {
+    for (int8_t bit = bits - 1; bit >= 0; bit--) {
+        uint8_t mask = 0x80 >> (bitPosition & 7);
+
+        if ((value >> bit) & 1)
+            buffer[bitPosition >> 3] |= mask;
+        else
+            buffer[bitPosition >> 3] &= ~mask;
+
+        bitPosition++;
+    }
+
+    return bitPosition;
+}
+
+bool LogCodec::_ReadBits(const uint8_t *buffer, uint32_t bitLength, uint32_t *bitPosition, uint8_t bits, uint32_t *value) {
+    if ((*bitPosition + bits) > bitLength)
+        return false;
+
+    uint32_t result = 0;
+
+    for (uint8_t bit = 0; bit < bits; bit++) {
+        result = (result << 1) | ((buffer[*bitPosition >> 3] >> (7 - (*bitPosition & 7))) & 1);
+        (*bitPosition)++;
+    }
+
+    *value = result;
+    return true;
+}
+
+uint32_t LogCodec::_WriteCode(uint8_t *buffer, uint32_t bitPosition, int32_t value) {
+    uint32_t zigZag = ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+    uint8_t codeClass = 0;
+
+    while ((codeClass < 4) && (zigZag >= ((codeClass == 0) ? 1UL : (1UL << codeWidths[codeClass])))) {
+        codeClass++;
+    }
+
+    // 0, 10, 110, 1110, 1111
+    if (codeClass < 4)
+        bitPosition = _WriteBits(buffer, bitPosition, ((1UL << codeClass) - 1) << 1, codeClass + 1);
+    else
+        bitPosition = _WriteBits(buffer, bitPosition, 0x0F, 4);
+
+    return _WriteBits(buffer, bitPosition, zigZag, codeWidths[codeClass]);
+}
+
+bool LogCodec::_ReadCode(const uint8_t *buffer, uint32_t bitLength, uint32_t *bitPosition, int32_t *value) {
+    uint8_t codeClass = 0;
+    uint32_t bit;
+    uint32_t zigZag = 0;
+
+    while (codeClass < 4) {
+        if (_ReadBits(buffer, bitLength, bitPosition, 1, &bit) == false)
+            return false;
+
+        if (bit == 0)
+            break;
+
+        codeClass++;
+    }
+
+    if ((codeWidths[codeClass] > 0) && (_ReadBits(buffer, bitLength, bitPosition, codeWidths[codeClass], &zigZag) == false))
+        return false;
+
+    *value = (int32_t)((zigZag >> 1) ^ (0 - (zigZag & 1)));
+    return true;
+}
+
+//=============================================================================
+// Public functions
+//=============================================================================
+
+void LogCodec::Reset(logCodecState_s *state, uint8_t fieldCount, uint32_t epoch) {
+    memset(state, 0, sizeof(*state));
+    state->epoch = epoch;
+    state->fieldCount = min<uint8_t>(fieldCount, LOG_CODEC_FIELDS_MAX);
+}
+
+// Appends one record at bitPosition, the bits before it in the first byte are
+// kept; returns the bit position after the record
+uint32_t LogCodec::Encode(logCodecState_s *state, uint32_t epoch, const int32_t *values, uint8_t *buffer, uint32_t bitPosition) {
+    int32_t delta = (int32_t)(epoch - state->epoch);
+
+    bitPosition = _WriteCode(buffer, bitPosition, (int32_t)((uint32_t)delta - (uint32_t)state->delta));
+    state->delta = delta;
+    state->epoch = epoch;
+
+    for (uint8_t i = 0; i < state->fieldCount; i++) {
+        // Differences wrap in 32 bits, the decoder wraps them back
+        bitPosition = _WriteCode(buffer, bitPosition, (int32_t)((uint32_t)values[i] - (uint32_t)state->values[i]));
+        state->values[i] = values[i];
+    }
+
+    return bitPosition;
+}
+
+// Decodes the record at bitPosition; on a truncated record nothing changes
+// and false is returned
+bool LogCodec::Decode(logCodecState_s *state, const uint8_t *buffer, uint32_t bitLength, uint32_t *bitPosition, uint32_t *epoch, int32_t *values) {
+    uint32_t position = *bitPosition;
+    int32_t deltaOfDelta;
+    int32_t difference;
+
+    if (_ReadCode(buffer, bitLength, &position, &deltaOfDelta) == false)
+        return false;
+
+    for (uint8_t i = 0; i < state->fieldCount; i++) {
+        if (_ReadCode(buffer, bitLength, &position, &difference) == false)
+            return false;
+
+        values[i] = (int32_t)((uint32_t)state->values[i] + (uint32_t)difference);
+    }
+
+    state->delta = (int32_t)((uint32_t)state->delta + (uint32_t)deltaOfDelta);
+    state->epoch += (uint32_t)state->delta;
+    memcpy(state->values, values, state->fieldCount * sizeof(int32_t));
+
+    *epoch = state->epoch;
+    *bitPosition = position;
+
+    return true;
+}
+
+// Fills the rest of the byte holding bitPosition with 1 bits
+void LogCodec::Pad(uint8_t *buffer, uint32_t bitPosition) {
+    if ((bitPosition & 7) != 0)
+        buffer[bitPosition >> 3] |= 0xFF >> (bitPosition & 7);
+}
@@ -0,0 +1,55 @@
+#ifndef LOG_CODEC_H
+#define LOG_CODEC_H
+
+#include "Arduino.h"
+
+//=============================================================================
+// Defines
+//=============================================================================
+
+#define LOG_CODEC_FIELDS_MAX                17      // 4 values for each of 4 channels, and the record flags
+
+// Worst case: a 36 bit time stamp code plus a 36 bit code per field
+#define LOG_CODEC_RECORD_BITS_MAX           (36 * (1 + LOG_CODEC_FIELDS_MAX))
+#define LOG_CODEC_RECORD_BYTES_MAX          ((LOG_CODEC_RECORD_BITS_MAX + 7) / 8)
+
+//=============================================================================
+// Types
+//=============================================================================
+
+// Everything a record is coded against: the previous time stamp and spacing
+// and the previous value of every field
+typedef struct {
+
+    uint32_t epoch;
+    int32_t delta;
+    int32_t values[LOG_CODEC_FIELDS_MAX];
+    uint8_t fieldCount;
+
+} logCodecState_s;
+
+//=============================================================================
+// Classes
+//=============================================================================
+
+// Time series codec after Gorilla: the time stamp as delta of delta, every
+// field as the zig-zag coded difference to its previous value, each in a
+// prefix code of 1, 9, 15, 24 or 36 bits. Records are packed MSB first
+// without alignment; a stream ends in 1 bits, which never form a complete
+// record, so a decoder stops cleanly at the end or at a torn write.
+class LogCodec
+{
+    public:
+        static void Reset(logCodecState_s *state, uint8_t fieldCount, uint32_t epoch);
+        static uint32_t Encode(logCodecState_s *state, uint32_t epoch, const int32_t *values, uint8_t *buffer, uint32_t bitPosition);
+        static bool Decode(logCodecState_s *state, const uint8_t *buffer, uint32_t bitLength, uint32_t *bitPosition, uint32_t *epoch, int32_t *values);
+        static void Pad(uint8_t *buffer, uint32_t bitPosition);
+
+    private:
+        static uint32_t _WriteBits(uint8_t *buffer, uint32_t bitPosition, uint32_t value, uint8_t bits);
+        static bool _ReadBits(const uint8_t *buffer, uint32_t bitLength, uint32_t *bitPosition, uint8_t bits, uint32_t *value);
+        static uint32_t _WriteCode(uint8_t *buffer, uint32_t bitPosition, int32_t value);
+        static bool _ReadCode(const uint8_t *buffer, uint32_t bitLength, uint32_t *bitPosition, int32_t *value);
+};
+
+#endif // LOG_CODEC_H
@@ -0,0 +1,308 @@
+#include "logStore.h"
+
+//=============================================================================
+// Object constructors
+//=============================================================================
+
+LogReader::LogReader(void) {
+    memset(&_state, 0, sizeof(_state));
+    _bufferBytes = 0;
+    _bufferBitPosition = 0;
+    _consumedBytes = 0;
+}
+
+LogStore::LogStore(void) {
+    _fieldCount = 0;
+    _firstBlock = 0;
+    _lastBlock = 0;
+    _blockOpen = false;
+    _bitLength = 0;
+    _tailByte = 0;
+    _recordCount = 0;
+
+    memset(&_state, 0, sizeof(_state));
+}
+
+//=============================================================================
+// LogReader private functions
+//=============================================================================
+
+// Drops the bytes already decoded and tops the buffer up from the file
+bool LogReader::_Fill(void) {
+    uint32_t consumed = _bufferBitPosition / 8;
+
+    memmove(_buffer, &_buffer[consumed], _bufferBytes - consumed);
+    _bufferBytes -= consumed;
+    _bufferBitPosition -= consumed * 8;
+    _consumedBytes += consumed;
+
+    if ((_file == false) || (_bufferBytes >= sizeof(_buffer)))
+        return false;
+
+    size_t received = _file.read(&_buffer[_bufferBytes], sizeof(_buffer) - _bufferBytes);
+    _bufferBytes += received;
+
+    return (received > 0);
+}
+
+//=============================================================================
+// LogReader public functions
+//=============================================================================
+
+bool LogReader::Open(const char *path) {
+    logBlockHeader_s header;
+
+    Close();
+    _file = LittleFS.open(path, "r");
+
+    if (_file == false)
+        return false;
+
+    if ((_file.read((uint8_t *)&header, sizeof(header)) != sizeof(header)) ||
+        (header.magic != LOG_STORE_BLOCK_MAGIC) || (header.version != LOG_STORE_BLOCK_VERSION) ||
+        (header.fieldCount == 0) || (header.fieldCount > LOG_CODEC_FIELDS_MAX)) {
+        Close();
+        return false;
+    }
+
+    LogCodec::Reset(&_state, header.fieldCount, header.epoch);
+    _bufferBytes = 0;
+    _bufferBitPosition = 0;
+    _consumedBytes = 0;
+
+    return true;
+}
+
+bool LogReader::Next(uint32_t *epoch, int32_t *values) {
+    do {
+        if (LogCodec::Decode(&_state, _buffer, _bufferBytes * 8, &_bufferBitPosition, epoch, values) == true)
+            return true;
+    } while (_Fill() == true);
+
+    return false;
+}
+
+void LogReader::Close(void) {
+    if (_file == true)
+        _file.close();
+
+    _bufferBytes = 0;
+    _bufferBitPosition = 0;
+}
+
+uint8_t LogReader::GetFieldCount(void) {
+    return _state.fieldCount;
+}
+
+// Bits after the header up to the end of the last decoded record
+uint32_t LogReader::GetBitPosition(void) {
+    return (_consumedBytes * 8) + _bufferBitPosition;
+}
+
+const logCodecState_s * LogReader::GetState(void) {
+    return &_state;
+}
+
+//=============================================================================
+// LogStore private functions
+//=============================================================================
+
+bool LogStore::_StartBlock(uint32_t epoch) {
+    char path[LOG_STORE_PATH_MAX];
+    logBlockHeader_s header = {LOG_STORE_BLOCK_MAGIC, LOG_STORE_BLOCK_VERSION, _fieldCount, 0, epoch};
+
+    if (_lastBlock == 0)
+        _firstBlock = 1;
+
+    GetBlockPath(_lastBlock + 1, path);
+    File blockFile = LittleFS.open(path, "w");
+
+    if (blockFile == false)
+        return false;
+
+    blockFile.write((const uint8_t *)&header, sizeof(header));
+    blockFile.close();
+
+    _lastBlock++;
+    _blockOpen = true;
+    _bitLength = 0;
+    _tailByte = 0;
+    LogCodec::Reset(&_state, _fieldCount, epoch);
+
+    _DropOldBlocks();
+
+    return true;
+}
+
+// Continues the last block after a reset: decoding it gives the codec state,
+// anything after the last complete record (a torn write) is cut off
+bool LogStore::_Restore(void) {
+    char path[LOG_STORE_PATH_MAX];
+    LogReader reader;
+    uint32_t epoch;
+    int32_t values[LOG_CODEC_FIELDS_MAX];
+    uint32_t records = 0;
+
+    GetBlockPath(_lastBlock, path);
+
+    if ((reader.Open(path) == false) || (reader.GetFieldCount() != _fieldCount))
+        return false;
+
+    while (reader.Next(&epoch, values) == true) {
+        records++;
+    }
+
+    _state = *reader.GetState();
+    _bitLength = reader.GetBitPosition();
+    reader.Close();
+
+    uint32_t dataBytes = (_bitLength + 7) / 8;
+    File blockFile = LittleFS.open(path, "r+");
+
+    if (blockFile == false)
+        return false;
+
+    if (blockFile.size() > (sizeof(logBlockHeader_s) + dataBytes))
+        blockFile.truncate(sizeof(logBlockHeader_s) + dataBytes);
+
+    _tailByte = 0;
+
+    if ((_bitLength & 7) != 0) {
+        blockFile.seek(sizeof(logBlockHeader_s) + (_bitLength / 8));
+        _tailByte = blockFile.read();
+        LogCodec::Pad(&_tailByte, _bitLength & 7);
+    }
+
+    blockFile.close();
+
+    _blockOpen = true;
+    _recordCount = records;
+
+    return true;
+}
+
+// Oldest history goes first when the file system runs short
+void LogStore::_DropOldBlocks(void) {
+    FSInfo fsInfo;
+    char path[LOG_STORE_PATH_MAX];
+
+    while (_firstBlock < _lastBlock) {
+        if ((LittleFS.info(fsInfo) == false) || ((fsInfo.totalBytes - fsInfo.usedBytes) >= LOG_STORE_FREE_MIN))
+            return;
+
+        GetBlockPath(_firstBlock++, path);
+        LittleFS.remove(path);
+    }
+}
+
+//=============================================================================
+// LogStore public functions
+//=============================================================================
+
+bool LogStore::Begin(uint8_t fieldCount) {
+    _fieldCount = min<uint8_t>(fieldCount, LOG_CODEC_FIELDS_MAX);
+    _firstBlock = 0;
+    _lastBlock = 0;
+    _blockOpen = false;
+    _recordCount = 0;
+
+    LittleFS.mkdir(LOG_STORE_DIRECTORY);
+    Dir directory = LittleFS.openDir(LOG_STORE_DIRECTORY);
+
+    while (directory.next()) {
+        uint32_t sequence = strtoul(directory.fileName().c_str(), NULL, 16);
+
+        if (sequence == 0)
+            continue;
+
+        if ((_firstBlock == 0) || (sequence < _firstBlock))
+            _firstBlock = sequence;
+
+        if (sequence > _lastBlock)
+            _lastBlock = sequence;
+    }
+
+    // A block of another layout is left as it is, the next record starts a new one
+    if (_lastBlock > 0)
+        _Restore();
+
+    return true;
+}
+
+bool LogStore::Append(uint32_t epoch, const int32_t *values) {
+    char path[LOG_STORE_PATH_MAX];
+    uint8_t buffer[LOG_CODEC_RECORD_BYTES_MAX + 1];
+
+    if ((_blockOpen == false) || ((sizeof(logBlockHeader_s) + ((_bitLength + 7) / 8) + LOG_CODEC_RECORD_BYTES_MAX) > LOG_STORE_BLOCK_BYTES)) {
+        if (_StartBlock(epoch) == false)
+            return false;
+    }
+
+    // The record continues in the padded last byte, which is written again
+    memset(buffer, 0, sizeof(buffer));
+    buffer[0] = _tailByte;
+
+    uint32_t bitOffset = _bitLength & 7;
+    uint32_t bitEnd = LogCodec::Encode(&_state, epoch, values, buffer, bitOffset);
+
+    LogCodec::Pad(buffer, bitEnd);
+
+    GetBlockPath(_lastBlock, path);
+    File blockFile = LittleFS.open(path, "r+");
+
+    if (blockFile == false)
+        return false;
+
+    blockFile.seek(sizeof(logBlockHeader_s) + (_bitLength / 8));
+    blockFile.write(buffer, (bitEnd + 7) / 8);
+    blockFile.close();
+
+    _bitLength += bitEnd - bitOffset;
+    _tailByte = ((bitEnd & 7) != 0) ? buffer[bitEnd / 8] : 0;
+    _recordCount++;
+
+    return true;
+}
+
+void LogStore::Clear(void) {
+    char path[LOG_STORE_PATH_MAX];
+
+    for (uint32_t sequence = _firstBlock; (sequence > 0) && (sequence <= _lastBlock); sequence++) {
+        GetBlockPath(sequence, path);
+        LittleFS.remove(path);
+    }
+
+    _firstBlock = 0;
+    _lastBlock = 0;
+    _blockOpen = false;
+    _recordCount = 0;
+}
+
+uint8_t LogStore::GetFieldCount(void) {
+    return _fieldCount;
+}
+
+uint32_t LogStore::GetFirstBlock(void) {
+    return _firstBlock;
+}
+
+uint32_t LogStore::GetLastBlock(void) {
+    return _lastBlock;
+}
+
+uint32_t LogStore::GetBlockCount(void) {
+    return (_lastBlock > 0) ? (_lastBlock - _firstBlock + 1) : 0;
+}
+
+void LogStore::GetBlockPath(uint32_t sequence, char *path) {
+    snprintf(path, LOG_STORE_PATH_MAX, LOG_STORE_DIRECTORY "/%08x.bin", sequence);
+}
+
+uint32_t LogStore::GetRecordCount(void) {
+    return _recordCount;
+}
+
+// Epoch of the newest record, 0 without an open block
+uint32_t LogStore::GetLastEpoch(void) {
+    return (_blockOpen == true) ? _state.epoch : 0;
+}
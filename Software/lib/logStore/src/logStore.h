@@ -0,0 +1,100 @@
+#ifndef LOG_STORE_H
+#define LOG_STORE_H
+
+#include "Arduino.h"
+
+#include <FS.h>
+#include <LittleFS.h>
+#include <logCodec.h>
+
+//=============================================================================
+// Defines
+//=============================================================================
+
+#define LOG_STORE_DIRECTORY                 "/log"
+#define LOG_STORE_BLOCK_MAGIC               0x31424C50  // "PLB1"
+#define LOG_STORE_BLOCK_VERSION             1
+#define LOG_STORE_BLOCK_BYTES               8000        // one 8 KiB LittleFS block per file
+#define LOG_STORE_FREE_MIN                  65536       // oldest blocks are dropped to keep this free
+#define LOG_STORE_PATH_MAX                  24
+#define LOG_STORE_READ_BUFFER               128
+
+//=============================================================================
+// Types
+//=============================================================================
+
+typedef struct {
+
+    uint32_t magic;
+    uint8_t version;
+    uint8_t fieldCount;
+    uint16_t reserved;
+    uint32_t epoch;                     // the codec starts from this time stamp
+
+} logBlockHeader_s;
+
+//=============================================================================
+// Classes
+//=============================================================================
+
+// Reads the records of one block file in order
+class LogReader
+{
+    public:
+        LogReader(void);
+
+        bool Open(const char *path);
+        bool Next(uint32_t *epoch, int32_t *values);
+        void Close(void);
+
+        uint8_t GetFieldCount(void);
+        uint32_t GetBitPosition(void);
+        const logCodecState_s *GetState(void);
+
+    private:
+        bool _Fill(void);
+
+        File _file;
+        logCodecState_s _state;
+        uint8_t _buffer[LOG_STORE_READ_BUFFER];
+        uint32_t _bufferBytes;
+        uint32_t _bufferBitPosition;
+        uint32_t _consumedBytes;        // block data bytes before the buffer
+};
+
+// Power log in compressed, append only block files /log/<sequence>.bin. The
+// last block is continued after a reset; a record costs 2-3 bytes in steady
+// state against about 30 as CSV.
+class LogStore
+{
+    public:
+        LogStore(void);
+
+        bool Begin(uint8_t fieldCount);
+        bool Append(uint32_t epoch, const int32_t *values);
+        void Clear(void);
+
+        uint8_t GetFieldCount(void);
+        uint32_t GetFirstBlock(void);
+        uint32_t GetLastBlock(void);
+        uint32_t GetBlockCount(void);
+        void GetBlockPath(uint32_t sequence, char *path);
+        uint32_t GetRecordCount(void);
+        uint32_t GetLastEpoch(void);
+
+    private:
+        bool _StartBlock(uint32_t epoch);
+        bool _Restore(void);
+        void _DropOldBlocks(void);
+
+        uint8_t _fieldCount;
+        uint32_t _firstBlock;
+        uint32_t _lastBlock;
+        bool _blockOpen;
+        logCodecState_s _state;
+        uint32_t _bitLength;            // record bits in the last block
+        uint8_t _tailByte;              // last partly used byte, padded with 1 bits
+        uint32_t _recordCount;          // records appended or restored since Begin()
+};
+
+#endif // LOG_STORE_H
@@ -0,0 +1,117 @@
+#include "loopProfiler.h"
+
+//=============================================================================
+// Object constructors
+//=============================================================================
+
+LoopProfiler::LoopProfiler(void) {
+    _stageCount = 0;
+    _cyclesPerMicroSecond = 80;
+}
+
+//=============================================================================
+// Private functions
+//=============================================================================
+
+void LoopProfiler::_ClearStage(loopProfilerStage_s *stage) {
+    stage->startCycles = 0;
+    stage->count = 0;
+    stage->minCycles = UINT32_MAX;
+    stage->maxCycles = 0;
+    stage->totalCycles = 0;
+
+    for (uint8_t i = 0; i < LOOP_PROFILER_HISTOGRAM_BUCKETS; i++) {
+        stage->histogram[i] = 0;
+    }
+}
+
+//=============================================================================
+// Public functions
+//=============================================================================
+
+void LoopProfiler::Init(void) {
+    _cyclesPerMicroSecond = ESP.getCpuFreqMHz();
+    Clear();
+}
+
+uint8_t LoopProfiler::AddStage(const char *name) {
+
+    if (_stageCount >= LOOP_PROFILER_STAGES_MAX) {
+        return LOOP_PROFILER_INVALID_STAGE;
+    }
+
+    _stages[_stageCount].name = name;
+    _ClearStage(&_stages[_stageCount]);
+
+    return _stageCount++;
+}
+
+void LoopProfiler::Begin(uint8_t stageId) {
+    if (stageId < _stageCount) {
+        _stages[stageId].startCycles = ESP.getCycleCount();
+    }
+}
+
+void LoopProfiler::End(uint8_t stageId) {
+
+    uint32_t currentCycles = ESP.getCycleCount();
+
+    if (stageId >= _stageCount) {
+        return;
+    }
+
+    // Cycle counter wraps every ~53 s at 80 MHz, unsigned subtraction copes
+    // with a single wrap which is far longer than any stage should take.
+    loopProfilerStage_s *stage = &_stages[stageId];
+    uint32_t elapsedCycles = currentCycles - stage->startCycles;
+    uint32_t elapsedMicroSeconds = elapsedCycles / _cyclesPerMicroSecond;
+    uint8_t bucket = 0;
+
+    // log2 bucket: position of the highest set bit
+    while ((elapsedMicroSeconds > 0) && (bucket < (LOOP_PROFILER_HISTOGRAM_BUCKETS - 1))) {
+        elapsedMicroSeconds >>= 1;
+        bucket++;
+    }
+
+    stage->count++;
+    stage->totalCycles += elapsedCycles;
+    stage->histogram[bucket]++;
+
+    if (elapsedCycles < stage->minCycles) {
+        stage->minCycles = elapsedCycles;
+    }
+
+    if (elapsedCycles > stage->maxCycles) {
+        stage->maxCycles = elapsedCycles;
+    }
+}
+
+void LoopProfiler::Clear(void) {
+    for (uint8_t i = 0; i < _stageCount; i++) {
+        _ClearStage(&_stages[i]);
+    }
+}
+
+uint8_t LoopProfiler::GetStageCount(void) {
+    return _stageCount;
+}
+
+const loopProfilerStage_s * LoopProfiler::GetStage(uint8_t stageId) {
+    if (stageId >= _stageCount) {
+        return NULL;
+    }
+
+    return &_stages[stageId];
+}
+
+uint32_t LoopProfiler::CyclesToMicroSeconds(uint32_t cycles) {
+    return cycles / _cyclesPerMicroSecond;
+}
+
+uint32_t LoopProfiler::GetMeanMicroSeconds(uint8_t stageId) {
+    if ((stageId >= _stageCount) || (_stages[stageId].count == 0)) {
+        return 0;
+    }
+
+    return (uint32_t)((_stages[stageId].totalCycles / _stages[stageId].count) / _cyclesPerMicroSecond);
+}
@@ -0,0 +1,58 @@
+#ifndef LOOP_PROFILER_H
+#define LOOP_PROFILER_H
+
+#include "Arduino.h"
+
+//=============================================================================
+// Defines
+//=============================================================================
+
+#define LOOP_PROFILER_STAGES_MAX            8
+#define LOOP_PROFILER_HISTOGRAM_BUCKETS     20      // bucket n holds [2^(n-1), 2^n) micro-seconds
+#define LOOP_PROFILER_INVALID_STAGE         0xFF
+
+//=============================================================================
+// Types
+//=============================================================================
+
+typedef struct {
+
+    const char *name;
+    uint32_t startCycles;
+    uint32_t count;
+    uint32_t minCycles;
+    uint32_t maxCycles;
+    uint64_t totalCycles;
+    uint32_t histogram[LOOP_PROFILER_HISTOGRAM_BUCKETS];
+
+} loopProfilerStage_s;
+
+//=============================================================================
+// Classes
+//=============================================================================
+
+class LoopProfiler
+{
+    public:
+        LoopProfiler(void);
+
+        void Init(void);
+        uint8_t AddStage(const char *name);
+        void Begin(uint8_t stageId);
+        void End(uint8_t stageId);
+        void Clear(void);
+
+        uint8_t GetStageCount(void);
+        const loopProfilerStage_s *GetStage(uint8_t stageId);
+        uint32_t CyclesToMicroSeconds(uint32_t cycles);
+        uint32_t GetMeanMicroSeconds(uint8_t stageId);
+
+    private:
+        void _ClearStage(loopProfilerStage_s *stage);
+
+        loopProfilerStage_s _stages[LOOP_PROFILER_STAGES_MAX];
+        uint8_t _stageCount;
+        uint32_t _cyclesPerMicroSecond;
+};
+
+#endif // LOOP_PROFILER_H
@@ -0,0 +1,456 @@
+#include "mqttClient.h"
+
+//=============================================================================
+// Object constructors
+//=============================================================================
+
+MqttClient::MqttClient(WiFiClient &client) {
+    _client = &client;
+    _host[0] = '\0';
+    _port = 0;
+    _serverResolved = false;
+    _clientId[0] = '\0';
+    _username[0] = '\0';
+    _password[0] = '\0';
+    _willTopic[0] = '\0';
+    _willMessage[0] = '\0';
+
+    _state = mqttClientDisconnected;
+    _stateTime = 0;
+    _retryTime = 0;
+    _retryInterval = MQTT_CLIENT_RETRY_MIN_MS;
+    _retryPending = false;
+
+    _txLength = 0;
+    _txPosition = 0;
+    _lastSendTime = 0;
+    _pingPending = false;
+    _pingTime = 0;
+
+    _rxHeader = 0;
+    _rxLength = 0;
+    _rxLengthShift = 0;
+    _rxPosition = 0;
+    _rxStage = 0;
+
+    _publishState = mqttPublishIdle;
+    _publishQos = 0;
+    _packetId = 0;
+    _publishTime = 0;
+
+    _connectCount = 0;
+    _failureCount = 0;
+    _publishCount = 0;
+}
+
+//=============================================================================
+// Private functions
+//=============================================================================
+
+void MqttClient::_Connect(void) {
+    // A name is resolved once per server, IP addresses are taken as they are
+    if (_serverResolved == false) {
+        if ((_serverIp.fromString(_host) == false) && (WiFi.hostByName(_host, _serverIp, MQTT_CLIENT_DNS_TIMEOUT_MS) != 1)) {
+            _Failed();
+            return;
+        }
+
+        _serverResolved = true;
+    }
+
+    _client->setTimeout(MQTT_CLIENT_CONNECT_TIMEOUT_MS);
+
+    if (_client->connect(_serverIp, _port) == 0) {
+        _Failed();
+        return;
+    }
+
+    _client->setNoDelay(true);
+
+    // Clean session: nothing is kept by the broker, unacknowledged samples
+    // stay in the outbox and are simply published again
+    bool will = (_willTopic[0] != '\0');
+    uint8_t flags = 0x02;
+    uint32_t remainingLength = 10 + 2 + strlen(_clientId);
+
+    if (will == true) {
+        flags |= 0x04 | 0x08 | 0x20;    // will, QoS 1, retained
+        remainingLength += 2 + strlen(_willTopic) + 2 + strlen(_willMessage);
+    }
+
+    if (_username[0] != '\0') {
+        flags |= 0x80;
+        remainingLength += 2 + strlen(_username);
+
+        if (_password[0] != '\0') {
+            flags |= 0x40;
+            remainingLength += 2 + strlen(_password);
+        }
+    }
+
+    _txLength = 0;
+    _txPosition = 0;
+
+    _BeginPacket(MQTT_PACKET_CONNECT, remainingLength);
+    _WriteString("MQTT");
+    _txBuffer[_txLength++] = 4;         // protocol level 3.1.1
+    _txBuffer[_txLength++] = flags;
+    _WriteUint16(MQTT_CLIENT_KEEP_ALIVE_S);
+    _WriteString(_clientId);
+
+    if (will == true) {
+        _WriteString(_willTopic);
+        _WriteString(_willMessage);
+    }
+
+    if (flags & 0x80)
+        _WriteString(_username);
+
+    if (flags & 0x40)
+        _WriteString(_password);
+
+    _rxStage = 0;
+    _pingPending = false;
+    _state = mqttClientWaitConnack;
+    _stateTime = millis();
+
+    _Send();
+}
+
+void MqttClient::_Failed(void) {
+    _failureCount++;
+    _retryTime = millis();
+    _retryPending = true;
+}
+
+// Closes the connection without a DISCONNECT, the broker publishes the will
+void MqttClient::_Drop(void) {
+    _client->stop();
+
+    _state = mqttClientDisconnected;
+    _txLength = 0;
+    _txPosition = 0;
+    _pingPending = false;
+
+    if ((_publishState == mqttPublishSending) || (_publishState == mqttPublishWaitAck))
+        _publishState = mqttPublishFailed;
+}
+
+// Hands the TCP stack as much of the packet as fits its send window
+void MqttClient::_Send(void) {
+    while (_txPosition < _txLength) {
+        size_t space = _client->availableForWrite();
+
+        if (space == 0)
+            return;
+
+        size_t written = _client->write(&_txBuffer[_txPosition], min<size_t>(space, _txLength - _txPosition));
+
+        if (written == 0)
+            return;
+
+        _txPosition += written;
+    }
+
+    if (_txLength == 0)
+        return;
+
+    _txLength = 0;
+    _txPosition = 0;
+    _lastSendTime = millis();
+
+    if (_publishState == mqttPublishSending) {
+        _publishState = (_publishQos > 0) ? mqttPublishWaitAck : mqttPublishDelivered;
+        _publishTime = _lastSendTime;
+    }
+}
+
+// Returns true when the CONNACK accepting the connection came in
+bool MqttClient::_Receive(void) {
+    bool connected = false;
+
+    while (_client->available() > 0) {
+        int value = _client->read();
+
+        if (value < 0)
+            break;
+
+        switch (_rxStage) {
+            case 0:
+                _rxHeader = value;
+                _rxLength = 0;
+                _rxLengthShift = 0;
+                _rxPosition = 0;
+                _rxStage = 1;
+                break;
+
+            case 1:
+                _rxLength |= (uint32_t)(value & 0x7F) << _rxLengthShift;
+                _rxLengthShift += 7;
+
+                if (value & 0x80)
+                    break;
+
+                _rxStage = 2;
+
+                if (_rxLength == 0) {
+                    connected |= _Process();
+                    _rxStage = 0;
+                }
+                break;
+
+            default:
+                if (_rxPosition < MQTT_CLIENT_RECEIVE_SIZE)
+                    _rxBuffer[_rxPosition] = value;
+
+                if (++_rxPosition >= _rxLength) {
+                    connected |= _Process();
+                    _rxStage = 0;
+                }
+                break;
+        }
+    }
+
+    return connected;
+}
+
+bool MqttClient::_Process(void) {
+    switch (_rxHeader & 0xF0) {
+        case MQTT_PACKET_CONNACK:
+            if ((_state != mqttClientWaitConnack) || (_rxLength < 2))
+                return false;
+
+            if (_rxBuffer[1] != 0) {
+                _Drop();
+                _Failed();
+                return false;
+            }
+
+            _state = mqttClientConnected;
+            _stateTime = millis();
+            _retryInterval = MQTT_CLIENT_RETRY_MIN_MS;
+            _connectCount++;
+            return true;
+
+        case MQTT_PACKET_PUBACK:
+            if ((_publishState == mqttPublishWaitAck) && (_rxLength >= 2) &&
+                ((((uint16_t)_rxBuffer[0] << 8) | _rxBuffer[1]) == _packetId)) {
+                _publishState = mqttPublishDelivered;
+            }
+            return false;
+
+        case MQTT_PACKET_PINGRESP:
+            _pingPending = false;
+            return false;
+
+        default:
+            return false;
+    }
+}
+
+bool MqttClient::_BeginPacket(uint8_t header, uint32_t remainingLength) {
+    uint8_t lengthBytes = (remainingLength < 128) ? 1 : ((remainingLength < 16384) ? 2 : 3);
+
+    if ((1 + lengthBytes + remainingLength) > MQTT_CLIENT_BUFFER_SIZE)
+        return false;
+
+    _txBuffer[_txLength++] = header;
+
+    do {
+        uint8_t lengthByte = remainingLength & 0x7F;
+        remainingLength >>= 7;
+
+        if (remainingLength > 0)
+            lengthByte |= 0x80;
+
+        _txBuffer[_txLength++] = lengthByte;
+    } while (remainingLength > 0);
+
+    return true;
+}
+
+void MqttClient::_WriteUint16(uint16_t value) {
+    _txBuffer[_txLength++] = value >> 8;
+    _txBuffer[_txLength++] = value & 0xFF;
+}
+
+void MqttClient::_WriteString(const char *string) {
+    uint16_t length = strlen(string);
+
+    _WriteUint16(length);
+    memcpy(&_txBuffer[_txLength], string, length);
+    _txLength += length;
+}
+
+//=============================================================================
+// Public functions
+//=============================================================================
+
+void MqttClient::SetServer(const char *host, uint16_t port) {
+    if ((strncmp(host, _host, MQTT_CLIENT_HOST_MAX) == 0) && (port == _port))
+        return;
+
+    strncpy(_host, host, MQTT_CLIENT_HOST_MAX - 1);
+    _host[MQTT_CLIENT_HOST_MAX - 1] = '\0';
+    _port = port;
+    _serverResolved = false;
+    _retryInterval = MQTT_CLIENT_RETRY_MIN_MS;
+    _retryPending = false;
+
+    if (_state != mqttClientDisconnected)
+        _Drop();
+}
+
+void MqttClient::SetCredentials(const char *clientId, const char *username, const char *password) {
+    strncpy(_clientId, clientId, MQTT_CLIENT_ID_MAX - 1);
+    _clientId[MQTT_CLIENT_ID_MAX - 1] = '\0';
+    strncpy(_username, username, MQTT_CLIENT_USERNAME_MAX - 1);
+    _username[MQTT_CLIENT_USERNAME_MAX - 1] = '\0';
+    strncpy(_password, password, MQTT_CLIENT_PASSWORD_MAX - 1);
+    _password[MQTT_CLIENT_PASSWORD_MAX - 1] = '\0';
+}
+
+void MqttClient::SetWill(const char *topic, const char *message) {
+    strncpy(_willTopic, topic, MQTT_CLIENT_TOPIC_MAX - 1);
+    _willTopic[MQTT_CLIENT_TOPIC_MAX - 1] = '\0';
+    strncpy(_willMessage, message, MQTT_CLIENT_WILL_MAX - 1);
+    _willMessage[MQTT_CLIENT_WILL_MAX - 1] = '\0';
+}
+
+// Returns true when a connection has just been accepted by the broker
+bool MqttClient::Update(bool online) {
+    uint32_t now = millis();
+
+    if ((online == false) || (_host[0] == '\0') || (_port == 0)) {
+        if (_state != mqttClientDisconnected)
+            _Drop();
+
+        return false;
+    }
+
+    if (_state == mqttClientDisconnected) {
+        if (_retryPending == false) {
+            _Connect();
+        } else if ((now - _retryTime) >= _retryInterval) {
+            // The next failure waits twice as long
+            _retryInterval = min<uint32_t>(_retryInterval * 2, MQTT_CLIENT_RETRY_MAX_MS);
+            _retryPending = false;
+            _Connect();
+        }
+
+        return false;
+    }
+
+    if (_client->connected() == 0) {
+        _Drop();
+        _Failed();
+        return false;
+    }
+
+    _Send();
+    bool connected = _Receive();
+
+    if (_state == mqttClientDisconnected)
+        return false;
+
+    // A broker which stops answering is given up, the connection is built again
+    bool timedOut = ((_state == mqttClientWaitConnack) && ((now - _stateTime) >= MQTT_CLIENT_RESPONSE_TIMEOUT_MS)) ||
+                    ((_publishState == mqttPublishWaitAck) && ((now - _publishTime) >= MQTT_CLIENT_RESPONSE_TIMEOUT_MS)) ||
+                    ((_pingPending == true) && ((now - _pingTime) >= MQTT_CLIENT_RESPONSE_TIMEOUT_MS));
+
+    if (timedOut == true) {
+        _Drop();
+        _Failed();
+        return false;
+    }
+
+    // Keep alive at half the interval the broker was told
+    if ((_state == mqttClientConnected) && (_txLength == 0) && (_pingPending == false) &&
+        ((now - _lastSendTime) >= (MQTT_CLIENT_KEEP_ALIVE_S * 500UL))) {
+        _BeginPacket(MQTT_PACKET_PINGREQ, 0);
+        _pingPending = true;
+        _pingTime = now;
+        _Send();
+    }
+
+    return connected;
+}
+
+void MqttClient::Disconnect(void) {
+    if (_state == mqttClientConnected) {
+        uint8_t packet[2] = {MQTT_PACKET_DISCONNECT, 0};
+
+        if (_client->availableForWrite() >= sizeof(packet))
+            _client->write(packet, sizeof(packet));
+    }
+
+    _Drop();
+}
+
+bool MqttClient::IsConnected(void) {
+    return (_state == mqttClientConnected);
+}
+
+bool MqttClient::CanPublish(void) {
+    return (_state == mqttClientConnected) && (_txLength == 0) && (_publishState == mqttPublishIdle);
+}
+
+// QoS 2 is not supported, anything above 0 is sent as QoS 1
+bool MqttClient::Publish(const char *topic, const uint8_t *payload, size_t length, uint8_t qos, bool retain) {
+    if (CanPublish() == false)
+        return false;
+
+    uint16_t topicLength = strlen(topic);
+    uint8_t header = MQTT_PACKET_PUBLISH | ((qos > 0) ? 0x02 : 0x00) | ((retain == true) ? 0x01 : 0x00);
+    uint32_t remainingLength = 2 + topicLength + ((qos > 0) ? 2 : 0) + length;
+
+    if (_BeginPacket(header, remainingLength) == false)
+        return false;
+
+    _WriteString(topic);
+
+    if (qos > 0) {
+        // Packet identifiers are non-zero
+        if (++_packetId == 0)
+            _packetId = 1;
+
+        _WriteUint16(_packetId);
+    }
+
+    memcpy(&_txBuffer[_txLength], payload, length);
+    _txLength += length;
+
+    _publishQos = (qos > 0) ? 1 : 0;
+    _publishState = mqttPublishSending;
+    _publishCount++;
+
+    _Send();
+
+    return true;
+}
+
+mqttPublishState_e MqttClient::GetPublishState(void) {
+    return _publishState;
+}
+
+// Delivered or failed publishes are kept until the caller has seen them
+void MqttClient::AcknowledgePublish(void) {
+    if ((_publishState == mqttPublishDelivered) || (_publishState == mqttPublishFailed))
+        _publishState = mqttPublishIdle;
+}
+
+uint32_t MqttClient::GetConnectCount(void) {
+    return _connectCount;
+}
+
+uint32_t MqttClient::GetFailureCount(void) {
+    return _failureCount;
+}
+
+uint32_t MqttClient::GetPublishCount(void) {
+    return _publishCount;
+}
+
+uint32_t MqttClient::GetRetryInterval(void) {
+    return _retryInterval;
+}
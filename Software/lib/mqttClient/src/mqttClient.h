@@ -0,0 +1,146 @@
+#ifndef MQTT_CLIENT_H
+#define MQTT_CLIENT_H
+
+#include "Arduino.h"
+
+#include <ESP8266WiFi.h>
+#include <WiFiClient.h>
+
+//=============================================================================
+// Defines
+//=============================================================================
+
+#define MQTT_CLIENT_HOST_MAX                48
+#define MQTT_CLIENT_ID_MAX                  33
+#define MQTT_CLIENT_USERNAME_MAX            33
+#define MQTT_CLIENT_PASSWORD_MAX            65
+#define MQTT_CLIENT_TOPIC_MAX               64
+#define MQTT_CLIENT_WILL_MAX                16
+
+#define MQTT_CLIENT_BUFFER_SIZE             1024    // one outgoing packet, CONNECT or a batched PUBLISH
+#define MQTT_CLIENT_RECEIVE_SIZE            4       // acknowledgements only, longer packets are skipped
+
+#define MQTT_CLIENT_KEEP_ALIVE_S            60
+#define MQTT_CLIENT_RESPONSE_TIMEOUT_MS     10000   // CONNACK, PUBACK and PINGRESP
+#define MQTT_CLIENT_CONNECT_TIMEOUT_MS      1000    // TCP connect, the only wait on the network
+#define MQTT_CLIENT_DNS_TIMEOUT_MS          500
+#define MQTT_CLIENT_RETRY_MIN_MS            2000    // first retry, doubles per failure
+#define MQTT_CLIENT_RETRY_MAX_MS            120000
+
+// MQTT 3.1.1 control packet types, upper nibble of the fixed header
+#define MQTT_PACKET_CONNECT                 0x10
+#define MQTT_PACKET_CONNACK                 0x20
+#define MQTT_PACKET_PUBLISH                 0x30
+#define MQTT_PACKET_PUBACK                  0x40
+#define MQTT_PACKET_PINGREQ                 0xC0
+#define MQTT_PACKET_PINGRESP                0xD0
+#define MQTT_PACKET_DISCONNECT              0xE0
+
+//=============================================================================
+// Types
+//=============================================================================
+
+typedef enum {
+
+    mqttClientDisconnected = 0,
+    mqttClientWaitConnack,
+    mqttClientConnected
+
+} mqttClientState_e;
+
+typedef enum {
+
+    mqttPublishIdle = 0,
+    mqttPublishSending,                 // queued in the packet buffer
+    mqttPublishWaitAck,                 // QoS 1, sent and waiting for PUBACK
+    mqttPublishDelivered,               // sent (QoS 0) or acknowledged (QoS 1)
+    mqttPublishFailed                   // connection lost first, publish again
+
+} mqttPublishState_e;
+
+//=============================================================================
+// Classes
+//=============================================================================
+
+// MQTT 3.1.1 publisher driven from Update(). Packets are built in a buffer and
+// written only as far as the TCP send window takes them, acknowledgements are
+// polled; a single publish is in flight at a time. Nothing waits on the
+// network except the bounded DNS lookup and TCP connect of a (re)connect.
+class MqttClient
+{
+    public:
+        MqttClient(WiFiClient &client);
+
+        void SetServer(const char *host, uint16_t port);
+        void SetCredentials(const char *clientId, const char *username, const char *password);
+        void SetWill(const char *topic, const char *message);
+        bool Update(bool online);
+        void Disconnect(void);
+
+        bool IsConnected(void);
+        bool CanPublish(void);
+        bool Publish(const char *topic, const uint8_t *payload, size_t length, uint8_t qos, bool retain);
+        mqttPublishState_e GetPublishState(void);
+        void AcknowledgePublish(void);
+
+        uint32_t GetConnectCount(void);
+        uint32_t GetFailureCount(void);
+        uint32_t GetPublishCount(void);
+        uint32_t GetRetryInterval(void);
+
+    private:
+        void _Connect(void);
+        void _Failed(void);
+        void _Drop(void);
+        void _Send(void);
+        bool _Receive(void);
+        bool _Process(void);
+
+        bool _BeginPacket(uint8_t header, uint32_t remainingLength);
+        void _WriteUint16(uint16_t value);
+        void _WriteString(const char *string);
+
+        WiFiClient *_client;
+        char _host[MQTT_CLIENT_HOST_MAX];
+        uint16_t _port;
+        IPAddress _serverIp;
+        bool _serverResolved;
+        char _clientId[MQTT_CLIENT_ID_MAX];
+        char _username[MQTT_CLIENT_USERNAME_MAX];
+        char _password[MQTT_CLIENT_PASSWORD_MAX];
+        char _willTopic[MQTT_CLIENT_TOPIC_MAX];
+        char _willMessage[MQTT_CLIENT_WILL_MAX];
+
+        mqttClientState_e _state;
+        uint32_t _stateTime;
+        uint32_t _retryTime;
+        uint32_t _retryInterval;
+        bool _retryPending;
+
+        // Outgoing packet, _txPosition bytes of it are with the TCP stack
+        uint8_t _txBuffer[MQTT_CLIENT_BUFFER_SIZE];
+        uint16_t _txLength;
+        uint16_t _txPosition;
+        uint32_t _lastSendTime;
+        bool _pingPending;
+        uint32_t _pingTime;
+
+        // Incoming packet, the fixed header and up to MQTT_CLIENT_RECEIVE_SIZE bytes
+        uint8_t _rxHeader;
+        uint32_t _rxLength;
+        uint8_t _rxLengthShift;
+        uint32_t _rxPosition;
+        uint8_t _rxBuffer[MQTT_CLIENT_RECEIVE_SIZE];
+        uint8_t _rxStage;               // 0 fixed header, 1 remaining length, 2 body
+
+        mqttPublishState_e _publishState;
+        uint8_t _publishQos;
+        uint16_t _packetId;
+        uint32_t _publishTime;
+
+        uint32_t _connectCount;
+        uint32_t _failureCount;
+        uint32_t _publishCount;
+};
+
+#endif // MQTT_CLIENT_H
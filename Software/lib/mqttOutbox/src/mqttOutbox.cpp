@@ -0,0 +1,313 @@
+#include "mqttOutbox.h"
+
+#include <coredecls.h>
+
+//=============================================================================
+// Object constructors
+//=============================================================================
+
+MqttOutbox::MqttOutbox(uint32_t rtcOffset) {
+    _rtcOffset = rtcOffset;
+    _ramHead = 0;
+    _ramCount = 0;
+    _firstSegment = 0;
+    _lastSegment = 0;
+    _firstIndex = 0;
+    _firstCount = 0;
+    _lastCount = 0;
+    _storedCount = 0;
+    _droppedCount = 0;
+}
+
+//=============================================================================
+// Private functions
+//=============================================================================
+
+void MqttOutbox::_GetSegmentPath(uint32_t sequence, char *path) {
+    snprintf(path, MQTT_OUTBOX_PATH_MAX, MQTT_OUTBOX_DIRECTORY "/%08x.out", sequence);
+}
+
+bool MqttOutbox::_Append(const mqttSample_s *sample) {
+    char path[MQTT_OUTBOX_PATH_MAX];
+
+    // A drained outbox starts over in a fresh segment that is also the first,
+    // the last one may still be named but is gone
+    if ((_firstSegment == 0) || (_lastCount >= MQTT_OUTBOX_SEGMENT_SAMPLES)) {
+        _lastSegment++;
+        _lastCount = 0;
+
+        if (_firstSegment == 0) {
+            _firstSegment = _lastSegment;
+            _firstIndex = 0;
+            _firstCount = 0;
+        }
+
+        _DropOldSegments();
+    }
+
+    _GetSegmentPath(_lastSegment, path);
+    File segmentFile = LittleFS.open(path, "a");
+
+    if ((segmentFile == false) || (segmentFile.write((const uint8_t *)sample, sizeof(*sample)) != sizeof(*sample))) {
+        segmentFile.close();
+        _droppedCount++;
+        return false;
+    }
+
+    segmentFile.close();
+
+    _lastCount++;
+    _storedCount++;
+
+    if (_lastSegment == _firstSegment)
+        _firstCount = _lastCount;
+
+    return true;
+}
+
+// RAM samples are older than the one about to be stored, they go first
+void MqttOutbox::_Spill(void) {
+    while (_ramCount > 0) {
+        _Append(&_ram[_ramHead]);
+        _ramHead = (_ramHead + 1) % MQTT_OUTBOX_RAM_SAMPLES;
+        _ramCount--;
+    }
+}
+
+// The oldest samples go first when the outage outlasts the segments or the
+// file system runs short
+void MqttOutbox::_DropOldSegments(void) {
+    FSInfo fsInfo;
+
+    while ((_lastSegment - _firstSegment) >= MQTT_OUTBOX_SEGMENTS_MAX) {
+        _DropFirstSegment();
+    }
+
+    while (_firstSegment < _lastSegment) {
+        if ((LittleFS.info(fsInfo) == false) || ((fsInfo.totalBytes - fsInfo.usedBytes) >= MQTT_OUTBOX_FREE_MIN))
+            return;
+
+        _DropFirstSegment();
+    }
+}
+
+void MqttOutbox::_DropFirstSegment(void) {
+    char path[MQTT_OUTBOX_PATH_MAX];
+
+    _GetSegmentPath(_firstSegment, path);
+    LittleFS.remove(path);
+
+    _droppedCount += _firstCount - _firstIndex;
+    _storedCount -= _firstCount - _firstIndex;
+    _firstIndex = 0;
+    _firstCount = 0;
+
+    if (_firstSegment >= _lastSegment) {
+        // Empty, the next sample starts a new segment
+        _firstSegment = 0;
+        _lastCount = 0;
+    } else {
+        _firstSegment++;
+        _GetSegmentPath(_firstSegment, path);
+
+        File segmentFile = LittleFS.open(path, "r");
+
+        if (segmentFile == true) {
+            _firstCount = segmentFile.size() / sizeof(mqttSample_s);
+            segmentFile.close();
+        }
+
+        if (_firstSegment == _lastSegment)
+            _firstCount = min(_firstCount, _lastCount);
+    }
+
+    _SavePosition();
+}
+
+void MqttOutbox::_SavePosition(void) {
+    mqttOutboxPosition_s position;
+
+    position.magic = MQTT_OUTBOX_RTC_MAGIC;
+    position.segment = _firstSegment;
+    position.index = _firstIndex;
+    position.crc = crc32(&position, offsetof(mqttOutboxPosition_s, crc));
+
+    ESP.rtcUserMemoryWrite(_rtcOffset, (uint32_t *)&position, sizeof(position));
+}
+
+//=============================================================================
+// Public functions
+//=============================================================================
+
+bool MqttOutbox::Begin(void) {
+    char path[MQTT_OUTBOX_PATH_MAX];
+    mqttOutboxPosition_s position;
+
+    _ramHead = 0;
+    _ramCount = 0;
+    _firstSegment = 0;
+    _lastSegment = 0;
+    _storedCount = 0;
+
+    LittleFS.mkdir(MQTT_OUTBOX_DIRECTORY);
+    Dir directory = LittleFS.openDir(MQTT_OUTBOX_DIRECTORY);
+
+    while (directory.next()) {
+        uint32_t sequence = strtoul(directory.fileName().c_str(), NULL, 16);
+
+        if (sequence == 0)
+            continue;
+
+        if ((_firstSegment == 0) || (sequence < _firstSegment))
+            _firstSegment = sequence;
+
+        if (sequence > _lastSegment)
+            _lastSegment = sequence;
+
+        _storedCount += directory.fileSize() / sizeof(mqttSample_s);
+    }
+
+    if (_lastSegment == 0)
+        return true;
+
+    _GetSegmentPath(_firstSegment, path);
+    File firstFile = LittleFS.open(path, "r");
+    _firstCount = firstFile.size() / sizeof(mqttSample_s);
+    firstFile.close();
+
+    // A sample torn by a reset leaves a partial record, appending continues
+    // in a new segment so the records stay aligned
+    _GetSegmentPath(_lastSegment, path);
+    File lastFile = LittleFS.open(path, "r");
+    _lastCount = ((lastFile.size() % sizeof(mqttSample_s)) == 0) ? (lastFile.size() / sizeof(mqttSample_s)) : MQTT_OUTBOX_SEGMENT_SAMPLES;
+    lastFile.close();
+
+    // RTC memory holds the position only across resets and deep sleep, after
+    // a power loss the first segment is replayed from its start
+    _firstIndex = 0;
+
+    if (ESP.rtcUserMemoryRead(_rtcOffset, (uint32_t *)&position, sizeof(position))) {
+        if ((position.magic == MQTT_OUTBOX_RTC_MAGIC) &&
+            (position.crc == crc32(&position, offsetof(mqttOutboxPosition_s, crc))) &&
+            (position.segment == _firstSegment) && (position.index <= _firstCount)) {
+            _firstIndex = position.index;
+        }
+    }
+
+    _storedCount -= _firstIndex;
+
+    if (_firstIndex >= _firstCount)
+        _DropFirstSegment();
+
+    return true;
+}
+
+// Queues a sample; persist stores it in flash right away, for while the
+// broker can't be reached
+bool MqttOutbox::Push(const mqttSample_s *sample, bool persist) {
+    if ((persist == true) || (_ramCount >= MQTT_OUTBOX_RAM_SAMPLES)) {
+        _Spill();
+        return _Append(sample);
+    }
+
+    _ram[(_ramHead + _ramCount) % MQTT_OUTBOX_RAM_SAMPLES] = *sample;
+    _ramCount++;
+
+    return true;
+}
+
+// Copies up to count of the oldest samples, stored ones first; they stay
+// queued until Pop()
+uint16_t MqttOutbox::Peek(mqttSample_s *samples, uint16_t count) {
+    char path[MQTT_OUTBOX_PATH_MAX];
+
+    if (_storedCount > 0) {
+        count = min<uint32_t>(count, _firstCount - _firstIndex);
+
+        _GetSegmentPath(_firstSegment, path);
+        File segmentFile = LittleFS.open(path, "r");
+
+        // A segment which went missing can't be replayed, move past it
+        if (segmentFile == false) {
+            _DropFirstSegment();
+            return 0;
+        }
+
+        segmentFile.seek(_firstIndex * sizeof(mqttSample_s));
+        count = segmentFile.read((uint8_t *)samples, count * sizeof(mqttSample_s)) / sizeof(mqttSample_s);
+        segmentFile.close();
+
+        return count;
+    }
+
+    count = min(count, _ramCount);
+
+    for (uint16_t i = 0; i < count; i++) {
+        samples[i] = _ram[(_ramHead + i) % MQTT_OUTBOX_RAM_SAMPLES];
+    }
+
+    return count;
+}
+
+// Removes the samples of the last Peek() once the broker has them
+void MqttOutbox::Pop(uint16_t count) {
+    if (_storedCount > 0) {
+        count = min<uint32_t>(count, _firstCount - _firstIndex);
+
+        _firstIndex += count;
+        _storedCount -= count;
+
+        if (_firstIndex >= _firstCount) {
+            _DropFirstSegment();
+        } else {
+            _SavePosition();
+        }
+
+        return;
+    }
+
+    count = min(count, _ramCount);
+
+    _ramHead = (_ramHead + count) % MQTT_OUTBOX_RAM_SAMPLES;
+    _ramCount -= count;
+}
+
+// Moves the RAM queue to flash, before a planned reset or deep sleep
+void MqttOutbox::Persist(void) {
+    _Spill();
+}
+
+void MqttOutbox::Clear(void) {
+    char path[MQTT_OUTBOX_PATH_MAX];
+
+    for (uint32_t sequence = _firstSegment; (sequence > 0) && (sequence <= _lastSegment); sequence++) {
+        _GetSegmentPath(sequence, path);
+        LittleFS.remove(path);
+    }
+
+    _ramHead = 0;
+    _ramCount = 0;
+    _firstSegment = 0;
+    _firstIndex = 0;
+    _firstCount = 0;
+    _lastCount = 0;
+    _storedCount = 0;
+
+    _SavePosition();
+}
+
+uint32_t MqttOutbox::GetCount(void) {
+    return _storedCount + _ramCount;
+}
+
+uint32_t MqttOutbox::GetStoredCount(void) {
+    return _storedCount;
+}
+
+uint32_t MqttOutbox::GetDroppedCount(void) {
+    return _droppedCount;
+}
+
+uint32_t MqttOutbox::GetSegmentCount(void) {
+    return (_firstSegment > 0) ? (_lastSegment - _firstSegment + 1) : 0;
+}
@@ -0,0 +1,100 @@
+#ifndef MQTT_OUTBOX_H
+#define MQTT_OUTBOX_H
+
+#include "Arduino.h"
+
+#include <FS.h>
+#include <LittleFS.h>
+
+//=============================================================================
+// Defines
+//=============================================================================
+
+#define MQTT_OUTBOX_DIRECTORY               "/mqtt"
+#define MQTT_OUTBOX_RTC_MAGIC               0x4D4F4231  // "MOB1"
+#define MQTT_OUTBOX_RAM_SAMPLES             32          // queued in RAM while the broker is reachable
+#define MQTT_OUTBOX_SEGMENT_SAMPLES         400         // 8000 bytes, one LittleFS block per file
+#define MQTT_OUTBOX_SEGMENTS_MAX            16          // ~17 hours at the 10 s default log interval
+#define MQTT_OUTBOX_FREE_MIN                131072      // yields to the power log, which keeps 64 KiB
+#define MQTT_OUTBOX_PATH_MAX                24
+
+#define MQTT_SAMPLE_TEMPERATURE_NONE        INT16_MIN
+#define MQTT_SAMPLE_HUMIDITY_NONE           UINT16_MAX
+#define MQTT_SAMPLE_ESTIMATED               0x0001      // watts and energy estimated from one batched pulse interval
+
+//=============================================================================
+// Types
+//=============================================================================
+
+typedef struct {
+
+    uint32_t epoch;
+    uint32_t watts;                     // mean over the log interval
+    uint32_t energy;                    // milli-watt hours in the log interval
+    int16_t temperature;                // 0.1 degrees celsius
+    uint16_t humidity;                  // 0.1 %RH
+    uint16_t battery;                   // ADC counts
+    uint16_t flags;                     // MQTT_SAMPLE_ESTIMATED
+
+} mqttSample_s;
+
+// Replay position in the first segment, kept in RTC user memory so a reset
+// does not publish the delivered part of a segment again
+typedef struct {
+
+    uint32_t magic;
+    uint32_t segment;
+    uint32_t index;
+    uint32_t crc;
+
+} mqttOutboxPosition_s;
+
+//=============================================================================
+// Classes
+//=============================================================================
+
+// Samples waiting for the broker, oldest first. While the broker is reachable
+// they are queued in RAM; otherwise, or when RAM runs full, they go to append
+// only segment files /mqtt/<sequence>.out which are replayed before anything
+// newer. Everything in flash is always older than what is in RAM.
+class MqttOutbox
+{
+    public:
+        MqttOutbox(uint32_t rtcOffset);
+
+        bool Begin(void);
+        bool Push(const mqttSample_s *sample, bool persist);
+        uint16_t Peek(mqttSample_s *samples, uint16_t count);
+        void Pop(uint16_t count);
+        void Persist(void);
+        void Clear(void);
+
+        uint32_t GetCount(void);
+        uint32_t GetStoredCount(void);
+        uint32_t GetDroppedCount(void);
+        uint32_t GetSegmentCount(void);
+
+    private:
+        void _GetSegmentPath(uint32_t sequence, char *path);
+        bool _Append(const mqttSample_s *sample);
+        void _Spill(void);
+        void _DropOldSegments(void);
+        void _DropFirstSegment(void);
+        void _SavePosition(void);
+
+        uint32_t _rtcOffset;
+
+        mqttSample_s _ram[MQTT_OUTBOX_RAM_SAMPLES];
+        uint16_t _ramHead;
+        uint16_t _ramCount;
+
+        uint32_t _firstSegment;
+        uint32_t _lastSegment;
+        uint32_t _firstIndex;           // samples of the first segment already delivered
+        uint32_t _firstCount;           // samples in the first segment
+        uint32_t _lastCount;            // samples in the last segment
+        uint32_t _storedCount;          // undelivered samples in flash
+        uint32_t _droppedCount;
+};
+
+#endif // MQTT_OUTBOX_H
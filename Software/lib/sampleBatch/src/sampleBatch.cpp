@@ -0,0 +1,80 @@
+#include "sampleBatch.h"
+
+#include <coredecls.h>
+
+//=============================================================================
+// Object constructors
+//=============================================================================
+
+SampleBatch::SampleBatch(uint32_t rtcOffset) {
+    _rtcOffset = rtcOffset;
+
+    memset(&_batch, 0, sizeof(_batch));
+}
+
+//=============================================================================
+// Public functions
+//=============================================================================
+
+bool SampleBatch::Init(void) {
+    // RTC user memory is lost on power loss, a matching CRC means the batch
+    // was written by the previous cycle
+    if (ESP.rtcUserMemoryRead(_rtcOffset, (uint32_t *)&_batch, sizeof(_batch))) {
+        if ((_batch.magic == SAMPLE_BATCH_RTC_MAGIC) &&
+            (_batch.count <= SAMPLE_BATCH_SAMPLES_MAX) &&
+            (_batch.crc == crc32(&_batch, offsetof(sampleBatch_s, crc)))) {
+            return true;
+        }
+    }
+
+    Start();
+
+    return false;
+}
+
+void SampleBatch::Start(void) {
+    memset(&_batch, 0, sizeof(_batch));
+    _batch.magic = SAMPLE_BATCH_RTC_MAGIC;
+}
+
+bool SampleBatch::Add(uint16_t watts) {
+    if (_batch.count >= SAMPLE_BATCH_SAMPLES_MAX) {
+        _batch.dropped++;
+        return false;
+    }
+
+    batchSample_s *sample = &_batch.samples[_batch.count++];
+    sample->offset = min<uint32_t>((_batch.elapsed + millis()) / 1000, UINT16_MAX);
+    sample->watts = watts;
+
+    return true;
+}
+
+void SampleBatch::AdvanceTime(uint32_t milliSeconds) {
+    _batch.elapsed += milliSeconds;
+}
+
+void SampleBatch::Persist(void) {
+    _batch.crc = crc32(&_batch, offsetof(sampleBatch_s, crc));
+    ESP.rtcUserMemoryWrite(_rtcOffset, (uint32_t *)&_batch, sizeof(_batch));
+}
+
+bool SampleBatch::IsFull(void) {
+    return (_batch.count >= SAMPLE_BATCH_SAMPLES_MAX);
+}
+
+uint16_t SampleBatch::GetCount(void) {
+    return _batch.count;
+}
+
+uint16_t SampleBatch::GetDropped(void) {
+    return _batch.dropped;
+}
+
+uint32_t SampleBatch::GetElapsed(void) {
+    return _batch.elapsed;
+}
+
+const batchSample_s * SampleBatch::GetSample(uint16_t index) {
+    return (index < _batch.count) ? &_batch.samples[index] : NULL;
+}
@@ -0,0 +1,63 @@
+#ifndef SAMPLE_BATCH_H
+#define SAMPLE_BATCH_H
+
+#include "Arduino.h"
+
+//=============================================================================
+// Defines
+//=============================================================================
+
+#define SAMPLE_BATCH_RTC_MAGIC                  0x53424331  // "SBC1"
+#define SAMPLE_BATCH_SAMPLES_MAX                56          // 244 bytes of RTC user memory
+
+//=============================================================================
+// Types
+//=============================================================================
+
+typedef struct {
+
+    uint16_t offset;                    // seconds since the batch was started
+    uint16_t watts;
+
+} batchSample_s;
+
+// Persisted in RTC user memory across deep sleep cycles; sample times are kept
+// relative to the batch so no wall clock is needed while the radio is off.
+typedef struct {
+
+    uint32_t magic;
+    uint32_t elapsed;                   // milli-seconds since the batch was started
+    uint16_t count;
+    uint16_t dropped;                   // samples lost while the batch was full
+    batchSample_s samples[SAMPLE_BATCH_SAMPLES_MAX];
+    uint32_t crc;
+
+} sampleBatch_s;
+
+//=============================================================================
+// Classes
+//=============================================================================
+
+class SampleBatch
+{
+    public:
+        SampleBatch(uint32_t rtcOffset);
+
+        bool Init(void);
+        void Start(void);
+        bool Add(uint16_t watts);
+        void AdvanceTime(uint32_t milliSeconds);
+        void Persist(void);
+
+        bool IsFull(void);
+        uint16_t GetCount(void);
+        uint16_t GetDropped(void);
+        uint32_t GetElapsed(void);
+        const batchSample_s *GetSample(uint16_t index);
+
+    private:
+        uint32_t _rtcOffset;
+        sampleBatch_s _batch;
+};
+
+#endif // SAMPLE_BATCH_H
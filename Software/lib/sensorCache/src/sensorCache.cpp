@@ -0,0 +1,102 @@
+#include "sensorCache.h"
+
+//=============================================================================
+// Object constructors
+//=============================================================================
+
+SensorCache::SensorCache(void) {
+    _reading.temperature = NAN;
+    _reading.humidity = NAN;
+    _valid = false;
+    _readTime = 0;
+    _demandTime = 0;
+    _demanded = false;
+    _pollInterval = SENSOR_CACHE_INTERVAL_MIN_MS;
+    _readCount = 0;
+    _errorCount = 0;
+    _consecutiveErrors = 0;
+}
+
+//=============================================================================
+// Private functions
+//=============================================================================
+
+bool SensorCache::_IsDemanded(void) {
+    return (_demanded == true) && ((millis() - _demandTime) < SENSOR_CACHE_DEMAND_HOLD_MS);
+}
+
+//=============================================================================
+// Public functions
+//=============================================================================
+
+void SensorCache::Update(dhtReaderResult_e result, const dhtReading_s *reading) {
+    _readCount++;
+
+    if (result != dhtReaderOk) {
+        // Keep the last good values, retry soon but back off while the sensor keeps failing
+        _errorCount++;
+        _consecutiveErrors++;
+        _pollInterval = min<uint32_t>(SENSOR_CACHE_INTERVAL_MIN_MS << min<uint32_t>(_consecutiveErrors - 1, 6), SENSOR_CACHE_INTERVAL_MAX_MS);
+        return;
+    }
+
+    bool changed = (_valid == false) ||
+                   (fabsf(reading->temperature - _reading.temperature) >= SENSOR_CACHE_TEMPERATURE_DELTA) ||
+                   (fabsf(reading->humidity - _reading.humidity) >= SENSOR_CACHE_HUMIDITY_DELTA);
+
+    _reading = *reading;
+    _valid = true;
+    _readTime = millis();
+    _consecutiveErrors = 0;
+
+    if ((changed == true) || (_IsDemanded() == true)) {
+        _pollInterval = SENSOR_CACHE_INTERVAL_MIN_MS;
+    } else {
+        _pollInterval = min<uint32_t>(_pollInterval * 2, SENSOR_CACHE_INTERVAL_MAX_MS);
+    }
+}
+
+// A consumer looked at the values; returns true when the poll interval was
+// shortened so the caller can reschedule the pending read
+bool SensorCache::Demand(void) {
+    _demandTime = millis();
+    _demanded = true;
+
+    if ((_pollInterval <= SENSOR_CACHE_INTERVAL_MIN_MS) || (_consecutiveErrors > 0))
+        return false;
+
+    _pollInterval = SENSOR_CACHE_INTERVAL_MIN_MS;
+    return true;
+}
+
+bool SensorCache::IsValid(void) {
+    return _valid;
+}
+
+bool SensorCache::IsStale(void) {
+    return (_valid == false) || (GetAge() > SENSOR_CACHE_STALE_MS);
+}
+
+uint32_t SensorCache::GetAge(void) {
+    return (_valid == true) ? (millis() - _readTime) : UINT32_MAX;
+}
+
+const dhtReading_s * SensorCache::GetReading(void) {
+    return &_reading;
+}
+
+uint32_t SensorCache::GetPollInterval(void) {
+    return _pollInterval;
+}
+
+uint32_t SensorCache::GetReadCount(void) {
+    return _readCount;
+}
+
+uint32_t SensorCache::GetErrorCount(void) {
+    return _errorCount;
+}
+
+uint32_t SensorCache::GetConsecutiveErrors(void) {
+    return _consecutiveErrors;
+}
@@ -0,0 +1,59 @@
+#ifndef SENSOR_CACHE_H
+#define SENSOR_CACHE_H
+
+#include "Arduino.h"
+
+#include <dhtReader.h>
+
+//=============================================================================
+// Defines
+//=============================================================================
+
+#define SENSOR_CACHE_INTERVAL_MIN_MS        2000        // DHT11 needs >= 1 s between reads
+#define SENSOR_CACHE_INTERVAL_MAX_MS        120000
+#define SENSOR_CACHE_DEMAND_HOLD_MS         30000       // poll fast this long after a consumer asked
+#define SENSOR_CACHE_STALE_MS               300000      // no good read for longer than this
+
+// A change at least this large between two good reads keeps the fast cadence
+#define SENSOR_CACHE_TEMPERATURE_DELTA      0.5f
+#define SENSOR_CACHE_HUMIDITY_DELTA         2.0f
+
+//=============================================================================
+// Classes
+//=============================================================================
+
+// Last good temperature/humidity with its age and the read statistics. The
+// poll interval doubles while the values are steady and nobody is looking,
+// and drops back to the minimum on a change or a consumer request.
+class SensorCache
+{
+    public:
+        SensorCache(void);
+
+        void Update(dhtReaderResult_e result, const dhtReading_s *reading);
+        bool Demand(void);
+
+        bool IsValid(void);
+        bool IsStale(void);
+        uint32_t GetAge(void);
+        const dhtReading_s *GetReading(void);
+        uint32_t GetPollInterval(void);
+        uint32_t GetReadCount(void);
+        uint32_t GetErrorCount(void);
+        uint32_t GetConsecutiveErrors(void);
+
+    private:
+        bool _IsDemanded(void);
+
+        dhtReading_s _reading;
+        bool _valid;
+        uint32_t _readTime;
+        uint32_t _demandTime;
+        bool _demanded;
+        uint32_t _pollInterval;
+        uint32_t _readCount;
+        uint32_t _errorCount;
+        uint32_t _consecutiveErrors;
+};
+
+#endif // SENSOR_CACHE_H
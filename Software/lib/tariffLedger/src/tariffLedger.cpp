@@ -0,0 +1,256 @@
+#include "tariffLedger.h"
+
+#include <coredecls.h>
+
+static const char *_slotPaths[TARIFF_LEDGER_SLOTS] = {TARIFF_LEDGER_SLOT_PATH_0, TARIFF_LEDGER_SLOT_PATH_1};
+
+//=============================================================================
+// Object constructors
+//=============================================================================
+
+TariffLedger::TariffLedger(void) {
+    _schedule = NULL;
+    memset(&_data, 0, sizeof(_data));
+    _sequence = 0;
+    _activeSlot = 0;
+    _remainder = 0;
+    _pendingPulses = 0;
+    _lastDay = 0;
+    _dirty = false;
+    _saveDue = false;
+    _saveTime = 0;
+}
+
+//=============================================================================
+// Private functions
+//=============================================================================
+
+// Totals are kept in a ring by period, an entry of an older period is reused
+tariffTotal_s *TariffLedger::_GetTotal(tariffTotal_s *totals, uint8_t count, uint32_t period) {
+    tariffTotal_s *total = &totals[period % count];
+
+    if (total->period != period) {
+        memset(total, 0, sizeof(*total));
+        total->period = period;
+    }
+
+    return total;
+}
+
+//=============================================================================
+// Public functions
+//=============================================================================
+
+void TariffLedger::SetSchedule(const tariffSchedule_s *schedule) {
+    _schedule = schedule;
+}
+
+const tariffSchedule_s *TariffLedger::GetSchedule(void) {
+    return _schedule;
+}
+
+bool TariffLedger::Begin(void) {
+    tariffLedgerHeader_s header;
+    tariffLedgerData_s slotData;
+    bool slotFound = false;
+
+    _saveTime = millis();
+
+    // Newest slot with a valid CRC wins, as for the configuration
+    for (uint8_t slot = 0; slot < TARIFF_LEDGER_SLOTS; slot++) {
+        File ledgerFile = LittleFS.open(_slotPaths[slot], "r");
+
+        if (!ledgerFile)
+            continue;
+
+        bool valid = (ledgerFile.read((uint8_t *)&header, sizeof(header)) == sizeof(header)) &&
+                     (header.magic == TARIFF_LEDGER_MAGIC) &&
+                     (header.version <= TARIFF_LEDGER_VERSION) &&
+                     (header.size == sizeof(slotData)) &&
+                     (ledgerFile.read((uint8_t *)&slotData, sizeof(slotData)) == sizeof(slotData)) &&
+                     (crc32(&slotData, sizeof(slotData)) == header.crc);
+
+        ledgerFile.close();
+
+        if ((valid == true) && ((slotFound == false) || ((int32_t)(header.sequence - _sequence) > 0))) {
+            // Version 1 left the estimated energy as padding of unknown content
+            if (header.version < 2) {
+                for (uint8_t i = 0; i < TARIFF_DAYS_KEPT; i++) {
+                    slotData.days[i].estimated = 0;
+                }
+
+                for (uint8_t i = 0; i < TARIFF_MONTHS_KEPT; i++) {
+                    slotData.months[i].estimated = 0;
+                }
+            }
+
+            _data = slotData;
+            _sequence = header.sequence;
+            _activeSlot = slot;
+            slotFound = true;
+        }
+    }
+
+    return slotFound;
+}
+
+// Pulses counted before the time was known are booked with the next ones that
+// have a time stamp
+// Estimated pulses were not counted but modelled from sampled watts, their
+// energy is booked as usual and also summed separately
+void TariffLedger::AddPulses(uint32_t epoch, uint32_t pulses, uint32_t pulsesPerKilowattHour, bool estimated) {
+    if ((pulses == 0) || (pulsesPerKilowattHour == 0))
+        return;
+
+    if (epoch == 0) {
+        _pendingPulses += pulses;
+        return;
+    }
+
+    pulses += _pendingPulses;
+    _pendingPulses = 0;
+
+    // Meters with a pulse worth a fraction of a milli-watt hour carry the rest
+    uint64_t scaled = ((uint64_t)pulses * TARIFF_MICRO_KWH_PER_KWH) + _remainder;
+    uint32_t energy = scaled / pulsesPerKilowattHour;
+    _remainder = scaled % pulsesPerKilowattHour;
+
+    uint8_t rate = GetRate(epoch);
+    uint32_t price = (_schedule != NULL) ? _schedule->rates[rate].price : 0;
+    uint32_t day = GetDayNumber(epoch);
+
+    tariffTotal_s *dayTotal = _GetTotal(_data.days, TARIFF_DAYS_KEPT, day);
+    tariffTotal_s *monthTotal = _GetTotal(_data.months, TARIFF_MONTHS_KEPT, GetMonthNumber(day));
+
+    dayTotal->energy[rate] += energy;
+    dayTotal->cost += (uint64_t)energy * price;
+    monthTotal->energy[rate] += energy;
+    monthTotal->cost += (uint64_t)energy * price;
+
+    if (estimated == true) {
+        dayTotal->estimated += energy;
+        monthTotal->estimated += energy;
+    }
+
+    _dirty = true;
+
+    // A finished day is written right away
+    if (day != _lastDay) {
+        _saveDue = (_lastDay != 0);
+        _lastDay = day;
+    }
+}
+
+void TariffLedger::Update(void) {
+    if ((_dirty == true) && ((_saveDue == true) || ((millis() - _saveTime) >= TARIFF_LEDGER_SAVE_INTERVAL)))
+        Save();
+}
+
+// Writes the totals if they changed, also before a planned reset or deep sleep
+bool TariffLedger::Save(void) {
+    tariffLedgerHeader_s header;
+    uint8_t slot = (_sequence != 0) ? (_activeSlot + 1) % TARIFF_LEDGER_SLOTS : _activeSlot;
+
+    if (_dirty == false)
+        return true;
+
+    _saveTime = millis();
+
+    header.magic = TARIFF_LEDGER_MAGIC;
+    header.version = TARIFF_LEDGER_VERSION;
+    header.size = sizeof(_data);
+    header.sequence = _sequence + 1;
+    header.crc = crc32(&_data, sizeof(_data));
+
+    File ledgerFile = LittleFS.open(_slotPaths[slot], "w");
+
+    if (!ledgerFile)
+        return false;
+
+    size_t written = ledgerFile.write((const uint8_t *)&header, sizeof(header));
+    written += ledgerFile.write((const uint8_t *)&_data, sizeof(_data));
+    ledgerFile.close();
+
+    if (written != (sizeof(header) + sizeof(_data)))
+        return false;
+
+    _activeSlot = slot;
+    _sequence = header.sequence;
+    _dirty = false;
+    _saveDue = false;
+
+    return true;
+}
+
+// Epochs include the UTC offset, the schedule is in local time
+uint8_t TariffLedger::GetRate(uint32_t epoch) {
+    if (_schedule == NULL)
+        return 0;
+
+    uint8_t rate = _schedule->schedule[GetDayType(GetDayNumber(epoch))][(epoch % TARIFF_SECONDS_PER_DAY) / TARIFF_SLOT_SECONDS];
+
+    return (rate < TARIFF_RATES_MAX) ? rate : 0;
+}
+
+// NULL when the day is not in the ring any more or nothing was booked on it
+const tariffTotal_s *TariffLedger::GetDay(uint32_t day) {
+    const tariffTotal_s *total = &_data.days[day % TARIFF_DAYS_KEPT];
+
+    return (total->period == day) ? total : NULL;
+}
+
+const tariffTotal_s *TariffLedger::GetMonth(uint32_t month) {
+    const tariffTotal_s *total = &_data.months[month % TARIFF_MONTHS_KEPT];
+
+    return (total->period == month) ? total : NULL;
+}
+
+// Newest day with a total, also while the time is not known yet
+uint32_t TariffLedger::GetLastDay(void) {
+    uint32_t lastDay = 0;
+
+    for (uint8_t i = 0; i < TARIFF_DAYS_KEPT; i++) {
+        lastDay = max(lastDay, _data.days[i].period);
+    }
+
+    return lastDay;
+}
+
+uint32_t TariffLedger::GetPendingPulses(void) {
+    return _pendingPulses;
+}
+
+uint32_t TariffLedger::GetDayNumber(uint32_t epoch) {
+    return epoch / TARIFF_SECONDS_PER_DAY;
+}
+
+uint32_t TariffLedger::GetMonthNumber(uint32_t day) {
+    uint16_t year;
+    uint8_t month;
+    uint8_t dayOfMonth;
+
+    GetDate(day, &year, &month, &dayOfMonth);
+
+    return (year * 12) + (month - 1);
+}
+
+// Days since 1970-01-01 to the civil date (after Howard Hinnant's algorithm)
+void TariffLedger::GetDate(uint32_t day, uint16_t *year, uint8_t *month, uint8_t *dayOfMonth) {
+    uint32_t shifted = day + 719468;    // days since 0000-03-01
+    uint32_t era = shifted / 146097;
+    uint32_t dayOfEra = shifted - (era * 146097);
+    uint32_t yearOfEra = (dayOfEra - (dayOfEra / 1460) + (dayOfEra / 36524) - (dayOfEra / 146096)) / 365;
+    uint32_t dayOfYear = dayOfEra - ((365 * yearOfEra) + (yearOfEra / 4) - (yearOfEra / 100));
+    uint32_t monthShifted = ((5 * dayOfYear) + 2) / 153;
+
+    *dayOfMonth = dayOfYear - (((153 * monthShifted) + 2) / 5) + 1;
+    *month = (monthShifted < 10) ? (monthShifted + 3) : (monthShifted - 9);
+    *year = yearOfEra + (era * 400) + ((*month <= 2) ? 1 : 0);
+}
+
+// 1970-01-01 was a Thursday
+tariffDayType_e TariffLedger::GetDayType(uint32_t day) {
+    uint8_t weekday = (day + 4) % 7;
+
+    return ((weekday == 0) || (weekday == 6)) ? tariffDayWeekend : tariffDayWeekday;
+}
@@ -0,0 +1,134 @@
+#ifndef TARIFF_LEDGER_H
+#define TARIFF_LEDGER_H
+
+#include "Arduino.h"
+
+#include <FS.h>
+#include <LittleFS.h>
+
+//=============================================================================
+// Defines
+//=============================================================================
+
+#define TARIFF_RATES_MAX                    4
+#define TARIFF_RATE_NAME_MAX                12
+#define TARIFF_SLOTS_PER_DAY                48      // half hours
+#define TARIFF_SLOT_SECONDS                 1800
+#define TARIFF_DAY_TYPES                    2       // weekdays, weekend
+#define TARIFF_DAYS_KEPT                    31
+#define TARIFF_MONTHS_KEPT                  12
+#define TARIFF_SECONDS_PER_DAY              86400
+#define TARIFF_MICRO_KWH_PER_KWH            1000000 // milli-watt hours per kilo-watt hour
+
+// Prices are in 1/10000 of the currency per kWh, costs accumulate as milli-watt
+// hours times price, so 1e10 cost units make one currency unit
+#define TARIFF_PRICE_SCALE                  10000
+#define TARIFF_COST_SCALE                   10000000000ULL
+
+// Totals are written alternately to two slots like the configuration, at
+// most this long after a change and at every change of day
+#define TARIFF_LEDGER_SLOT_PATH_0           "/tariff0.bin"
+#define TARIFF_LEDGER_SLOT_PATH_1           "/tariff1.bin"
+#define TARIFF_LEDGER_SLOTS                 2
+#define TARIFF_LEDGER_MAGIC                 0x54415246  // "TARF"
+#define TARIFF_LEDGER_VERSION               2           // 1 had no estimated energy, in what was padding
+#define TARIFF_LEDGER_SAVE_INTERVAL         900000      // 15 minutes
+
+//=============================================================================
+// Types
+//=============================================================================
+
+typedef enum {
+
+    tariffDayWeekday = 0,
+    tariffDayWeekend,
+
+} tariffDayType_e;
+
+typedef struct {
+
+    char name[TARIFF_RATE_NAME_MAX];
+    uint32_t price;                     // 1/10000 currency per kWh
+
+} tariffRate_s;
+
+typedef struct {
+
+    tariffRate_s rates[TARIFF_RATES_MAX];
+    uint8_t schedule[TARIFF_DAY_TYPES][TARIFF_SLOTS_PER_DAY];  // rate per half hour, local time
+
+} tariffSchedule_s;
+
+typedef struct {
+
+    uint32_t period;                    // local day number, or year * 12 + month - 1
+    uint32_t energy[TARIFF_RATES_MAX];  // milli-watt hours
+    uint32_t estimated;                 // milli-watt hours of energy modelled from batched samples
+    uint64_t cost;                      // milli-watt hours times price, see TARIFF_COST_SCALE
+
+} tariffTotal_s;
+
+typedef struct {
+
+    uint32_t magic;
+    uint16_t version;
+    uint16_t size;                      // of the payload following the header
+    uint32_t sequence;
+    uint32_t crc;
+
+} tariffLedgerHeader_s;
+
+typedef struct {
+
+    tariffTotal_s days[TARIFF_DAYS_KEPT];       // indexed by day number modulo
+    tariffTotal_s months[TARIFF_MONTHS_KEPT];   // indexed by month modulo
+
+} tariffLedgerData_s;
+
+//=============================================================================
+// Classes
+//=============================================================================
+
+// Daily and monthly energy and cost per tariff rate. Pulses are binned into
+// the rate of their local time as they are counted; the totals live in RAM
+// and are saved to flash periodically and on every change of day.
+class TariffLedger
+{
+    public:
+        TariffLedger(void);
+
+        void SetSchedule(const tariffSchedule_s *schedule);
+        const tariffSchedule_s *GetSchedule(void);
+        bool Begin(void);
+        void AddPulses(uint32_t epoch, uint32_t pulses, uint32_t pulsesPerKilowattHour, bool estimated);
+        void Update(void);
+        bool Save(void);
+
+        uint8_t GetRate(uint32_t epoch);
+        const tariffTotal_s *GetDay(uint32_t day);
+        const tariffTotal_s *GetMonth(uint32_t month);
+        uint32_t GetLastDay(void);
+        uint32_t GetPendingPulses(void);
+
+        static uint32_t GetDayNumber(uint32_t epoch);
+        static uint32_t GetMonthNumber(uint32_t day);
+        static void GetDate(uint32_t day, uint16_t *year, uint8_t *month, uint8_t *dayOfMonth);
+        static tariffDayType_e GetDayType(uint32_t day);
+
+    private:
+        tariffTotal_s *_GetTotal(tariffTotal_s *totals, uint8_t count, uint32_t period);
+
+        const tariffSchedule_s *_schedule;
+        tariffLedgerData_s _data;
+        uint32_t _sequence;
+        uint8_t _activeSlot;
+
+        uint32_t _remainder;            // pulses * 1e6 not yet worth a milli-watt hour
+        uint32_t _pendingPulses;        // counted before the time was known
+        uint32_t _lastDay;
+        bool _dirty;
+        bool _saveDue;
+        uint32_t _saveTime;
+};
+
+#endif // TARIFF_LEDGER_H
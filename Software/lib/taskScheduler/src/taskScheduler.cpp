@@ -0,0 +1,228 @@
+#include "taskScheduler.h"
+
+//=============================================================================
+// Object constructors
+//=============================================================================
+
+TaskScheduler::TaskScheduler(void) {
+    _taskCount = 0;
+    _runningTask = TASK_SCHEDULER_INVALID_TASK;
+    _deadlinePending = false;
+    _pendingDeadline = 0;
+}
+
+//=============================================================================
+// Private functions
+//=============================================================================
+
+bool TaskScheduler::_IsEarlier(uint8_t taskA, uint8_t taskB) {
+    // Signed difference keeps the ordering valid across a millis() roll over
+    int32_t deadlineDifference = (int32_t)(_tasks[taskA].nextDeadline - _tasks[taskB].nextDeadline);
+
+    if (deadlineDifference != 0) {
+        return (deadlineDifference < 0);
+    }
+
+    return (_tasks[taskA].priority > _tasks[taskB].priority);
+}
+
+void TaskScheduler::_SiftUp(uint8_t heapIndex) {
+    while (heapIndex > 0) {
+        uint8_t parentIndex = (heapIndex - 1) / 2;
+
+        if (!_IsEarlier(_heap[heapIndex], _heap[parentIndex])) {
+            break;
+        }
+
+        uint8_t swapTask = _heap[parentIndex];
+        _heap[parentIndex] = _heap[heapIndex];
+        _heap[heapIndex] = swapTask;
+        heapIndex = parentIndex;
+    }
+}
+
+void TaskScheduler::_SiftDown(uint8_t heapIndex) {
+    while (true) {
+        uint8_t leftIndex = (2 * heapIndex) + 1;
+        uint8_t rightIndex = leftIndex + 1;
+        uint8_t earliestIndex = heapIndex;
+
+        if ((leftIndex < _taskCount) && _IsEarlier(_heap[leftIndex], _heap[earliestIndex])) {
+            earliestIndex = leftIndex;
+        }
+
+        if ((rightIndex < _taskCount) && _IsEarlier(_heap[rightIndex], _heap[earliestIndex])) {
+            earliestIndex = rightIndex;
+        }
+
+        if (earliestIndex == heapIndex) {
+            break;
+        }
+
+        uint8_t swapTask = _heap[earliestIndex];
+        _heap[earliestIndex] = _heap[heapIndex];
+        _heap[heapIndex] = swapTask;
+        heapIndex = earliestIndex;
+    }
+}
+
+// A task's deadline moved, sift it from wherever it is in the heap
+void TaskScheduler::_Reschedule(uint8_t taskId) {
+    for (uint8_t heapIndex = 0; heapIndex < _taskCount; heapIndex++) {
+        if (_heap[heapIndex] == taskId) {
+            _SiftUp(heapIndex);
+            _SiftDown(heapIndex);
+            return;
+        }
+    }
+}
+
+//=============================================================================
+// Public functions
+//=============================================================================
+
+uint8_t TaskScheduler::AddTask(const char *name, taskCallback_t callback, uint32_t period, uint8_t priority, uint32_t maxRuntime) {
+
+    if ((_taskCount >= TASK_SCHEDULER_TASKS_MAX) || (callback == NULL)) {
+        return TASK_SCHEDULER_INVALID_TASK;
+    }
+
+    uint8_t taskId = _taskCount;
+    schedulerTask_s *task = &_tasks[taskId];
+
+    task->name = name;
+    task->callback = callback;
+    task->period = period;
+    task->maxRuntime = maxRuntime;
+    task->nextDeadline = millis();
+    task->priority = priority;
+
+    task->runCount = 0;
+    task->deadlineMissCount = 0;
+    task->overrunCount = 0;
+    task->lastRuntime = 0;
+    task->maxObservedRuntime = 0;
+    task->maxLateness = 0;
+
+    _heap[_taskCount] = taskId;
+    _taskCount++;
+    _SiftUp(_taskCount - 1);
+
+    return taskId;
+}
+
+bool TaskScheduler::Update(void) {
+
+    if (_taskCount == 0) {
+        return false;
+    }
+
+    uint32_t currentTime = millis();
+    schedulerTask_s *task = &_tasks[_heap[0]];
+
+    // Earliest deadline is still in the future, nothing to do this pass
+    if ((int32_t)(currentTime - task->nextDeadline) < 0) {
+        return false;
+    }
+
+    uint32_t lateness = currentTime - task->nextDeadline;
+
+    if (lateness > task->maxLateness) {
+        task->maxLateness = lateness;
+    }
+
+    // A task which could not start within its own period has missed at least one
+    // deadline; skip the lost periods so the sampling grid stays aligned.
+    if ((task->period > 0) && (lateness >= task->period)) {
+        uint32_t missedPeriods = lateness / task->period;
+
+        task->deadlineMissCount += missedPeriods;
+        task->nextDeadline += missedPeriods * task->period;
+    }
+
+    uint8_t taskId = _heap[0];
+
+    // A deadline the task sets for itself while running is held back until
+    // it returns, the period must not be added on top of it
+    _runningTask = taskId;
+    _deadlinePending = false;
+
+    uint32_t startTime = micros();
+    task->callback();
+    uint32_t runtime = micros() - startTime;
+
+    _runningTask = TASK_SCHEDULER_INVALID_TASK;
+
+    task->runCount++;
+    task->lastRuntime = runtime;
+
+    if (runtime > task->maxObservedRuntime) {
+        task->maxObservedRuntime = runtime;
+    }
+
+    if (runtime > (task->maxRuntime * 1000)) {
+        task->overrunCount++;
+    }
+
+    if (_deadlinePending == true) {
+        task->nextDeadline = _pendingDeadline;
+    } else if (task->period > 0) {
+        task->nextDeadline += task->period;
+    } else {
+        task->nextDeadline = millis();
+    }
+
+    // The callback may have rescheduled other tasks, so this one is not
+    // necessarily still at the top
+    _Reschedule(taskId);
+
+    return true;
+}
+
+void TaskScheduler::ClearStatistics(void) {
+    for (uint8_t i = 0; i < _taskCount; i++) {
+        _tasks[i].runCount = 0;
+        _tasks[i].deadlineMissCount = 0;
+        _tasks[i].overrunCount = 0;
+        _tasks[i].lastRuntime = 0;
+        _tasks[i].maxObservedRuntime = 0;
+        _tasks[i].maxLateness = 0;
+    }
+}
+
+void TaskScheduler::SetPeriod(uint8_t taskId, uint32_t period) {
+    if (taskId >= _taskCount) {
+        return;
+    }
+
+    _tasks[taskId].period = period;
+    SetNextDeadline(taskId, period);
+}
+
+// The task runs once after delay milli-seconds, then on its period again
+void TaskScheduler::SetNextDeadline(uint8_t taskId, uint32_t delay) {
+    if (taskId >= _taskCount) {
+        return;
+    }
+
+    if (taskId == _runningTask) {
+        _pendingDeadline = millis() + delay;
+        _deadlinePending = true;
+        return;
+    }
+
+    _tasks[taskId].nextDeadline = millis() + delay;
+    _Reschedule(taskId);
+}
+
+uint8_t TaskScheduler::GetTaskCount(void) {
+    return _taskCount;
+}
+
+const schedulerTask_s * TaskScheduler::GetTask(uint8_t taskId) {
+    if (taskId >= _taskCount) {
+        return NULL;
+    }
+
+    return &_tasks[taskId];
+}
@@ -0,0 +1,69 @@
+#ifndef TASK_SCHEDULER_H
+#define TASK_SCHEDULER_H
+
+#include "Arduino.h"
+
+//=============================================================================
+// Defines
+//=============================================================================
+
+#define TASK_SCHEDULER_TASKS_MAX            16
+#define TASK_SCHEDULER_INVALID_TASK         0xFF
+
+//=============================================================================
+// Types
+//=============================================================================
+
+typedef void (*taskCallback_t)(void);
+
+typedef struct {
+
+    const char *name;
+    taskCallback_t callback;
+    uint32_t period;                // milli-seconds, 0 = run on every idle pass
+    uint32_t maxRuntime;            // milli-seconds, longer runs count as overrun
+    uint32_t nextDeadline;          // milli-seconds
+    uint8_t priority;               // higher value wins when deadlines are equal
+
+    uint32_t runCount;
+    uint32_t deadlineMissCount;     // number of whole periods which were skipped
+    uint32_t overrunCount;
+    uint32_t lastRuntime;           // micro-seconds
+    uint32_t maxObservedRuntime;    // micro-seconds
+    uint32_t maxLateness;           // milli-seconds
+
+} schedulerTask_s;
+
+//=============================================================================
+// Classes
+//=============================================================================
+
+class TaskScheduler
+{
+    public:
+        TaskScheduler(void);
+
+        uint8_t AddTask(const char *name, taskCallback_t callback, uint32_t period, uint8_t priority, uint32_t maxRuntime);
+        bool Update(void);
+        void ClearStatistics(void);
+        void SetPeriod(uint8_t taskId, uint32_t period);
+        void SetNextDeadline(uint8_t taskId, uint32_t delay);
+
+        uint8_t GetTaskCount(void);
+        const schedulerTask_s *GetTask(uint8_t taskId);
+
+    private:
+        bool _IsEarlier(uint8_t taskA, uint8_t taskB);
+        void _SiftUp(uint8_t heapIndex);
+        void _SiftDown(uint8_t heapIndex);
+        void _Reschedule(uint8_t taskId);
+
+        schedulerTask_s _tasks[TASK_SCHEDULER_TASKS_MAX];
+        uint8_t _heap[TASK_SCHEDULER_TASKS_MAX];
+        uint8_t _taskCount;
+        uint8_t _runningTask;           // TASK_SCHEDULER_INVALID_TASK outside a callback
+        bool _deadlinePending;          // the running task set its own next deadline
+        uint32_t _pendingDeadline;
+};
+
+#endif // TASK_SCHEDULER_H
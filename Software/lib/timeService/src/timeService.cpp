@@ -0,0 +1,250 @@
+#include "timeService.h"
+
+//=============================================================================
+// Object constructors
+//=============================================================================
+
+TimeService::TimeService(WiFiUDP &udp) {
+    _udp = &udp;
+    _server[0] = '\0';
+    _serverResolved = false;
+    _utcOffset = 0;
+    _state = timeServiceIdle;
+    _lastMillis = 0;
+    _millisHigh = 0;
+    _synced = false;
+    _epochOffsetMs = 0;
+    _slewMs = 0;
+    _slewUptime = 0;
+    _requestUptime = 0;
+    _nextSyncUptime = 0;
+    _lastSyncUptime = 0;
+    _retryInterval = TIME_SERVICE_RETRY_MIN_MS;
+    _syncCount = 0;
+    _failureCount = 0;
+    _lastCorrection = 0;
+    _lastRoundTrip = 0;
+}
+
+//=============================================================================
+// Private functions
+//=============================================================================
+
+void TimeService::_SendRequest(void) {
+    uint8_t packet[TIME_SERVICE_PACKET_SIZE];
+
+    // Resolved once and kept until a request fails, pool names rotate servers
+    if (_serverResolved == false) {
+        if (WiFi.hostByName(_server, _serverIp, TIME_SERVICE_DNS_TIMEOUT_MS) != 1) {
+            _Failed();
+            return;
+        }
+
+        _serverResolved = true;
+    }
+
+    _requestUptime = GetUptimeMs();
+
+    // Client request, version 4; the transmit time stamp carries the request
+    // uptime, the server echoes it as originate time stamp
+    memset(packet, 0, sizeof(packet));
+    packet[0] = 0xE3;
+    packet[2] = 6;
+    packet[3] = 0xEC;
+
+    for (uint8_t i = 0; i < 8; i++) {
+        packet[40 + i] = (uint8_t)(_requestUptime >> (56 - (8 * i)));
+    }
+
+    _udp->beginPacket(_serverIp, TIME_SERVICE_NTP_PORT);
+    _udp->write(packet, sizeof(packet));
+    _udp->endPacket();
+
+    _state = timeServiceWaitReply;
+}
+
+bool TimeService::_ReadReply(void) {
+    uint8_t packet[TIME_SERVICE_PACKET_SIZE];
+    uint64_t originate = 0;
+
+    if (_udp->parsePacket() < TIME_SERVICE_PACKET_SIZE)
+        return false;
+
+    _udp->read(packet, sizeof(packet));
+
+    for (uint8_t i = 0; i < 8; i++) {
+        originate = (originate << 8) | packet[24 + i];
+    }
+
+    // Late replies to an earlier request are ignored
+    if (originate != _requestUptime)
+        return false;
+
+    uint32_t seconds = ((uint32_t)packet[40] << 24) | ((uint32_t)packet[41] << 16) | ((uint32_t)packet[42] << 8) | packet[43];
+    uint32_t fraction = ((uint32_t)packet[44] << 24) | ((uint32_t)packet[45] << 16) | ((uint32_t)packet[46] << 8) | packet[47];
+
+    // Server mode, a stratum of 0 is a kiss of death
+    if (((packet[0] & 0x07) != 4) || (packet[1] == 0) || (seconds < TIME_SERVICE_NTP_UNIX_OFFSET)) {
+        _Failed();
+        return false;
+    }
+
+    uint64_t now = GetUptimeMs();
+
+    _lastRoundTrip = now - _requestUptime;
+
+    // The server stamped the reply about half a round trip ago
+    int64_t epochMs = ((int64_t)(seconds - TIME_SERVICE_NTP_UNIX_OFFSET) * 1000) + (((uint64_t)fraction * 1000) >> 32) + (_lastRoundTrip / 2);
+    int64_t offsetMs = epochMs - (int64_t)now;
+    int64_t correction = offsetMs - _epochOffsetMs;
+
+    if ((_synced == false) || (correction > TIME_SERVICE_STEP_LIMIT_MS) || (correction < -TIME_SERVICE_STEP_LIMIT_MS)) {
+        _epochOffsetMs = offsetMs;
+        _slewMs = 0;
+    } else {
+        _slewMs = (int32_t)correction;
+        _slewUptime = now;
+    }
+
+    _lastCorrection = (_synced == true) ? (int32_t)constrain(correction, (int64_t)INT32_MIN, (int64_t)INT32_MAX) : 0;
+    _synced = true;
+    _syncCount++;
+    _lastSyncUptime = now;
+    _retryInterval = TIME_SERVICE_RETRY_MIN_MS;
+    _nextSyncUptime = now + TIME_SERVICE_SYNC_INTERVAL_MS;
+    _state = timeServiceIdle;
+
+    return true;
+}
+
+void TimeService::_Failed(void) {
+    _failureCount++;
+    _serverResolved = false;
+    _state = timeServiceIdle;
+    _nextSyncUptime = GetUptimeMs() + _retryInterval;
+    _retryInterval = min<uint32_t>(_retryInterval * 2, TIME_SERVICE_RETRY_MAX_MS);
+}
+
+void TimeService::_Slew(uint64_t uptimeMs) {
+    if (_slewMs == 0) {
+        _slewUptime = uptimeMs;
+        return;
+    }
+
+    // One milli-second of correction per 64 ms elapsed, the remainder carries over
+    uint64_t steps = (uptimeMs - _slewUptime) >> TIME_SERVICE_SLEW_SHIFT;
+
+    if (steps == 0)
+        return;
+
+    _slewUptime += steps << TIME_SERVICE_SLEW_SHIFT;
+
+    int32_t step = (int32_t)min<uint64_t>(steps, (uint64_t)abs(_slewMs));
+
+    if (_slewMs < 0)
+        step = -step;
+
+    _epochOffsetMs += step;
+    _slewMs -= step;
+}
+
+//=============================================================================
+// Public functions
+//=============================================================================
+
+void TimeService::Begin(void) {
+    _udp->begin(TIME_SERVICE_LOCAL_PORT);
+}
+
+void TimeService::SetServer(const char *server) {
+    if (strncmp(_server, server, sizeof(_server)) == 0)
+        return;
+
+    strncpy(_server, server, sizeof(_server) - 1);
+    _server[sizeof(_server) - 1] = '\0';
+
+    // A new server is asked right away
+    _serverResolved = false;
+    _state = timeServiceIdle;
+    _nextSyncUptime = GetUptimeMs();
+    _retryInterval = TIME_SERVICE_RETRY_MIN_MS;
+}
+
+void TimeService::SetOffset(int32_t utcOffset) {
+    _utcOffset = utcOffset;
+}
+
+// Returns true when a reply has just been applied
+bool TimeService::Update(bool online) {
+    uint64_t now = GetUptimeMs();
+
+    _Slew(now);
+
+    if (_state == timeServiceWaitReply) {
+        if (_ReadReply() == true)
+            return true;
+
+        if ((_state == timeServiceWaitReply) && ((now - _requestUptime) > TIME_SERVICE_REPLY_TIMEOUT_MS))
+            _Failed();
+
+        return false;
+    }
+
+    if ((online == false) || (now < _nextSyncUptime) || (_server[0] == '\0'))
+        return false;
+
+    _SendRequest();
+
+    return false;
+}
+
+uint64_t TimeService::GetUptimeMs(void) {
+    uint32_t milliSeconds = millis();
+
+    if (milliSeconds < _lastMillis)
+        _millisHigh++;
+
+    _lastMillis = milliSeconds;
+
+    return ((uint64_t)_millisHigh << 32) | milliSeconds;
+}
+
+bool TimeService::IsSynced(void) {
+    return _synced;
+}
+
+// Local time in seconds since 1970, the configured UTC offset included
+uint32_t TimeService::GetEpoch(void) {
+    return ToEpoch(GetUptimeMs());
+}
+
+uint32_t TimeService::ToEpoch(uint64_t uptimeMs) {
+    if (_synced == false)
+        return 0;
+
+    return (uint32_t)((((int64_t)uptimeMs + _epochOffsetMs) / 1000) + _utcOffset);
+}
+
+uint32_t TimeService::GetSyncCount(void) {
+    return _syncCount;
+}
+
+uint32_t TimeService::GetFailureCount(void) {
+    return _failureCount;
+}
+
+int32_t TimeService::GetLastCorrection(void) {
+    return _lastCorrection;
+}
+
+int32_t TimeService::GetPendingSlew(void) {
+    return _slewMs;
+}
+
+uint32_t TimeService::GetLastRoundTrip(void) {
+    return _lastRoundTrip;
+}
+
+uint64_t TimeService::GetLastSyncUptime(void) {
+    return _lastSyncUptime;
+}
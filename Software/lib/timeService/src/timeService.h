@@ -0,0 +1,104 @@
+#ifndef TIME_SERVICE_H
+#define TIME_SERVICE_H
+
+#include "Arduino.h"
+
+#include <ESP8266WiFi.h>
+#include <WiFiUdp.h>
+
+//=============================================================================
+// Defines
+//=============================================================================
+
+#define TIME_SERVICE_NTP_PORT               123
+#define TIME_SERVICE_LOCAL_PORT             2390
+#define TIME_SERVICE_PACKET_SIZE            48
+#define TIME_SERVICE_SERVER_MAX             48
+#define TIME_SERVICE_NTP_UNIX_OFFSET        2208988800UL    // 1900-01-01 to 1970-01-01 in seconds
+
+#define TIME_SERVICE_SYNC_INTERVAL_MS       900000          // re-sync every 15 minutes once synced
+#define TIME_SERVICE_RETRY_MIN_MS           2000            // first retry, doubles per failure
+#define TIME_SERVICE_RETRY_MAX_MS           64000
+#define TIME_SERVICE_REPLY_TIMEOUT_MS       2000
+#define TIME_SERVICE_DNS_TIMEOUT_MS         500
+
+// Corrections up to the step limit are slewed: the clock runs 1/64 (~1.6 %)
+// faster or slower until the error is gone, so time stamps never go backwards
+#define TIME_SERVICE_STEP_LIMIT_MS          10000
+#define TIME_SERVICE_SLEW_SHIFT             6
+
+//=============================================================================
+// Types
+//=============================================================================
+
+typedef enum {
+
+    timeServiceIdle = 0,
+    timeServiceWaitReply
+
+} timeServiceState_e;
+
+//=============================================================================
+// Classes
+//=============================================================================
+
+// Wall clock disciplined by NTP on top of a monotonic 64 bit uptime clock.
+// Requests are sent and replies polled from Update(), nothing waits on the
+// network except a bounded DNS lookup when the server name is (re)resolved.
+class TimeService
+{
+    public:
+        TimeService(WiFiUDP &udp);
+
+        void Begin(void);
+        void SetServer(const char *server);
+        void SetOffset(int32_t utcOffset);
+        bool Update(bool online);
+
+        uint64_t GetUptimeMs(void);
+        bool IsSynced(void);
+        uint32_t GetEpoch(void);
+        uint32_t ToEpoch(uint64_t uptimeMs);
+
+        uint32_t GetSyncCount(void);
+        uint32_t GetFailureCount(void);
+        int32_t GetLastCorrection(void);
+        int32_t GetPendingSlew(void);
+        uint32_t GetLastRoundTrip(void);
+        uint64_t GetLastSyncUptime(void);
+
+    private:
+        void _SendRequest(void);
+        bool _ReadReply(void);
+        void _Failed(void);
+        void _Slew(uint64_t uptimeMs);
+
+        WiFiUDP *_udp;
+        char _server[TIME_SERVICE_SERVER_MAX];
+        IPAddress _serverIp;
+        bool _serverResolved;
+        int32_t _utcOffset;
+        timeServiceState_e _state;
+
+        // Extended millis(), survives the 49 day wrap
+        uint32_t _lastMillis;
+        uint32_t _millisHigh;
+
+        // Epoch in milli-seconds = uptime + offset, with the pending slew
+        // applied a little on every Update()
+        bool _synced;
+        int64_t _epochOffsetMs;
+        int32_t _slewMs;
+        uint64_t _slewUptime;
+
+        uint64_t _requestUptime;
+        uint64_t _nextSyncUptime;
+        uint64_t _lastSyncUptime;
+        uint32_t _retryInterval;
+        uint32_t _syncCount;
+        uint32_t _failureCount;
+        int32_t _lastCorrection;
+        uint32_t _lastRoundTrip;
+};
+
+#endif // TIME_SERVICE_H
@@ -0,0 +1,74 @@
+#include "wifiCache.h"
+
+#include <coredecls.h>
+
+//=============================================================================
+// Object constructors
+//=============================================================================
+
+WiFiCache::WiFiCache(uint32_t rtcOffset) {
+    _rtcOffset = rtcOffset;
+    _credentialsCrc = 0;
+    _valid = false;
+
+    memset(&_entry, 0, sizeof(_entry));
+}
+
+//=============================================================================
+// Public functions
+//=============================================================================
+
+void WiFiCache::Init(const char *ssid, const char *password) {
+    // Changed credentials make the cached access point meaningless
+    _credentialsCrc = crc32(ssid, strlen(ssid));
+    _credentialsCrc = crc32(password, strlen(password), _credentialsCrc);
+
+    _valid = false;
+
+    if (ESP.rtcUserMemoryRead(_rtcOffset, (uint32_t *)&_entry, sizeof(_entry))) {
+        _valid = (_entry.magic == WIFI_CACHE_RTC_MAGIC) &&
+                 (_entry.crc == crc32(&_entry, offsetof(wifiCacheEntry_s, crc))) &&
+                 (_entry.credentialsCrc == _credentialsCrc) &&
+                 (_entry.channel != 0);
+    }
+}
+
+bool WiFiCache::IsValid(void) {
+    return _valid;
+}
+
+const wifiCacheEntry_s * WiFiCache::GetEntry(void) {
+    return &_entry;
+}
+
+void WiFiCache::Store(uint8_t channel, const uint8_t *bssid, uint32_t ipAddress, uint32_t gateway, uint32_t netmask, uint32_t dns) {
+    wifiCacheEntry_s entry;
+
+    memset(&entry, 0, sizeof(entry));
+    entry.magic = WIFI_CACHE_RTC_MAGIC;
+    entry.credentialsCrc = _credentialsCrc;
+    memcpy(entry.bssid, bssid, WIFI_CACHE_BSSID_LENGTH);
+    entry.channel = channel;
+    entry.ipAddress = ipAddress;
+    entry.gateway = gateway;
+    entry.netmask = netmask;
+    entry.dns = dns;
+    entry.crc = crc32(&entry, offsetof(wifiCacheEntry_s, crc));
+
+    // Reconnects to the same access point leave RTC memory untouched
+    if ((_valid == true) && (memcmp(&entry, &_entry, sizeof(entry)) == 0))
+        return;
+
+    _entry = entry;
+    _valid = true;
+    ESP.rtcUserMemoryWrite(_rtcOffset, (uint32_t *)&_entry, sizeof(_entry));
+}
+
+void WiFiCache::Invalidate(void) {
+    if (_valid == false)
+        return;
+
+    _valid = false;
+    _entry.magic = 0;
+    ESP.rtcUserMemoryWrite(_rtcOffset, (uint32_t *)&_entry, sizeof(_entry));
+}
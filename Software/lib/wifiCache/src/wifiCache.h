@@ -0,0 +1,59 @@
+#ifndef WIFI_CACHE_H
+#define WIFI_CACHE_H
+
+#include "Arduino.h"
+
+//=============================================================================
+// Defines
+//=============================================================================
+
+#define WIFI_CACHE_RTC_MAGIC                    0x57464331  // "WFC1"
+#define WIFI_CACHE_BSSID_LENGTH                 6
+
+//=============================================================================
+// Types
+//=============================================================================
+
+// Persisted in RTC user memory, learned on the last successful connection and
+// bound to the credentials it was learned with
+typedef struct {
+
+    uint32_t magic;
+    uint32_t credentialsCrc;
+    uint8_t bssid[WIFI_CACHE_BSSID_LENGTH];
+    uint8_t channel;
+    uint8_t reserved;
+    uint32_t ipAddress;                 // lease of the last connection, network order
+    uint32_t gateway;
+    uint32_t netmask;
+    uint32_t dns;
+    uint32_t crc;
+
+} wifiCacheEntry_s;
+
+//=============================================================================
+// Classes
+//=============================================================================
+
+// Connection parameters cached across resets and deep sleep so the station can
+// join on a known channel and BSSID with a known address, skipping the scan
+// and DHCP; any failure drops the cache and the next attempt scans again.
+class WiFiCache
+{
+    public:
+        WiFiCache(uint32_t rtcOffset);
+
+        void Init(const char *ssid, const char *password);
+        bool IsValid(void);
+        const wifiCacheEntry_s *GetEntry(void);
+        void Store(uint8_t channel, const uint8_t *bssid, uint32_t ipAddress, uint32_t gateway, uint32_t netmask, uint32_t dns);
+        void Invalidate(void);
+
+    private:
+        uint32_t _rtcOffset;
+        uint32_t _credentialsCrc;
+        bool _valid;
+        wifiCacheEntry_s _entry;
+};
+
+#endif // WIFI_CACHE_H
@@ -0,0 +1,98 @@
+#ifndef ARDUINO_H
+#define ARDUINO_H
+
+//=============================================================================
+// Host shim of the Arduino/ESP8266 core used by the native environment. Time,
+// GPIO and interrupts are driven by the simulation (see simulation.h).
+//=============================================================================
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include <algorithm>
+
+#include "binary.h"
+#include "WString.h"
+#include "Print.h"
+#include "IPAddress.h"
+#include "HardwareSerial.h"
+#include "Esp.h"
+
+//=============================================================================
+// Defines
+//=============================================================================
+
+#define ESP8266
+#define ARDUINO                 10813
+
+#define IRAM_ATTR
+#define ICACHE_RAM_ATTR
+#define PROGMEM
+#define F(string)               (string)
+#define PSTR(string)            (string)
+#define pgm_read_byte(address)  (*(const uint8_t *)(address))
+
+#define HIGH                    0x1
+#define LOW                     0x0
+
+#define INPUT                   0x00
+#define INPUT_PULLUP            0x02
+#define INPUT_PULLDOWN_16       0x04
+#define OUTPUT                  0x01
+#define OUTPUT_OPEN_DRAIN       0x03
+
+#define RISING                  0x01
+#define FALLING                 0x02
+#define CHANGE                  0x03
+#define ONLOW                   0x04
+#define ONHIGH                  0x05
+
+#define A0                      17
+#define NUM_DIGITAL_PINS        18
+
+#define digitalPinToInterrupt(pin)  (pin)
+
+using std::min;
+using std::max;
+
+#define constrain(value, low, high) ((value) < (low) ? (low) : ((value) > (high) ? (high) : (value)))
+
+//=============================================================================
+// Types
+//=============================================================================
+
+typedef bool boolean;
+typedef uint8_t byte;
+
+//=============================================================================
+// Prototypes
+//=============================================================================
+
+unsigned long millis(void);
+unsigned long micros(void);
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+void yield(void);
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t value);
+int digitalRead(uint8_t pin);
+int analogRead(uint8_t pin);
+
+void attachInterrupt(uint8_t pin, void (*isr)(void), int mode);
+void attachInterruptArg(uint8_t pin, void (*isr)(void *), void *arg, int mode);
+void detachInterrupt(uint8_t pin);
+void noInterrupts(void);
+void interrupts(void);
+
+void tone(uint8_t pin, unsigned int frequency, unsigned long duration = 0);
+void noTone(uint8_t pin);
+
+void setup(void);
+void loop(void);
+
+#endif // ARDUINO_H
@@ -0,0 +1,16 @@
+#ifndef ESP8266_HTTP_UPDATE_SERVER_H
+#define ESP8266_HTTP_UPDATE_SERVER_H
+
+#include "ESP8266WebServer.h"
+
+//=============================================================================
+// Classes
+//=============================================================================
+
+class ESP8266HTTPUpdateServer
+{
+    public:
+        void setup(ESP8266WebServer *server) { (void)server; }
+};
+
+#endif // ESP8266_HTTP_UPDATE_SERVER_H
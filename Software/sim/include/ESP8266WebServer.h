@@ -0,0 +1,138 @@
+#ifndef ESP8266_WEB_SERVER_H
+#define ESP8266_WEB_SERVER_H
+
+#include <functional>
+#include <vector>
+
+#include "Arduino.h"
+#include "ESP8266WiFi.h"
+#include "FS.h"
+
+//=============================================================================
+// Defines
+//=============================================================================
+
+#define CONTENT_LENGTH_UNKNOWN      ((size_t)-1)
+#define CONTENT_LENGTH_NOT_SET      ((size_t)-2)
+#define HTTP_UPLOAD_BUFLEN          2048
+
+//=============================================================================
+// Types
+//=============================================================================
+
+typedef enum {
+
+    HTTP_ANY = 0,
+    HTTP_GET,
+    HTTP_HEAD,
+    HTTP_POST,
+    HTTP_PUT,
+    HTTP_PATCH,
+    HTTP_DELETE,
+    HTTP_OPTIONS
+
+} HTTPMethod;
+
+typedef enum {
+
+    UPLOAD_FILE_START = 0,
+    UPLOAD_FILE_WRITE,
+    UPLOAD_FILE_END,
+    UPLOAD_FILE_ABORTED
+
+} HTTPUploadStatus;
+
+typedef struct {
+
+    HTTPUploadStatus status;
+    String filename;
+    String name;
+    String type;
+    size_t totalSize;
+    size_t currentSize;
+    uint8_t buf[HTTP_UPLOAD_BUFLEN];
+
+} HTTPUpload;
+
+//=============================================================================
+// Classes
+//=============================================================================
+
+class ESP8266WebServer
+{
+    public:
+        typedef std::function<void(void)> THandlerFunction;
+
+        ESP8266WebServer(int port = 80);
+
+        void begin(void) { _running = true; }
+        void stop(void) { _running = false; }
+        void handleClient(void);
+
+        void on(const String &uri, THandlerFunction handler);
+        void on(const String &uri, HTTPMethod method, THandlerFunction handler);
+        void on(const String &uri, HTTPMethod method, THandlerFunction handler, THandlerFunction uploadHandler);
+        void onNotFound(THandlerFunction handler) { _notFoundHandler = handler; }
+
+        String uri(void) { return _currentUri; }
+        HTTPMethod method(void) { return _currentMethod; }
+        HTTPUpload &upload(void) { return _upload; }
+
+        String arg(const String &name);
+        String arg(int index);
+        String argName(int index);
+        int args(void) { return (int)_argumentNames.size(); }
+        bool hasArg(const String &name);
+
+        void sendHeader(const String &name, const String &value, bool first = false);
+        void setContentLength(size_t contentLength) { _contentLength = contentLength; }
+        void send(int code, const char *contentType = NULL, const String &content = String());
+        void send(int code, const String &contentType, const String &content) { send(code, contentType.c_str(), content); }
+        void send_P(int code, const char *contentType, const char *content, size_t contentLength);
+        void sendContent(const String &content);
+        void sendContent(const char *content, size_t size);
+        size_t streamFile(File &file, const String &contentType);
+
+        // Simulation interface, queue a request which the next handleClient() serves
+        void SimulationQueueRequest(HTTPMethod method, const String &uri, const std::vector<String> &argumentNames, const std::vector<String> &argumentValues);
+        bool SimulationRequest(HTTPMethod method, const String &uri, const std::vector<String> &argumentNames, const std::vector<String> &argumentValues);
+        int SimulationGetResponseCode(void) { return _responseCode; }
+        const String &SimulationGetResponse(void) { return _response; }
+        uint32_t SimulationGetRequestCount(void) { return _requestCount; }
+
+    private:
+        typedef struct {
+
+            String uri;
+            HTTPMethod method;
+            THandlerFunction handler;
+            THandlerFunction uploadHandler;
+
+        } route_s;
+
+        typedef struct {
+
+            HTTPMethod method;
+            String uri;
+            std::vector<String> argumentNames;
+            std::vector<String> argumentValues;
+
+        } request_s;
+
+        bool _running;
+        String _currentUri;
+        HTTPMethod _currentMethod;
+        HTTPUpload _upload;
+        size_t _contentLength;
+        int _responseCode;
+        String _response;
+        uint32_t _requestCount;
+
+        std::vector<route_s> _routes;
+        std::vector<request_s> _pendingRequests;
+        std::vector<String> _argumentNames;
+        std::vector<String> _argumentValues;
+        THandlerFunction _notFoundHandler;
+};
+
+#endif // ESP8266_WEB_SERVER_H
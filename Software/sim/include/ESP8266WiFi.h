@@ -0,0 +1,150 @@
+#ifndef ESP8266_WIFI_H
+#define ESP8266_WIFI_H
+
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "Arduino.h"
+#include "WiFiClient.h"
+#include "WiFiUdp.h"
+
+//=============================================================================
+// Types
+//=============================================================================
+
+typedef enum {
+
+    WIFI_OFF = 0,
+    WIFI_STA = 1,
+    WIFI_AP = 2,
+    WIFI_AP_STA = 3
+
+} WiFiMode_t;
+
+typedef enum {
+
+    WL_IDLE_STATUS = 0,
+    WL_NO_SSID_AVAIL = 1,
+    WL_SCAN_COMPLETED = 2,
+    WL_CONNECTED = 3,
+    WL_CONNECT_FAILED = 4,
+    WL_CONNECTION_LOST = 5,
+    WL_WRONG_PASSWORD = 6,
+    WL_DISCONNECTED = 7
+
+} wl_status_t;
+
+struct WiFiEventStationModeConnected {
+
+    String ssid;
+    uint8_t bssid[6];
+    uint8_t channel;
+};
+
+struct WiFiEventStationModeGotIP {
+
+    IPAddress ip;
+    IPAddress mask;
+    IPAddress gw;
+};
+
+struct WiFiEventStationModeDisconnected {
+
+    String ssid;
+    uint8_t bssid[6];
+    uint8_t reason;
+};
+
+struct WiFiEventSoftAPModeStationConnected {
+
+    uint8_t mac[6];
+    uint8_t aid;
+};
+
+struct WiFiEventHandlerOpaque {
+
+    virtual ~WiFiEventHandlerOpaque(void) {}
+};
+
+typedef std::shared_ptr<WiFiEventHandlerOpaque> WiFiEventHandler;
+
+//=============================================================================
+// Classes
+//=============================================================================
+
+class ESP8266WiFiClass
+{
+    public:
+        ESP8266WiFiClass(void);
+
+        bool mode(WiFiMode_t mode);
+        WiFiMode_t getMode(void);
+        wl_status_t status(void);
+        bool isConnected(void) { return status() == WL_CONNECTED; }
+
+        wl_status_t begin(const char *ssid, const char *passphrase = NULL, int32_t channel = 0, const uint8_t *bssid = NULL, bool connect = true);
+        wl_status_t begin(const String &ssid, const String &passphrase = String(), int32_t channel = 0, const uint8_t *bssid = NULL, bool connect = true);
+        bool config(IPAddress localIP, IPAddress gateway, IPAddress subnet, IPAddress dns1 = IPAddress(), IPAddress dns2 = IPAddress());
+        bool disconnect(bool wifiOff = false);
+        bool persistent(bool persistent) { (void)persistent; return true; }
+        bool setAutoConnect(bool autoConnect) { (void)autoConnect; return true; }
+        bool setAutoReconnect(bool autoReconnect) { (void)autoReconnect; return true; }
+        bool hostname(const char *name);
+        bool hostname(const String &name) { return hostname(name.c_str()); }
+        String hostname(void) { return _hostname; }
+
+        bool forceSleepBegin(uint32_t sleepUs = 0);
+        bool forceSleepWake(void);
+
+        IPAddress localIP(void);
+        IPAddress subnetMask(void);
+        IPAddress gatewayIP(void);
+        IPAddress dnsIP(uint8_t dnsNumber = 0);
+        int32_t RSSI(void);
+        int32_t channel(void);
+        uint8_t *BSSID(void);
+        String BSSIDstr(void);
+        String SSID(void);
+        String macAddress(void) { return String("5C:CF:7F:C0:FF:EE"); }
+
+        bool softAPConfig(IPAddress localIP, IPAddress gateway, IPAddress subnet);
+        bool softAP(const char *ssid, const char *passphrase = NULL);
+        IPAddress softAPIP(void);
+
+        int hostByName(const char *hostName, IPAddress &result, uint32_t timeoutMs = 10000);
+
+        WiFiEventHandler onStationModeConnected(std::function<void(const WiFiEventStationModeConnected &)> handler);
+        WiFiEventHandler onStationModeGotIP(std::function<void(const WiFiEventStationModeGotIP &)> handler);
+        WiFiEventHandler onStationModeDisconnected(std::function<void(const WiFiEventStationModeDisconnected &)> handler);
+        WiFiEventHandler onSoftAPModeStationConnected(std::function<void(const WiFiEventSoftAPModeStationConnected &)> handler);
+
+        // Simulation interface
+        void SimulationUpdate(void);
+        void SimulationSetAccessPoint(bool available, uint8_t channel, int32_t rssi);
+        bool SimulationIsRadioOn(void);
+
+    private:
+        WiFiMode_t _mode;
+        wl_status_t _status;
+        bool _radioSleeping;
+        bool _staticIp;
+        bool _accessPointAvailable;
+        uint8_t _accessPointChannel;
+        uint8_t _accessPointBssid[6];
+        int32_t _accessPointRssi;
+        uint64_t _connectTime;
+        String _ssid;
+        String _hostname;
+        IPAddress _localIP;
+        IPAddress _gatewayIP;
+        IPAddress _subnetMask;
+        IPAddress _dnsIP;
+        IPAddress _softAPIP;
+
+        std::vector<std::weak_ptr<WiFiEventHandlerOpaque> > _handlers;
+};
+
+extern ESP8266WiFiClass WiFi;
+
+#endif // ESP8266_WIFI_H
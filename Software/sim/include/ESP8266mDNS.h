@@ -0,0 +1,21 @@
+#ifndef ESP8266_MDNS_H
+#define ESP8266_MDNS_H
+
+#include "Arduino.h"
+
+//=============================================================================
+// Classes
+//=============================================================================
+
+class MDNSResponder
+{
+    public:
+        bool begin(const char *hostName) { (void)hostName; return true; }
+        bool begin(const String &hostName) { return begin(hostName.c_str()); }
+        bool update(void) { return true; }
+        bool addService(const char *service, const char *protocol, uint16_t port) { (void)service; (void)protocol; (void)port; return true; }
+};
+
+extern MDNSResponder MDNS;
+
+#endif // ESP8266_MDNS_H
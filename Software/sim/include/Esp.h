@@ -0,0 +1,87 @@
+#ifndef ESP_H
+#define ESP_H
+
+#include <stdint.h>
+
+#include "WString.h"
+
+//=============================================================================
+// Defines
+//=============================================================================
+
+#define RTC_USER_MEMORY_SIZE    512
+
+//=============================================================================
+// Types
+//=============================================================================
+
+enum rst_reason {
+
+    REASON_DEFAULT_RST = 0,
+    REASON_WDT_RST,
+    REASON_EXCEPTION_RST,
+    REASON_SOFT_WDT_RST,
+    REASON_SOFT_RESTART,
+    REASON_DEEP_SLEEP_AWAKE,
+    REASON_EXT_SYS_RST
+};
+
+struct rst_info {
+
+    uint32_t reason;
+    uint32_t exccause;
+    uint32_t epc1;
+    uint32_t epc2;
+    uint32_t epc3;
+    uint32_t excvaddr;
+    uint32_t depc;
+};
+
+typedef enum {
+
+    RF_DEFAULT = 0,
+    RF_CAL,
+    RF_NO_CAL,
+    RF_DISABLED
+
+} RFMode;
+
+//=============================================================================
+// Classes
+//=============================================================================
+
+class EspClass
+{
+    public:
+        uint32_t getSketchSize(void) { return 400000; }
+        uint32_t getFreeSketchSpace(void) { return 600000; }
+        uint32_t getFlashChipSize(void) { return 4194304; }
+        uint32_t getFlashChipRealSize(void) { return 4194304; }
+        uint32_t getFlashChipSpeed(void) { return 40000000; }
+        const char *getSdkVersion(void) { return "host-simulation"; }
+        String getFullVersion(void) { return String("host-simulation"); }
+        uint8_t getCpuFreqMHz(void) { return 80; }
+        uint32_t getChipId(void) { return 0x00C0FFEE; }
+
+        uint32_t getCycleCount(void);
+        uint32_t getFreeHeap(void);
+        uint32_t getMaxFreeBlockSize(void);
+        uint8_t getHeapFragmentation(void);
+        void getHeapStats(uint32_t *freeHeap, uint32_t *maxFreeBlock, uint8_t *fragmentation);
+
+        String getResetInfo(void);
+        String getResetReason(void);
+        struct rst_info *getResetInfoPtr(void);
+
+        bool rtcUserMemoryRead(uint32_t offset, uint32_t *data, size_t size);
+        bool rtcUserMemoryWrite(uint32_t offset, uint32_t *data, size_t size);
+
+        void reset(void);
+        void restart(void);
+        void deepSleep(uint64_t timeUs, RFMode mode = RF_DEFAULT);
+        uint64_t deepSleepMax(void) { return 3 * 3600ULL * 1000000ULL; }
+};
+
+extern EspClass ESP;
+
+#endif // ESP_H
@@ -0,0 +1,164 @@
+#ifndef FS_H
+#define FS_H
+
+#include <time.h>
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Arduino.h"
+
+//=============================================================================
+// Types
+//=============================================================================
+
+enum SeekMode {
+
+    SeekSet = 0,
+    SeekCur = 1,
+    SeekEnd = 2
+};
+
+struct FSInfo {
+
+    size_t totalBytes;
+    size_t usedBytes;
+    size_t blockSize;
+    size_t pageSize;
+    size_t maxOpenFiles;
+    size_t maxPathLength;
+};
+
+typedef struct {
+
+    std::vector<uint8_t> data;
+    time_t lastWrite;
+    time_t creation;
+
+} simulationFileNode_s;
+
+typedef struct {
+
+    uint64_t bytesWritten;          // bytes handed to the file system by the application
+    uint64_t blocksErased;          // modelled copy-on-write block erases
+    uint32_t writeOperations;
+
+} simulationFlashStatistics_s;
+
+//=============================================================================
+// Classes
+//=============================================================================
+
+class FS;
+
+class File : public Stream
+{
+    public:
+        File(void) : _position(0), _dirtyStart(0), _dirtyEnd(0), _append(false), _writable(false), _owner(NULL) {}
+        File(std::shared_ptr<simulationFileNode_s> node, const std::string &path, bool append, bool writable, FS *owner);
+
+        size_t write(uint8_t c);
+        size_t write(const uint8_t *buffer, size_t size);
+        using Print::write;
+
+        int available(void);
+        int read(void);
+        int peek(void);
+        size_t read(uint8_t *buffer, size_t size);
+        bool seek(uint32_t position, SeekMode mode = SeekSet);
+        size_t position(void) const { return _position; }
+        size_t size(void) const;
+        bool truncate(uint32_t size);
+        void flush(void) {}
+        void close(void);
+
+        const char *name(void) const;
+        const char *fullName(void) const { return _path.c_str(); }
+        bool isFile(void) const { return _node != NULL; }
+        bool isDirectory(void) const { return false; }
+        time_t getLastWrite(void) const { return _node ? _node->lastWrite : 0; }
+
+        operator bool(void) const { return _node != NULL; }
+
+    private:
+        std::shared_ptr<simulationFileNode_s> _node;
+        std::string _path;
+        size_t _position;
+        size_t _dirtyStart;
+        size_t _dirtyEnd;
+        bool _append;
+        bool _writable;
+        FS *_owner;
+};
+
+class Dir
+{
+    public:
+        Dir(void) : _index(-1) {}
+        Dir(const std::vector<std::string> &names, const std::vector<bool> &directories, const std::string &path, FS *owner);
+
+        bool next(void);
+        bool rewind(void) { _index = -1; return true; }
+        String fileName(void);
+        size_t fileSize(void);
+        time_t fileTime(void);
+        time_t fileCreationTime(void);
+        bool isFile(void);
+        bool isDirectory(void);
+        File openFile(const char *mode);
+
+    private:
+        std::vector<std::string> _names;
+        std::vector<bool> _directories;
+        std::string _path;
+        int _index;
+        FS *_owner;
+};
+
+class FS
+{
+    public:
+        typedef time_t (*timeCallback_t)(void);
+
+        FS(void);
+
+        bool begin(void) { return true; }
+        void end(void) {}
+        bool format(void);
+        bool info(FSInfo &info);
+
+        File open(const char *path, const char *mode);
+        File open(const String &path, const char *mode) { return open(path.c_str(), mode); }
+        bool exists(const char *path);
+        bool exists(const String &path) { return exists(path.c_str()); }
+        bool remove(const char *path);
+        bool remove(const String &path) { return remove(path.c_str()); }
+        bool rename(const char *pathFrom, const char *pathTo);
+        bool rename(const String &pathFrom, const String &pathTo) { return rename(pathFrom.c_str(), pathTo.c_str()); }
+        bool mkdir(const char *path);
+        bool mkdir(const String &path) { return mkdir(path.c_str()); }
+        bool rmdir(const char *path) { (void)path; return true; }
+        Dir openDir(const char *path);
+        Dir openDir(const String &path) { return openDir(path.c_str()); }
+        void setTimeCallback(timeCallback_t callback) { _timeCallback = callback; }
+
+        // Simulation interface
+        void SimulationRecordCommit(simulationFileNode_s *node, size_t start, size_t end);
+        time_t SimulationGetTime(void);
+        const simulationFlashStatistics_s &SimulationGetStatistics(void) { return _statistics; }
+        std::shared_ptr<simulationFileNode_s> SimulationGetNode(const std::string &path);
+        void SimulationSaveState(std::vector<uint8_t> &state);
+        size_t SimulationLoadState(const uint8_t *state, size_t size, size_t position);
+
+    private:
+        std::string _NormalisePath(const char *path);
+
+        std::map<std::string, std::shared_ptr<simulationFileNode_s> > _files;
+        std::map<std::string, bool> _directories;
+        timeCallback_t _timeCallback;
+        simulationFlashStatistics_s _statistics;
+};
+
+#endif // FS_H
@@ -0,0 +1,39 @@
+#ifndef HARDWARE_SERIAL_H
+#define HARDWARE_SERIAL_H
+
+#include "Print.h"
+
+//=============================================================================
+// Defines
+//=============================================================================
+
+#define SERIAL_8N1          0x1c
+#define SERIAL_FULL         0
+#define SERIAL_RX_ONLY      1
+#define SERIAL_TX_ONLY      2
+
+//=============================================================================
+// Classes
+//=============================================================================
+
+class HardwareSerial : public Stream
+{
+    public:
+        void begin(unsigned long baud) { (void)baud; }
+        void begin(unsigned long baud, int config, int mode = SERIAL_FULL) { (void)baud; (void)config; (void)mode; }
+        void setDebugOutput(bool enable) { (void)enable; }
+
+        int available(void) { return 0; }
+        int read(void) { return -1; }
+        int peek(void) { return -1; }
+
+        size_t write(uint8_t c);
+        size_t write(const uint8_t *buffer, size_t size);
+        using Print::write;
+
+        operator bool(void) const { return true; }
+};
+
+extern HardwareSerial Serial;
+
+#endif // HARDWARE_SERIAL_H
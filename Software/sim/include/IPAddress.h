@@ -0,0 +1,35 @@
+#ifndef IP_ADDRESS_H
+#define IP_ADDRESS_H
+
+#include <stdint.h>
+
+#include "WString.h"
+
+//=============================================================================
+// Classes
+//=============================================================================
+
+class IPAddress
+{
+    public:
+        IPAddress(void) : _address(0) {}
+        IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d) : _address((uint32_t)a | ((uint32_t)b << 8) | ((uint32_t)c << 16) | ((uint32_t)d << 24)) {}
+        IPAddress(uint32_t address) : _address(address) {}
+
+        operator uint32_t(void) const { return _address; }
+        uint8_t operator[](int index) const { return (_address >> (8 * index)) & 0xFF; }
+        bool operator==(const IPAddress &rhs) const { return _address == rhs._address; }
+        bool isSet(void) const { return _address != 0; }
+        uint32_t v4(void) const { return _address; }
+
+        bool fromString(const char *address);
+        bool fromString(const String &address) { return fromString(address.c_str()); }
+        String toString(void) const;
+
+    private:
+        uint32_t _address;
+};
+
+#define INADDR_NONE IPAddress(0, 0, 0, 0)
+
+#endif // IP_ADDRESS_H
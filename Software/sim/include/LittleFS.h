@@ -0,0 +1,8 @@
+#ifndef LITTLE_FS_H
+#define LITTLE_FS_H
+
+#include "FS.h"
+
+extern FS LittleFS;
+
+#endif // LITTLE_FS_H
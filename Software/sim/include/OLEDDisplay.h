@@ -0,0 +1,87 @@
+#ifndef OLED_DISPLAY_H
+#define OLED_DISPLAY_H
+
+#include "Arduino.h"
+#include "OLEDDisplayFonts.h"
+
+//=============================================================================
+// Types
+//=============================================================================
+
+typedef enum {
+
+    TEXT_ALIGN_LEFT = 0,
+    TEXT_ALIGN_RIGHT = 1,
+    TEXT_ALIGN_CENTER = 2,
+    TEXT_ALIGN_CENTER_BOTH = 3
+
+} OLEDDISPLAY_TEXT_ALIGNMENT;
+
+typedef enum {
+
+    BLACK = 0,
+    WHITE = 1,
+    INVERSE = 2
+
+} OLEDDISPLAY_COLOR;
+
+typedef enum {
+
+    GEOMETRY_128_64 = 0,
+    GEOMETRY_128_32,
+    GEOMETRY_64_48,
+    GEOMETRY_64_32
+
+} OLEDDISPLAY_GEOMETRY;
+
+//=============================================================================
+// Classes
+//=============================================================================
+
+// Host OLED with a real 1bpp frame buffer so frames can be rendered and inspected.
+class OLEDDisplay
+{
+    public:
+        OLEDDisplay(OLEDDISPLAY_GEOMETRY geometry = GEOMETRY_128_32);
+        virtual ~OLEDDisplay(void) {}
+
+        bool init(void) { clear(); return true; }
+        void resetDisplay(void) { clear(); }
+        void flipScreenVertically(void) {}
+        void displayOn(void);
+        void displayOff(void);
+        void display(void) { _frameCount++; }
+        void clear(void);
+
+        void setColor(OLEDDISPLAY_COLOR color) { _color = color; }
+        void setTextAlignment(OLEDDISPLAY_TEXT_ALIGNMENT alignment) { _alignment = alignment; }
+        void setFont(const uint8_t *font) { _font = font; }
+
+        void setPixel(int16_t x, int16_t y);
+        void drawHorizontalLine(int16_t x, int16_t y, int16_t length);
+        void drawVerticalLine(int16_t x, int16_t y, int16_t length);
+        void drawLine(int16_t x0, int16_t y0, int16_t x1, int16_t y1);
+        void drawRect(int16_t x, int16_t y, int16_t width, int16_t height);
+        void fillRect(int16_t x, int16_t y, int16_t width, int16_t height);
+        void drawXbm(int16_t x, int16_t y, int16_t width, int16_t height, const uint8_t *xbm);
+        void drawString(int16_t x, int16_t y, const String &text);
+        uint16_t getStringWidth(const String &text);
+
+        uint16_t getWidth(void) { return _width; }
+        uint16_t getHeight(void) { return _height; }
+        const uint8_t *SimulationGetBuffer(void) { return _buffer; }
+        uint32_t SimulationGetFrameCount(void) { return _frameCount; }
+        bool SimulationIsDisplayOn(void) { return _displayOn; }
+
+    private:
+        uint8_t _buffer[128 * 64 / 8];
+        uint16_t _width;
+        uint16_t _height;
+        bool _displayOn;
+        uint32_t _frameCount;
+        OLEDDISPLAY_COLOR _color;
+        OLEDDISPLAY_TEXT_ALIGNMENT _alignment;
+        const uint8_t *_font;
+};
+
+#endif // OLED_DISPLAY_H
@@ -0,0 +1,12 @@
+#ifndef OLED_DISPLAY_FONTS_H
+#define OLED_DISPLAY_FONTS_H
+
+#include <stdint.h>
+
+// Font headers only (width, height, first char, char count); glyphs are drawn
+// as blocks by the host OLEDDisplay.
+const uint8_t ArialMT_Plain_10[] = {0x0A, 0x0D, 0x20, 0xE0};
+const uint8_t ArialMT_Plain_16[] = {0x10, 0x13, 0x20, 0xE0};
+const uint8_t ArialMT_Plain_24[] = {0x18, 0x1C, 0x20, 0xE0};
+
+#endif // OLED_DISPLAY_FONTS_H
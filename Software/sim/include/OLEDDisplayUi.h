@@ -0,0 +1,74 @@
+#ifndef OLED_DISPLAY_UI_H
+#define OLED_DISPLAY_UI_H
+
+#include "Arduino.h"
+#include "OLEDDisplay.h"
+
+//=============================================================================
+// Types
+//=============================================================================
+
+enum FrameState {
+
+    IN_TRANSITION,
+    FIXED
+};
+
+struct OLEDDisplayUiState {
+
+    uint64_t lastUpdate;
+    uint16_t ticksSinceLastStateSwitch;
+    FrameState frameState;
+    uint8_t currentFrame;
+    bool isIndicatorDrawn;
+    int8_t frameTransitionDirection;
+    bool manualControl;
+    void *userData;
+};
+
+typedef void (*FrameCallback)(OLEDDisplay *display, OLEDDisplayUiState *state, int16_t x, int16_t y);
+typedef void (*OverlayCallback)(OLEDDisplay *display, OLEDDisplayUiState *state);
+
+//=============================================================================
+// Classes
+//=============================================================================
+
+class OLEDDisplayUi
+{
+    public:
+        OLEDDisplayUi(OLEDDisplay *display);
+
+        void init(void);
+        void setTargetFPS(uint8_t fps);
+        void disableAllIndicators(void) {}
+        void enableAllIndicators(void) {}
+        void disableAutoTransition(void) { _autoTransition = false; }
+        void enableAutoTransition(void) { _autoTransition = true; }
+        void setTimePerFrame(uint16_t time) { (void)time; }
+        void setTimePerTransition(uint16_t time) { (void)time; }
+
+        void setFrames(FrameCallback *frames, uint8_t frameCount);
+        void setOverlays(OverlayCallback *overlays, uint8_t overlayCount);
+
+        void nextFrame(void);
+        void previousFrame(void);
+        void switchToFrame(uint8_t frame);
+        void transitionToFrame(uint8_t frame) { switchToFrame(frame); }
+
+        OLEDDisplayUiState *getUiState(void) { return &_state; }
+        int16_t update(void);
+
+    private:
+        void _Tick(void);
+
+        OLEDDisplay *_display;
+        OLEDDisplayUiState _state;
+        FrameCallback *_frames;
+        OverlayCallback *_overlays;
+        uint8_t _frameCount;
+        uint8_t _overlayCount;
+        uint16_t _updateInterval;
+        bool _autoTransition;
+};
+
+#endif // OLED_DISPLAY_UI_H
@@ -0,0 +1,56 @@
+#ifndef PRINT_H
+#define PRINT_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdarg.h>
+
+#include "WString.h"
+
+//=============================================================================
+// Classes
+//=============================================================================
+
+class Print
+{
+    public:
+        virtual ~Print(void) {}
+
+        virtual size_t write(uint8_t c) = 0;
+        virtual size_t write(const uint8_t *buffer, size_t size);
+        size_t write(const char *str);
+
+        size_t printf(const char *format, ...) __attribute__ ((format (printf, 2, 3)));
+
+        size_t print(const String &str);
+        size_t print(const char *str);
+        size_t print(char c);
+        size_t print(int value);
+        size_t print(unsigned int value);
+        size_t print(long value);
+        size_t print(unsigned long value);
+        size_t print(long long value);
+        size_t print(unsigned long long value);
+        size_t print(double value, int decimalPlaces = 2);
+
+        size_t println(void);
+        template <typename T> size_t println(const T &value) { return print(value) + println(); }
+        size_t println(double value, int decimalPlaces) { return print(value, decimalPlaces) + println(); }
+
+        virtual void flush(void) {}
+};
+
+class Stream : public Print
+{
+    public:
+        virtual int available(void) = 0;
+        virtual int read(void) = 0;
+        virtual int peek(void) = 0;
+
+        virtual size_t readBytes(uint8_t *buffer, size_t length);
+        size_t readBytes(char *buffer, size_t length) { return readBytes((uint8_t *)buffer, length); }
+        String readStringUntil(char terminator);
+        String readString(void);
+};
+
+#endif // PRINT_H
@@ -0,0 +1,8 @@
+#ifndef SSD1306_H
+#define SSD1306_H
+
+#include "SSD1306Wire.h"
+
+typedef SSD1306Wire SSD1306;
+
+#endif // SSD1306_H
@@ -0,0 +1,20 @@
+#ifndef SSD1306_WIRE_H
+#define SSD1306_WIRE_H
+
+#include "OLEDDisplay.h"
+
+//=============================================================================
+// Classes
+//=============================================================================
+
+class SSD1306Wire : public OLEDDisplay
+{
+    public:
+        SSD1306Wire(uint8_t address, int sda, int scl, OLEDDISPLAY_GEOMETRY geometry = GEOMETRY_128_64) : OLEDDisplay(geometry) {
+            (void)address;
+            (void)sda;
+            (void)scl;
+        }
+};
+
+#endif // SSD1306_WIRE_H
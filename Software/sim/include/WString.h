@@ -0,0 +1,76 @@
+#ifndef WSTRING_H
+#define WSTRING_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+
+//=============================================================================
+// Classes
+//=============================================================================
+
+class String
+{
+    public:
+        String(void) {}
+        String(const char *cstr) : _buffer(cstr ? cstr : "") {}
+        String(const std::string &str) : _buffer(str) {}
+        String(char c) : _buffer(1, c) {}
+        String(unsigned char value, unsigned char base = 10);
+        String(int value, unsigned char base = 10);
+        String(unsigned int value, unsigned char base = 10);
+        String(long value, unsigned char base = 10);
+        String(unsigned long value, unsigned char base = 10);
+        String(long long value, unsigned char base = 10);
+        String(unsigned long long value, unsigned char base = 10);
+        String(float value, unsigned char decimalPlaces = 2);
+        String(double value, unsigned char decimalPlaces = 2);
+
+        unsigned int length(void) const { return _buffer.length(); }
+        const char *c_str(void) const { return _buffer.c_str(); }
+        bool reserve(unsigned int size) { _buffer.reserve(size); return true; }
+        bool isEmpty(void) const { return _buffer.empty(); }
+
+        bool concat(const String &str) { _buffer += str._buffer; return true; }
+        bool concat(const char *cstr) { if (cstr) _buffer += cstr; return true; }
+        bool concat(char c) { _buffer += c; return true; }
+        template <typename T> bool concat(T value) { return concat(String(value)); }
+
+        template <typename T> String &operator+=(const T &value) { concat(value); return *this; }
+        String &operator+=(const char *cstr) { concat(cstr); return *this; }
+
+        bool operator==(const String &rhs) const { return _buffer == rhs._buffer; }
+        bool operator==(const char *rhs) const { return _buffer == (rhs ? rhs : ""); }
+        bool operator!=(const String &rhs) const { return !(*this == rhs); }
+        bool operator!=(const char *rhs) const { return !(*this == rhs); }
+        bool operator<(const String &rhs) const { return _buffer < rhs._buffer; }
+        char operator[](unsigned int index) const { return (index < _buffer.length()) ? _buffer[index] : 0; }
+        char charAt(unsigned int index) const { return (*this)[index]; }
+
+        bool equals(const String &rhs) const { return *this == rhs; }
+        bool startsWith(const String &prefix) const { return _buffer.compare(0, prefix._buffer.length(), prefix._buffer) == 0; }
+        bool endsWith(const String &suffix) const;
+        int indexOf(char c, unsigned int from = 0) const;
+        int indexOf(const String &str, unsigned int from = 0) const;
+        int lastIndexOf(char c) const;
+        String substring(unsigned int from) const;
+        String substring(unsigned int from, unsigned int to) const;
+        void replace(const String &find, const String &replace);
+        void remove(unsigned int index, unsigned int count = (unsigned int)-1);
+        void trim(void);
+        void toLowerCase(void);
+        void toUpperCase(void);
+        long toInt(void) const;
+        float toFloat(void) const;
+        double toDouble(void) const;
+
+    private:
+        std::string _buffer;
+};
+
+String operator+(const String &lhs, const String &rhs);
+String operator+(const char *lhs, const String &rhs);
+String operator+(const String &lhs, const char *rhs);
+String operator+(const String &lhs, char rhs);
+
+#endif // WSTRING_H
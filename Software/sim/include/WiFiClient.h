@@ -0,0 +1,64 @@
+#ifndef WIFI_CLIENT_H
+#define WIFI_CLIENT_H
+
+#include <deque>
+#include <vector>
+
+#include "Arduino.h"
+
+//=============================================================================
+// Types
+//=============================================================================
+
+// Server side of the simulated TCP connections. A connection is refused when
+// connect() returns 0, otherwise the returned id names it; bytes written by
+// the firmware go to receive(), which queues its reply after a delay.
+typedef struct {
+
+    uint32_t (*connect)(IPAddress ip, uint16_t port);
+    bool (*isOpen)(uint32_t connection);
+    void (*receive)(uint32_t connection, const uint8_t *data, size_t size, std::vector<uint8_t> &reply, uint32_t *delayMs);
+    void (*close)(uint32_t connection);
+
+} simulationTcpPeer_s;
+
+//=============================================================================
+// Classes
+//=============================================================================
+
+// Host stand-in for a TCP client; connections always fail unless a
+// simulation peer accepts them.
+class WiFiClient : public Stream
+{
+    public:
+        WiFiClient(void);
+
+        int connect(const char *host, uint16_t port);
+        int connect(IPAddress ip, uint16_t port);
+        uint8_t connected(void);
+        void stop(void);
+        void setNoDelay(bool noDelay) { (void)noDelay; }
+        void setTimeout(unsigned long timeout) { (void)timeout; }
+        size_t availableForWrite(void);
+
+        int available(void);
+        int read(void);
+        int peek(void);
+
+        size_t write(uint8_t c);
+        size_t write(const uint8_t *buffer, size_t size);
+        using Print::write;
+
+        operator bool(void) { return connected(); }
+
+        static void SimulationSetPeer(const simulationTcpPeer_s *peer);
+
+    private:
+        void _Deliver(void);
+
+        uint32_t _connection;
+        std::deque<uint8_t> _rxData;
+        std::deque<std::pair<uint64_t, std::vector<uint8_t> > > _pending;
+};
+
+#endif // WIFI_CLIENT_H
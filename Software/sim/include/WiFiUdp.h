@@ -0,0 +1,51 @@
+#ifndef WIFI_UDP_H
+#define WIFI_UDP_H
+
+#include "Arduino.h"
+
+//=============================================================================
+// Classes
+//=============================================================================
+
+// Host stand-in for a UDP socket. Outgoing packets are handed to an optional
+// simulation responder which may queue a reply after a delay.
+class WiFiUDP : public Stream
+{
+    public:
+        typedef bool (*responder_t)(const uint8_t *request, size_t requestSize, uint8_t *reply, size_t *replySize, uint32_t *delayMs);
+
+        WiFiUDP(void);
+
+        uint8_t begin(uint16_t port) { _localPort = port; return 1; }
+        void stop(void) { _localPort = 0; }
+
+        int beginPacket(const char *host, uint16_t port);
+        int beginPacket(IPAddress ip, uint16_t port);
+        int endPacket(void);
+        int parsePacket(void);
+
+        int available(void);
+        int read(void);
+        int read(uint8_t *buffer, size_t length);
+        int peek(void);
+
+        size_t write(uint8_t c);
+        size_t write(const uint8_t *buffer, size_t size);
+        using Print::write;
+
+        static void SimulationSetResponder(responder_t responder);
+
+    private:
+        uint16_t _localPort;
+        uint8_t _txBuffer[64];
+        size_t _txSize;
+        uint8_t _rxBuffer[64];
+        size_t _rxSize;
+        size_t _rxPosition;
+        uint8_t _pendingBuffer[64];
+        size_t _pendingSize;
+        uint64_t _pendingTime;
+        bool _pending;
+};
+
+#endif // WIFI_UDP_H
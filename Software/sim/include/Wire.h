@@ -0,0 +1,6 @@
+#ifndef WIRE_H
+#define WIRE_H
+
+#include "Arduino.h"
+
+#endif // WIRE_H
@@ -0,0 +1,13 @@
+#ifndef CORE_DECLS_H
+#define CORE_DECLS_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+//=============================================================================
+// Prototypes
+//=============================================================================
+
+uint32_t crc32(const void *data, size_t length, uint32_t crc = 0xffffffff);
+
+#endif // CORE_DECLS_H
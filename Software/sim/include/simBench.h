@@ -0,0 +1,12 @@
+#ifndef SIMULATION_BENCH_H
+#define SIMULATION_BENCH_H
+
+#include <stdint.h>
+
+//=============================================================================
+// Prototypes
+//=============================================================================
+
+int SimulationRunBenchmarks(uint32_t iterations);
+
+#endif // SIMULATION_BENCH_H
@@ -0,0 +1,15 @@
+#ifndef SIMULATION_BUTTONS_H
+#define SIMULATION_BUTTONS_H
+
+#include <stdint.h>
+
+//=============================================================================
+// Prototypes
+//=============================================================================
+
+bool SimulationButtonsLoadTrace(const char *path);
+void SimulationButtonsRestore(uint64_t timeUs);
+uint64_t SimulationButtonsNextEdge(void);
+void SimulationButtonsApplyEdge(void);
+
+#endif // SIMULATION_BUTTONS_H
@@ -0,0 +1,16 @@
+#ifndef SIMULATION_DHT_H
+#define SIMULATION_DHT_H
+
+#include <stdint.h>
+
+//=============================================================================
+// Prototypes
+//=============================================================================
+
+void SimulationDhtInit(uint8_t pin);
+bool SimulationDhtLoadTrace(const char *path);
+void SimulationDhtPoll(void);
+uint64_t SimulationDhtNextEdge(void);
+void SimulationDhtApplyEdge(void);
+
+#endif // SIMULATION_DHT_H
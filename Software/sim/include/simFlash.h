@@ -0,0 +1,26 @@
+#ifndef SIMULATION_FLASH_H
+#define SIMULATION_FLASH_H
+
+#include <stdint.h>
+
+//=============================================================================
+// Prototypes
+//=============================================================================
+
+// The LittleFS and flash HAL entry points of the core that firmware may wrap
+// at link time; the simulated file system calls them like the core does
+extern "C" {
+
+int lfs_file_open(void *lfs, void *file, const char *path, int flags);
+int lfs_file_opencfg(void *lfs, void *file, const char *path, int flags, const void *config);
+int32_t lfs_file_write(void *lfs, void *file, const void *buffer, uint32_t size);
+int lfs_file_close(void *lfs, void *file);
+int32_t flash_hal_write(uint32_t address, uint32_t size, const uint8_t *source);
+int32_t flash_hal_erase(uint32_t address, uint32_t size);
+
+}
+
+#define SIMULATION_LFS_O_RDONLY         1
+#define SIMULATION_LFS_O_WRONLY         2
+
+#endif // SIMULATION_FLASH_H
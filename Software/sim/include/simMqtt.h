@@ -0,0 +1,32 @@
+#ifndef SIMULATION_MQTT_H
+#define SIMULATION_MQTT_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include <utility>
+#include <vector>
+
+//=============================================================================
+// Types
+//=============================================================================
+
+// What the broker received over the whole run, handed from boot to boot
+typedef struct {
+
+    uint32_t connects;
+    uint32_t publishes;
+    uint32_t samples;
+    uint32_t duplicates;                // samples not newer than one already received
+    uint32_t lastEpoch;
+    uint32_t drops;                     // connections closed by an outage
+
+} simulationMqttStats_s;
+
+//=============================================================================
+// Prototypes
+//=============================================================================
+
+void SimulationMqttInit(simulationMqttStats_s *stats, const std::vector<std::pair<uint64_t, uint64_t> > *outages, FILE *log);
+
+#endif // SIMULATION_MQTT_H
@@ -0,0 +1,66 @@
+#ifndef SIMULATION_H
+#define SIMULATION_H
+
+#include <stdint.h>
+
+#include <vector>
+
+//=============================================================================
+// Defines
+//=============================================================================
+
+#define SIMULATION_EPOCH_START      1767225600UL    // 2026-01-01 00:00:00 UTC, simulated time zero
+
+//=============================================================================
+// Types
+//=============================================================================
+
+typedef enum {
+
+    simulationResetSoftware = 0,
+    simulationResetDeepSleep
+
+} simulationReset_e;
+
+// Thrown by ESP.reset()/restart()/deepSleep() and caught by the simulation driver
+typedef struct {
+
+    simulationReset_e reason;
+    uint64_t sleepTimeUs;
+    bool radioDisabled;         // deep sleep with RF_DISABLED, no WiFi until the next one
+
+} simulationReset_s;
+
+// Called by delay()/delayMicroseconds() with the time the busy wait ends
+typedef void (*simulationTimeHook_t)(uint64_t untilUs);
+
+//=============================================================================
+// Prototypes
+//=============================================================================
+
+uint64_t SimulationGetTime(void);
+void SimulationSetTime(uint64_t timeUs);
+void SimulationAdvanceTime(uint64_t deltaUs);
+void SimulationBoot(void);      // millis()/micros() restart from zero like after a reset
+void SimulationSetTimeHook(simulationTimeHook_t hook);
+
+void SimulationSetPin(uint8_t pin, uint8_t level);
+uint8_t SimulationGetPin(uint8_t pin);
+uint8_t SimulationGetPinMode(uint8_t pin);
+void SimulationSetAnalog(uint8_t pin, int value);
+bool SimulationIsToneActive(void);
+
+void SimulationSetVerbose(bool verbose);
+bool SimulationGetVerbose(void);
+
+void SimulationSetResetReason(uint32_t reason);
+bool SimulationIsRadioDisabled(void);
+
+// State which survives a simulated reset (clock, RTC user memory, flash), used
+// by the driver to hand over to a freshly started firmware process.
+void SimulationSaveState(std::vector<uint8_t> &state);
+size_t SimulationLoadState(const uint8_t *state, size_t size);
+void SimulationAppendState(std::vector<uint8_t> &state, const void *data, size_t size);
+size_t SimulationReadState(const uint8_t *state, size_t size, size_t position, void *data, size_t dataSize);
+
+#endif // SIMULATION_H
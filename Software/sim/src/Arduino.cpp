@@ -0,0 +1,491 @@
+#include "Arduino.h"
+#include "simulation.h"
+
+#include "coredecls.h"
+#include "LittleFS.h"
+
+#include <new>
+
+//=============================================================================
+// Simulation state
+//=============================================================================
+
+#define SIMULATION_HEAP_SIZE        52000
+
+typedef struct {
+
+    uint8_t mode;
+    uint8_t level;
+    int analogValue;
+    void (*isr)(void);
+    void (*isrArg)(void *);
+    void *arg;
+    int interruptMode;
+
+} simulationPin_s;
+
+static uint64_t _simulationTimeUs = 0;
+static uint64_t _bootTimeUs = 0;
+static simulationTimeHook_t _timeHook = NULL;
+static simulationPin_s _pins[NUM_DIGITAL_PINS];
+static uint32_t _interruptNesting = 0;
+static bool _toneActive = false;
+static bool _verbose = false;
+static size_t _heapInUse = 0;
+static size_t _heapBaseline = 0;
+static bool _heapBaselineSet = false;
+static uint32_t _rtcUserMemory[RTC_USER_MEMORY_SIZE / sizeof(uint32_t)];
+static struct rst_info _resetInfo = {REASON_DEFAULT_RST, 0, 0, 0, 0, 0, 0};
+static bool _radioDisabled = false;
+
+HardwareSerial Serial;
+EspClass ESP;
+
+//=============================================================================
+// Simulation control
+//=============================================================================
+
+uint64_t SimulationGetTime(void) {
+    return _simulationTimeUs;
+}
+
+void SimulationSetTime(uint64_t timeUs) {
+    _simulationTimeUs = timeUs;
+}
+
+void SimulationAdvanceTime(uint64_t deltaUs) {
+    _simulationTimeUs += deltaUs;
+}
+
+void SimulationSetTimeHook(simulationTimeHook_t hook) {
+    _timeHook = hook;
+}
+
+void SimulationBoot(void) {
+    _bootTimeUs = _simulationTimeUs;
+}
+
+void SimulationSetPin(uint8_t pin, uint8_t level) {
+    if (pin >= NUM_DIGITAL_PINS)
+        return;
+
+    simulationPin_s *simPin = &_pins[pin];
+    uint8_t previousLevel = simPin->level;
+
+    simPin->level = level ? HIGH : LOW;
+
+    if (previousLevel == simPin->level)
+        return;
+
+    bool trigger = (simPin->interruptMode == CHANGE) ||
+                   ((simPin->interruptMode == RISING) && (simPin->level == HIGH)) ||
+                   ((simPin->interruptMode == FALLING) && (simPin->level == LOW));
+
+    if (trigger == false)
+        return;
+
+    if (simPin->isr != NULL)
+        simPin->isr();
+    else if (simPin->isrArg != NULL)
+        simPin->isrArg(simPin->arg);
+}
+
+uint8_t SimulationGetPin(uint8_t pin) {
+    return (pin < NUM_DIGITAL_PINS) ? _pins[pin].level : LOW;
+}
+
+uint8_t SimulationGetPinMode(uint8_t pin) {
+    return (pin < NUM_DIGITAL_PINS) ? _pins[pin].mode : INPUT;
+}
+
+void SimulationSetAnalog(uint8_t pin, int value) {
+    if (pin < NUM_DIGITAL_PINS)
+        _pins[pin].analogValue = value;
+}
+
+bool SimulationIsToneActive(void) {
+    return _toneActive;
+}
+
+void SimulationSetVerbose(bool verbose) {
+    _verbose = verbose;
+}
+
+bool SimulationGetVerbose(void) {
+    return _verbose;
+}
+
+void SimulationSetResetReason(uint32_t reason) {
+    _resetInfo.reason = reason;
+}
+
+bool SimulationIsRadioDisabled(void) {
+    return _radioDisabled;
+}
+
+void SimulationAppendState(std::vector<uint8_t> &state, const void *data, size_t size) {
+    const uint8_t *bytes = (const uint8_t *)data;
+    state.insert(state.end(), bytes, bytes + size);
+}
+
+size_t SimulationReadState(const uint8_t *state, size_t size, size_t position, void *data, size_t dataSize) {
+    if (position + dataSize > size)
+        return size;
+
+    memcpy(data, &state[position], dataSize);
+    return position + dataSize;
+}
+
+void SimulationSaveState(std::vector<uint8_t> &state) {
+    SimulationAppendState(state, &_simulationTimeUs, sizeof(_simulationTimeUs));
+    SimulationAppendState(state, _rtcUserMemory, sizeof(_rtcUserMemory));
+    SimulationAppendState(state, &_resetInfo, sizeof(_resetInfo));
+    SimulationAppendState(state, &_radioDisabled, sizeof(_radioDisabled));
+    LittleFS.SimulationSaveState(state);
+}
+
+size_t SimulationLoadState(const uint8_t *state, size_t size) {
+    size_t position = 0;
+
+    position = SimulationReadState(state, size, position, &_simulationTimeUs, sizeof(_simulationTimeUs));
+    position = SimulationReadState(state, size, position, _rtcUserMemory, sizeof(_rtcUserMemory));
+    position = SimulationReadState(state, size, position, &_resetInfo, sizeof(_resetInfo));
+    position = SimulationReadState(state, size, position, &_radioDisabled, sizeof(_radioDisabled));
+
+    return LittleFS.SimulationLoadState(state, size, position);
+}
+
+//=============================================================================
+// Time
+//=============================================================================
+
+unsigned long millis(void) {
+    return (uint32_t)((_simulationTimeUs - _bootTimeUs) / 1000);
+}
+
+unsigned long micros(void) {
+    return (uint32_t)(_simulationTimeUs - _bootTimeUs);
+}
+
+// Busy waits let the driver deliver the GPIO edges due while the firmware blocks
+static void simulationBusyWait(uint64_t deltaUs) {
+    uint64_t endTimeUs = _simulationTimeUs + deltaUs;
+
+    if (_timeHook != NULL)
+        _timeHook(endTimeUs);
+
+    if (_simulationTimeUs < endTimeUs)
+        _simulationTimeUs = endTimeUs;
+}
+
+void delay(unsigned long ms) {
+    simulationBusyWait((uint64_t)ms * 1000);
+}
+
+void delayMicroseconds(unsigned int us) {
+    simulationBusyWait(us);
+}
+
+void yield(void) {
+}
+
+//=============================================================================
+// GPIO and interrupts
+//=============================================================================
+
+void pinMode(uint8_t pin, uint8_t mode) {
+    if (pin >= NUM_DIGITAL_PINS)
+        return;
+
+    _pins[pin].mode = mode;
+
+    if (mode == INPUT_PULLUP)
+        _pins[pin].level = HIGH;
+}
+
+void digitalWrite(uint8_t pin, uint8_t value) {
+    if (pin < NUM_DIGITAL_PINS)
+        _pins[pin].level = value ? HIGH : LOW;
+}
+
+int digitalRead(uint8_t pin) {
+    return (pin < NUM_DIGITAL_PINS) ? _pins[pin].level : LOW;
+}
+
+int analogRead(uint8_t pin) {
+    if (pin == 0)
+        pin = A0;
+
+    return (pin < NUM_DIGITAL_PINS) ? _pins[pin].analogValue : 0;
+}
+
+void attachInterrupt(uint8_t pin, void (*isr)(void), int mode) {
+    if (pin >= NUM_DIGITAL_PINS)
+        return;
+
+    _pins[pin].isr = isr;
+    _pins[pin].isrArg = NULL;
+    _pins[pin].arg = NULL;
+    _pins[pin].interruptMode = mode;
+}
+
+void attachInterruptArg(uint8_t pin, void (*isr)(void *), void *arg, int mode) {
+    if (pin >= NUM_DIGITAL_PINS)
+        return;
+
+    _pins[pin].isr = NULL;
+    _pins[pin].isrArg = isr;
+    _pins[pin].arg = arg;
+    _pins[pin].interruptMode = mode;
+}
+
+void detachInterrupt(uint8_t pin) {
+    if (pin >= NUM_DIGITAL_PINS)
+        return;
+
+    _pins[pin].isr = NULL;
+    _pins[pin].isrArg = NULL;
+    _pins[pin].interruptMode = 0;
+}
+
+void noInterrupts(void) {
+    _interruptNesting++;
+}
+
+void interrupts(void) {
+    if (_interruptNesting > 0)
+        _interruptNesting--;
+}
+
+void tone(uint8_t pin, unsigned int frequency, unsigned long duration) {
+    (void)pin;
+    (void)frequency;
+    (void)duration;
+    _toneActive = true;
+}
+
+void noTone(uint8_t pin) {
+    (void)pin;
+    _toneActive = false;
+}
+
+//=============================================================================
+// Serial
+//=============================================================================
+
+size_t HardwareSerial::write(uint8_t c) {
+    if (_verbose)
+        fputc(c, stdout);
+
+    return 1;
+}
+
+size_t HardwareSerial::write(const uint8_t *buffer, size_t size) {
+    if (_verbose)
+        fwrite(buffer, 1, size, stdout);
+
+    return size;
+}
+
+//=============================================================================
+// IPAddress
+//=============================================================================
+
+bool IPAddress::fromString(const char *address) {
+    unsigned int a, b, c, d;
+
+    if (sscanf(address, "%u.%u.%u.%u", &a, &b, &c, &d) != 4)
+        return false;
+
+    if ((a > 255) || (b > 255) || (c > 255) || (d > 255))
+        return false;
+
+    *this = IPAddress(a, b, c, d);
+    return true;
+}
+
+String IPAddress::toString(void) const {
+    char buffer[16];
+
+    snprintf(buffer, sizeof(buffer), "%u.%u.%u.%u", (*this)[0], (*this)[1], (*this)[2], (*this)[3]);
+    return String(buffer);
+}
+
+//=============================================================================
+// ESP
+//=============================================================================
+
+uint32_t EspClass::getCycleCount(void) {
+    return (uint32_t)((_simulationTimeUs - _bootTimeUs) * getCpuFreqMHz());
+}
+
+uint32_t EspClass::getFreeHeap(void) {
+    // The host heap is unbounded; report C++ heap usage relative to the first
+    // query against the free heap a typical ESP8266 sketch starts with.
+    if (_heapBaselineSet == false) {
+        _heapBaseline = _heapInUse;
+        _heapBaselineSet = true;
+    }
+
+    long used = (long)_heapInUse - (long)_heapBaseline;
+
+    if (used < 0)
+        used = 0;
+
+    if (used > SIMULATION_HEAP_SIZE)
+        return 0;
+
+    return SIMULATION_HEAP_SIZE - used;
+}
+
+uint32_t EspClass::getMaxFreeBlockSize(void) {
+    return (getFreeHeap() * 9) / 10;
+}
+
+uint8_t EspClass::getHeapFragmentation(void) {
+    uint32_t freeHeap = getFreeHeap();
+
+    if (freeHeap == 0)
+        return 0;
+
+    return (uint8_t)(100 - ((getMaxFreeBlockSize() * 100) / freeHeap));
+}
+
+void EspClass::getHeapStats(uint32_t *freeHeap, uint32_t *maxFreeBlock, uint8_t *fragmentation) {
+    if (freeHeap)
+        *freeHeap = getFreeHeap();
+
+    if (maxFreeBlock)
+        *maxFreeBlock = getMaxFreeBlockSize();
+
+    if (fragmentation)
+        *fragmentation = getHeapFragmentation();
+}
+
+String EspClass::getResetInfo(void) {
+    return String("Fatal exception:0 flag:") + String(_resetInfo.reason) + " (" + getResetReason() + ")";
+}
+
+String EspClass::getResetReason(void) {
+    switch (_resetInfo.reason) {
+        case REASON_WDT_RST:            return String("Hardware Watchdog");
+        case REASON_EXCEPTION_RST:      return String("Exception");
+        case REASON_SOFT_WDT_RST:       return String("Software Watchdog");
+        case REASON_SOFT_RESTART:       return String("Software/System restart");
+        case REASON_DEEP_SLEEP_AWAKE:   return String("Deep-Sleep Wake");
+        case REASON_EXT_SYS_RST:        return String("External System");
+        default:                        return String("Power On");
+    }
+}
+
+struct rst_info *EspClass::getResetInfoPtr(void) {
+    return &_resetInfo;
+}
+
+bool EspClass::rtcUserMemoryRead(uint32_t offset, uint32_t *data, size_t size) {
+    if ((offset * sizeof(uint32_t)) + size > RTC_USER_MEMORY_SIZE)
+        return false;
+
+    memcpy(data, &_rtcUserMemory[offset], size);
+    return true;
+}
+
+bool EspClass::rtcUserMemoryWrite(uint32_t offset, uint32_t *data, size_t size) {
+    if ((offset * sizeof(uint32_t)) + size > RTC_USER_MEMORY_SIZE)
+        return false;
+
+    memcpy(&_rtcUserMemory[offset], data, size);
+    return true;
+}
+
+void EspClass::reset(void) {
+    simulationReset_s resetRequest = {simulationResetSoftware, 0, false};
+
+    _resetInfo.reason = REASON_SOFT_RESTART;
+    _radioDisabled = false;
+    throw resetRequest;
+}
+
+void EspClass::restart(void) {
+    reset();
+}
+
+void EspClass::deepSleep(uint64_t timeUs, RFMode mode) {
+    simulationReset_s resetRequest = {simulationResetDeepSleep, timeUs, (mode == RF_DISABLED)};
+
+    _resetInfo.reason = REASON_DEEP_SLEEP_AWAKE;
+    _radioDisabled = (mode == RF_DISABLED);
+    throw resetRequest;
+}
+
+//=============================================================================
+// Core helpers
+//=============================================================================
+
+uint32_t crc32(const void *data, size_t length, uint32_t crc) {
+    const uint8_t *bytes = (const uint8_t *)data;
+
+    while (length--) {
+        uint8_t c = *bytes++;
+
+        for (uint32_t i = 0x80; i > 0; i >>= 1) {
+            bool bit = crc & 0x80000000;
+
+            if (c & i)
+                bit = !bit;
+
+            crc <<= 1;
+
+            if (bit)
+                crc ^= 0x04c11db7;
+        }
+    }
+
+    return crc;
+}
+
+//=============================================================================
+// Heap accounting, every C++ allocation carries its size in front of the block
+//=============================================================================
+
+#define SIMULATION_HEAP_HEADER      16
+
+void *operator new(size_t size) {
+    uint8_t *block = (uint8_t *)malloc(size + SIMULATION_HEAP_HEADER);
+
+    if (block == NULL)
+        throw std::bad_alloc();
+
+    *(size_t *)block = size;
+    _heapInUse += size;
+
+    return block + SIMULATION_HEAP_HEADER;
+}
+
+void *operator new[](size_t size) {
+    return operator new(size);
+}
+
+void operator delete(void *pointer) noexcept {
+    if (pointer == NULL)
+        return;
+
+    uint8_t *block = (uint8_t *)pointer - SIMULATION_HEAP_HEADER;
+
+    _heapInUse -= *(size_t *)block;
+    free(block);
+}
+
+void operator delete[](void *pointer) noexcept {
+    operator delete(pointer);
+}
+
+void operator delete(void *pointer, size_t size) noexcept {
+    (void)size;
+    operator delete(pointer);
+}
+
+void operator delete[](void *pointer, size_t size) noexcept {
+    (void)size;
+    operator delete(pointer);
+}
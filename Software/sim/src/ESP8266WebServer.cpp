@@ -0,0 +1,143 @@
+#include "ESP8266WebServer.h"
+#include "ESP8266mDNS.h"
+
+MDNSResponder MDNS;
+
+//=============================================================================
+// Object constructors
+//=============================================================================
+
+ESP8266WebServer::ESP8266WebServer(int port) {
+    (void)port;
+
+    _running = false;
+    _currentMethod = HTTP_GET;
+    _contentLength = CONTENT_LENGTH_NOT_SET;
+    _responseCode = 0;
+    _requestCount = 0;
+}
+
+//=============================================================================
+// Public functions
+//=============================================================================
+
+void ESP8266WebServer::handleClient(void) {
+    if ((_running == false) || _pendingRequests.empty())
+        return;
+
+    request_s request = _pendingRequests.front();
+    _pendingRequests.erase(_pendingRequests.begin());
+
+    SimulationRequest(request.method, request.uri, request.argumentNames, request.argumentValues);
+}
+
+void ESP8266WebServer::on(const String &uri, THandlerFunction handler) {
+    on(uri, HTTP_ANY, handler);
+}
+
+void ESP8266WebServer::on(const String &uri, HTTPMethod method, THandlerFunction handler) {
+    on(uri, method, handler, THandlerFunction());
+}
+
+void ESP8266WebServer::on(const String &uri, HTTPMethod method, THandlerFunction handler, THandlerFunction uploadHandler) {
+    route_s route = {uri, method, handler, uploadHandler};
+    _routes.push_back(route);
+}
+
+String ESP8266WebServer::arg(const String &name) {
+    for (size_t i = 0; i < _argumentNames.size(); i++) {
+        if (_argumentNames[i] == name)
+            return _argumentValues[i];
+    }
+
+    return String();
+}
+
+String ESP8266WebServer::arg(int index) {
+    if ((index < 0) || ((size_t)index >= _argumentValues.size()))
+        return String();
+
+    return _argumentValues[index];
+}
+
+String ESP8266WebServer::argName(int index) {
+    if ((index < 0) || ((size_t)index >= _argumentNames.size()))
+        return String();
+
+    return _argumentNames[index];
+}
+
+bool ESP8266WebServer::hasArg(const String &name) {
+    for (size_t i = 0; i < _argumentNames.size(); i++) {
+        if (_argumentNames[i] == name)
+            return true;
+    }
+
+    return false;
+}
+
+void ESP8266WebServer::sendHeader(const String &name, const String &value, bool first) {
+    (void)name;
+    (void)value;
+    (void)first;
+}
+
+void ESP8266WebServer::send(int code, const char *contentType, const String &content) {
+    (void)contentType;
+
+    _responseCode = code;
+    _response = content;
+}
+
+void ESP8266WebServer::send_P(int code, const char *contentType, const char *content, size_t contentLength) {
+    send(code, contentType, String(std::string(content, contentLength)));
+}
+
+void ESP8266WebServer::sendContent(const String &content) {
+    _response += content;
+}
+
+void ESP8266WebServer::sendContent(const char *content, size_t size) {
+    _response += String(std::string(content, size));
+}
+
+size_t ESP8266WebServer::streamFile(File &file, const String &contentType) {
+    (void)contentType;
+
+    _responseCode = 200;
+    _response = file.readString();
+
+    return _response.length();
+}
+
+//=============================================================================
+// Simulation interface
+//=============================================================================
+
+void ESP8266WebServer::SimulationQueueRequest(HTTPMethod method, const String &uri, const std::vector<String> &argumentNames, const std::vector<String> &argumentValues) {
+    request_s request = {method, uri, argumentNames, argumentValues};
+    _pendingRequests.push_back(request);
+}
+
+bool ESP8266WebServer::SimulationRequest(HTTPMethod method, const String &uri, const std::vector<String> &argumentNames, const std::vector<String> &argumentValues) {
+    _currentUri = uri;
+    _currentMethod = method;
+    _argumentNames = argumentNames;
+    _argumentValues = argumentValues;
+    _contentLength = CONTENT_LENGTH_NOT_SET;
+    _responseCode = 0;
+    _response = String();
+    _requestCount++;
+
+    for (size_t i = 0; i < _routes.size(); i++) {
+        if ((_routes[i].uri == uri) && ((_routes[i].method == HTTP_ANY) || (_routes[i].method == method))) {
+            _routes[i].handler();
+            return true;
+        }
+    }
+
+    if (_notFoundHandler)
+        _notFoundHandler();
+
+    return false;
+}
@@ -0,0 +1,311 @@
+#include "ESP8266WiFi.h"
+#include "simulation.h"
+
+//=============================================================================
+// Defines
+//=============================================================================
+
+#define SIMULATION_WIFI_SCAN_CONNECT_US     2200000     // full scan and association
+#define SIMULATION_WIFI_FAST_CONNECT_US     250000      // association on a known channel/BSSID
+#define SIMULATION_WIFI_DHCP_US             800000
+
+//=============================================================================
+// Event handler containers
+//=============================================================================
+
+template <typename T>
+struct WiFiEventHandlerSimulation : public WiFiEventHandlerOpaque {
+
+    WiFiEventHandlerSimulation(std::function<void(const T &)> handler) : handler(handler) {}
+    std::function<void(const T &)> handler;
+};
+
+template <typename T>
+static void dispatchEvent(std::vector<std::weak_ptr<WiFiEventHandlerOpaque> > &handlers, const T &event) {
+    for (size_t i = 0; i < handlers.size(); i++) {
+        std::shared_ptr<WiFiEventHandlerOpaque> handler = handlers[i].lock();
+        WiFiEventHandlerSimulation<T> *typedHandler = dynamic_cast<WiFiEventHandlerSimulation<T> *>(handler.get());
+
+        if (typedHandler != NULL)
+            typedHandler->handler(event);
+    }
+}
+
+ESP8266WiFiClass WiFi;
+
+//=============================================================================
+// Object constructors
+//=============================================================================
+
+ESP8266WiFiClass::ESP8266WiFiClass(void) {
+    _mode = WIFI_OFF;
+    _status = WL_IDLE_STATUS;
+    _radioSleeping = false;
+    _staticIp = false;
+    _accessPointAvailable = true;
+    _accessPointChannel = 6;
+    _accessPointRssi = -62;
+    _connectTime = 0;
+
+    uint8_t bssid[6] = {0x02, 0x1A, 0x11, 0xF0, 0x00, 0x01};
+    memcpy(_accessPointBssid, bssid, sizeof(_accessPointBssid));
+
+    _softAPIP = IPAddress(192, 168, 4, 1);
+}
+
+//=============================================================================
+// Public functions
+//=============================================================================
+
+bool ESP8266WiFiClass::mode(WiFiMode_t mode) {
+    _mode = mode;
+
+    if (mode == WIFI_OFF)
+        _status = WL_DISCONNECTED;
+
+    return true;
+}
+
+WiFiMode_t ESP8266WiFiClass::getMode(void) {
+    return _mode;
+}
+
+wl_status_t ESP8266WiFiClass::status(void) {
+    return _status;
+}
+
+wl_status_t ESP8266WiFiClass::begin(const char *ssid, const char *passphrase, int32_t channel, const uint8_t *bssid, bool connect) {
+    (void)passphrase;
+
+    _ssid = String(ssid);
+    _status = WL_DISCONNECTED;
+
+    if (connect == false)
+        return _status;
+
+    if (_mode == WIFI_OFF)
+        _mode = WIFI_STA;
+
+    bool targeted = (channel != 0) || (bssid != NULL);
+    bool fastConnect = (channel == _accessPointChannel) && (bssid != NULL) && (memcmp(bssid, _accessPointBssid, 6) == 0);
+
+    // Like the SDK, a join pinned to a channel and BSSID never scans, it just
+    // fails when the access point is not there
+    if ((targeted == true) && (fastConnect == false)) {
+        _status = WL_NO_SSID_AVAIL;
+        _connectTime = 0;
+
+        return _status;
+    }
+
+    _connectTime = SimulationGetTime() + (fastConnect ? SIMULATION_WIFI_FAST_CONNECT_US : SIMULATION_WIFI_SCAN_CONNECT_US);
+
+    if (_staticIp == false)
+        _connectTime += SIMULATION_WIFI_DHCP_US;
+
+    return _status;
+}
+
+wl_status_t ESP8266WiFiClass::begin(const String &ssid, const String &passphrase, int32_t channel, const uint8_t *bssid, bool connect) {
+    return begin(ssid.c_str(), passphrase.c_str(), channel, bssid, connect);
+}
+
+bool ESP8266WiFiClass::config(IPAddress localIP, IPAddress gateway, IPAddress subnet, IPAddress dns1, IPAddress dns2) {
+    (void)dns2;
+
+    _staticIp = localIP.isSet();
+    _localIP = localIP;
+    _gatewayIP = gateway;
+    _subnetMask = subnet;
+    _dnsIP = dns1;
+
+    return true;
+}
+
+bool ESP8266WiFiClass::disconnect(bool wifiOff) {
+    _status = WL_DISCONNECTED;
+    _connectTime = 0;
+
+    if (wifiOff)
+        _mode = WIFI_OFF;
+
+    return true;
+}
+
+bool ESP8266WiFiClass::hostname(const char *name) {
+    _hostname = String(name);
+    return true;
+}
+
+bool ESP8266WiFiClass::forceSleepBegin(uint32_t sleepUs) {
+    (void)sleepUs;
+
+    _radioSleeping = true;
+    _status = WL_DISCONNECTED;
+    _connectTime = 0;
+
+    return true;
+}
+
+bool ESP8266WiFiClass::forceSleepWake(void) {
+    _radioSleeping = false;
+    return true;
+}
+
+IPAddress ESP8266WiFiClass::localIP(void) {
+    return (_status == WL_CONNECTED) ? _localIP : IPAddress();
+}
+
+IPAddress ESP8266WiFiClass::subnetMask(void) {
+    return _subnetMask;
+}
+
+IPAddress ESP8266WiFiClass::gatewayIP(void) {
+    return _gatewayIP;
+}
+
+IPAddress ESP8266WiFiClass::dnsIP(uint8_t dnsNumber) {
+    (void)dnsNumber;
+    return _dnsIP;
+}
+
+int32_t ESP8266WiFiClass::RSSI(void) {
+    return (_status == WL_CONNECTED) ? _accessPointRssi : 31;
+}
+
+int32_t ESP8266WiFiClass::channel(void) {
+    return _accessPointChannel;
+}
+
+uint8_t *ESP8266WiFiClass::BSSID(void) {
+    return _accessPointBssid;
+}
+
+String ESP8266WiFiClass::BSSIDstr(void) {
+    char buffer[18];
+
+    snprintf(buffer, sizeof(buffer), "%02X:%02X:%02X:%02X:%02X:%02X", _accessPointBssid[0], _accessPointBssid[1],
+             _accessPointBssid[2], _accessPointBssid[3], _accessPointBssid[4], _accessPointBssid[5]);
+
+    return String(buffer);
+}
+
+String ESP8266WiFiClass::SSID(void) {
+    return _ssid;
+}
+
+bool ESP8266WiFiClass::softAPConfig(IPAddress localIP, IPAddress gateway, IPAddress subnet) {
+    (void)gateway;
+    (void)subnet;
+
+    _softAPIP = localIP;
+    return true;
+}
+
+bool ESP8266WiFiClass::softAP(const char *ssid, const char *passphrase) {
+    (void)ssid;
+    (void)passphrase;
+
+    if (_mode == WIFI_OFF)
+        _mode = WIFI_AP;
+
+    return true;
+}
+
+IPAddress ESP8266WiFiClass::softAPIP(void) {
+    return _softAPIP;
+}
+
+// Every name resolves to a documentation address while the station is up
+int ESP8266WiFiClass::hostByName(const char *hostName, IPAddress &result, uint32_t timeoutMs) {
+    (void)hostName;
+    (void)timeoutMs;
+
+    if (status() != WL_CONNECTED)
+        return 0;
+
+    result = IPAddress(192, 0, 2, 123);
+    return 1;
+}
+
+WiFiEventHandler ESP8266WiFiClass::onStationModeConnected(std::function<void(const WiFiEventStationModeConnected &)> handler) {
+    WiFiEventHandler eventHandler = std::make_shared<WiFiEventHandlerSimulation<WiFiEventStationModeConnected> >(handler);
+    _handlers.push_back(eventHandler);
+    return eventHandler;
+}
+
+WiFiEventHandler ESP8266WiFiClass::onStationModeGotIP(std::function<void(const WiFiEventStationModeGotIP &)> handler) {
+    WiFiEventHandler eventHandler = std::make_shared<WiFiEventHandlerSimulation<WiFiEventStationModeGotIP> >(handler);
+    _handlers.push_back(eventHandler);
+    return eventHandler;
+}
+
+WiFiEventHandler ESP8266WiFiClass::onStationModeDisconnected(std::function<void(const WiFiEventStationModeDisconnected &)> handler) {
+    WiFiEventHandler eventHandler = std::make_shared<WiFiEventHandlerSimulation<WiFiEventStationModeDisconnected> >(handler);
+    _handlers.push_back(eventHandler);
+    return eventHandler;
+}
+
+WiFiEventHandler ESP8266WiFiClass::onSoftAPModeStationConnected(std::function<void(const WiFiEventSoftAPModeStationConnected &)> handler) {
+    WiFiEventHandler eventHandler = std::make_shared<WiFiEventHandlerSimulation<WiFiEventSoftAPModeStationConnected> >(handler);
+    _handlers.push_back(eventHandler);
+    return eventHandler;
+}
+
+//=============================================================================
+// Simulation interface
+//=============================================================================
+
+void ESP8266WiFiClass::SimulationUpdate(void) {
+    if ((_connectTime == 0) || (_status == WL_CONNECTED) || _radioSleeping || SimulationIsRadioDisabled())
+        return;
+
+    if (!(_mode & WIFI_STA) || (_accessPointAvailable == false))
+        return;
+
+    if (SimulationGetTime() < _connectTime)
+        return;
+
+    WiFiEventStationModeConnected connectedEvent;
+    connectedEvent.ssid = _ssid;
+    memcpy(connectedEvent.bssid, _accessPointBssid, sizeof(connectedEvent.bssid));
+    connectedEvent.channel = _accessPointChannel;
+
+    if (_staticIp == false) {
+        _localIP = IPAddress(192, 168, 1, 50);
+        _gatewayIP = IPAddress(192, 168, 1, 1);
+        _subnetMask = IPAddress(255, 255, 255, 0);
+        _dnsIP = IPAddress(192, 168, 1, 1);
+    }
+
+    WiFiEventStationModeGotIP gotIpEvent;
+    gotIpEvent.ip = _localIP;
+    gotIpEvent.mask = _subnetMask;
+    gotIpEvent.gw = _gatewayIP;
+
+    _status = WL_CONNECTED;
+    _connectTime = 0;
+
+    dispatchEvent(_handlers, connectedEvent);
+    dispatchEvent(_handlers, gotIpEvent);
+}
+
+void ESP8266WiFiClass::SimulationSetAccessPoint(bool available, uint8_t channel, int32_t rssi) {
+    _accessPointAvailable = available;
+    _accessPointChannel = channel;
+    _accessPointRssi = rssi;
+
+    if ((available == false) && (_status == WL_CONNECTED)) {
+        WiFiEventStationModeDisconnected disconnectedEvent;
+        disconnectedEvent.ssid = _ssid;
+        memcpy(disconnectedEvent.bssid, _accessPointBssid, sizeof(disconnectedEvent.bssid));
+        disconnectedEvent.reason = 200;
+
+        _status = WL_DISCONNECTED;
+        dispatchEvent(_handlers, disconnectedEvent);
+    }
+}
+
+bool ESP8266WiFiClass::SimulationIsRadioOn(void) {
+    return (_mode != WIFI_OFF) && (_radioSleeping == false) && (SimulationIsRadioDisabled() == false);
+}
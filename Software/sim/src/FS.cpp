@@ -0,0 +1,458 @@
+#include "FS.h"
+#include "LittleFS.h"
+#include "simulation.h"
+#include "simFlash.h"
+
+//=============================================================================
+// Defines
+//=============================================================================
+
+#define SIMULATION_FS_TOTAL_BYTES       1024000     // eagle.flash.4m1m.ld
+#define SIMULATION_FS_BLOCK_SIZE        8192
+#define SIMULATION_FS_PAGE_SIZE         256
+
+FS LittleFS;
+
+//=============================================================================
+// File
+//=============================================================================
+
+File::File(std::shared_ptr<simulationFileNode_s> node, const std::string &path, bool append, bool writable, FS *owner) {
+    _node = node;
+    _path = path;
+    _append = append;
+    _writable = writable;
+    _owner = owner;
+    _position = append ? node->data.size() : 0;
+    _dirtyStart = 0;
+    _dirtyEnd = 0;
+}
+
+size_t File::write(uint8_t c) {
+    return write(&c, 1);
+}
+
+size_t File::write(const uint8_t *buffer, size_t size) {
+    if ((_node == NULL) || (_writable == false) || (size == 0))
+        return 0;
+
+    if (_append)
+        _position = _node->data.size();
+
+    if (_position + size > _node->data.size())
+        _node->data.resize(_position + size);
+
+    memcpy(&_node->data[_position], buffer, size);
+    lfs_file_write(NULL, _node.get(), buffer, size);
+
+    if (_dirtyEnd == _dirtyStart) {
+        _dirtyStart = _position;
+        _dirtyEnd = _position + size;
+    } else {
+        _dirtyStart = min(_dirtyStart, _position);
+        _dirtyEnd = max(_dirtyEnd, _position + size);
+    }
+
+    _position += size;
+
+    return size;
+}
+
+int File::available(void) {
+    if (_node == NULL)
+        return 0;
+
+    return (int)(_node->data.size() - min(_position, _node->data.size()));
+}
+
+int File::read(void) {
+    if ((_node == NULL) || (_position >= _node->data.size()))
+        return -1;
+
+    return _node->data[_position++];
+}
+
+int File::peek(void) {
+    if ((_node == NULL) || (_position >= _node->data.size()))
+        return -1;
+
+    return _node->data[_position];
+}
+
+size_t File::read(uint8_t *buffer, size_t size) {
+    size_t count = min<size_t>(size, (size_t)available());
+
+    if (count > 0) {
+        memcpy(buffer, &_node->data[_position], count);
+        _position += count;
+    }
+
+    return count;
+}
+
+bool File::seek(uint32_t position, SeekMode mode) {
+    if (_node == NULL)
+        return false;
+
+    size_t target = position;
+
+    if (mode == SeekCur)
+        target = _position + position;
+    else if (mode == SeekEnd)
+        target = _node->data.size() - position;
+
+    if (target > _node->data.size())
+        return false;
+
+    _position = target;
+    return true;
+}
+
+size_t File::size(void) const {
+    return (_node != NULL) ? _node->data.size() : 0;
+}
+
+bool File::truncate(uint32_t size) {
+    if ((_node == NULL) || (_writable == false))
+        return false;
+
+    _node->data.resize(size);
+    _position = min<size_t>(_position, size);
+
+    return true;
+}
+
+void File::close(void) {
+    if ((_node != NULL) && (_owner != NULL) && (_dirtyEnd > _dirtyStart))
+        _owner->SimulationRecordCommit(_node.get(), _dirtyStart, _dirtyEnd);
+
+    if ((_node != NULL) && (_writable == true))
+        lfs_file_close(NULL, _node.get());
+
+    _dirtyStart = 0;
+    _dirtyEnd = 0;
+    _node.reset();
+}
+
+const char *File::name(void) const {
+    size_t separator = _path.rfind('/');
+    return (separator == std::string::npos) ? _path.c_str() : _path.c_str() + separator + 1;
+}
+
+//=============================================================================
+// Dir
+//=============================================================================
+
+Dir::Dir(const std::vector<std::string> &names, const std::vector<bool> &directories, const std::string &path, FS *owner) {
+    _names = names;
+    _directories = directories;
+    _path = path;
+    _index = -1;
+    _owner = owner;
+}
+
+bool Dir::next(void) {
+    if ((_index + 1) >= (int)_names.size())
+        return false;
+
+    _index++;
+    return true;
+}
+
+String Dir::fileName(void) {
+    if ((_index < 0) || (_index >= (int)_names.size()))
+        return String();
+
+    return String(_names[_index]);
+}
+
+size_t Dir::fileSize(void) {
+    if ((_index < 0) || _directories[_index])
+        return 0;
+
+    std::shared_ptr<simulationFileNode_s> node = _owner->SimulationGetNode(_path + _names[_index]);
+    return node ? node->data.size() : 0;
+}
+
+time_t Dir::fileTime(void) {
+    if (_index < 0)
+        return 0;
+
+    std::shared_ptr<simulationFileNode_s> node = _owner->SimulationGetNode(_path + _names[_index]);
+    return node ? node->lastWrite : 0;
+}
+
+time_t Dir::fileCreationTime(void) {
+    if (_index < 0)
+        return 0;
+
+    std::shared_ptr<simulationFileNode_s> node = _owner->SimulationGetNode(_path + _names[_index]);
+    return node ? node->creation : 0;
+}
+
+bool Dir::isFile(void) {
+    return (_index >= 0) && (_directories[_index] == false);
+}
+
+bool Dir::isDirectory(void) {
+    return (_index >= 0) && _directories[_index];
+}
+
+File Dir::openFile(const char *mode) {
+    if (isFile() == false)
+        return File();
+
+    return _owner->open((_path + _names[_index]).c_str(), mode);
+}
+
+//=============================================================================
+// FS
+//=============================================================================
+
+FS::FS(void) {
+    _timeCallback = NULL;
+    memset(&_statistics, 0, sizeof(_statistics));
+}
+
+std::string FS::_NormalisePath(const char *path) {
+    std::string normalised(path ? path : "");
+
+    if (normalised.empty() || (normalised[0] != '/'))
+        normalised = "/" + normalised;
+
+    return normalised;
+}
+
+bool FS::format(void) {
+    _files.clear();
+    _directories.clear();
+    _statistics.blocksErased += SIMULATION_FS_TOTAL_BYTES / SIMULATION_FS_BLOCK_SIZE;
+    flash_hal_erase(0, SIMULATION_FS_TOTAL_BYTES);
+
+    return true;
+}
+
+bool FS::info(FSInfo &info) {
+    size_t usedBlocks = 2;
+
+    for (std::map<std::string, std::shared_ptr<simulationFileNode_s> >::iterator it = _files.begin(); it != _files.end(); ++it) {
+        usedBlocks += 1 + (it->second->data.size() / SIMULATION_FS_BLOCK_SIZE);
+    }
+
+    info.totalBytes = SIMULATION_FS_TOTAL_BYTES;
+    info.usedBytes = min<size_t>(usedBlocks * SIMULATION_FS_BLOCK_SIZE, SIMULATION_FS_TOTAL_BYTES);
+    info.blockSize = SIMULATION_FS_BLOCK_SIZE;
+    info.pageSize = SIMULATION_FS_PAGE_SIZE;
+    info.maxOpenFiles = 5;
+    info.maxPathLength = 32;
+
+    return true;
+}
+
+File FS::open(const char *path, const char *mode) {
+    std::string normalised = _NormalisePath(path);
+    std::map<std::string, std::shared_ptr<simulationFileNode_s> >::iterator it = _files.find(normalised);
+    bool writable = (strchr(mode, 'w') != NULL) || (strchr(mode, 'a') != NULL) || (strchr(mode, '+') != NULL);
+    bool append = (strchr(mode, 'a') != NULL);
+    bool truncate = (strchr(mode, 'w') != NULL);
+
+    if (it == _files.end()) {
+        if (writable == false)
+            return File();
+
+        std::shared_ptr<simulationFileNode_s> node = std::make_shared<simulationFileNode_s>();
+        node->creation = SimulationGetTime();
+        node->lastWrite = node->creation;
+        _files[normalised] = node;
+        it = _files.find(normalised);
+    } else if (truncate) {
+        it->second->data.clear();
+    }
+
+    if (writable == true)
+        lfs_file_open(NULL, it->second.get(), normalised.c_str(), SIMULATION_LFS_O_WRONLY);
+
+    return File(it->second, normalised, append, writable, this);
+}
+
+// Like LittleFS the root always exists, and so does a directory created
+// implicitly by opening a file below it for writing
+bool FS::exists(const char *path) {
+    std::string normalised = _NormalisePath(path);
+
+    if ((normalised.length() > 1) && (normalised[normalised.length() - 1] == '/'))
+        normalised.erase(normalised.length() - 1);
+
+    if ((normalised == "/") || (_files.find(normalised) != _files.end()) || (_directories.find(normalised) != _directories.end()))
+        return true;
+
+    std::map<std::string, std::shared_ptr<simulationFileNode_s> >::iterator it = _files.lower_bound(normalised + "/");
+
+    return (it != _files.end()) && (it->first.compare(0, normalised.length() + 1, normalised + "/") == 0);
+}
+
+bool FS::remove(const char *path) {
+    return _files.erase(_NormalisePath(path)) > 0;
+}
+
+bool FS::rename(const char *pathFrom, const char *pathTo) {
+    std::string from = _NormalisePath(pathFrom);
+    std::string to = _NormalisePath(pathTo);
+    std::map<std::string, std::shared_ptr<simulationFileNode_s> >::iterator it = _files.find(from);
+
+    if (it == _files.end())
+        return false;
+
+    _files[to] = it->second;
+    _files.erase(from);
+    _statistics.blocksErased++;
+    flash_hal_erase(0, SIMULATION_FS_BLOCK_SIZE);
+
+    return true;
+}
+
+bool FS::mkdir(const char *path) {
+    _directories[_NormalisePath(path)] = true;
+    return true;
+}
+
+Dir FS::openDir(const char *path) {
+    std::string directory = _NormalisePath(path);
+    std::vector<std::string> names;
+    std::vector<bool> directories;
+
+    if (directory[directory.length() - 1] != '/')
+        directory += "/";
+
+    for (std::map<std::string, std::shared_ptr<simulationFileNode_s> >::iterator it = _files.begin(); it != _files.end(); ++it) {
+        if (it->first.compare(0, directory.length(), directory) != 0)
+            continue;
+
+        std::string remainder = it->first.substr(directory.length());
+        size_t separator = remainder.find('/');
+
+        if (separator == std::string::npos) {
+            names.push_back(remainder);
+            directories.push_back(false);
+        } else if (std::find(names.begin(), names.end(), remainder.substr(0, separator)) == names.end()) {
+            names.push_back(remainder.substr(0, separator));
+            directories.push_back(true);
+        }
+    }
+
+    for (std::map<std::string, bool>::iterator it = _directories.begin(); it != _directories.end(); ++it) {
+        if ((it->first.length() <= directory.length()) || (it->first.compare(0, directory.length(), directory) != 0))
+            continue;
+
+        std::string remainder = it->first.substr(directory.length());
+
+        if ((remainder.find('/') == std::string::npos) && (std::find(names.begin(), names.end(), remainder) == names.end())) {
+            names.push_back(remainder);
+            directories.push_back(true);
+        }
+    }
+
+    return Dir(names, directories, directory, this);
+}
+
+//=============================================================================
+// Simulation interface
+//=============================================================================
+
+void FS::SimulationRecordCommit(simulationFileNode_s *node, size_t start, size_t end) {
+    // LittleFS commits a file copy-on-write on close, each commit costs one
+    // erase for every data block touched plus one for the metadata pair.
+    size_t firstBlock = start / SIMULATION_FS_BLOCK_SIZE;
+    size_t lastBlock = (end - 1) / SIMULATION_FS_BLOCK_SIZE;
+
+    _statistics.bytesWritten += end - start;
+    _statistics.blocksErased += 2 + (lastBlock - firstBlock);
+    _statistics.writeOperations++;
+
+    // Data pages plus a page of metadata are programmed into the erased blocks
+    flash_hal_write(firstBlock * SIMULATION_FS_BLOCK_SIZE, (((end - start + SIMULATION_FS_PAGE_SIZE - 1) / SIMULATION_FS_PAGE_SIZE) + 1) * SIMULATION_FS_PAGE_SIZE, NULL);
+    flash_hal_erase(firstBlock * SIMULATION_FS_BLOCK_SIZE, (2 + (lastBlock - firstBlock)) * SIMULATION_FS_BLOCK_SIZE);
+
+    node->lastWrite = SimulationGetTime();
+}
+
+time_t FS::SimulationGetTime(void) {
+    if (_timeCallback != NULL)
+        return _timeCallback();
+
+    return (time_t)(::SimulationGetTime() / 1000000);
+}
+
+std::shared_ptr<simulationFileNode_s> FS::SimulationGetNode(const std::string &path) {
+    std::map<std::string, std::shared_ptr<simulationFileNode_s> >::iterator it = _files.find(path);
+    return (it == _files.end()) ? std::shared_ptr<simulationFileNode_s>() : it->second;
+}
+
+void FS::SimulationSaveState(std::vector<uint8_t> &state) {
+    uint32_t fileCount = _files.size();
+    uint32_t directoryCount = _directories.size();
+
+    ::SimulationAppendState(state, &_statistics, sizeof(_statistics));
+    ::SimulationAppendState(state, &fileCount, sizeof(fileCount));
+
+    for (std::map<std::string, std::shared_ptr<simulationFileNode_s> >::iterator it = _files.begin(); it != _files.end(); ++it) {
+        uint32_t pathLength = it->first.length();
+        uint32_t dataLength = it->second->data.size();
+
+        ::SimulationAppendState(state, &pathLength, sizeof(pathLength));
+        ::SimulationAppendState(state, it->first.data(), pathLength);
+        ::SimulationAppendState(state, &it->second->lastWrite, sizeof(it->second->lastWrite));
+        ::SimulationAppendState(state, &it->second->creation, sizeof(it->second->creation));
+        ::SimulationAppendState(state, &dataLength, sizeof(dataLength));
+        ::SimulationAppendState(state, it->second->data.data(), dataLength);
+    }
+
+    ::SimulationAppendState(state, &directoryCount, sizeof(directoryCount));
+
+    for (std::map<std::string, bool>::iterator it = _directories.begin(); it != _directories.end(); ++it) {
+        uint32_t pathLength = it->first.length();
+
+        ::SimulationAppendState(state, &pathLength, sizeof(pathLength));
+        ::SimulationAppendState(state, it->first.data(), pathLength);
+    }
+}
+
+size_t FS::SimulationLoadState(const uint8_t *state, size_t size, size_t position) {
+    uint32_t fileCount = 0;
+    uint32_t directoryCount = 0;
+
+    _files.clear();
+    _directories.clear();
+
+    position = ::SimulationReadState(state, size, position, &_statistics, sizeof(_statistics));
+    position = ::SimulationReadState(state, size, position, &fileCount, sizeof(fileCount));
+
+    for (uint32_t i = 0; (i < fileCount) && (position < size); i++) {
+        uint32_t pathLength = 0;
+        uint32_t dataLength = 0;
+        std::shared_ptr<simulationFileNode_s> node = std::make_shared<simulationFileNode_s>();
+
+        position = ::SimulationReadState(state, size, position, &pathLength, sizeof(pathLength));
+        std::string path((const char *)&state[position], min<size_t>(pathLength, size - position));
+        position += pathLength;
+        position = ::SimulationReadState(state, size, position, &node->lastWrite, sizeof(node->lastWrite));
+        position = ::SimulationReadState(state, size, position, &node->creation, sizeof(node->creation));
+        position = ::SimulationReadState(state, size, position, &dataLength, sizeof(dataLength));
+        node->data.assign(&state[position], &state[min<size_t>(position + dataLength, size)]);
+        position += dataLength;
+
+        _files[path] = node;
+    }
+
+    position = ::SimulationReadState(state, size, position, &directoryCount, sizeof(directoryCount));
+
+    for (uint32_t i = 0; (i < directoryCount) && (position < size); i++) {
+        uint32_t pathLength = 0;
+
+        position = ::SimulationReadState(state, size, position, &pathLength, sizeof(pathLength));
+        _directories[std::string((const char *)&state[position], min<size_t>(pathLength, size - position))] = true;
+        position += pathLength;
+    }
+
+    return position;
+}
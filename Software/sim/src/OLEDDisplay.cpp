@@ -0,0 +1,213 @@
+#include "OLEDDisplay.h"
+#include "OLEDDisplayUi.h"
+
+#include "simulation.h"
+
+// Frame and display changes are echoed with --verbose as "seconds ui ...",
+// so button handling is observed from the outside rather than by the firmware
+static void traceUi(const char *change, int value) {
+    if (SimulationGetVerbose())
+        printf("%.3f ui %s %d\n", SimulationGetTime() / 1e6, change, value);
+}
+
+//=============================================================================
+// OLEDDisplay
+//=============================================================================
+
+OLEDDisplay::OLEDDisplay(OLEDDISPLAY_GEOMETRY geometry) {
+    _width = ((geometry == GEOMETRY_64_48) || (geometry == GEOMETRY_64_32)) ? 64 : 128;
+    _height = (geometry == GEOMETRY_128_64) ? 64 : ((geometry == GEOMETRY_64_48) ? 48 : 32);
+    _displayOn = true;
+    _frameCount = 0;
+    _color = WHITE;
+    _alignment = TEXT_ALIGN_LEFT;
+    _font = ArialMT_Plain_10;
+
+    clear();
+}
+
+void OLEDDisplay::displayOn(void) {
+    _displayOn = true;
+    traceUi("display", 1);
+}
+
+void OLEDDisplay::displayOff(void) {
+    _displayOn = false;
+    traceUi("display", 0);
+}
+
+void OLEDDisplay::clear(void) {
+    memset(_buffer, 0, sizeof(_buffer));
+}
+
+void OLEDDisplay::setPixel(int16_t x, int16_t y) {
+    if ((x < 0) || (x >= _width) || (y < 0) || (y >= _height))
+        return;
+
+    uint8_t *page = &_buffer[x + ((y / 8) * _width)];
+    uint8_t mask = 1 << (y & 7);
+
+    switch (_color) {
+        case WHITE:     *page |= mask; break;
+        case BLACK:     *page &= ~mask; break;
+        case INVERSE:   *page ^= mask; break;
+    }
+}
+
+void OLEDDisplay::drawHorizontalLine(int16_t x, int16_t y, int16_t length) {
+    for (int16_t i = 0; i < length; i++)
+        setPixel(x + i, y);
+}
+
+void OLEDDisplay::drawVerticalLine(int16_t x, int16_t y, int16_t length) {
+    for (int16_t i = 0; i < length; i++)
+        setPixel(x, y + i);
+}
+
+void OLEDDisplay::drawLine(int16_t x0, int16_t y0, int16_t x1, int16_t y1) {
+    int16_t dx = abs(x1 - x0);
+    int16_t dy = -abs(y1 - y0);
+    int16_t sx = (x0 < x1) ? 1 : -1;
+    int16_t sy = (y0 < y1) ? 1 : -1;
+    int16_t error = dx + dy;
+
+    while (true) {
+        setPixel(x0, y0);
+
+        if ((x0 == x1) && (y0 == y1))
+            break;
+
+        int16_t doubleError = 2 * error;
+
+        if (doubleError >= dy) {
+            error += dy;
+            x0 += sx;
+        }
+
+        if (doubleError <= dx) {
+            error += dx;
+            y0 += sy;
+        }
+    }
+}
+
+void OLEDDisplay::drawRect(int16_t x, int16_t y, int16_t width, int16_t height) {
+    drawHorizontalLine(x, y, width);
+    drawHorizontalLine(x, y + height - 1, width);
+    drawVerticalLine(x, y, height);
+    drawVerticalLine(x + width - 1, y, height);
+}
+
+void OLEDDisplay::fillRect(int16_t x, int16_t y, int16_t width, int16_t height) {
+    for (int16_t i = 0; i < height; i++)
+        drawHorizontalLine(x, y + i, width);
+}
+
+void OLEDDisplay::drawXbm(int16_t x, int16_t y, int16_t width, int16_t height, const uint8_t *xbm) {
+    int16_t bytesPerRow = (width + 7) / 8;
+
+    for (int16_t row = 0; row < height; row++) {
+        for (int16_t column = 0; column < width; column++) {
+            if (xbm[(row * bytesPerRow) + (column / 8)] & (1 << (column & 7)))
+                setPixel(x + column, y + row);
+        }
+    }
+}
+
+uint16_t OLEDDisplay::getStringWidth(const String &text) {
+    return text.length() * ((_font[1] / 2) + 1);
+}
+
+void OLEDDisplay::drawString(int16_t x, int16_t y, const String &text) {
+    uint16_t glyphHeight = _font[1] - 3;
+    uint16_t glyphWidth = _font[1] / 2;
+    uint16_t width = getStringWidth(text);
+
+    if (_alignment == TEXT_ALIGN_RIGHT)
+        x -= width;
+    else if ((_alignment == TEXT_ALIGN_CENTER) || (_alignment == TEXT_ALIGN_CENTER_BOTH))
+        x -= width / 2;
+
+    for (unsigned int i = 0; i < text.length(); i++) {
+        if (text[i] != ' ')
+            drawRect(x, y, glyphWidth, glyphHeight);
+
+        x += glyphWidth + 1;
+    }
+}
+
+//=============================================================================
+// OLEDDisplayUi
+//=============================================================================
+
+OLEDDisplayUi::OLEDDisplayUi(OLEDDisplay *display) {
+    _display = display;
+    _frames = NULL;
+    _overlays = NULL;
+    _frameCount = 0;
+    _overlayCount = 0;
+    _updateInterval = 33;
+    _autoTransition = true;
+
+    memset(&_state, 0, sizeof(_state));
+    _state.frameState = FIXED;
+}
+
+void OLEDDisplayUi::init(void) {
+    _display->init();
+}
+
+void OLEDDisplayUi::setTargetFPS(uint8_t fps) {
+    _updateInterval = (fps > 0) ? (1000 / fps) : 1000;
+}
+
+void OLEDDisplayUi::setFrames(FrameCallback *frames, uint8_t frameCount) {
+    _frames = frames;
+    _frameCount = frameCount;
+}
+
+void OLEDDisplayUi::setOverlays(OverlayCallback *overlays, uint8_t overlayCount) {
+    _overlays = overlays;
+    _overlayCount = overlayCount;
+}
+
+void OLEDDisplayUi::nextFrame(void) {
+    if (_frameCount > 0)
+        switchToFrame((_state.currentFrame + 1) % _frameCount);
+}
+
+void OLEDDisplayUi::previousFrame(void) {
+    if (_frameCount > 0)
+        switchToFrame((_state.currentFrame + _frameCount - 1) % _frameCount);
+}
+
+void OLEDDisplayUi::switchToFrame(uint8_t frame) {
+    if (frame < _frameCount) {
+        _state.currentFrame = frame;
+        traceUi("frame", frame);
+    }
+}
+
+void OLEDDisplayUi::_Tick(void) {
+    _display->clear();
+
+    if ((_frames != NULL) && (_state.currentFrame < _frameCount))
+        _frames[_state.currentFrame](_display, &_state, 0, 0);
+
+    for (uint8_t i = 0; i < _overlayCount; i++)
+        _overlays[i](_display, &_state);
+
+    _display->display();
+}
+
+int16_t OLEDDisplayUi::update(void) {
+    uint32_t frameStart = millis();
+    int32_t timeBudget = _updateInterval - (int32_t)(frameStart - _state.lastUpdate);
+
+    if (timeBudget <= 0) {
+        _state.lastUpdate = frameStart;
+        _Tick();
+    }
+
+    return _updateInterval - (int32_t)(millis() - frameStart);
+}
@@ -0,0 +1,106 @@
+#include "Print.h"
+
+#include <stdio.h>
+#include <string.h>
+
+//=============================================================================
+// Print
+//=============================================================================
+
+size_t Print::write(const uint8_t *buffer, size_t size) {
+    size_t written = 0;
+
+    while (size--) {
+        written += write(*buffer++);
+    }
+
+    return written;
+}
+
+size_t Print::write(const char *str) {
+    if (str == NULL)
+        return 0;
+
+    return write((const uint8_t *)str, strlen(str));
+}
+
+size_t Print::printf(const char *format, ...) {
+    char stackBuffer[128];
+    char *buffer = stackBuffer;
+    va_list arguments;
+
+    va_start(arguments, format);
+    int length = vsnprintf(stackBuffer, sizeof(stackBuffer), format, arguments);
+    va_end(arguments);
+
+    if (length < 0)
+        return 0;
+
+    if ((size_t)length >= sizeof(stackBuffer)) {
+        buffer = new char[length + 1];
+        va_start(arguments, format);
+        vsnprintf(buffer, length + 1, format, arguments);
+        va_end(arguments);
+    }
+
+    size_t written = write((const uint8_t *)buffer, length);
+
+    if (buffer != stackBuffer)
+        delete[] buffer;
+
+    return written;
+}
+
+size_t Print::print(const String &str) { return write((const uint8_t *)str.c_str(), str.length()); }
+size_t Print::print(const char *str) { return write(str); }
+size_t Print::print(char c) { return write((uint8_t)c); }
+size_t Print::print(int value) { return print(String(value)); }
+size_t Print::print(unsigned int value) { return print(String(value)); }
+size_t Print::print(long value) { return print(String(value)); }
+size_t Print::print(unsigned long value) { return print(String(value)); }
+size_t Print::print(long long value) { return print(String(value)); }
+size_t Print::print(unsigned long long value) { return print(String(value)); }
+size_t Print::print(double value, int decimalPlaces) { return print(String(value, (unsigned char)decimalPlaces)); }
+
+size_t Print::println(void) {
+    return write((const uint8_t *)"\r\n", 2);
+}
+
+//=============================================================================
+// Stream
+//=============================================================================
+
+size_t Stream::readBytes(uint8_t *buffer, size_t length) {
+    size_t count = 0;
+
+    while ((count < length) && (available() > 0)) {
+        buffer[count++] = (uint8_t)read();
+    }
+
+    return count;
+}
+
+String Stream::readStringUntil(char terminator) {
+    String result;
+
+    while (available() > 0) {
+        int c = read();
+
+        if (c == terminator)
+            break;
+
+        result += (char)c;
+    }
+
+    return result;
+}
+
+String Stream::readString(void) {
+    String result;
+
+    while (available() > 0) {
+        result += (char)read();
+    }
+
+    return result;
+}
@@ -0,0 +1,180 @@
+#include "WString.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <ctype.h>
+
+//=============================================================================
+// Helper functions
+//=============================================================================
+
+static std::string integerToString(unsigned long long value, unsigned char base, bool negative) {
+    char buffer[72];
+    int index = sizeof(buffer) - 1;
+
+    if (base < 2)
+        base = 10;
+
+    buffer[index] = '\0';
+
+    do {
+        uint8_t digit = value % base;
+        buffer[--index] = (digit < 10) ? ('0' + digit) : ('a' + digit - 10);
+        value /= base;
+    } while (value > 0);
+
+    if (negative)
+        buffer[--index] = '-';
+
+    return std::string(&buffer[index]);
+}
+
+static std::string signedToString(long long value, unsigned char base) {
+    if ((value < 0) && (base == 10))
+        return integerToString(0ULL - (unsigned long long)value, base, true);
+
+    return integerToString((unsigned long long)value, base, false);
+}
+
+static std::string floatToString(double value, unsigned char decimalPlaces) {
+    char buffer[64];
+
+    snprintf(buffer, sizeof(buffer), "%.*f", decimalPlaces, value);
+    return std::string(buffer);
+}
+
+//=============================================================================
+// Object constructors
+//=============================================================================
+
+String::String(unsigned char value, unsigned char base) : _buffer(integerToString(value, base, false)) {}
+String::String(int value, unsigned char base) : _buffer(signedToString(value, base)) {}
+String::String(unsigned int value, unsigned char base) : _buffer(integerToString(value, base, false)) {}
+String::String(long value, unsigned char base) : _buffer(signedToString(value, base)) {}
+String::String(unsigned long value, unsigned char base) : _buffer(integerToString(value, base, false)) {}
+String::String(long long value, unsigned char base) : _buffer(signedToString(value, base)) {}
+String::String(unsigned long long value, unsigned char base) : _buffer(integerToString(value, base, false)) {}
+String::String(float value, unsigned char decimalPlaces) : _buffer(floatToString(value, decimalPlaces)) {}
+String::String(double value, unsigned char decimalPlaces) : _buffer(floatToString(value, decimalPlaces)) {}
+
+//=============================================================================
+// Public functions
+//=============================================================================
+
+bool String::endsWith(const String &suffix) const {
+    if (suffix._buffer.length() > _buffer.length())
+        return false;
+
+    return _buffer.compare(_buffer.length() - suffix._buffer.length(), suffix._buffer.length(), suffix._buffer) == 0;
+}
+
+int String::indexOf(char c, unsigned int from) const {
+    size_t position = _buffer.find(c, from);
+    return (position == std::string::npos) ? -1 : (int)position;
+}
+
+int String::indexOf(const String &str, unsigned int from) const {
+    size_t position = _buffer.find(str._buffer, from);
+    return (position == std::string::npos) ? -1 : (int)position;
+}
+
+int String::lastIndexOf(char c) const {
+    size_t position = _buffer.rfind(c);
+    return (position == std::string::npos) ? -1 : (int)position;
+}
+
+String String::substring(unsigned int from) const {
+    if (from >= _buffer.length())
+        return String();
+
+    return String(_buffer.substr(from));
+}
+
+String String::substring(unsigned int from, unsigned int to) const {
+    if (from > to) {
+        unsigned int swap = from;
+        from = to;
+        to = swap;
+    }
+
+    if (from >= _buffer.length())
+        return String();
+
+    return String(_buffer.substr(from, to - from));
+}
+
+void String::replace(const String &find, const String &replace) {
+    if (find._buffer.empty())
+        return;
+
+    size_t position = 0;
+
+    while ((position = _buffer.find(find._buffer, position)) != std::string::npos) {
+        _buffer.replace(position, find._buffer.length(), replace._buffer);
+        position += replace._buffer.length();
+    }
+}
+
+void String::remove(unsigned int index, unsigned int count) {
+    if (index < _buffer.length())
+        _buffer.erase(index, count);
+}
+
+void String::trim(void) {
+    size_t first = 0;
+    size_t last = _buffer.length();
+
+    while ((first < last) && isspace((unsigned char)_buffer[first]))
+        first++;
+
+    while ((last > first) && isspace((unsigned char)_buffer[last - 1]))
+        last--;
+
+    _buffer = _buffer.substr(first, last - first);
+}
+
+void String::toLowerCase(void) {
+    for (size_t i = 0; i < _buffer.length(); i++)
+        _buffer[i] = tolower((unsigned char)_buffer[i]);
+}
+
+void String::toUpperCase(void) {
+    for (size_t i = 0; i < _buffer.length(); i++)
+        _buffer[i] = toupper((unsigned char)_buffer[i]);
+}
+
+long String::toInt(void) const {
+    return strtol(_buffer.c_str(), NULL, 10);
+}
+
+float String::toFloat(void) const {
+    return strtof(_buffer.c_str(), NULL);
+}
+
+double String::toDouble(void) const {
+    return strtod(_buffer.c_str(), NULL);
+}
+
+String operator+(const String &lhs, const String &rhs) {
+    String result(lhs);
+    result.concat(rhs);
+    return result;
+}
+
+String operator+(const char *lhs, const String &rhs) {
+    String result(lhs);
+    result.concat(rhs);
+    return result;
+}
+
+String operator+(const String &lhs, const char *rhs) {
+    String result(lhs);
+    result.concat(rhs);
+    return result;
+}
+
+String operator+(const String &lhs, char rhs) {
+    String result(lhs);
+    result.concat(rhs);
+    return result;
+}
@@ -0,0 +1,129 @@
+#include "WiFiClient.h"
+#include "ESP8266WiFi.h"
+#include "simulation.h"
+
+// Send window of the modelled TCP stack, one segment
+#define SIMULATION_TCP_WINDOW       1460
+
+static const simulationTcpPeer_s *_peer = NULL;
+
+//=============================================================================
+// Object constructors
+//=============================================================================
+
+WiFiClient::WiFiClient(void) {
+    _connection = 0;
+}
+
+//=============================================================================
+// Private functions
+//=============================================================================
+
+// Replies become readable once their network delay has passed
+void WiFiClient::_Deliver(void) {
+    while ((_pending.empty() == false) && (_pending.front().first <= SimulationGetTime())) {
+        _rxData.insert(_rxData.end(), _pending.front().second.begin(), _pending.front().second.end());
+        _pending.pop_front();
+    }
+}
+
+//=============================================================================
+// Public functions
+//=============================================================================
+
+int WiFiClient::connect(const char *host, uint16_t port) {
+    IPAddress ip;
+
+    if (WiFi.hostByName(host, ip) != 1)
+        return 0;
+
+    return connect(ip, port);
+}
+
+int WiFiClient::connect(IPAddress ip, uint16_t port) {
+    stop();
+
+    if ((_peer == NULL) || (WiFi.status() != WL_CONNECTED))
+        return 0;
+
+    _connection = _peer->connect(ip, port);
+
+    return (_connection != 0) ? 1 : 0;
+}
+
+uint8_t WiFiClient::connected(void) {
+    if (_connection == 0)
+        return 0;
+
+    // Losing the access point or the peer closing ends the connection
+    if ((WiFi.status() != WL_CONNECTED) || (_peer->isOpen(_connection) == false)) {
+        _peer->close(_connection);
+        _connection = 0;
+        _pending.clear();
+    }
+
+    _Deliver();
+
+    return ((_connection != 0) || (_rxData.empty() == false)) ? 1 : 0;
+}
+
+void WiFiClient::stop(void) {
+    if ((_connection != 0) && (_peer != NULL))
+        _peer->close(_connection);
+
+    _connection = 0;
+    _rxData.clear();
+    _pending.clear();
+}
+
+size_t WiFiClient::availableForWrite(void) {
+    return (connected() && (_connection != 0)) ? SIMULATION_TCP_WINDOW : 0;
+}
+
+int WiFiClient::available(void) {
+    _Deliver();
+
+    return (int)_rxData.size();
+}
+
+int WiFiClient::read(void) {
+    _Deliver();
+
+    if (_rxData.empty() == true)
+        return -1;
+
+    uint8_t value = _rxData.front();
+    _rxData.pop_front();
+
+    return value;
+}
+
+int WiFiClient::peek(void) {
+    _Deliver();
+
+    return (_rxData.empty() == true) ? -1 : _rxData.front();
+}
+
+size_t WiFiClient::write(uint8_t c) {
+    return write(&c, 1);
+}
+
+size_t WiFiClient::write(const uint8_t *buffer, size_t size) {
+    std::vector<uint8_t> reply;
+    uint32_t delayMs = 0;
+
+    if (availableForWrite() == 0)
+        return 0;
+
+    size = min<size_t>(size, SIMULATION_TCP_WINDOW);
+    _peer->receive(_connection, buffer, size, reply, &delayMs);
+
+    if (reply.empty() == false)
+        _pending.push_back(std::make_pair(SimulationGetTime() + ((uint64_t)delayMs * 1000), reply));
+
+    return size;
+}
+
+void WiFiClient::SimulationSetPeer(const simulationTcpPeer_s *peer) {
+    _peer = peer;
+}
@@ -0,0 +1,116 @@
+#include "WiFiUdp.h"
+#include "simulation.h"
+
+static WiFiUDP::responder_t _responder = NULL;
+
+//=============================================================================
+// Object constructors
+//=============================================================================
+
+WiFiUDP::WiFiUDP(void) {
+    _localPort = 0;
+    _txSize = 0;
+    _rxSize = 0;
+    _rxPosition = 0;
+    _pendingSize = 0;
+    _pendingTime = 0;
+    _pending = false;
+}
+
+//=============================================================================
+// Public functions
+//=============================================================================
+
+int WiFiUDP::beginPacket(const char *host, uint16_t port) {
+    (void)host;
+    (void)port;
+
+    _txSize = 0;
+    return 1;
+}
+
+int WiFiUDP::beginPacket(IPAddress ip, uint16_t port) {
+    (void)ip;
+    (void)port;
+
+    _txSize = 0;
+    return 1;
+}
+
+int WiFiUDP::endPacket(void) {
+    uint32_t delayMs = 0;
+
+    if (_responder == NULL)
+        return 1;
+
+    _pendingSize = sizeof(_pendingBuffer);
+
+    if (_responder(_txBuffer, _txSize, _pendingBuffer, &_pendingSize, &delayMs)) {
+        _pending = true;
+        _pendingTime = SimulationGetTime() + ((uint64_t)delayMs * 1000);
+    }
+
+    return 1;
+}
+
+int WiFiUDP::parsePacket(void) {
+    if ((_pending == false) || (SimulationGetTime() < _pendingTime))
+        return 0;
+
+    memcpy(_rxBuffer, _pendingBuffer, _pendingSize);
+    _rxSize = _pendingSize;
+    _rxPosition = 0;
+    _pending = false;
+
+    return (int)_rxSize;
+}
+
+int WiFiUDP::available(void) {
+    return (int)(_rxSize - _rxPosition);
+}
+
+int WiFiUDP::read(void) {
+    if (_rxPosition >= _rxSize)
+        return -1;
+
+    return _rxBuffer[_rxPosition++];
+}
+
+int WiFiUDP::read(uint8_t *buffer, size_t length) {
+    size_t count = 0;
+
+    while ((count < length) && (_rxPosition < _rxSize)) {
+        buffer[count++] = _rxBuffer[_rxPosition++];
+    }
+
+    return (int)count;
+}
+
+int WiFiUDP::peek(void) {
+    if (_rxPosition >= _rxSize)
+        return -1;
+
+    return _rxBuffer[_rxPosition];
+}
+
+size_t WiFiUDP::write(uint8_t c) {
+    if (_txSize >= sizeof(_txBuffer))
+        return 0;
+
+    _txBuffer[_txSize++] = c;
+    return 1;
+}
+
+size_t WiFiUDP::write(const uint8_t *buffer, size_t size) {
+    size_t written = 0;
+
+    while ((written < size) && (write(buffer[written]) == 1)) {
+        written++;
+    }
+
+    return written;
+}
+
+void WiFiUDP::SimulationSetResponder(responder_t responder) {
+    _responder = responder;
+}
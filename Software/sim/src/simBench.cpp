@@ -0,0 +1,299 @@
+#include <Arduino.h>
+#include <ESP8266WiFi.h>
+#include <ESP8266WebServer.h>
+#include <LittleFS.h>
+#include <OLEDDisplayUi.h>
+#include <SSD1306.h>
+
+#include <batteryHistogram.h>
+#include <impulseCapture.h>
+#include <logCodec.h>
+#include <logStore.h>
+
+#include <algorithm>
+#include <chrono>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "simulation.h"
+#include "simBench.h"
+
+//=============================================================================
+// Host benchmarks of the firmware hot paths. They run inside one firmware
+// boot after setup(), against the same globals the scheduler tasks use, and
+// report wall clock cost per operation as JSON:
+//
+//   .pio/build/native/program --bench [--bench-iterations N]
+//=============================================================================
+
+//=============================================================================
+// Defines
+//=============================================================================
+
+#define BENCH_SENSOR_PIN                    2
+#define BENCH_REPETITIONS                   5
+#define BENCH_WARM_UP_US                    15000000ULL     // WiFi and NTP up before measuring
+#define BENCH_PULSE_INTERVAL_US             72000           // 5 kW at 10000 pulses per kWh
+#define BENCH_PULSE_WIDTH_US                10000
+#define BENCH_LIST_FILES                    32
+#define BENCH_UI_FRAMES                     4
+#define BENCH_LOG_FIELDS                    4
+#define BENCH_LOG_RECORDS                   1024
+#define BENCH_LOG_INTERVAL                  10
+
+//=============================================================================
+// Types
+//=============================================================================
+
+typedef struct {
+
+    const char *name;
+    uint32_t operations;
+    double meanNs;
+    double minimumNs;
+    double maximumNs;
+
+} benchResult_s;
+
+typedef void (*benchBody_t)(uint32_t operations);
+
+//=============================================================================
+// Externals from the firmware
+//=============================================================================
+
+extern ESP8266WebServer httpServer;
+extern SSD1306 display;
+extern OLEDDisplayUi ui;
+extern FrameCallback frames[];
+extern OverlayCallback overlays[];
+extern BatteryHistogram battery;
+extern ImpulseCapture impulseChannels[];
+extern LogStore logStore;
+
+void taskLog(void);
+
+//=============================================================================
+// Benchmark bodies
+//=============================================================================
+
+static volatile uint32_t benchSink;
+
+static void benchImpulseInterrupt(uint32_t operations) {
+    for (uint32_t i = 0; i < operations; i++) {
+        SimulationAdvanceTime(BENCH_PULSE_WIDTH_US);
+        SimulationSetPin(BENCH_SENSOR_PIN, HIGH);
+        SimulationAdvanceTime(BENCH_PULSE_INTERVAL_US - BENCH_PULSE_WIDTH_US);
+        SimulationSetPin(BENCH_SENSOR_PIN, LOW);
+        benchSink = impulseChannels[0].GetInstantWattUsgage();
+    }
+}
+
+static void benchLogAppend(uint32_t operations) {
+    for (uint32_t i = 0; i < operations; i++) {
+        taskLog();
+    }
+}
+
+// Log records of a steady 5 kW load like the 10 s log produces them
+static void benchLogRecord(uint32_t index, uint32_t *epoch, int32_t *values) {
+    *epoch = SIMULATION_EPOCH_START + (index * BENCH_LOG_INTERVAL);
+    values[0] = 4968 + ((index * 7) % 40);
+    values[1] = 138 + (index & 1);
+    values[2] = 5000;
+    values[3] = 5000;
+}
+
+static uint8_t benchLogBuffer[BENCH_LOG_RECORDS * LOG_CODEC_RECORD_BYTES_MAX];
+
+static void benchLogEncode(uint32_t operations) {
+    logCodecState_s state;
+    uint32_t bitPosition = 0;
+    uint32_t epoch;
+    int32_t values[LOG_CODEC_FIELDS_MAX];
+
+    LogCodec::Reset(&state, BENCH_LOG_FIELDS, SIMULATION_EPOCH_START);
+
+    for (uint32_t i = 0; i < operations; i++) {
+        // Start over once the buffer is used up, as a new block would
+        if ((i % BENCH_LOG_RECORDS) == 0) {
+            LogCodec::Reset(&state, BENCH_LOG_FIELDS, SIMULATION_EPOCH_START);
+            bitPosition = 0;
+        }
+
+        benchLogRecord(i, &epoch, values);
+        bitPosition = LogCodec::Encode(&state, epoch, values, benchLogBuffer, bitPosition);
+    }
+
+    benchSink = bitPosition;
+}
+
+static void benchLogDecode(uint32_t operations) {
+    logCodecState_s state;
+    uint32_t bitPosition = 0;
+    uint32_t epoch;
+    int32_t values[LOG_CODEC_FIELDS_MAX];
+
+    LogCodec::Reset(&state, BENCH_LOG_FIELDS, SIMULATION_EPOCH_START);
+
+    for (uint32_t i = 0; i < BENCH_LOG_RECORDS; i++) {
+        benchLogRecord(i, &epoch, values);
+        bitPosition = LogCodec::Encode(&state, epoch, values, benchLogBuffer, bitPosition);
+    }
+
+    LogCodec::Pad(benchLogBuffer, bitPosition);
+    uint32_t bitLength = ((bitPosition + 7) / 8) * 8;
+
+    for (uint32_t i = 0; i < operations; i++) {
+        if ((i % BENCH_LOG_RECORDS) == 0) {
+            LogCodec::Reset(&state, BENCH_LOG_FIELDS, SIMULATION_EPOCH_START);
+            bitPosition = 0;
+        }
+
+        LogCodec::Decode(&state, benchLogBuffer, bitLength, &bitPosition, &epoch, values);
+    }
+
+    benchSink = epoch;
+}
+
+static void benchJson(const char *uri, uint32_t operations) {
+    std::vector<String> noArguments;
+
+    for (uint32_t i = 0; i < operations; i++) {
+        httpServer.SimulationRequest(HTTP_GET, uri, noArguments, noArguments);
+        benchSink = httpServer.SimulationGetResponse().length();
+    }
+}
+
+static void benchJsonWatts(uint32_t operations) {
+    benchJson("/watts", operations);
+}
+
+static void benchJsonScheduler(uint32_t operations) {
+    benchJson("/scheduler", operations);
+}
+
+static void benchJsonDiagnostics(uint32_t operations) {
+    benchJson("/diagnostics", operations);
+}
+
+static void benchBatteryUpdate(uint32_t operations) {
+    // Every call is due for an ADC sample, every 16th also shifts the histogram
+    for (uint32_t i = 0; i < operations; i++) {
+        SimulationAdvanceTime((ADC_SAMPLE_INTERVAL_DELAY_M_SECONDS * 1000UL) + 1000);
+        battery.Update();
+    }
+}
+
+static void benchUiFrames(uint32_t operations) {
+    OLEDDisplayUiState *state = ui.getUiState();
+
+    for (uint32_t i = 0; i < operations; i++) {
+        display.clear();
+        frames[i % BENCH_UI_FRAMES](&display, state, 0, 0);
+        overlays[0](&display, state);
+        display.display();
+    }
+
+    benchSink = display.SimulationGetBuffer()[0];
+}
+
+static void benchFileList(uint32_t operations) {
+    benchJson("/list", operations);
+}
+
+//=============================================================================
+// Helper functions
+//=============================================================================
+
+static benchResult_s runBenchmark(const char *name, benchBody_t body, uint32_t operations) {
+    double samples[BENCH_REPETITIONS];
+
+    operations = max<uint32_t>(operations, 1);
+    benchResult_s result = {name, operations, 0.0, 0.0, 0.0};
+
+    // One untimed pass so lazily allocated buffers don't count
+    body((operations / 10) + 1);
+
+    for (uint8_t i = 0; i < BENCH_REPETITIONS; i++) {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        body(operations);
+        std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+
+        samples[i] = std::chrono::duration<double, std::nano>(end - start).count() / operations;
+        result.meanNs += samples[i] / BENCH_REPETITIONS;
+    }
+
+    result.minimumNs = *std::min_element(samples, samples + BENCH_REPETITIONS);
+    result.maximumNs = *std::max_element(samples, samples + BENCH_REPETITIONS);
+
+    return result;
+}
+
+static void populateFileSystem(void) {
+    for (uint8_t i = 0; i < BENCH_LIST_FILES; i++) {
+        File benchFile = LittleFS.open("/bench" + String(i) + ".bin", "w");
+        benchFile.print("benchmark");
+        benchFile.close();
+    }
+}
+
+static void warmUp(void) {
+    uint64_t endTime = SimulationGetTime() + BENCH_WARM_UP_US;
+
+    while (SimulationGetTime() < endTime) {
+        SimulationAdvanceTime(1000);
+        WiFi.SimulationUpdate();
+        loop();
+    }
+}
+
+//=============================================================================
+// Benchmark entry point
+//=============================================================================
+
+int SimulationRunBenchmarks(uint32_t iterations) {
+    std::vector<benchResult_s> results;
+
+    // setup() reports to stdout through printf(), keep it out of the JSON
+    fflush(stdout);
+    int stdoutFd = dup(STDOUT_FILENO);
+    int nullFd = open("/dev/null", O_WRONLY);
+    dup2(nullFd, STDOUT_FILENO);
+
+    SimulationBoot();
+    setup();
+    SimulationSetPin(BENCH_SENSOR_PIN, LOW);
+    warmUp();
+
+    fflush(stdout);
+    dup2(stdoutFd, STDOUT_FILENO);
+    close(stdoutFd);
+    close(nullFd);
+
+    // The log benchmark appends to the log store, start it from an empty log
+    logStore.Clear();
+    populateFileSystem();
+
+    results.push_back(runBenchmark("impulseInterrupt", benchImpulseInterrupt, iterations));
+    results.push_back(runBenchmark("logAppend", benchLogAppend, iterations / 10));
+    results.push_back(runBenchmark("logEncode", benchLogEncode, iterations));
+    results.push_back(runBenchmark("logDecode", benchLogDecode, iterations));
+    results.push_back(runBenchmark("jsonWatts", benchJsonWatts, iterations / 10));
+    results.push_back(runBenchmark("jsonScheduler", benchJsonScheduler, iterations / 100));
+    results.push_back(runBenchmark("jsonDiagnostics", benchJsonDiagnostics, iterations / 100));
+    results.push_back(runBenchmark("batteryUpdate", benchBatteryUpdate, iterations));
+    results.push_back(runBenchmark("uiFrame", benchUiFrames, iterations / 10));
+    results.push_back(runBenchmark("fileList", benchFileList, iterations / 100));
+
+    printf("{\"iterations\":%u,\"repetitions\":%u,\"benchmarks\":[", iterations, BENCH_REPETITIONS);
+
+    for (size_t i = 0; i < results.size(); i++) {
+        printf("%s{\"name\":\"%s\",\"operations\":%u,\"meanNs\":%.1f,\"minNs\":%.1f,\"maxNs\":%.1f}",
+               (i > 0) ? "," : "", results[i].name, results[i].operations, results[i].meanNs, results[i].minimumNs, results[i].maximumNs);
+    }
+
+    printf("]}\n");
+
+    return 0;
+}
@@ -0,0 +1,76 @@
+#include <Arduino.h>
+
+#include <vector>
+
+#include "simulation.h"
+#include "simButtons.h"
+
+//=============================================================================
+// Push buttons replayed from a recorded trace (--button-trace, "time_us,pin,
+// level" from the start of the run, bounces included). The driver delivers
+// the edges at their time stamps like the meter pulses, also while the
+// firmware blocks in a --stall.
+//=============================================================================
+
+//=============================================================================
+// Types
+//=============================================================================
+
+typedef struct {
+
+    uint64_t time;
+    uint8_t pin;
+    uint8_t level;
+
+} simulationButtonEdge_s;
+
+//=============================================================================
+// Globals
+//=============================================================================
+
+static std::vector<simulationButtonEdge_s> buttonTrace;
+static size_t nextButtonEdge = 0;
+
+//=============================================================================
+// Simulation control
+//=============================================================================
+
+bool SimulationButtonsLoadTrace(const char *path) {
+    FILE *traceFile = fopen(path, "r");
+    unsigned long long time;
+    unsigned int pin;
+    unsigned int level;
+
+    if (traceFile == NULL)
+        return false;
+
+    while (fscanf(traceFile, "%llu,%u,%u", &time, &pin, &level) == 3) {
+        buttonTrace.push_back({time, (uint8_t)pin, (uint8_t)((level != 0) ? HIGH : LOW)});
+    }
+
+    fclose(traceFile);
+
+    return (buttonTrace.empty() == false);
+}
+
+// Every boot starts from the trace start; the levels up to the boot time are
+// set without interrupts, nothing was attached to see them
+void SimulationButtonsRestore(uint64_t timeUs) {
+    nextButtonEdge = 0;
+
+    while ((nextButtonEdge < buttonTrace.size()) && (buttonTrace[nextButtonEdge].time < timeUs)) {
+        SimulationSetPin(buttonTrace[nextButtonEdge].pin, buttonTrace[nextButtonEdge].level);
+        nextButtonEdge++;
+    }
+}
+
+uint64_t SimulationButtonsNextEdge(void) {
+    return (nextButtonEdge < buttonTrace.size()) ? buttonTrace[nextButtonEdge].time : UINT64_MAX;
+}
+
+void SimulationButtonsApplyEdge(void) {
+    const simulationButtonEdge_s *edge = &buttonTrace[nextButtonEdge++];
+
+    SimulationSetTime(max(SimulationGetTime(), edge->time));
+    SimulationSetPin(edge->pin, edge->level);
+}
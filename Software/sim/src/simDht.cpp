@@ -0,0 +1,154 @@
+#include <Arduino.h>
+
+#include <vector>
+
+#include "simulation.h"
+#include "simDht.h"
+
+//=============================================================================
+// DHT11 on the single wire bus: once the host has held the line low for the
+// start signal and released it, the sensor answers with the response and the
+// 40 data bits. Each release queues the frame as time stamped edges which the
+// driver delivers like the meter pulses. A recorded waveform (--dht-trace,
+// "offset_us,level" relative to the release) replaces the generated frame.
+//=============================================================================
+
+//=============================================================================
+// Defines
+//=============================================================================
+
+#define SIMULATION_DHT_START_MINIMUM_US     18000
+#define SIMULATION_DHT_RESPONSE_DELAY_US    30
+#define SIMULATION_DHT_RESPONSE_US          80
+#define SIMULATION_DHT_BIT_LOW_US           50
+#define SIMULATION_DHT_BIT_ZERO_US          26
+#define SIMULATION_DHT_BIT_ONE_US           70
+#define SIMULATION_DHT_HUMIDITY             45
+#define SIMULATION_DHT_TEMPERATURE          21
+
+//=============================================================================
+// Types
+//=============================================================================
+
+typedef struct {
+
+    uint64_t time;
+    uint8_t level;
+
+} simulationDhtEdge_s;
+
+//=============================================================================
+// Globals
+//=============================================================================
+
+static uint8_t dhtPin = 0xFF;
+static uint64_t startSignalTime = UINT64_MAX;
+static std::vector<simulationDhtEdge_s> dhtTrace;
+static std::vector<simulationDhtEdge_s> frame;
+static size_t nextFrameEdge = 0;
+
+//=============================================================================
+// Helper functions
+//=============================================================================
+
+static void queueEdge(uint64_t *time, uint64_t delayUs, uint8_t level) {
+    *time += delayUs;
+    frame.push_back({*time, level});
+}
+
+static void queueFrame(uint64_t releaseTime) {
+    frame.clear();
+    nextFrameEdge = 0;
+
+    if (dhtTrace.empty() == false) {
+        for (const simulationDhtEdge_s &edge : dhtTrace) {
+            frame.push_back({releaseTime + edge.time, edge.level});
+        }
+
+        return;
+    }
+
+    uint8_t data[5] = {SIMULATION_DHT_HUMIDITY, 0, SIMULATION_DHT_TEMPERATURE, 0, 0};
+    uint64_t time = releaseTime;
+
+    data[4] = data[0] + data[1] + data[2] + data[3];
+
+    queueEdge(&time, SIMULATION_DHT_RESPONSE_DELAY_US, LOW);
+    queueEdge(&time, SIMULATION_DHT_RESPONSE_US, HIGH);
+
+    // Every bit is 50 us low followed by a high phase whose length is the value
+    uint64_t highUs = SIMULATION_DHT_RESPONSE_US;
+
+    for (uint8_t bit = 0; bit < 40; bit++) {
+        queueEdge(&time, highUs, LOW);
+        queueEdge(&time, SIMULATION_DHT_BIT_LOW_US, HIGH);
+
+        highUs = (data[bit / 8] & (0x80 >> (bit % 8))) ? SIMULATION_DHT_BIT_ONE_US : SIMULATION_DHT_BIT_ZERO_US;
+    }
+
+    // End of frame, the sensor pulls low for 50 us before releasing the bus
+    queueEdge(&time, highUs, LOW);
+    queueEdge(&time, SIMULATION_DHT_BIT_LOW_US, HIGH);
+}
+
+//=============================================================================
+// Simulation control
+//=============================================================================
+
+void SimulationDhtInit(uint8_t pin) {
+    dhtPin = pin;
+    startSignalTime = UINT64_MAX;
+    frame.clear();
+    nextFrameEdge = 0;
+}
+
+bool SimulationDhtLoadTrace(const char *path) {
+    FILE *traceFile = fopen(path, "r");
+    unsigned long long time;
+    unsigned int level;
+
+    if (traceFile == NULL)
+        return false;
+
+    while (fscanf(traceFile, "%llu,%u", &time, &level) == 2) {
+        dhtTrace.push_back({time, (uint8_t)((level != 0) ? HIGH : LOW)});
+    }
+
+    fclose(traceFile);
+
+    return (dhtTrace.empty() == false);
+}
+
+// Watches the host side of the bus, called after every loop() and busy wait
+void SimulationDhtPoll(void) {
+    if (dhtPin == 0xFF)
+        return;
+
+    bool hostLow = (SimulationGetPinMode(dhtPin) == OUTPUT) && (SimulationGetPin(dhtPin) == LOW);
+
+    if (hostLow == true) {
+        if (startSignalTime == UINT64_MAX)
+            startSignalTime = SimulationGetTime();
+
+        return;
+    }
+
+    if (startSignalTime == UINT64_MAX)
+        return;
+
+    if ((SimulationGetTime() - startSignalTime) >= SIMULATION_DHT_START_MINIMUM_US)
+        queueFrame(SimulationGetTime());
+
+    startSignalTime = UINT64_MAX;
+}
+
+uint64_t SimulationDhtNextEdge(void) {
+    return (nextFrameEdge < frame.size()) ? frame[nextFrameEdge].time : UINT64_MAX;
+}
+
+void SimulationDhtApplyEdge(void) {
+    const simulationDhtEdge_s &edge = frame[nextFrameEdge++];
+
+    SimulationSetTime(max(SimulationGetTime(), edge.time));
+    SimulationSetPin(dhtPin, edge.level);
+}
@@ -0,0 +1,31 @@
+#include "simFlash.h"
+
+//=============================================================================
+// LittleFS and flash HAL entry points. The simulated file system keeps its
+// data itself, these only report success so that link time wrappers see the
+// same calls as on the device.
+//=============================================================================
+
+int lfs_file_open(void *lfs, void *file, const char *path, int flags) {
+    return 0;
+}
+
+int lfs_file_opencfg(void *lfs, void *file, const char *path, int flags, const void *config) {
+    return 0;
+}
+
+int32_t lfs_file_write(void *lfs, void *file, const void *buffer, uint32_t size) {
+    return (int32_t)size;
+}
+
+int lfs_file_close(void *lfs, void *file) {
+    return 0;
+}
+
+int32_t flash_hal_write(uint32_t address, uint32_t size, const uint8_t *source) {
+    return 0;
+}
+
+int32_t flash_hal_erase(uint32_t address, uint32_t size) {
+    return 0;
+}
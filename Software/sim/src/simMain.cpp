@@ -0,0 +1,768 @@
+#include <Arduino.h>
+#include <ESP8266WiFi.h>
+#include <ESP8266WebServer.h>
+#include <LittleFS.h>
+#include <SSD1306.h>
+#include <WiFiUdp.h>
+
+#include <chrono>
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "simulation.h"
+#include "simBench.h"
+#include "simButtons.h"
+#include "simDht.h"
+#include "simMqtt.h"
+
+//=============================================================================
+// Host simulation driver: runs the firmware setup()/loop() against the shim
+// in accelerated simulated time while an impulse generator models the meter.
+// Each boot runs in its own process so a reset starts from pristine globals.
+//
+//   .pio/build/native/program --days 7 --watts 5000
+//=============================================================================
+
+//=============================================================================
+// Defines
+//=============================================================================
+
+#define SIMULATION_SENSOR_PIN               2
+#define SIMULATION_DHT_PIN                  0
+#define SIMULATION_PULSES_PER_KWH           10000
+#define SIMULATION_PULSE_WIDTH_US           10000
+#define SIMULATION_BATTERY_ADC              950
+#define SIMULATION_BOOT_SETTLE_US           10000000ULL
+#define SIMULATION_GLITCH_WIDTH_MIN_US      50
+#define SIMULATION_GLITCH_WIDTH_MAX_US      20000
+
+// Supply current model, ESP-12 module plus the OLED
+#define SIMULATION_CURRENT_DEEP_SLEEP_MA    0.02
+#define SIMULATION_CURRENT_CPU_MA           15.0        // awake with the radio off
+#define SIMULATION_CURRENT_RADIO_MA         55.0        // on top while the radio is on
+#define SIMULATION_CURRENT_DISPLAY_MA       10.0        // on top while the OLED is on
+#define SIMULATION_BOOT_US                  120000      // ROM and boot loader, before setup() and outside simulated time
+#define SIMULATION_BATTERY_MAH              600.0
+
+// NTP server, answers after a fixed network delay
+#define SIMULATION_NTP_DELAY_MS             30
+#define SIMULATION_NTP_UNIX_OFFSET          2208988800ULL
+
+//=============================================================================
+// Types
+//=============================================================================
+
+typedef struct {
+
+    uint64_t durationUs;
+    uint64_t stepUs;
+    double watts;
+    bool verbose;
+    bool wifi;
+    bool bench;
+    uint32_t benchIterations;
+    double glitchesPerMinute;
+    uint32_t seed;
+    int32_t wifiChannelAfterReset;
+    double batteryMah;
+    uint64_t ntpAfterUs;
+    double ntpSkewPpm;
+    FILE *mqttLog;
+    std::vector<std::pair<uint64_t, uint64_t> > mqttOutages;
+    std::vector<std::pair<uint64_t, uint64_t> > wifiOutages;
+    std::vector<std::pair<uint64_t, uint64_t> > stalls;    // time, duration
+    std::vector<String> requests;
+    std::vector<std::pair<uint64_t, String> > timedRequests;
+
+} simulationOptions_s;
+
+typedef struct {
+
+    uint64_t time;
+    uint8_t level;
+
+} simulationTraceEdge_s;
+
+typedef struct {
+
+    uint64_t time;
+    double watts;
+
+} simulationLoadStep_s;
+
+// Driver state handed from one firmware boot to the next
+typedef struct {
+
+    uint64_t endTime;
+    uint64_t pulseIntervalUs;
+    uint64_t nextRisingEdge;
+    uint64_t nextFallingEdge;
+    uint64_t nextGlitchRisingEdge;
+    uint64_t nextGlitchFallingEdge;
+    uint64_t pulsesGenerated;
+    uint64_t glitchesGenerated;
+    uint64_t loopIterations;
+    uint64_t nextTraceEdge;
+    uint32_t random;
+    bool pulseHigh;
+    bool glitchHigh;
+    uint32_t resets;
+    uint32_t nextRequest;
+    uint32_t nextTimedRequest;
+    uint32_t nextStall;
+    uint64_t lastConnectUs;             // from setup() of the last boot to WL_CONNECTED
+    uint64_t chargeTime;                // simulated time the charge is accounted up to
+    uint64_t deepSleepUs;
+    uint32_t deepSleeps;
+    double chargeMilliAmpSeconds;
+    simulationMqttStats_s mqtt;
+    bool finished;
+
+} simulationDriver_s;
+
+//=============================================================================
+// Externals from the firmware
+//=============================================================================
+
+extern ESP8266WebServer httpServer;
+extern SSD1306 display;
+
+//=============================================================================
+// Globals
+//=============================================================================
+
+static std::vector<simulationTraceEdge_s> trace;
+static std::vector<simulationLoadStep_s> load;
+
+// Run of the current firmware process, for edges due while the firmware blocks
+static const simulationOptions_s *activeOptions;
+static simulationDriver_s *activeDriver;
+static uint8_t accessPointChannel;
+
+//=============================================================================
+// Helper functions
+//=============================================================================
+
+static void printUsage(const char *program) {
+    fprintf(stderr, "usage: %s [--days N] [--hours N] [--seconds N] [--watts W] [--step-us N] [--glitches-per-minute N] [--seed N] [--trace FILE] [--load FILE] [--dht-trace FILE] [--button-trace FILE] [--stall SECONDS:MS]... [--no-wifi] [--wifi-channel-after-reset N] [--battery-mah N] [--ntp-after SECONDS] [--ntp-skew-ppm N] [--wifi-down FROM:TO]... [--mqtt-down FROM:TO]... [--mqtt-log FILE] [--verbose] [--request METHOD:/uri[?a=b&c=d]]... [--request-at SECONDS:METHOD:/uri]... | --bench [--bench-iterations N]\n", program);
+}
+
+static bool loadTrace(const char *path) {
+    FILE *traceFile = fopen(path, "r");
+    unsigned long long time;
+    unsigned int level;
+
+    if (traceFile == NULL)
+        return false;
+
+    while (fscanf(traceFile, "%llu,%u", &time, &level) == 2) {
+        trace.push_back({time, (uint8_t)((level != 0) ? HIGH : LOW)});
+    }
+
+    fclose(traceFile);
+
+    return (trace.empty() == false);
+}
+
+// Load steps as seconds,watts; each holds until the next, the last one to the end
+static bool loadProfile(const char *path) {
+    FILE *loadFile = fopen(path, "r");
+    double seconds;
+    double watts;
+
+    if (loadFile == NULL)
+        return false;
+
+    while (fscanf(loadFile, "%lf,%lf", &seconds, &watts) == 2) {
+        load.push_back({(uint64_t)(seconds * 1000000.0), max(watts, 0.0)});
+    }
+
+    fclose(loadFile);
+
+    return (load.empty() == false);
+}
+
+// Next meter pulse after the given one, one pulse worth of energy integrated
+// over the load profile or the constant load
+static uint64_t nextPulseTime(const simulationDriver_s *driver, uint64_t pulseTime) {
+    if (load.empty() == true)
+        return (driver->pulseIntervalUs > 0) ? pulseTime + driver->pulseIntervalUs : UINT64_MAX;
+
+    double energy = 3600.0e9 / SIMULATION_PULSES_PER_KWH;   // watt micro-seconds
+    uint64_t time = pulseTime;
+
+    for (size_t i = 0; i < load.size(); i++) {
+        uint64_t stepEnd = ((i + 1) < load.size()) ? load[i + 1].time : UINT64_MAX;
+
+        if (stepEnd <= time)
+            continue;
+
+        time = max(time, load[i].time);
+
+        if (load[i].watts <= 0.0) {
+            time = stepEnd;
+            continue;
+        }
+
+        double needed = energy / load[i].watts;
+
+        if ((stepEnd == UINT64_MAX) || (needed <= (double)(stepEnd - time)))
+            return time + (uint64_t)needed;
+
+        energy -= (double)(stepEnd - time) * load[i].watts;
+        time = stepEnd;
+    }
+
+    return UINT64_MAX;
+}
+
+static bool parseOptions(int argc, char **argv, simulationOptions_s *options) {
+    options->durationUs = 3600ULL * 1000000ULL;
+    options->stepUs = 1000;
+    options->watts = 5000.0;
+    options->verbose = false;
+    options->wifi = true;
+    options->bench = false;
+    options->benchIterations = 10000;
+    options->glitchesPerMinute = 0.0;
+    options->seed = 1;
+    options->wifiChannelAfterReset = 0;
+    options->batteryMah = SIMULATION_BATTERY_MAH;
+    options->ntpAfterUs = 0;
+    options->ntpSkewPpm = 0.0;
+    options->mqttLog = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        String argument(argv[i]);
+        bool hasValue = (i + 1) < argc;
+
+        if ((argument == "--days") && hasValue) {
+            options->durationUs = (uint64_t)(atof(argv[++i]) * 86400.0 * 1000000.0);
+        } else if ((argument == "--hours") && hasValue) {
+            options->durationUs = (uint64_t)(atof(argv[++i]) * 3600.0 * 1000000.0);
+        } else if ((argument == "--seconds") && hasValue) {
+            options->durationUs = (uint64_t)(atof(argv[++i]) * 1000000.0);
+        } else if ((argument == "--watts") && hasValue) {
+            options->watts = atof(argv[++i]);
+        } else if ((argument == "--step-us") && hasValue) {
+            options->stepUs = strtoull(argv[++i], NULL, 10);
+        } else if ((argument == "--request") && hasValue) {
+            options->requests.push_back(String(argv[++i]));
+        } else if ((argument == "--request-at") && hasValue) {
+            String timedRequest(argv[++i]);
+            int separator = timedRequest.indexOf(':');
+
+            options->timedRequests.push_back(std::make_pair((uint64_t)(atof(timedRequest.substring(0, separator).c_str()) * 1000000.0),
+                                                            timedRequest.substring(separator + 1)));
+        } else if ((argument == "--glitches-per-minute") && hasValue) {
+            options->glitchesPerMinute = atof(argv[++i]);
+        } else if ((argument == "--seed") && hasValue) {
+            options->seed = strtoul(argv[++i], NULL, 10);
+        } else if ((argument == "--trace") && hasValue) {
+            if (loadTrace(argv[++i]) == false) {
+                fprintf(stderr, "unable to read trace %s\n", argv[i]);
+                return false;
+            }
+        } else if ((argument == "--load") && hasValue) {
+            if (loadProfile(argv[++i]) == false) {
+                fprintf(stderr, "unable to read load %s\n", argv[i]);
+                return false;
+            }
+        } else if ((argument == "--dht-trace") && hasValue) {
+            if (SimulationDhtLoadTrace(argv[++i]) == false) {
+                fprintf(stderr, "unable to read DHT trace %s\n", argv[i]);
+                return false;
+            }
+        } else if ((argument == "--button-trace") && hasValue) {
+            if (SimulationButtonsLoadTrace(argv[++i]) == false) {
+                fprintf(stderr, "unable to read button trace %s\n", argv[i]);
+                return false;
+            }
+        } else if ((argument == "--stall") && hasValue) {
+            String stall(argv[++i]);
+            int separator = stall.indexOf(':');
+
+            options->stalls.push_back(std::make_pair((uint64_t)(atof(stall.substring(0, separator).c_str()) * 1000000.0),
+                                                     (uint64_t)(atof(stall.substring(separator + 1).c_str()) * 1000.0)));
+        } else if ((argument == "--bench-iterations") && hasValue) {
+            options->benchIterations = strtoul(argv[++i], NULL, 10);
+        } else if (argument == "--bench") {
+            options->bench = true;
+        } else if ((argument == "--wifi-channel-after-reset") && hasValue) {
+            options->wifiChannelAfterReset = atoi(argv[++i]);
+        } else if ((argument == "--battery-mah") && hasValue) {
+            options->batteryMah = atof(argv[++i]);
+        } else if ((argument == "--ntp-after") && hasValue) {
+            options->ntpAfterUs = (uint64_t)(atof(argv[++i]) * 1000000.0);
+        } else if ((argument == "--ntp-skew-ppm") && hasValue) {
+            options->ntpSkewPpm = atof(argv[++i]);
+        } else if (((argument == "--wifi-down") || (argument == "--mqtt-down")) && hasValue) {
+            double from = 0.0;
+            double to = 0.0;
+
+            if (sscanf(argv[++i], "%lf:%lf", &from, &to) != 2)
+                return false;
+
+            ((argument == "--wifi-down") ? options->wifiOutages : options->mqttOutages).push_back(
+                std::make_pair((uint64_t)(from * 1000000.0), (uint64_t)(to * 1000000.0)));
+        } else if ((argument == "--mqtt-log") && hasValue) {
+            options->mqttLog = fopen(argv[++i], "w");
+
+            if (options->mqttLog == NULL) {
+                fprintf(stderr, "unable to write MQTT log %s\n", argv[i]);
+                return false;
+            }
+        } else if (argument == "--no-wifi") {
+            options->wifi = false;
+        } else if (argument == "--verbose") {
+            options->verbose = true;
+        } else {
+            return false;
+        }
+    }
+
+    return (options->stepUs > 0);
+}
+
+// xorshift32, the generator state is part of the driver state so a reset does
+// not replay the same glitch sequence
+static uint32_t nextRandom(simulationDriver_s *driver) {
+    driver->random ^= driver->random << 13;
+    driver->random ^= driver->random >> 17;
+    driver->random ^= driver->random << 5;
+
+    return driver->random;
+}
+
+static uint64_t randomBetween(simulationDriver_s *driver, uint64_t minimum, uint64_t maximum) {
+    return minimum + (nextRandom(driver) % (maximum - minimum + 1));
+}
+
+// Glitches arrive as a Poisson process at the requested mean rate
+static uint64_t nextGlitchDelay(const simulationOptions_s *options, simulationDriver_s *driver) {
+    double uniform = (nextRandom(driver) + 1.0) / 4294967296.0;
+
+    return (uint64_t)(-log(uniform) * 60.0e6 / options->glitchesPerMinute) + 1;
+}
+
+static uint64_t nextSensorEdge(const simulationDriver_s *driver) {
+    if (trace.empty() == false)
+        return (driver->nextTraceEdge < trace.size()) ? trace[driver->nextTraceEdge].time : UINT64_MAX;
+
+    return min(min(driver->nextRisingEdge, driver->nextFallingEdge), min(driver->nextGlitchRisingEdge, driver->nextGlitchFallingEdge));
+}
+
+// Advance the earliest sensor source by one edge; the sensor output is high
+// while either the meter pulse or a glitch is high. Edges during deep sleep
+// only advance the generator, nothing is there to see them.
+static void applySensorEdge(const simulationOptions_s *options, simulationDriver_s *driver, bool deliver = true) {
+    uint64_t edgeTime = nextSensorEdge(driver);
+    uint8_t level;
+
+    if (deliver == true)
+        SimulationSetTime(max(SimulationGetTime(), edgeTime));
+
+    if (trace.empty() == false) {
+        level = trace[driver->nextTraceEdge++].level;
+    } else {
+        if (edgeTime == driver->nextRisingEdge) {
+            driver->pulseHigh = true;
+            driver->nextFallingEdge = driver->nextRisingEdge + SIMULATION_PULSE_WIDTH_US;
+            driver->nextRisingEdge = nextPulseTime(driver, driver->nextRisingEdge);
+            driver->pulsesGenerated++;
+        } else if (edgeTime == driver->nextFallingEdge) {
+            driver->pulseHigh = false;
+            driver->nextFallingEdge = UINT64_MAX;
+        } else if (edgeTime == driver->nextGlitchRisingEdge) {
+            driver->glitchHigh = true;
+            driver->nextGlitchFallingEdge = edgeTime + randomBetween(driver, SIMULATION_GLITCH_WIDTH_MIN_US, SIMULATION_GLITCH_WIDTH_MAX_US);
+            driver->nextGlitchRisingEdge = driver->nextGlitchFallingEdge + nextGlitchDelay(options, driver);
+            driver->glitchesGenerated++;
+        } else {
+            driver->glitchHigh = false;
+            driver->nextGlitchFallingEdge = UINT64_MAX;
+        }
+
+        level = ((driver->pulseHigh == true) || (driver->glitchHigh == true)) ? HIGH : LOW;
+    }
+
+    if ((deliver == true) && (SimulationGetPin(SIMULATION_SENSOR_PIN) != level))
+        SimulationSetPin(SIMULATION_SENSOR_PIN, level);
+}
+
+// Delivers the meter, DHT11 and button edges due up to the given time in order
+static void deliverEdges(const simulationOptions_s *options, simulationDriver_s *driver, uint64_t untilUs) {
+    while (true) {
+        uint64_t sensorEdge = nextSensorEdge(driver);
+        uint64_t dhtEdge = SimulationDhtNextEdge();
+        uint64_t buttonEdge = SimulationButtonsNextEdge();
+
+        if (min(min(sensorEdge, dhtEdge), buttonEdge) > untilUs)
+            break;
+
+        if ((buttonEdge < sensorEdge) && (buttonEdge < dhtEdge))
+            SimulationButtonsApplyEdge();
+        else if (dhtEdge < sensorEdge)
+            SimulationDhtApplyEdge();
+        else
+            applySensorEdge(options, driver);
+    }
+}
+
+static bool inOutage(const std::vector<std::pair<uint64_t, uint64_t> > &outages) {
+    for (size_t i = 0; i < outages.size(); i++) {
+        if ((SimulationGetTime() >= outages[i].first) && (SimulationGetTime() < outages[i].second))
+            return true;
+    }
+
+    return false;
+}
+
+// The access point goes away during --wifi-down windows and comes back after
+static void updateAccessPoint(const simulationOptions_s *options) {
+    static bool available = true;
+    bool availableNow = (options->wifi == true) && (inOutage(options->wifiOutages) == false);
+
+    if (availableNow != available) {
+        available = availableNow;
+        WiFi.SimulationSetAccessPoint(available, accessPointChannel, -62);
+    }
+}
+
+static double awakeCurrent(void) {
+    double current = SIMULATION_CURRENT_CPU_MA;
+
+    if (WiFi.SimulationIsRadioOn() == true)
+        current += SIMULATION_CURRENT_RADIO_MA;
+
+    if (display.SimulationIsDisplayOn() == true)
+        current += SIMULATION_CURRENT_DISPLAY_MA;
+
+    return current;
+}
+
+// Integrates the supply current of the state the firmware was in since the
+// last call, called every loop step and from every busy wait
+static void accountCharge(simulationDriver_s *driver) {
+    uint64_t now = SimulationGetTime();
+
+    if (now <= driver->chargeTime)
+        return;
+
+    driver->chargeMilliAmpSeconds += awakeCurrent() * ((now - driver->chargeTime) / 1e6);
+    driver->chargeTime = now;
+}
+
+// NTP server behind the simulated access point. Its clock is simulated time
+// from SIMULATION_EPOCH_START, running --ntp-skew-ppm fast against the
+// device; requests before --ntp-after are lost.
+static bool ntpResponder(const uint8_t *request, size_t requestSize, uint8_t *reply, size_t *replySize, uint32_t *delayMs) {
+    if ((requestSize < 48) || (*replySize < 48) || (SimulationGetTime() < activeOptions->ntpAfterUs))
+        return false;
+
+    double serverUs = (SimulationGetTime() + (SIMULATION_NTP_DELAY_MS * 500.0)) * (1.0 + (activeOptions->ntpSkewPpm / 1e6));
+    uint64_t seconds = SIMULATION_NTP_UNIX_OFFSET + SIMULATION_EPOCH_START + (uint64_t)(serverUs / 1e6);
+    uint32_t fraction = (uint32_t)((fmod(serverUs, 1e6) / 1e6) * 4294967296.0);
+
+    memset(reply, 0, 48);
+    reply[0] = 0x24;
+    reply[1] = 2;
+    memcpy(&reply[24], &request[40], 8);
+
+    for (uint8_t i = 0; i < 4; i++) {
+        reply[40 + i] = (uint8_t)(seconds >> (24 - (8 * i)));
+        reply[44 + i] = (uint8_t)(fraction >> (24 - (8 * i)));
+    }
+
+    *replySize = 48;
+    *delayMs = SIMULATION_NTP_DELAY_MS;
+
+    return true;
+}
+
+// Query arguments are percent decoded like ESP8266WebServer does
+static String decodeArgument(const String &text) {
+    String decoded = String();
+
+    for (unsigned int i = 0; i < text.length(); i++) {
+        if ((text[i] == '%') && ((i + 2) < text.length())) {
+            char hex[3] = {text[i + 1], text[i + 2], '\0'};
+
+            decoded += (char)strtol(hex, NULL, 16);
+            i += 2;
+        } else {
+            decoded += (text[i] == '+') ? ' ' : text[i];
+        }
+    }
+
+    return decoded;
+}
+
+static void issueRequest(const String &request) {
+    int separator = request.indexOf(':');
+    String method = request.substring(0, separator);
+    String uri = request.substring(separator + 1);
+    std::vector<String> argumentNames;
+    std::vector<String> argumentValues;
+    int query = uri.indexOf('?');
+
+    if (query >= 0) {
+        String arguments = uri.substring(query + 1);
+        uri = uri.substring(0, query);
+
+        while (arguments.length() > 0) {
+            int next = arguments.indexOf('&');
+            String pair = (next >= 0) ? arguments.substring(0, next) : arguments;
+            int equals = pair.indexOf('=');
+
+            argumentNames.push_back(decodeArgument((equals >= 0) ? pair.substring(0, equals) : pair));
+            argumentValues.push_back(decodeArgument((equals >= 0) ? pair.substring(equals + 1) : String()));
+            arguments = (next >= 0) ? arguments.substring(next + 1) : String();
+        }
+    }
+
+    HTTPMethod httpMethod = HTTP_GET;
+
+    if (method == "POST")
+        httpMethod = HTTP_POST;
+    else if (method == "DELETE")
+        httpMethod = HTTP_DELETE;
+
+    httpServer.SimulationRequest(httpMethod, uri, argumentNames, argumentValues);
+    printf("%s %s -> %d\n%s\n", method.c_str(), uri.c_str(), httpServer.SimulationGetResponseCode(), httpServer.SimulationGetResponse().c_str());
+}
+
+static void deliverBlockedEdges(uint64_t untilUs) {
+    accountCharge(activeDriver);
+    SimulationDhtPoll();
+    deliverEdges(activeOptions, activeDriver, untilUs);
+}
+
+static void runSetup(const simulationDriver_s *driver) {
+    SimulationBoot();
+    SimulationButtonsRestore(SimulationGetTime());
+    setup();
+
+    // Level of the flame sensor output across the reset, pulses are active high
+    bool sensorHigh = (driver->pulseHigh == true) || (driver->glitchHigh == true);
+
+    if ((trace.empty() == false) && (driver->nextTraceEdge > 0))
+        sensorHigh = (trace[driver->nextTraceEdge - 1].level == HIGH);
+
+    SimulationSetPin(SIMULATION_SENSOR_PIN, (sensorHigh == true) ? HIGH : LOW);
+}
+
+static void sendState(int pipeFd, simulationDriver_s *driver) {
+    std::vector<uint8_t> state;
+
+    SimulationAppendState(state, driver, sizeof(*driver));
+    SimulationSaveState(state);
+
+    size_t written = 0;
+
+    while (written < state.size()) {
+        ssize_t result = write(pipeFd, &state[written], state.size() - written);
+
+        if (result <= 0)
+            break;
+
+        written += result;
+    }
+
+    close(pipeFd);
+}
+
+// One boot of the firmware, from setup() until the end of the run or a reset
+static void runBoot(const simulationOptions_s *options, simulationDriver_s *driver, int pipeFd) {
+    uint64_t runUntil = driver->endTime;
+
+    // After a reset requested by --request give the firmware time to come back up
+    if (driver->nextRequest > 0)
+        runUntil = max<uint64_t>(runUntil, SimulationGetTime() + SIMULATION_BOOT_SETTLE_US);
+
+    activeOptions = options;
+    activeDriver = driver;
+    SimulationSetTimeHook(deliverBlockedEdges);
+
+    uint64_t bootTime = SimulationGetTime();
+    bool connected = false;
+
+    driver->lastConnectUs = 0;
+    driver->chargeTime = bootTime;
+
+    // Boot before setup(), with RF calibration unless the wake keeps the radio off
+    driver->chargeMilliAmpSeconds += (SIMULATION_CURRENT_CPU_MA + (SimulationIsRadioDisabled() ? 0.0 : SIMULATION_CURRENT_RADIO_MA)) * (SIMULATION_BOOT_US / 1e6);
+
+    try {
+        runSetup(driver);
+
+        while (SimulationGetTime() < runUntil) {
+            uint64_t stepEnd = SimulationGetTime() + options->stepUs;
+
+            // Deliver every sensor edge due in this step at its exact time stamp
+            deliverEdges(options, driver, stepEnd);
+
+            SimulationSetTime(max(SimulationGetTime(), stepEnd));
+            updateAccessPoint(options);
+            WiFi.SimulationUpdate();
+
+            if ((connected == false) && (WiFi.status() == WL_CONNECTED)) {
+                connected = true;
+                driver->lastConnectUs = SimulationGetTime() - bootTime;
+            }
+
+            // A stall blocks the firmware as a long flash write or request
+            // would, edges keep arriving meanwhile
+            while ((driver->nextStall < options->stalls.size()) &&
+                   (options->stalls[driver->nextStall].first <= SimulationGetTime())) {
+                delay(options->stalls[driver->nextStall++].second / 1000);
+            }
+
+            loop();
+            accountCharge(driver);
+            SimulationDhtPoll();
+
+            // Timed requests reach the firmware only while it is awake
+            while ((driver->nextTimedRequest < options->timedRequests.size()) &&
+                   (options->timedRequests[driver->nextTimedRequest].first <= SimulationGetTime())) {
+                issueRequest(options->timedRequests[driver->nextTimedRequest++].second);
+            }
+
+            driver->loopIterations++;
+        }
+
+        while (driver->nextRequest < options->requests.size()) {
+            issueRequest(options->requests[driver->nextRequest++]);
+        }
+
+        driver->finished = true;
+    } catch (simulationReset_s &resetRequest) {
+        accountCharge(driver);
+        SimulationAdvanceTime(resetRequest.sleepTimeUs);
+        driver->resets++;
+
+        if (resetRequest.reason == simulationResetDeepSleep) {
+            driver->deepSleeps++;
+            driver->deepSleepUs += resetRequest.sleepTimeUs;
+            driver->chargeMilliAmpSeconds += SIMULATION_CURRENT_DEEP_SLEEP_MA * (resetRequest.sleepTimeUs / 1e6);
+
+            while (nextSensorEdge(driver) <= SimulationGetTime()) {
+                applySensorEdge(options, driver, false);
+            }
+
+            // A sleeping device can't answer requests, end once the run is over
+            if ((SimulationGetTime() >= driver->endTime) && (driver->nextRequest >= options->requests.size()))
+                driver->finished = true;
+        }
+    }
+
+    sendState(pipeFd, driver);
+}
+
+//=============================================================================
+// Simulation entry point
+//=============================================================================
+
+int main(int argc, char **argv) {
+    simulationOptions_s options;
+    simulationDriver_s driver;
+
+    if (parseOptions(argc, argv, &options) == false) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    SimulationSetVerbose(options.verbose);
+
+    // Seed a station configuration so the firmware boots into station mode
+    File wifiConfig = LittleFS.open("/wifi.conf", "w");
+    wifiConfig.print("SimulationNetwork,SimulationPassword,");
+    wifiConfig.close();
+
+    memset(&driver, 0, sizeof(driver));
+    driver.pulseIntervalUs = (options.watts > 0) ? (uint64_t)(3600.0e9 / (SIMULATION_PULSES_PER_KWH * options.watts)) : 0;
+    driver.nextRisingEdge = nextPulseTime(&driver, 0);
+    driver.nextFallingEdge = UINT64_MAX;
+    driver.random = (options.seed != 0) ? options.seed : 1;
+    driver.nextGlitchRisingEdge = (options.glitchesPerMinute > 0) ? nextGlitchDelay(&options, &driver) : UINT64_MAX;
+    driver.nextGlitchFallingEdge = UINT64_MAX;
+    driver.endTime = options.durationUs;
+
+    if (options.bench == true) {
+        SimulationSetAnalog(A0, SIMULATION_BATTERY_ADC);
+        WiFi.SimulationSetAccessPoint(true, 6, -62);
+        return SimulationRunBenchmarks(options.benchIterations);
+    }
+
+    std::chrono::steady_clock::time_point wallStart = std::chrono::steady_clock::now();
+
+    // Every boot runs in a forked child so the firmware starts from freshly
+    // constructed globals; only the state a real reset keeps is handed back.
+    while (driver.finished == false) {
+        int pipeFds[2];
+
+        if (pipe(pipeFds) != 0) {
+            perror("pipe");
+            return 1;
+        }
+
+        fflush(stdout);
+        pid_t child = fork();
+
+        if (child < 0) {
+            perror("fork");
+            return 1;
+        }
+
+        if (child == 0) {
+            close(pipeFds[0]);
+            SimulationSetAnalog(A0, SIMULATION_BATTERY_ADC);
+            accessPointChannel = ((driver.resets > 0) && (options.wifiChannelAfterReset > 0)) ? options.wifiChannelAfterReset : 6;
+            WiFi.SimulationSetAccessPoint(options.wifi, accessPointChannel, -62);
+            SimulationDhtInit(SIMULATION_DHT_PIN);
+            WiFiUDP::SimulationSetResponder(ntpResponder);
+            SimulationMqttInit(&driver.mqtt, &options.mqttOutages, options.mqttLog);
+            runBoot(&options, &driver, pipeFds[1]);
+            fflush(stdout);
+
+            if (options.mqttLog != NULL)
+                fflush(options.mqttLog);
+
+            _exit(0);
+        }
+
+        close(pipeFds[1]);
+
+        std::vector<uint8_t> state;
+        uint8_t buffer[4096];
+        ssize_t received;
+
+        while ((received = read(pipeFds[0], buffer, sizeof(buffer))) > 0) {
+            state.insert(state.end(), buffer, buffer + received);
+        }
+
+        close(pipeFds[0]);
+        waitpid(child, NULL, 0);
+
+        if (state.size() < sizeof(driver)) {
+            fprintf(stderr, "firmware process terminated unexpectedly\n");
+            return 1;
+        }
+
+        memcpy(&driver, state.data(), sizeof(driver));
+        SimulationLoadState(&state[sizeof(driver)], state.size() - sizeof(driver));
+    }
+
+    double wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - wallStart).count();
+    double chargeMah = driver.chargeMilliAmpSeconds / 3600.0;
+    double averageMa = (SimulationGetTime() > 0) ? (driver.chargeMilliAmpSeconds / (SimulationGetTime() / 1e6)) : 0.0;
+
+    printf("{\"simulatedSeconds\":%.3f,\"wallSeconds\":%.3f,\"loopIterations\":%llu,\"pulsesGenerated\":%llu,\"glitchesGenerated\":%llu,\"traceEdges\":%llu,\"resets\":%u,\"lastConnectMs\":%.1f,\"deepSleeps\":%u,\"deepSleepSeconds\":%.1f,\"chargeMah\":%.3f,\"averageMa\":%.3f,\"batteryDays\":%.1f,\"mqttConnects\":%u,\"mqttPublishes\":%u,\"mqttSamples\":%u,\"mqttDuplicates\":%u,\"mqttDrops\":%u}\n",
+           SimulationGetTime() / 1e6, wallSeconds, (unsigned long long)driver.loopIterations, (unsigned long long)driver.pulsesGenerated,
+           (unsigned long long)driver.glitchesGenerated, (unsigned long long)driver.nextTraceEdge, driver.resets, driver.lastConnectUs / 1e3,
+           driver.deepSleeps, driver.deepSleepUs / 1e6, chargeMah, averageMa, (averageMa > 0) ? (options.batteryMah / averageMa / 24.0) : 0.0,
+           driver.mqtt.connects, driver.mqtt.publishes, driver.mqtt.samples, driver.mqtt.duplicates, driver.mqtt.drops);
+
+    return 0;
+}
@@ -0,0 +1,180 @@
+#include <Arduino.h>
+#include <WiFiClient.h>
+
+#include <vector>
+
+#include "simulation.h"
+#include "simMqtt.h"
+
+//=============================================================================
+// MQTT broker on the LAN, a stand-in for Mosquitto: accepts one client on
+// port 1883, acknowledges CONNECT, QoS 1 PUBLISH and PINGREQ, and checks the
+// sample time stamps it received for repeats. During
+// an outage (--mqtt-down) connections are refused and open ones are dropped.
+// Received messages are written to --mqtt-log as "seconds topic payload".
+//=============================================================================
+
+//=============================================================================
+// Defines
+//=============================================================================
+
+#define SIMULATION_MQTT_PORT                1883
+#define SIMULATION_MQTT_DELAY_MS            5
+#define SIMULATION_MQTT_SAMPLES_TOPIC       "/samples"
+
+//=============================================================================
+// Globals
+//=============================================================================
+
+static simulationMqttStats_s *mqttStats = NULL;
+static const std::vector<std::pair<uint64_t, uint64_t> > *mqttOutages = NULL;
+static FILE *mqttLog = NULL;
+static uint32_t mqttConnection = 0;
+static uint32_t mqttNextConnection = 1;
+static std::vector<uint8_t> mqttStream;
+
+//=============================================================================
+// Helper functions
+//=============================================================================
+
+static bool brokerDown(void) {
+    for (size_t i = 0; (mqttOutages != NULL) && (i < mqttOutages->size()); i++) {
+        if ((SimulationGetTime() >= (*mqttOutages)[i].first) && (SimulationGetTime() < (*mqttOutages)[i].second))
+            return true;
+    }
+
+    return false;
+}
+
+// Sample time stamps of a batch, "t":<epoch> per sample
+static void countSamples(const String &payload) {
+    int position = 0;
+
+    while ((position = payload.indexOf("\"t\":", position)) >= 0) {
+        uint32_t epoch = strtoul(payload.c_str() + position + 4, NULL, 10);
+
+        // Samples are published in time order, anything not newer than the
+        // last one is a repeat after a lost acknowledgement
+        if (epoch <= mqttStats->lastEpoch)
+            mqttStats->duplicates++;
+        else
+            mqttStats->lastEpoch = epoch;
+
+        mqttStats->samples++;
+        position += 4;
+    }
+}
+
+static void handlePacket(uint8_t header, const uint8_t *body, size_t length, std::vector<uint8_t> &reply) {
+    switch (header & 0xF0) {
+        case 0x10:
+            mqttStats->connects++;
+            reply.insert(reply.end(), {0x20, 0x02, 0x00, 0x00});
+            break;
+
+        case 0x30: {
+            uint8_t qos = (header >> 1) & 0x03;
+            size_t topicLength = ((size_t)body[0] << 8) | body[1];
+            size_t payloadStart = 2 + topicLength + ((qos > 0) ? 2 : 0);
+            String topic = String(std::string((const char *)&body[2], topicLength).c_str());
+            String payload = String(std::string((const char *)&body[payloadStart], length - payloadStart).c_str());
+
+            mqttStats->publishes++;
+
+            if (topic.endsWith(SIMULATION_MQTT_SAMPLES_TOPIC))
+                countSamples(payload);
+
+            if (mqttLog != NULL)
+                fprintf(mqttLog, "%.3f %s %s\n", SimulationGetTime() / 1e6, topic.c_str(), payload.c_str());
+
+            if (qos > 0)
+                reply.insert(reply.end(), {0x40, 0x02, body[2 + topicLength], body[3 + topicLength]});
+            break;
+        }
+
+        case 0xC0:
+            reply.insert(reply.end(), {0xD0, 0x00});
+            break;
+
+        case 0xE0:
+            mqttConnection = 0;
+            break;
+
+        default:
+            break;
+    }
+}
+
+//=============================================================================
+// TCP peer
+//=============================================================================
+
+static uint32_t brokerConnect(IPAddress ip, uint16_t port) {
+    (void)ip;
+
+    if ((port != SIMULATION_MQTT_PORT) || (brokerDown() == true))
+        return 0;
+
+    // Like a broker seeing the same client id again, the old session goes
+    mqttConnection = mqttNextConnection++;
+    mqttStream.clear();
+
+    return mqttConnection;
+}
+
+static bool brokerIsOpen(uint32_t connection) {
+    if ((connection == mqttConnection) && (brokerDown() == true)) {
+        mqttStats->drops++;
+        mqttConnection = 0;
+    }
+
+    return (connection == mqttConnection);
+}
+
+static void brokerReceive(uint32_t connection, const uint8_t *data, size_t size, std::vector<uint8_t> &reply, uint32_t *delayMs) {
+    if (connection != mqttConnection)
+        return;
+
+    mqttStream.insert(mqttStream.end(), data, data + size);
+    *delayMs = SIMULATION_MQTT_DELAY_MS;
+
+    // Complete packets only, a packet may arrive over several writes
+    while (mqttStream.size() >= 2) {
+        size_t length = 0;
+        size_t position = 1;
+        uint8_t shift = 0;
+
+        while ((position < mqttStream.size()) && (position <= 4)) {
+            length |= (size_t)(mqttStream[position] & 0x7F) << shift;
+            shift += 7;
+
+            if ((mqttStream[position++] & 0x80) == 0)
+                break;
+        }
+
+        if ((mqttStream.size() - position) < length)
+            return;
+
+        handlePacket(mqttStream[0], &mqttStream[position], length, reply);
+        mqttStream.erase(mqttStream.begin(), mqttStream.begin() + position + length);
+    }
+}
+
+static void brokerClose(uint32_t connection) {
+    if (connection == mqttConnection)
+        mqttConnection = 0;
+}
+
+static const simulationTcpPeer_s brokerPeer = {brokerConnect, brokerIsOpen, brokerReceive, brokerClose};
+
+//=============================================================================
+// Simulation interface
+//=============================================================================
+
+void SimulationMqttInit(simulationMqttStats_s *stats, const std::vector<std::pair<uint64_t, uint64_t> > *outages, FILE *log) {
+    mqttStats = stats;
+    mqttOutages = outages;
+    mqttLog = log;
+
+    WiFiClient::SimulationSetPeer(&brokerPeer);
+}
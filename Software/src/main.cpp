@@ -13,30 +13,44 @@
 #include <Wire.h>
 #include <SSD1306.h>
 #include <SSD1306Wire.h>
-#include <NTPClient.h>
-#include <DHTesp.h>
 
 #include <clickButton.h>
 #include <beeperControl.h>
 #include <batteryHistogram.h>
 #include <impulseCapture.h>
+#include <configStore.h>
+#include <taskScheduler.h>
+#include <loopProfiler.h>
+#include <heapMonitor.h>
+#include <wifiCache.h>
+#include <sampleBatch.h>
+#include <dhtReader.h>
+#include <sensorCache.h>
+#include <timeService.h>
+#include <logStore.h>
+#include <mqttClient.h>
+#include <mqttOutbox.h>
+#include <alertEngine.h>
+#include <tariffLedger.h>
+#include <applianceDetector.h>
+#include <loadProfile.h>
+#include <flashMonitor.h>
 
 #include "uiGlobal.h"
 #include "uiOverlay.h"
 #include "uiFrameStatus.h"
 #include "uiFrameSensor.h"
 #include "uiFrameBattery.h"
+#include "uiFrameTariff.h"
 
 //=============================================================================
 // Types
 //=============================================================================
 
 //=============================================================================
-// Hostname, SSID and Password for Wifi router
+// Access point used for provisioning, station credentials live in the
+// configuration store
 //=============================================================================
-String staSSID(32);
-String staPassword(32);
-
 IPAddress apIPAddress(192,168,1,2);
 IPAddress apGatwayAddress(192,168,1,1);
 IPAddress apNetmask(255,255,255,0);
@@ -44,17 +58,10 @@ IPAddress apNetmask(255,255,255,0);
 //=============================================================================
 // Application specific defines and globals
 //=============================================================================
-static uint32_t lastDhtUpdateTime = 0;
-static uint32_t lastLogUpdateTime = 0;
 static uint32_t lastLogUpdateUiTime = 0;
 
-unsigned long reconnectionTime;
 bool logUpdate = false;
-
-//=============================================================================
-// Global constants for NTP Client
-//=============================================================================
-const uint32_t utcOffsetInSeconds = 3600;
+bool displayState = true;
 
 //=============================================================================
 // Global constants for Impulse Sensor interface, buttons, beeper interface, DHT11
@@ -67,8 +74,46 @@ const uint32_t utcOffsetInSeconds = 3600;
 #define ACCESSORY_MODEL             ("ESP8266")
 
 #define RECONNECT_INTERVAL          5000
-#define LOG_INTERVAL                10000   // 10 seconds in milli-seconds
 #define LOG_UI_DISPLAY_TIME         500
+#define LOG_FIELDS_PER_CHANNEL      4       // mean watts, pulses, min watts, max watts
+#define LOG_FIELDS_RECORD           1       // record flags, after the channels
+#define LOG_RECORD_ESTIMATED        0x01    // batched sample, nothing was counted
+#define LOG_LEGACY_FILE             "/log.csv"
+#define LOG_RESPONSE_CHUNK          1024
+#define LIST_RESPONSE_CHUNK         1024
+#define LIST_DEFAULT_LIMIT          50
+#define LIST_MAXIMUM_LIMIT          500
+#define LOG_PENDING_FILE            "/log.pending"  // records stamped with uptime until the time is known
+#define LOG_PENDING_CURSOR_FILE     "/log.cursor"   // bytes of LOG_PENDING_FILE already back-filled
+#define LOG_PENDING_BYTES_MAX       65536           // about 6 h at the default interval, later records are dropped
+#define LOG_PENDING_TAIL_BYTES      160             // holds the last record of 4 channels
+#define LOG_BACKFILL_RECORDS        32              // per log task run, keeps loop() short
+
+#define UI_TARGET_FPS               10
+#define UI_UPDATE_INTERVAL          10      // polled faster than the frame rate, OLEDDisplayUi paces itself
+#define UI_SENSOR_FRAME_INDEX       2       // index of uiFrameSensor in frames[]
+#define BUTTON_UPDATE_INTERVAL      20      // clicks are decoded from time stamped edges, not the poll rate
+#define BEEPER_UPDATE_INTERVAL      5
+#define IMPULSE_UPDATE_INTERVAL     50
+#define PROFILER_REPORT_INTERVAL    60000
+#define HEAP_MONITOR_INTERVAL       1000
+#define TIME_UPDATE_INTERVAL        50
+#define POWER_UPDATE_INTERVAL       1000
+#define MQTT_UPDATE_INTERVAL        100
+#define ALERT_UPDATE_INTERVAL       1000    // rules age this often while no pulse arrives
+
+// Battery operation, a wake from deep sleep with the radio off waits this long
+// for one full pulse interval (two pulses, >= 90 W at 10000 pulses per kWh)
+#define BATCH_SAMPLE_WINDOW         8000
+#define BATCH_SAMPLE_POLL           10
+#define BATCH_MINIMUM_SLEEP         1000
+#define BATCH_FLUSH_WINDOW_FACTOR   3       // awake windows to wait for NTP before sleeping unflushed
+
+// RTC user memory is addressed in 4 byte blocks, blocks 0..31 belong to eboot (OTA)
+#define RTC_HEAP_MONITOR_OFFSET     32
+#define RTC_WIFI_CACHE_OFFSET       48
+#define RTC_SAMPLE_BATCH_OFFSET     64
+#define RTC_MQTT_OUTBOX_OFFSET      124
 
 const uint8_t SensorPin = 2;
 const uint8_t MenuPin = 14;
@@ -77,6 +122,10 @@ const uint8_t BeeperPin = 13;
 const uint8_t dhtSensorPin = 0;
 const uint8_t DeepSleepPin = 16;
 
+// GPIOs left for meter channels: 0, 4, 5, 13, 14 and 15 are taken above,
+// 1 and 3 are the UART, 6 to 11 the SPI flash and 16 has no interrupt
+const uint8_t ImpulsePins[] = {SensorPin, 12};
+
 //=============================================================================
 // Global objects for Wifi and ESP specifics
 //=============================================================================
@@ -87,6 +136,13 @@ WiFiEventHandler onGotIpHandler;
 WiFiEventHandler onAccessPointConnectedHandler;
 File fsUploadFile;
 
+// Channel, BSSID and lease of the last connection, reused after a reset or
+// deep sleep to join without a scan or DHCP
+WiFiCache wifiCache(RTC_WIFI_CACHE_OFFSET);
+bool wifiFastConnectPending = false;
+uint32_t wifiConnectStartTime = 0;
+bool wifiConnectStarted = false;
+
 //=============================================================================
 // OLED global object (https://github.com/ThingPulse/esp8266-oled-ssd1306)
 //=============================================================================
@@ -94,21 +150,23 @@ SSD1306 display(0x3C, 4, 5, GEOMETRY_128_32);
 OLEDDisplayUi ui(&display);
 
 OverlayCallback overlays[] = {uiOverlay};
-FrameCallback frames[] = {uiFrameStatus, uiFrameBattery, uiFrameSensor};
+FrameCallback frames[] = {uiFrameStatus, uiFrameBattery, uiFrameSensor, uiFrameTariff};
 int overlaysCount = 1;
-int frameCount = 3;
+int frameCount = 4;
 
 //=============================================================================
-// Declare DHTxx object (DHT sensor library for ESPx by Bernd Giesecke)
+// Global objects for DHT11, read without blocking across several task runs
+// into a cache which sets the poll interval
 //=============================================================================
-DHTesp dht;
-TempAndHumidity dhtTempAndHumidity;
+DhtReader dhtReader(dhtSensorPin);
+SensorCache sensorCache;
+uint8_t dhtTaskId = TASK_SCHEDULER_INVALID_TASK;
 
 //=============================================================================
-// Global objects for NTP Client
+// Global objects for NTP time service
 //=============================================================================
 WiFiUDP ntpUDP;
-NTPClient timeClient(ntpUDP, "pool.ntp.org", utcOffsetInSeconds);
+TimeService timeService(ntpUDP);
 
 //=============================================================================
 // Global objects for ClickButton object
@@ -129,12 +187,107 @@ BatteryHistogram battery(true);
 //=============================================================================
 // Global objects for impulse object
 //=============================================================================
-ImpulseCapture impulse(SensorPin);
+// One entry per meter, configured from the meter configuration at boot. The
+// first is the one shown on the display, further meters go on spare GPIOs or
+// the SAO port with their own pulses per kWh.
+ImpulseCapture impulseChannels[IMPULSE_CHANNELS_MAX];
+uint8_t impulseChannelCount = 1;
+ImpulseCapture &impulse = impulseChannels[0];
+
+//=============================================================================
+// Global objects for runtime configuration
+//=============================================================================
+ConfigStore configStore;
+uint8_t logTaskId = TASK_SCHEDULER_INVALID_TASK;
+
+//=============================================================================
+// Global objects for the compressed power log
+//=============================================================================
+LogStore logStore;
+uint64_t logPendingBase = 0;            // uptime 0 of this boot on the time line of LOG_PENDING_FILE
+uint32_t logPendingDropped = 0;
+uint32_t logBackfilled = 0;
+
+//=============================================================================
+// Global objects for MQTT publishing, samples stay in the outbox until the
+// broker has them
+//=============================================================================
+WiFiClient mqttTcpClient;
+MqttClient mqttClient(mqttTcpClient);
+MqttOutbox mqttOutbox(RTC_MQTT_OUTBOX_OFFSET);
+uint16_t mqttSamplesInFlight = 0;
+
+//=============================================================================
+// Global objects for alert rules, evaluated on every power update of the main
+// meter; events go to the beeper, /alerts and <topic>/alert
+//=============================================================================
+AlertEngine alertEngine;
+uint32_t alertImpulseCount = 0;
+uint32_t alertUpdateTime = 0;
+uint32_t mqttAlertSequence = 0;         // next event to publish
+bool mqttAlertInFlight = false;
+
+const char *alertRuleNames[] = {"none", "above", "sustained", "step", "night"};
+
+//=============================================================================
+// Global objects for time-of-use accounting of the main meter
+//=============================================================================
+TariffLedger tariffLedger;
+uint32_t tariffImpulseCount = 0;
+
+//=============================================================================
+// Global objects for appliance detection on the pulse intervals of the main
+// meter
+//=============================================================================
+ApplianceDetector applianceDetector;
+uint32_t applianceImpulseCount = 0;
+
+//=============================================================================
+// Global objects for the hour of week load profile and the baseload
+//=============================================================================
+LoadProfile loadProfile;
+
+//=============================================================================
+// Global objects for flash wear and file system health
+//=============================================================================
+FlashMonitor flashMonitor;
+
+//=============================================================================
+// Global objects for batched, deep sleep operation
+//=============================================================================
+SampleBatch sampleBatch(RTC_SAMPLE_BATCH_OFFSET);
 
 //=============================================================================
 // Global objects for UX
 //=============================================================================
-uiGlobalObject_s uiGlobalObject = {&dhtTempAndHumidity, &battery, &impulse, &logUpdate};
+uiGlobalObject_s uiGlobalObject = {&sensorCache, &battery, &impulse, &logUpdate, &tariffLedger, &timeService};
+
+//=============================================================================
+// Global objects for cooperative task scheduler
+//=============================================================================
+TaskScheduler scheduler;
+
+//=============================================================================
+// Global objects for loop instrumentation
+//=============================================================================
+LoopProfiler profiler;
+
+uint8_t profilerStageLoop;
+uint8_t profilerStageHttp;
+uint8_t profilerStageUi;
+uint8_t profilerStageLog;
+uint8_t profilerStageDht;
+uint8_t profilerStageMqtt;
+
+//=============================================================================
+// Global objects for heap and fragmentation telemetry
+//=============================================================================
+HeapMonitor heapMonitor(RTC_HEAP_MONITOR_OFFSET);
+
+uint8_t heapSubsystemHttp;
+uint8_t heapSubsystemUi;
+uint8_t heapSubsystemLog;
+uint8_t heapSubsystemMqtt;
 
 //=============================================================================
 // Function prototypes
@@ -142,14 +295,536 @@ uiGlobalObject_s uiGlobalObject = {&dhtTempAndHumidity, &battery, &impulse, &log
 bool loadFromSpiffs(String path);
 void handleRoot(void);
 void handleFileList(void);
+time_t fileTimeCallback(void);
 void handleFileUpload(void);
 void handleFileDelete(void);
 void handleWebRequests(void);
 void handleBeeper(void);
+void handleScheduler(void);
+void handleProfiler(void);
+String buildProfilerReport(void);
+void handleDiagnostics(void);
+void handleImpulse(void);
+void handleConfig(void);
+void handleNetwork(void);
+void handleSensor(void);
+void handleTime(void);
+void handleLog(void);
+void handleLogIndex(void);
+void handleMqtt(void);
+void handleAlerts(void);
+void handleTariff(void);
+void handleAppliances(void);
+void handleLoadProfile(void);
+int8_t parseTariffSlot(const String &time);
+String formatTariffTotal(const tariffTotal_s *total);
+bool parseAddress(const char *argument, uint32_t *address);
+bool isImpulsePinFree(meterConfig_s *meterConfig, uint8_t channel);
+String escapeJson(const String &text);
+bool isValidName(const String &name, uint8_t size);
+void applyMeterConfig(void);
+void applyMqttConfig(void);
+void applyAlertConfig(void);
+void evaluateAlerts(void);
+void accountTariff(void);
+void detectAppliances(void);
+void queueMqttSample(uint32_t epoch, uint32_t watts, uint32_t pulses, bool estimated);
+void demandSensor(void);
+void runBatchSample(void);
+void enterBatchSleep(void);
+void flushSampleBatch(void);
+void restorePendingLog(void);
+void appendPendingLog(const int32_t *values);
+uint32_t pendingToEpoch(uint64_t stamp);
+void backfillLog(void);
+void importLegacyLog(void);
+uint64_t parseLogRecord(const char *record, int32_t *values);
+void taskNetwork(void);
+void taskWiFi(void);
+void taskButtons(void);
+void taskUi(void);
+void taskBeeper(void);
+void taskBattery(void);
+void taskImpulse(void);
+void taskLog(void);
+void taskDht(void);
+void taskProfilerReport(void);
+void taskHeapMonitor(void);
+void taskPower(void);
+void taskTime(void);
+void taskMqtt(void);
 
 //=============================================================================
 // Helper function
 //=============================================================================
+// A channel's pin has to be one of ImpulsePins and not taken by a lower
+// channel; a channel without a pin is not bound
+bool isImpulsePinFree(meterConfig_s *meterConfig, uint8_t channel) {
+    uint8_t pin = meterConfig->channels[channel].pin;
+    bool allowed = false;
+
+    if (pin == IMPULSE_PIN_NONE)
+        return true;
+
+    for (uint8_t i = 0; i < sizeof(ImpulsePins); i++) {
+        if (ImpulsePins[i] == pin)
+            allowed = true;
+    }
+
+    for (uint8_t i = 0; i < channel; i++) {
+        if (meterConfig->channels[i].pin == pin)
+            allowed = false;
+    }
+
+    return allowed;
+}
+
+// Strings from the user or the file system go into JSON replies quoted;
+// quotes, backslashes and control characters have to be escaped there
+String escapeJson(const String &text) {
+    String escaped = String();
+    char code[7];
+
+    for (uint32_t i = 0; i < text.length(); i++) {
+        char c = text[i];
+
+        if ((c == '"') || (c == '\\')) {
+            escaped += '\\';
+            escaped += c;
+        } else if ((uint8_t)c < 0x20) {
+            snprintf(code, sizeof(code), "\\u%04x", (uint8_t)c);
+            escaped += code;
+        } else {
+            escaped += c;
+        }
+    }
+
+    return escaped;
+}
+
+// Names are stored in fixed buffers of size bytes and shown in the page
+// and the CSV files; quotes, backslashes and control characters are refused
+bool isValidName(const String &name, uint8_t size) {
+    if ((name.length() == 0) || (name.length() >= size))
+        return false;
+
+    for (uint32_t i = 0; i < name.length(); i++) {
+        char c = name[i];
+
+        if ((c == '"') || (c == '\\') || ((uint8_t)c < 0x20) || (c == 0x7f))
+            return false;
+    }
+
+    return true;
+}
+
+void applyMeterConfig(void) {
+    meterConfig_s *meterConfig = configStore.GetMeterConfig();
+
+    // Constants are derived once here so the pulse interrupt never divides
+    for (uint8_t i = 0; i < impulseChannelCount; i++) {
+        impulseChannels[i].SetMeterConstants(meterConfig->channels[i].pulsesPerKilowattHour, meterConfig->minimumWatt, meterConfig->maximumWatt);
+        impulseChannels[i].SetEstimator((impulseEstimator_e)meterConfig->estimator, meterConfig->averagePulses, meterConfig->decay);
+    }
+
+    if (logTaskId != TASK_SCHEDULER_INVALID_TASK) {
+        scheduler.SetPeriod(logTaskId, meterConfig->logInterval);
+    }
+}
+
+void applyMqttConfig(void) {
+    mqttConfig_s *mqttConfig = configStore.GetMqttConfig();
+    networkConfig_s *networkConfig = configStore.GetNetworkConfig();
+    String statusTopic = String(mqttConfig->topic) + "/status";
+
+    // The broker reports the meter offline when the connection is lost
+    mqttClient.SetServer((mqttConfig->enabled != 0) ? mqttConfig->host : "", mqttConfig->port);
+    mqttClient.SetCredentials(networkConfig->hostname, mqttConfig->username, mqttConfig->password);
+    mqttClient.SetWill(statusTopic.c_str(), "offline");
+}
+
+void applyAlertConfig(void) {
+    alertConfig_s *alertConfig = configStore.GetAlertConfig();
+
+    for (uint8_t i = 0; i < ALERT_RULES_MAX; i++) {
+        alertEngine.SetRule(i, &alertConfig->rules[i]);
+    }
+}
+
+// A new pulse of the main meter is a power update; without pulses the rules
+// are still evaluated once a second so durations and night windows advance.
+// Nothing is known before the second pulse of a boot, which would otherwise
+// look like a step from 0 W.
+void evaluateAlerts(void) {
+    uint32_t impulseCount = impulse.GetImpulseCount();
+    uint32_t sequence = alertEngine.GetSequence();
+
+    if (impulseCount < 2)
+        return;
+
+    if ((impulseCount == alertImpulseCount) && ((millis() - alertUpdateTime) < ALERT_UPDATE_INTERVAL))
+        return;
+
+    alertImpulseCount = impulseCount;
+    alertUpdateTime = millis();
+
+    uint8_t beeps = alertEngine.Update(millis(), (timeService.IsSynced() == true) ? timeService.GetEpoch() : 0, impulse.GetWattUsage());
+
+    for (; sequence < alertEngine.GetSequence(); sequence++) {
+        const alertEvent_s *event = alertEngine.GetEvent(sequence);
+
+        Serial.printf("Alert rule %u (%s) %s at %d W\n", event->rule, alertRuleNames[event->type],
+                      (event->raised != 0) ? "raised" : "cleared", event->watts);
+    }
+
+    // A pattern already sounding is not cut short
+    if ((beeps > 0) && (beeper.GetBeeperState() == beepHandlerIdle))
+        beeper.RequestBeeper(beeps);
+}
+
+// Pulses of the main meter are booked to the rate of the moment they were
+// counted, within one impulse task period
+void accountTariff(void) {
+    uint32_t impulseCount = impulse.GetImpulseCount();
+
+    // A long press on enter clears the pulse count
+    if (impulseCount < tariffImpulseCount)
+        tariffImpulseCount = 0;
+
+    tariffLedger.AddPulses((timeService.IsSynced() == true) ? timeService.GetEpoch() : 0,
+                           impulseCount - tariffImpulseCount, impulse.GetPulsesPerKilowattHour(), false);
+    tariffImpulseCount = impulseCount;
+    tariffLedger.Update();
+}
+
+// Every new pulse interval of the main meter is one sample of the detector;
+// pulses arriving within one impulse task period count as one
+void detectAppliances(void) {
+    uint32_t impulseCount = impulse.GetImpulseCount();
+    uint32_t watts = impulse.GetInstantWattUsgage();
+
+    if ((impulseCount == applianceImpulseCount) || (watts == 0)) {
+        applianceImpulseCount = impulseCount;
+        return;
+    }
+
+    applianceImpulseCount = impulseCount;
+
+    if (applianceDetector.Update(millis(), (timeService.IsSynced() == true) ? timeService.GetEpoch() : 0, watts) == true) {
+        const applianceEvent_s *event = applianceDetector.GetEvent(applianceDetector.GetSequence() - 1);
+
+        Serial.printf("Appliance %s, %d W step to %u W, signature %u\n", (event->step > 0) ? "on" : "off",
+                      event->step, event->level, event->signature);
+    }
+}
+
+// Main meter, DHT11 and battery of one log interval. Stored in flash right
+// away while the broker can't be reached, so an outage or reset loses nothing.
+void queueMqttSample(uint32_t epoch, uint32_t watts, uint32_t pulses, bool estimated) {
+    mqttSample_s sample;
+
+    if (configStore.GetMqttConfig()->enabled == 0)
+        return;
+
+    memset(&sample, 0, sizeof(sample));
+    sample.epoch = epoch;
+    sample.watts = watts;
+    sample.energy = ((uint64_t)pulses * WATTS_PER_KILOWATT * 1000) / impulse.GetPulsesPerKilowattHour();
+    sample.temperature = MQTT_SAMPLE_TEMPERATURE_NONE;
+    sample.humidity = MQTT_SAMPLE_HUMIDITY_NONE;
+    sample.battery = battery.GetBatteryLevel();
+    sample.flags = (estimated == true) ? MQTT_SAMPLE_ESTIMATED : 0;
+
+    if ((sensorCache.IsValid() == true) && (sensorCache.IsStale() == false)) {
+        sample.temperature = lroundf(sensorCache.GetReading()->temperature * 10.0f);
+        sample.humidity = lroundf(sensorCache.GetReading()->humidity * 10.0f);
+    }
+
+    mqttOutbox.Push(&sample, mqttClient.IsConnected() == false);
+}
+
+// Consumers of the DHT11 values bring a slowed down poll back to the fast cadence
+void demandSensor(void) {
+    if ((sensorCache.Demand() == true) && (dhtReader.IsBusy() == false)) {
+        scheduler.SetNextDeadline(dhtTaskId, SENSOR_CACHE_INTERVAL_MIN_MS);
+    }
+}
+
+void runBatchSample(void) {
+    powerConfig_s *powerConfig = configStore.GetPowerConfig();
+
+    // A cold boot, or one without a batch in RTC memory, comes fully up first
+    if ((sampleBatch.Init() == false) || (ESP.getResetInfoPtr()->reason != REASON_DEEP_SLEEP_AWAKE))
+        return;
+
+    display.displayOff();
+
+    // GPIO edges are not seen in deep sleep, so each wake measures one pulse
+    // interval of the main meter with the radio still off
+    uint32_t windowStart = millis();
+
+    while ((impulse.GetImpulseCount() < 2) && ((millis() - windowStart) < BATCH_SAMPLE_WINDOW)) {
+        delay(BATCH_SAMPLE_POLL);
+    }
+
+    sampleBatch.Add((impulse.GetImpulseCount() >= 2) ? min<uint32_t>(impulse.GetInstantWattUsgage(), UINT16_MAX) : 0);
+
+    // Flush boots carry on with WiFi, the log and the HTTP server
+    if ((sampleBatch.IsFull() == true) || (sampleBatch.GetElapsed() >= (powerConfig->flushInterval * 60000UL)))
+        return;
+
+    enterBatchSleep();
+}
+
+void enterBatchSleep(void) {
+    powerConfig_s *powerConfig = configStore.GetPowerConfig();
+    uint32_t period = powerConfig->sampleInterval * 1000UL;
+    uint32_t awakeTime = millis();
+    uint32_t sleepTime = (awakeTime < (period - BATCH_MINIMUM_SLEEP)) ? (period - awakeTime) : BATCH_MINIMUM_SLEEP;
+
+    sampleBatch.AdvanceTime(awakeTime + sleepTime);
+    sampleBatch.Persist();
+
+    // RF calibration costs power, only the wake that flushes needs the radio
+    bool flushNext = ((sampleBatch.GetCount() + 1) >= SAMPLE_BATCH_SAMPLES_MAX) ||
+                     (sampleBatch.GetElapsed() >= (powerConfig->flushInterval * 60000UL));
+
+    display.displayOff();
+    mqttOutbox.Persist();
+    tariffLedger.Save();
+    loadProfile.Save();
+    flashMonitor.Save();
+    ESP.deepSleep(sleepTime * 1000ULL, flushNext ? RF_DEFAULT : RF_DISABLED);
+}
+
+void flushSampleBatch(void) {
+    uint32_t sampleInterval = configStore.GetPowerConfig()->sampleInterval;
+    uint32_t pulsesPerKilowattHour = impulse.GetPulsesPerKilowattHour();
+
+    // Sample times are relative to the batch start, anchor them to the clock now
+    uint32_t batchStartEpoch = timeService.GetEpoch() - ((sampleBatch.GetElapsed() + millis()) / 1000);
+
+    int32_t values[LOG_CODEC_FIELDS_MAX];
+
+    memset(values, 0, sizeof(values));
+
+    // Pulses are not counted in deep sleep. The watts of the one interval
+    // measured per wake stand for the whole sample interval and the pulses
+    // are modelled from them, so the records, samples and tariff energy are
+    // flagged as estimated.
+    values[impulseChannelCount * LOG_FIELDS_PER_CHANNEL] = LOG_RECORD_ESTIMATED;
+
+    for (uint16_t i = 0; i < sampleBatch.GetCount(); i++) {
+        const batchSample_s *sample = sampleBatch.GetSample(i);
+
+        values[0] = sample->watts;
+        values[1] = ((uint64_t)sample->watts * sampleInterval * pulsesPerKilowattHour) / (SECONDS_PER_HOUR * WATTS_PER_KILOWATT);
+        values[2] = sample->watts;
+        values[3] = sample->watts;
+
+        logStore.Append(batchStartEpoch + sample->offset, values);
+        queueMqttSample(batchStartEpoch + sample->offset, values[0], values[1], true);
+        tariffLedger.AddPulses(batchStartEpoch + sample->offset, values[1], pulsesPerKilowattHour, true);
+        loadProfile.Add(batchStartEpoch + sample->offset, values[0]);
+    }
+
+    Serial.printf("Flushed %u batched samples, %u dropped\n", sampleBatch.GetCount(), sampleBatch.GetDropped());
+
+    sampleBatch.Start();
+    sampleBatch.Persist();
+}
+
+// Splits "stamp,value,value,..." into the stamp and the values of the log
+// layout; missing values stay 0
+uint64_t parseLogRecord(const char *record, int32_t *values) {
+    char *field;
+    uint64_t stamp = strtoull(record, &field, 10);
+    uint8_t fieldCount = 0;
+
+    memset(values, 0, LOG_CODEC_FIELDS_MAX * sizeof(int32_t));
+
+    while ((*field == ',') && (fieldCount < logStore.GetFieldCount())) {
+        values[fieldCount++] = strtol(field + 1, &field, 10);
+    }
+
+    // The first log format only had epoch and watts
+    if (fieldCount == 1) {
+        values[2] = values[0];
+        values[3] = values[0];
+    }
+
+    return stamp;
+}
+
+// Records set aside before a watchdog, exception or software restart go on
+// on one time line, this boot starting one log interval after the last of
+// them. After a power on, an external reset or deep sleep the time in between
+// is unknown and they are dropped.
+void restorePendingLog(void) {
+    uint8_t reason = ESP.getResetInfoPtr()->reason;
+    bool placeable = (reason == REASON_WDT_RST) || (reason == REASON_EXCEPTION_RST) ||
+                     (reason == REASON_SOFT_WDT_RST) || (reason == REASON_SOFT_RESTART);
+    File pendingLog = LittleFS.open(LOG_PENDING_FILE, "r");
+    uint64_t lastStamp = 0;
+
+    if (!pendingLog) {
+        LittleFS.remove(LOG_PENDING_CURSOR_FILE);
+        return;
+    }
+
+    if (placeable == true) {
+        char tail[LOG_PENDING_TAIL_BYTES + 1];
+        size_t size = pendingLog.size();
+        size_t length = min<size_t>(size, LOG_PENDING_TAIL_BYTES);
+
+        pendingLog.seek(size - length);
+        length = pendingLog.read((uint8_t *)tail, length);
+        tail[length] = '\0';
+
+        while ((length > 0) && ((tail[length - 1] == '\n') || (tail[length - 1] == '\r'))) {
+            tail[--length] = '\0';
+        }
+
+        // The last record follows the last line break, or is the whole file
+        char *record = strrchr(tail, '\n');
+
+        if ((record != NULL) || (length == size))
+            lastStamp = strtoull((record != NULL) ? record + 1 : tail, NULL, 10);
+    }
+
+    pendingLog.close();
+
+    if (lastStamp == 0) {
+        Serial.printf("Discarding unsynchronised log records of the previous boot\n");
+        LittleFS.remove(LOG_PENDING_FILE);
+        LittleFS.remove(LOG_PENDING_CURSOR_FILE);
+        return;
+    }
+
+    logPendingBase = lastStamp + configStore.GetMeterConfig()->logInterval;
+
+    Serial.printf("Keeping unsynchronised log records of the previous boot\n");
+}
+
+// Without the time the record is stamped with the uptime in milli-seconds and
+// set aside as CSV; once the file is full further records are dropped
+void appendPendingLog(const int32_t *values) {
+    File pendingLog = LittleFS.open(LOG_PENDING_FILE, "a");
+
+    if (pendingLog.size() >= LOG_PENDING_BYTES_MAX) {
+        pendingLog.close();
+
+        if (logPendingDropped++ == 0)
+            Serial.printf("Unsynchronised log full, dropping records\n");
+
+        return;
+    }
+
+    pendingLog.printf("%llu", (unsigned long long)(timeService.GetUptimeMs() + logPendingBase));
+
+    for (uint8_t i = 0; i < logStore.GetFieldCount(); i++) {
+        pendingLog.printf(",%d", values[i]);
+    }
+
+    pendingLog.println();
+    pendingLog.close();
+}
+
+// Stamps of earlier boots lie before uptime 0 of this one
+uint32_t pendingToEpoch(uint64_t stamp) {
+    if (stamp >= logPendingBase)
+        return timeService.ToEpoch(stamp - logPendingBase);
+
+    return timeService.ToEpoch(0) - (uint32_t)((logPendingBase - stamp) / 1000);
+}
+
+// Moves up to LOG_BACKFILL_RECORDS records logged before the first sync into
+// the log per call, with the epoch their stamp maps to now that the clock is
+// known. The position is kept in a file so a reset continues where it
+// stopped; records older than the log, appended before a reset that came
+// ahead of the position, are skipped. One in the second of the newest log
+// record, as the last batched sample, is kept.
+void backfillLog(void) {
+    File pendingLog = LittleFS.open(LOG_PENDING_FILE, "r");
+    File cursorFile = LittleFS.open(LOG_PENDING_CURSOR_FILE, "r");
+    int32_t values[LOG_CODEC_FIELDS_MAX];
+    uint32_t cursor = 0;
+
+    if (cursorFile) {
+        if (cursorFile.read((uint8_t *)&cursor, sizeof(cursor)) != sizeof(cursor))
+            cursor = 0;
+
+        cursorFile.close();
+    }
+
+    pendingLog.seek(min<size_t>(cursor, pendingLog.size()));
+
+    for (uint8_t i = 0; (i < LOG_BACKFILL_RECORDS) && (pendingLog.available() > 0); i++) {
+        String record = pendingLog.readStringUntil('\n');
+
+        if (record.indexOf(',') <= 0)
+            continue;
+
+        uint32_t epoch = pendingToEpoch(parseLogRecord(record.c_str(), values));
+
+        if (epoch < logStore.GetLastEpoch())
+            continue;
+
+        logStore.Append(epoch, values);
+        queueMqttSample(epoch, values[0], values[1], false);
+        loadProfile.Add(epoch, values[0]);
+        logBackfilled++;
+    }
+
+    bool done = (pendingLog.available() == 0);
+
+    cursor = pendingLog.position();
+    pendingLog.close();
+
+    if (done == false) {
+        cursorFile = LittleFS.open(LOG_PENDING_CURSOR_FILE, "w");
+        cursorFile.write((const uint8_t *)&cursor, sizeof(cursor));
+        cursorFile.close();
+        return;
+    }
+
+    LittleFS.remove(LOG_PENDING_FILE);
+    LittleFS.remove(LOG_PENDING_CURSOR_FILE);
+
+    Serial.printf("Back-filled %u log records, %u dropped\n", logBackfilled, logPendingDropped);
+
+    logPendingBase = 0;
+    logPendingDropped = 0;
+    logBackfilled = 0;
+}
+
+// A CSV log of an earlier firmware is compressed into the log store once
+void importLegacyLog(void) {
+    File legacyLog = LittleFS.open(LOG_LEGACY_FILE, "r");
+    int32_t values[LOG_CODEC_FIELDS_MAX];
+    uint32_t records = 0;
+
+    if (legacyLog == false)
+        return;
+
+    while (legacyLog.available()) {
+        String record = legacyLog.readStringUntil('\n');
+
+        if (record.indexOf(',') <= 0)
+            continue;
+
+        uint32_t epoch = parseLogRecord(record.c_str(), values);
+
+        if (logStore.Append(epoch, values) == true)
+            records++;
+    }
+
+    legacyLog.close();
+    LittleFS.remove(LOG_LEGACY_FILE);
+
+    Serial.printf("Imported %u records of %s\n", records, LOG_LEGACY_FILE);
+}
+
 bool loadFromSpiffs(String path) {
     String dataType = "text/plain";
     bool fileTransferStatus = false;
@@ -168,139 +843,1352 @@ bool loadFromSpiffs(String path) {
     else if (path.endsWith(".xml")) dataType = "text/xml";
     else if (path.endsWith(".pdf")) dataType = "application/pdf";
     else if (path.endsWith(".zip")) dataType = "application/zip";
+    else if (path.endsWith(".bin")) dataType = "application/octet-stream";
+
+    File dataFile = LittleFS.open(path.c_str(), "r");
+
+    if (!dataFile) {
+        return fileTransferStatus;
+    }
+    else {
+        if (httpServer.streamFile(dataFile, dataType) == dataFile.size()) {
+            fileTransferStatus = true;
+        }
+    }
+
+    dataFile.close();
+    return fileTransferStatus;
+}
+
+//=============================================================================
+// Webserver event handlers
+//=============================================================================
+void handleRoot(void) {
+    httpServer.sendHeader("Location", "/index.html", true);
+
+    // Redirect to our index.html web page
+    httpServer.send(302, "text/plain", "");
+}
+
+void handleFileList(void) {
+    // curl -X GET "ACCESSORY_NAME.local/list?path=/log&prefix=0000&after=00001234.bin&limit=50"
+
+    String path = httpServer.hasArg("path") ? httpServer.arg("path") : String("/");
+    String prefix = httpServer.arg("prefix");
+    String after = httpServer.arg("after");
+    uint32_t limit = httpServer.hasArg("limit") ? httpServer.arg("limit").toInt() : LIST_DEFAULT_LIMIT;
+
+    if ((path.startsWith("/") == false) || (limit == 0) || (limit > LIST_MAXIMUM_LIMIT)) {
+        httpServer.send(400, "text/plain", "Invalid list request");
+        return;
+    }
+
+    // The status has to be right before the chunked reply commits to 200
+    if (LittleFS.exists(path) == false) {
+        httpServer.send(404, "text/plain", "Directory not found");
+        return;
+    }
+
+    if (path.endsWith("/") == false)
+        path += "/";
+
+    // Names, sizes and times come from the directory entries, no file is
+    // opened; entries go out in chunks as they are found. LittleFS keeps
+    // them sorted by name, so the last name listed is the cursor of the
+    // next page and holds when files before it are added or removed.
+    Dir directoryEntry = LittleFS.openDir(path);
+    String listData = String();
+    String lastName = String();
+    uint32_t listed = 0;
+    bool more = false;
+
+    httpServer.setContentLength(CONTENT_LENGTH_UNKNOWN);
+    httpServer.send(200, "text/plain", "");
+
+    listData = "{\"path\":\"" + escapeJson(path) + "\",\"entries\":[";
+
+    while (directoryEntry.next()) {
+        String name = directoryEntry.fileName();
+
+        if (name.startsWith(prefix) == false)
+            continue;
+
+        if ((after.length() > 0) && (strcmp(name.c_str(), after.c_str()) <= 0))
+            continue;
+
+        // One entry past the page tells whether there is a next one
+        if (listed == limit) {
+            more = true;
+            break;
+        }
+
+        if (listed++ > 0)
+            listData += ",";
+
+        listData += "{\"name\":\"" + escapeJson(name) + "\",";
+
+        if (directoryEntry.isDirectory() == true) {
+            listData += "\"dir\":1}";
+        } else {
+            listData += "\"size\":" + String(directoryEntry.fileSize()) + ",";
+            listData += "\"mtime\":" + String((uint32_t)directoryEntry.fileTime()) + "}";
+        }
+
+        lastName = name;
+
+        if (listData.length() >= LIST_RESPONSE_CHUNK) {
+            httpServer.sendContent(listData);
+            listData = String();
+        }
+    }
+
+    listData += "],\"next\":" + ((more == true) ? ("\"" + escapeJson(lastName) + "\"") : String("null")) + "}";
+
+    httpServer.sendContent(listData);
+    httpServer.sendContent("");
+}
+
+// File times in the directory entries, the local epoch like the log
+time_t fileTimeCallback(void) {
+    return (timeService.IsSynced() == true) ? timeService.GetEpoch() : 0;
+}
+
+void handleFileUpload(void) {
+    // curl -X POST -F "file=@SomeFile.EXT" ACCESSORY_NAME.local/upload
+
+    HTTPUpload& upload = httpServer.upload();
+
+    if (upload.status == UPLOAD_FILE_START) {
+        String filename = upload.filename;
+
+        if (!filename.startsWith("/"))
+            filename = "/" + filename;
+
+        fsUploadFile = LittleFS.open(filename, "w");
+
+    } else if (upload.status == UPLOAD_FILE_WRITE) {
+
+        if(fsUploadFile)
+            fsUploadFile.write(upload.buf, upload.currentSize);
+
+    } else if (upload.status == UPLOAD_FILE_END) {
+
+        if(fsUploadFile)
+            fsUploadFile.close();
+    }
+}
+
+void handleFileDelete(void) {
+
+    String fileDeleteResponse = String();
+    String fileName = httpServer.arg(0);
+
+    if (LittleFS.exists(fileName)) {
+        if (LittleFS.remove(fileName)) {
+            fileDeleteResponse = "{\"success\":1}";
+        }
+        else {
+            fileDeleteResponse = "{\"file does not exist\":1}";
+        }
+    }
+    else {
+        fileDeleteResponse = "{\"unable to open file\":1}";
+    }
+
+    httpServer.send(200, "text/plain", fileDeleteResponse);
+}
+
+void handleWebRequests(void) {
+    String message = "File Not Detected\n\n";
+
+    if (loadFromSpiffs(httpServer.uri()))
+        return;
+
+    message += "URI: ";
+    message += httpServer.uri();
+    message += "\nMethod: ";
+    message += (httpServer.method() == HTTP_GET) ? "GET" : "POST";
+    message += "\nArguments: ";
+    message += httpServer.args();
+    message += "\n";
+
+    for (uint8_t i = 0; i < httpServer.args(); i++) {
+        message += " NAME:" + httpServer.argName(i);
+        message += "\n VALUE:" + httpServer.arg(i) + "\n";
+    }
+
+    httpServer.send(404, "text/plain", message);
+}
+
+void handleBeeper() {
+    // curl -X POST ACCESSORY_NAME.local/beeper?count={BEEPS}"
+
+    String beeperRequestResponse = String();
+
+    if (beeper.GetBeeperState() == beepHandlerIdle) {
+        if (httpServer.hasArg("count")) {
+            beeper.RequestBeeper(httpServer.arg("count").toInt());
+
+            beeperRequestResponse = "{\"success\":1}";
+        } else {
+            beeperRequestResponse = "{\"no count specified\":1}";
+        }
+    }
+    else {
+        beeperRequestResponse = "{\"busy\":1}";
+    }
+
+    httpServer.send(200, "text/plain", beeperRequestResponse);
+}
+
+void handleConfig(void) {
+    // curl -X POST ACCESSORY_NAME.local/config -d "channel=0&pulsesPerKwh=1000"
+
+    meterConfig_s *meterConfig = configStore.GetMeterConfig();
+    powerConfig_s *powerConfig = configStore.GetPowerConfig();
+    bool restartRequired = false;
+
+    if (httpServer.method() == HTTP_POST) {
+        meterConfig_s updatedConfig = *meterConfig;
+        powerConfig_s updatedPowerConfig = *powerConfig;
+        long channel = 0;
+        long channelCount = updatedConfig.channelCount;
+        bool valid = true;
+
+        // Both are range checked as parsed, before narrowing into the config
+        if (httpServer.hasArg("channel"))
+            channel = httpServer.arg("channel").toInt();
+
+        if (httpServer.hasArg("channels"))
+            channelCount = httpServer.arg("channels").toInt();
+
+        if ((channelCount >= 1) && (channelCount <= IMPULSE_CHANNELS_MAX))
+            updatedConfig.channelCount = channelCount;
+
+        if (httpServer.hasArg("logInterval"))
+            updatedConfig.logInterval = httpServer.arg("logInterval").toInt();
+
+        if (httpServer.hasArg("minimumWatt"))
+            updatedConfig.minimumWatt = httpServer.arg("minimumWatt").toInt();
+
+        if (httpServer.hasArg("maximumWatt"))
+            updatedConfig.maximumWatt = httpServer.arg("maximumWatt").toInt();
+
+        if (httpServer.hasArg("estimator"))
+            updatedConfig.estimator = (httpServer.arg("estimator") == "average") ? impulseEstimatorAverage : impulseEstimatorInstant;
+
+        if (httpServer.hasArg("pulses"))
+            updatedConfig.averagePulses = constrain(httpServer.arg("pulses").toInt(), 1, IMPULSE_AVERAGE_PULSES_MAX);
+
+        if (httpServer.hasArg("decay"))
+            updatedConfig.decay = (httpServer.arg("decay").toInt() != 0);
+
+        if (httpServer.hasArg("batchMode"))
+            updatedPowerConfig.batchMode = (httpServer.arg("batchMode").toInt() != 0);
+
+        if (httpServer.hasArg("sampleInterval"))
+            updatedPowerConfig.sampleInterval = constrain(httpServer.arg("sampleInterval").toInt(), 0, UINT16_MAX);
+
+        if (httpServer.hasArg("flushInterval"))
+            updatedPowerConfig.flushInterval = constrain(httpServer.arg("flushInterval").toInt(), 0, UINT16_MAX);
+
+        if (httpServer.hasArg("awakeWindow"))
+            updatedPowerConfig.awakeWindow = constrain(httpServer.arg("awakeWindow").toInt(), 0, UINT16_MAX);
+
+        // A batch has to fit RTC memory, and only the main meter is sampled
+        valid = (updatedPowerConfig.sampleInterval >= CONFIG_MINIMUM_SAMPLE_INTERVAL) &&
+                (updatedPowerConfig.awakeWindow >= CONFIG_MINIMUM_AWAKE_WINDOW) &&
+                (updatedPowerConfig.flushInterval >= 1) &&
+                (((updatedPowerConfig.flushInterval * 60UL) / updatedPowerConfig.sampleInterval) <= SAMPLE_BATCH_SAMPLES_MAX) &&
+                ((updatedPowerConfig.batchMode == 0) || (updatedConfig.channelCount == 1));
+
+        valid = valid && (channel >= 0) && (channel < IMPULSE_CHANNELS_MAX) &&
+                (channelCount >= 1) && (channelCount <= IMPULSE_CHANNELS_MAX) &&
+                (updatedConfig.logInterval >= CONFIG_MINIMUM_LOG_INTERVAL) &&
+                (updatedConfig.minimumWatt >= 1) && (updatedConfig.maximumWatt > updatedConfig.minimumWatt);
+
+        if ((valid == true) && httpServer.hasArg("pulsesPerKwh")) {
+            updatedConfig.channels[channel].pulsesPerKilowattHour = httpServer.arg("pulsesPerKwh").toInt();
+            valid = (updatedConfig.channels[channel].pulsesPerKilowattHour > 0);
+        }
+
+        if ((valid == true) && httpServer.hasArg("name"))
+            valid = isValidName(httpServer.arg("name"), CONFIG_CHANNEL_NAME_MAX);
+
+        if ((valid == true) && httpServer.hasArg("name")) {
+            strncpy(updatedConfig.channels[channel].name, httpServer.arg("name").c_str(), CONFIG_CHANNEL_NAME_MAX - 1);
+            updatedConfig.channels[channel].name[CONFIG_CHANNEL_NAME_MAX - 1] = '\0';
+        }
+
+        if ((valid == true) && httpServer.hasArg("pin")) {
+            long pin = httpServer.arg("pin").toInt();
+
+            valid = (pin >= 0) && (pin < IMPULSE_PIN_NONE);
+            updatedConfig.channels[channel].pin = pin;
+        }
+
+        // Every channel in use, the edited one included, on a free and
+        // distinct pin; a bad pin would be bound at every boot
+        for (uint8_t i = 0; (valid == true) && (i < updatedConfig.channelCount); i++) {
+            valid = isImpulsePinFree(&updatedConfig, i);
+        }
+
+        if (valid == false) {
+            httpServer.send(400, "text/plain", "Invalid meter configuration");
+            return;
+        }
+
+        // Pins and the number of channels are bound to interrupts at boot
+        for (uint8_t i = 0; i < IMPULSE_CHANNELS_MAX; i++) {
+            if (updatedConfig.channels[i].pin != meterConfig->channels[i].pin)
+                restartRequired = true;
+        }
+
+        if (updatedConfig.channelCount != meterConfig->channelCount)
+            restartRequired = true;
+
+        *meterConfig = updatedConfig;
+        *powerConfig = updatedPowerConfig;
+
+        if (configStore.Save() == false) {
+            httpServer.send(500, "text/plain", "Unable to save meter configuration");
+            return;
+        }
+
+        applyMeterConfig();
+    }
+
+    String configData = String();
+
+    configData = "{";
+    configData += "\"logInterval\":" + String(meterConfig->logInterval) + ",";
+    configData += "\"minimumWatt\":" + String(meterConfig->minimumWatt) + ",";
+    configData += "\"maximumWatt\":" + String(meterConfig->maximumWatt) + ",";
+    configData += "\"estimator\":\"" + String((meterConfig->estimator == impulseEstimatorAverage) ? "average" : "instant") + "\",";
+    configData += "\"pulses\":" + String(meterConfig->averagePulses) + ",";
+    configData += "\"decay\":" + String(meterConfig->decay ? "true" : "false") + ",";
+    configData += "\"batchMode\":" + String(powerConfig->batchMode ? "true" : "false") + ",";
+    configData += "\"sampleInterval\":" + String(powerConfig->sampleInterval) + ",";
+    configData += "\"flushInterval\":" + String(powerConfig->flushInterval) + ",";
+    configData += "\"awakeWindow\":" + String(powerConfig->awakeWindow) + ",";
+    configData += "\"batchSamples\":" + String(sampleBatch.GetCount()) + ",";
+    configData += "\"restartRequired\":" + String(restartRequired ? "true" : "false") + ",";
+    configData += "\"channels\":[";
+
+    for (uint8_t i = 0; i < meterConfig->channelCount; i++) {
+        if (i > 0)
+            configData += ",";
+
+        configData += "{\"name\":\"" + escapeJson(meterConfig->channels[i].name) + "\",";
+        configData += "\"pin\":" + String(meterConfig->channels[i].pin) + ",";
+        configData += "\"pulsesPerKwh\":" + String(meterConfig->channels[i].pulsesPerKilowattHour) + "}";
+    }
+
+    configData += "]}";
+
+    httpServer.send(200, "text/plain", configData);
+}
+
+bool parseAddress(const char *argument, uint32_t *address) {
+    IPAddress parsedAddress;
+
+    if (!httpServer.hasArg(argument))
+        return true;
+
+    if (parsedAddress.fromString(httpServer.arg(argument)) == false)
+        return false;
+
+    *address = (uint32_t)parsedAddress;
+
+    return true;
+}
+
+void handleNetwork(void) {
+    // curl -X POST ACCESSORY_NAME.local/network -d "ssid=Home&password=Secret&hostname=PowerMeter"
+
+    networkConfig_s *networkConfig = configStore.GetNetworkConfig();
+    bool restartRequired = false;
+
+    if (httpServer.method() == HTTP_POST) {
+        networkConfig_s updatedConfig = *networkConfig;
+        bool valid = true;
+
+        if (httpServer.hasArg("ssid")) {
+            valid &= (httpServer.arg("ssid").length() < CONFIG_SSID_MAX);
+            strncpy(updatedConfig.ssid, httpServer.arg("ssid").c_str(), CONFIG_SSID_MAX - 1);
+        }
+
+        if (httpServer.hasArg("password")) {
+            valid &= (httpServer.arg("password").length() < CONFIG_PASSWORD_MAX);
+            strncpy(updatedConfig.password, httpServer.arg("password").c_str(), CONFIG_PASSWORD_MAX - 1);
+        }
+
+        if (httpServer.hasArg("hostname")) {
+            valid &= (httpServer.arg("hostname").length() > 0) && (httpServer.arg("hostname").length() < CONFIG_HOSTNAME_MAX);
+            strncpy(updatedConfig.hostname, httpServer.arg("hostname").c_str(), CONFIG_HOSTNAME_MAX - 1);
+        }
+
+        if (httpServer.hasArg("ntpServer")) {
+            valid &= (httpServer.arg("ntpServer").length() > 0) && (httpServer.arg("ntpServer").length() < CONFIG_NTP_SERVER_MAX);
+            strncpy(updatedConfig.ntpServer, httpServer.arg("ntpServer").c_str(), CONFIG_NTP_SERVER_MAX - 1);
+        }
+
+        if (httpServer.hasArg("utcOffset")) {
+            updatedConfig.utcOffset = httpServer.arg("utcOffset").toInt();
+            valid &= (abs(updatedConfig.utcOffset) <= (14 * SECONDS_PER_HOUR));
+        }
+
+        if (httpServer.hasArg("staticIp"))
+            updatedConfig.staticIp = (httpServer.arg("staticIp").toInt() != 0);
+
+        valid &= parseAddress("ip", &updatedConfig.ipAddress) &&
+                 parseAddress("gateway", &updatedConfig.gateway) &&
+                 parseAddress("netmask", &updatedConfig.netmask) &&
+                 parseAddress("dns", &updatedConfig.dns);
+
+        if ((updatedConfig.staticIp != 0) && ((updatedConfig.ipAddress == 0) || (updatedConfig.netmask == 0)))
+            valid = false;
+
+        if (valid == false) {
+            httpServer.send(400, "text/plain", "Invalid network configuration");
+            return;
+        }
+
+        updatedConfig.ssid[CONFIG_SSID_MAX - 1] = '\0';
+        updatedConfig.password[CONFIG_PASSWORD_MAX - 1] = '\0';
+        updatedConfig.hostname[CONFIG_HOSTNAME_MAX - 1] = '\0';
+        updatedConfig.ntpServer[CONFIG_NTP_SERVER_MAX - 1] = '\0';
+
+        // Only the time settings take effect without a restart
+        restartRequired = (memcmp(networkConfig, &updatedConfig, offsetof(networkConfig_s, ntpServer)) != 0) ||
+                          (memcmp(&networkConfig->staticIp, &updatedConfig.staticIp,
+                                  sizeof(networkConfig_s) - offsetof(networkConfig_s, staticIp)) != 0);
+
+        *networkConfig = updatedConfig;
+
+        if (configStore.Save() == false) {
+            httpServer.send(500, "text/plain", "Unable to save network configuration");
+            return;
+        }
+
+        timeService.SetServer(networkConfig->ntpServer);
+        timeService.SetOffset(networkConfig->utcOffset);
+    }
+
+    // The password is never reported back
+    String networkData = String();
+
+    networkData = "{";
+    networkData += "\"ssid\":\"" + escapeJson(networkConfig->ssid) + "\",";
+    networkData += "\"passwordSet\":" + String((networkConfig->password[0] != '\0') ? "true" : "false") + ",";
+    networkData += "\"hostname\":\"" + escapeJson(networkConfig->hostname) + "\",";
+    networkData += "\"ntpServer\":\"" + escapeJson(networkConfig->ntpServer) + "\",";
+    networkData += "\"utcOffset\":" + String(networkConfig->utcOffset) + ",";
+    networkData += "\"staticIp\":" + String((networkConfig->staticIp != 0) ? "true" : "false") + ",";
+    networkData += "\"ip\":\"" + IPAddress(networkConfig->ipAddress).toString() + "\",";
+    networkData += "\"gateway\":\"" + IPAddress(networkConfig->gateway).toString() + "\",";
+    networkData += "\"netmask\":\"" + IPAddress(networkConfig->netmask).toString() + "\",";
+    networkData += "\"dns\":\"" + IPAddress(networkConfig->dns).toString() + "\",";
+    networkData += "\"sequence\":" + String(configStore.GetSequence()) + ",";
+    networkData += "\"restartRequired\":" + String(restartRequired ? "true" : "false") + "}";
+
+    httpServer.send(200, "text/plain", networkData);
+}
+
+void handleSensor(void) {
+    // curl -X GET ACCESSORY_NAME.local/sensor
+
+    String sensorData = String();
+    const dhtReading_s *reading = sensorCache.GetReading();
+
+    demandSensor();
+
+    sensorData = "{";
+    // NaN is not JSON, a sensor that never answered reads null
+    sensorData += "\"temperature\":" + ((sensorCache.IsValid() == true) ? String(reading->temperature) : String("null")) + ",";
+    sensorData += "\"humidity\":" + ((sensorCache.IsValid() == true) ? String(reading->humidity) : String("null")) + ",";
+    sensorData += "\"valid\":" + String((sensorCache.IsValid() == true) ? "true" : "false") + ",";
+    sensorData += "\"stale\":" + String((sensorCache.IsStale() == true) ? "true" : "false") + ",";
+    sensorData += "\"ageMs\":" + String((sensorCache.IsValid() == true) ? String(sensorCache.GetAge()) : String("null")) + ",";
+    sensorData += "\"pollInterval\":" + String(sensorCache.GetPollInterval()) + ",";
+    sensorData += "\"reads\":" + String(sensorCache.GetReadCount()) + ",";
+    sensorData += "\"errors\":" + String(sensorCache.GetErrorCount()) + ",";
+    sensorData += "\"consecutiveErrors\":" + String(sensorCache.GetConsecutiveErrors());
+    sensorData += "}";
+
+    httpServer.send(200, "text/plain", sensorData);
+}
+
+void handleTime(void) {
+    // curl -X GET ACCESSORY_NAME.local/time
+
+    String timeData = String();
+
+    timeData = "{";
+    timeData += "\"synced\":" + String((timeService.IsSynced() == true) ? "true" : "false") + ",";
+    timeData += "\"epoch\":" + String(timeService.GetEpoch()) + ",";
+    timeData += "\"uptimeMs\":" + String((uint32_t)timeService.GetUptimeMs()) + ",";
+    timeData += "\"syncs\":" + String(timeService.GetSyncCount()) + ",";
+    timeData += "\"failures\":" + String(timeService.GetFailureCount()) + ",";
+    timeData += "\"lastSyncAgeMs\":" + String((timeService.IsSynced() == true) ? String((uint32_t)(timeService.GetUptimeMs() - timeService.GetLastSyncUptime())) : String("null")) + ",";
+    timeData += "\"roundTripMs\":" + String(timeService.GetLastRoundTrip()) + ",";
+    timeData += "\"lastCorrectionMs\":" + String(timeService.GetLastCorrection()) + ",";
+    timeData += "\"pendingSlewMs\":" + String(timeService.GetPendingSlew());
+    timeData += "}";
+
+    httpServer.send(200, "text/plain", timeData);
+}
+
+void handleLog(void) {
+    // curl -X GET ACCESSORY_NAME.local/log.csv?from=EPOCH&to=EPOCH
+
+    uint32_t from = httpServer.hasArg("from") ? strtoul(httpServer.arg("from").c_str(), NULL, 10) : 0;
+    uint32_t to = httpServer.hasArg("to") ? strtoul(httpServer.arg("to").c_str(), NULL, 10) : UINT32_MAX;
+    char path[LOG_STORE_PATH_MAX];
+    int32_t values[LOG_CODEC_FIELDS_MAX];
+    uint32_t epoch;
+    LogReader reader;
+    String logData = String();
+
+    // Decoded block by block into CSV, sent in chunks of about 1 kB
+    httpServer.setContentLength(CONTENT_LENGTH_UNKNOWN);
+    httpServer.send(200, "text/plain", "");
+
+    for (uint32_t sequence = logStore.GetFirstBlock(); (sequence > 0) && (sequence <= logStore.GetLastBlock()); sequence++) {
+        logStore.GetBlockPath(sequence, path);
+
+        if (reader.Open(path) == false)
+            continue;
+
+        while (reader.Next(&epoch, values) == true) {
+            if ((epoch < from) || (epoch > to))
+                continue;
+
+            logData += String(epoch);
+
+            for (uint8_t i = 0; i < reader.GetFieldCount(); i++) {
+                logData += ',' + String(values[i]);
+            }
+
+            logData += '\n';
+
+            if (logData.length() >= LOG_RESPONSE_CHUNK) {
+                httpServer.sendContent(logData);
+                logData = String();
+            }
+        }
+
+        reader.Close();
+    }
+
+    if (logData.length() > 0)
+        httpServer.sendContent(logData);
+
+    httpServer.sendContent("");
+}
+
+void handleLogIndex(void) {
+    // curl -X GET ACCESSORY_NAME.local/log/index
+
+    char path[LOG_STORE_PATH_MAX];
+    String indexData = String();
+
+    indexData = "{";
+    indexData += "\"fields\":" + String(logStore.GetFieldCount()) + ",";
+    indexData += "\"blocks\":[";
+
+    for (uint32_t sequence = logStore.GetFirstBlock(); (sequence > 0) && (sequence <= logStore.GetLastBlock()); sequence++) {
+        logStore.GetBlockPath(sequence, path);
+
+        File blockFile = LittleFS.open(path, "r");
+
+        if (blockFile == false)
+            continue;
+
+        if (indexData.endsWith("[") == false)
+            indexData += ",";
+
+        indexData += "{\"path\":\"" + String(path) + "\",\"size\":" + String(blockFile.size()) + "}";
+        blockFile.close();
+    }
+
+    indexData += "]}";
+    httpServer.send(200, "text/plain", indexData);
+}
+
+void handleMqtt(void) {
+    // curl -X POST ACCESSORY_NAME.local/mqtt -d "enabled=1&host=broker.local&qos=1&batch=6"
+
+    mqttConfig_s *mqttConfig = configStore.GetMqttConfig();
+
+    if (httpServer.method() == HTTP_POST) {
+        mqttConfig_s updatedConfig = *mqttConfig;
+        bool valid = true;
+
+        if (httpServer.hasArg("enabled"))
+            updatedConfig.enabled = (httpServer.arg("enabled").toInt() != 0);
+
+        if (httpServer.hasArg("host")) {
+            valid &= (httpServer.arg("host").length() < CONFIG_MQTT_HOST_MAX);
+            strncpy(updatedConfig.host, httpServer.arg("host").c_str(), CONFIG_MQTT_HOST_MAX - 1);
+        }
+
+        if (httpServer.hasArg("port")) {
+            updatedConfig.port = constrain(httpServer.arg("port").toInt(), 0, UINT16_MAX);
+            valid &= (updatedConfig.port > 0);
+        }
+
+        if (httpServer.hasArg("username")) {
+            valid &= (httpServer.arg("username").length() < CONFIG_MQTT_USERNAME_MAX);
+            strncpy(updatedConfig.username, httpServer.arg("username").c_str(), CONFIG_MQTT_USERNAME_MAX - 1);
+        }
+
+        if (httpServer.hasArg("password")) {
+            valid &= (httpServer.arg("password").length() < CONFIG_MQTT_PASSWORD_MAX);
+            strncpy(updatedConfig.password, httpServer.arg("password").c_str(), CONFIG_MQTT_PASSWORD_MAX - 1);
+        }
+
+        if (httpServer.hasArg("topic")) {
+            valid &= (httpServer.arg("topic").length() > 0) && (httpServer.arg("topic").length() < CONFIG_MQTT_TOPIC_MAX);
+            strncpy(updatedConfig.topic, httpServer.arg("topic").c_str(), CONFIG_MQTT_TOPIC_MAX - 1);
+        }
+
+        if (httpServer.hasArg("qos")) {
+            updatedConfig.qos = httpServer.arg("qos").toInt();
+            valid &= (updatedConfig.qos <= 1);
+        }
+
+        if (httpServer.hasArg("batch")) {
+            updatedConfig.batchSize = httpServer.arg("batch").toInt();
+            valid &= (updatedConfig.batchSize >= 1) && (updatedConfig.batchSize <= CONFIG_MAXIMUM_MQTT_BATCH);
+        }
+
+        valid &= (updatedConfig.enabled == 0) || (updatedConfig.host[0] != '\0');
+
+        if (valid == false) {
+            httpServer.send(400, "text/plain", "Invalid MQTT configuration");
+            return;
+        }
+
+        updatedConfig.host[CONFIG_MQTT_HOST_MAX - 1] = '\0';
+        updatedConfig.username[CONFIG_MQTT_USERNAME_MAX - 1] = '\0';
+        updatedConfig.password[CONFIG_MQTT_PASSWORD_MAX - 1] = '\0';
+        updatedConfig.topic[CONFIG_MQTT_TOPIC_MAX - 1] = '\0';
+
+        // A changed broker, account or topic needs a new session
+        bool reconnect = (strcmp(updatedConfig.username, mqttConfig->username) != 0) ||
+                         (strcmp(updatedConfig.password, mqttConfig->password) != 0) ||
+                         (strcmp(updatedConfig.topic, mqttConfig->topic) != 0);
+
+        *mqttConfig = updatedConfig;
+
+        if (configStore.Save() == false) {
+            httpServer.send(500, "text/plain", "Unable to save MQTT configuration");
+            return;
+        }
+
+        if (reconnect == true)
+            mqttClient.Disconnect();
+
+        applyMqttConfig();
+    }
+
+    // The password is never reported back
+    String mqttData = String();
+
+    mqttData = "{";
+    mqttData += "\"enabled\":" + String((mqttConfig->enabled != 0) ? "true" : "false") + ",";
+    mqttData += "\"host\":\"" + escapeJson(mqttConfig->host) + "\",";
+    mqttData += "\"port\":" + String(mqttConfig->port) + ",";
+    mqttData += "\"username\":\"" + escapeJson(mqttConfig->username) + "\",";
+    mqttData += "\"passwordSet\":" + String((mqttConfig->password[0] != '\0') ? "true" : "false") + ",";
+    mqttData += "\"topic\":\"" + escapeJson(mqttConfig->topic) + "\",";
+    mqttData += "\"qos\":" + String(mqttConfig->qos) + ",";
+    mqttData += "\"batch\":" + String(mqttConfig->batchSize) + ",";
+    mqttData += "\"connected\":" + String((mqttClient.IsConnected() == true) ? "true" : "false") + ",";
+    mqttData += "\"queued\":" + String(mqttOutbox.GetCount()) + ",";
+    mqttData += "\"stored\":" + String(mqttOutbox.GetStoredCount()) + ",";
+    mqttData += "\"segments\":" + String(mqttOutbox.GetSegmentCount()) + ",";
+    mqttData += "\"dropped\":" + String(mqttOutbox.GetDroppedCount()) + ",";
+    mqttData += "\"publishes\":" + String(mqttClient.GetPublishCount()) + ",";
+    mqttData += "\"connects\":" + String(mqttClient.GetConnectCount()) + ",";
+    mqttData += "\"failures\":" + String(mqttClient.GetFailureCount()) + ",";
+    mqttData += "\"retryMs\":" + String(mqttClient.GetRetryInterval());
+    mqttData += "}";
+
+    httpServer.send(200, "text/plain", mqttData);
+}
+
+void handleAlerts(void) {
+    // curl -X POST ACCESSORY_NAME.local/alerts -d "rule=0&type=sustained&watts=3000&duration=600&beeps=3"
+
+    alertConfig_s *alertConfig = configStore.GetAlertConfig();
+    uint32_t since = 0;
+
+    if (httpServer.method() == HTTP_POST) {
+        uint8_t index = httpServer.arg("rule").toInt();
+        bool valid = httpServer.hasArg("rule") && (index < ALERT_RULES_MAX);
+
+        if (valid == false) {
+            httpServer.send(400, "text/plain", "Invalid alert rule");
+            return;
+        }
+
+        alertRule_s updatedRule = alertConfig->rules[index];
+
+        if (httpServer.hasArg("type")) {
+            valid = false;
+
+            for (uint8_t i = 0; i <= alertRuleNightBaseload; i++) {
+                if (httpServer.arg("type") == alertRuleNames[i]) {
+                    updatedRule.type = i;
+                    valid = true;
+                }
+            }
+        }
+
+        if (httpServer.hasArg("watts"))
+            updatedRule.watts = constrain(httpServer.arg("watts").toInt(), 0, MAXIMUM_WATT_SUPPORTED);
+
+        if (httpServer.hasArg("duration"))
+            updatedRule.duration = constrain(httpServer.arg("duration").toInt(), 0, UINT16_MAX);
+
+        if (httpServer.hasArg("beeps"))
+            updatedRule.beeps = constrain(httpServer.arg("beeps").toInt(), 0, CONFIG_MAXIMUM_ALERT_BEEPS);
+
+        if (httpServer.hasArg("start"))
+            updatedRule.startHour = constrain(httpServer.arg("start").toInt(), 0, 23);
+
+        if (httpServer.hasArg("end"))
+            updatedRule.endHour = constrain(httpServer.arg("end").toInt(), 0, 23);
+
+        // An unused slot needs nothing else, a night window can't be empty
+        valid = valid && ((updatedRule.type == alertRuleNone) || (updatedRule.watts > 0)) &&
+                ((updatedRule.type != alertRuleSustained) || (updatedRule.duration > 0)) &&
+                ((updatedRule.type != alertRuleNightBaseload) || (updatedRule.startHour != updatedRule.endHour));
+
+        if (valid == false) {
+            httpServer.send(400, "text/plain", "Invalid alert rule");
+            return;
+        }
+
+        alertConfig->rules[index] = updatedRule;
+
+        if (configStore.Save() == false) {
+            httpServer.send(500, "text/plain", "Unable to save alert rule");
+            return;
+        }
+
+        alertEngine.SetRule(index, &updatedRule);
+    }
+
+    // Clients poll with the sequence of the last response to get only new events
+    if (httpServer.hasArg("since"))
+        since = strtoul(httpServer.arg("since").c_str(), NULL, 10);
+
+    since = max(since, alertEngine.GetSequence() - min<uint32_t>(alertEngine.GetSequence(), ALERT_EVENTS_MAX));
+
+    String alertData = String();
+
+    alertData = "{\"rules\":[";
+
+    for (uint8_t i = 0, listed = 0; i < ALERT_RULES_MAX; i++) {
+        const alertRule_s *rule = alertEngine.GetRule(i);
+
+        if (rule->type == alertRuleNone)
+            continue;
+
+        if (listed++ > 0)
+            alertData += ",";
+
+        alertData += "{\"rule\":" + String(i) + ",";
+        alertData += "\"type\":\"" + String(alertRuleNames[rule->type]) + "\",";
+        alertData += "\"watts\":" + String(rule->watts) + ",";
+        alertData += "\"duration\":" + String(rule->duration) + ",";
+        alertData += "\"beeps\":" + String(rule->beeps) + ",";
+        alertData += "\"start\":" + String(rule->startHour) + ",";
+        alertData += "\"end\":" + String(rule->endHour) + ",";
+        alertData += "\"active\":" + String((alertEngine.IsActive(i) == true) ? "true" : "false") + "}";
+    }
+
+    alertData += "],\"sequence\":" + String(alertEngine.GetSequence()) + ",";
+    alertData += "\"events\":[";
+
+    for (uint32_t sequence = since, listed = 0; sequence < alertEngine.GetSequence(); sequence++) {
+        const alertEvent_s *event = alertEngine.GetEvent(sequence);
+
+        if (listed++ > 0)
+            alertData += ",";
+
+        alertData += "{\"seq\":" + String(event->sequence) + ",";
+        alertData += "\"t\":" + String(event->epoch) + ",";
+        alertData += "\"rule\":" + String(event->rule) + ",";
+        alertData += "\"type\":\"" + String(alertRuleNames[event->type]) + "\",";
+        alertData += "\"raised\":" + String((event->raised != 0) ? "true" : "false") + ",";
+        alertData += "\"w\":" + String(event->watts) + "}";
+    }
+
+    alertData += "]}";
+
+    httpServer.send(200, "text/plain", alertData);
+}
+
+// "HH:MM" on a half hour to the schedule slot, 24:00 is the end of the day;
+// -1 when it is not a slot boundary
+int8_t parseTariffSlot(const String &time) {
+    int separator = time.indexOf(':');
+
+    if (separator < 1)
+        return -1;
+
+    long hours = time.substring(0, separator).toInt();
+    long minutes = time.substring(separator + 1).toInt();
+
+    if ((hours < 0) || (hours > 24) || ((minutes != 0) && (minutes != 30)) || ((hours == 24) && (minutes != 0)))
+        return -1;
+
+    return (hours * 2) + (minutes / 30);
+}
+
+// Energy per rate in kWh and the cost of a day or month
+String formatTariffTotal(const tariffTotal_s *total) {
+    String totalData = String();
+
+    totalData = "\"kwh\":[";
+
+    for (uint8_t i = 0; i < TARIFF_RATES_MAX; i++) {
+        if (i > 0)
+            totalData += ",";
+
+        totalData += String((total != NULL) ? (total->energy[i] / 1000000.0) : 0.0, 3);
+    }
+
+    totalData += "],\"estimatedKwh\":" + String((total != NULL) ? (total->estimated / 1000000.0) : 0.0, 3);
+    totalData += ",\"cost\":" + String((total != NULL) ? ((double)total->cost / TARIFF_COST_SCALE) : 0.0, 4);
+
+    return totalData;
+}
+
+void handleTariff(void) {
+    // curl -X POST ACCESSORY_NAME.local/tariff -d "rate=1&name=peak&price=0.3512"
+    // curl -X POST ACCESSORY_NAME.local/tariff -d "rate=1&day=weekday&from=07:00&to=23:00"
+
+    tariffSchedule_s *tariffConfig = configStore.GetTariffConfig();
+
+    if (httpServer.method() == HTTP_POST) {
+        tariffSchedule_s updatedConfig = *tariffConfig;
+        uint8_t rate = httpServer.arg("rate").toInt();
+        bool valid = httpServer.hasArg("rate") && (rate < TARIFF_RATES_MAX);
+
+        if ((valid == true) && httpServer.hasArg("name")) {
+            valid = (httpServer.arg("name").length() > 0) && (httpServer.arg("name").length() < TARIFF_RATE_NAME_MAX);
+            strncpy(updatedConfig.rates[rate].name, httpServer.arg("name").c_str(), TARIFF_RATE_NAME_MAX - 1);
+        }
+
+        // Currency per kWh, kept to 1/10000
+        if ((valid == true) && httpServer.hasArg("price")) {
+            double price = httpServer.arg("price").toFloat();
+
+            valid = (price >= 0) && (price < ((double)UINT32_MAX / TARIFF_PRICE_SCALE));
+            updatedConfig.rates[rate].price = lround(price * TARIFF_PRICE_SCALE);
+        }
+
+        // The rate applies from the start of the from slot up to the to slot,
+        // wrapping midnight when to is earlier
+        if ((valid == true) && (httpServer.hasArg("from") || httpServer.hasArg("to"))) {
+            int8_t fromSlot = parseTariffSlot(httpServer.arg("from"));
+            int8_t toSlot = parseTariffSlot(httpServer.arg("to"));
+            String day = httpServer.hasArg("day") ? httpServer.arg("day") : String("all");
+
+            valid = (fromSlot >= 0) && (fromSlot < TARIFF_SLOTS_PER_DAY) && (toSlot >= 0) && (fromSlot != toSlot) &&
+                    ((day == "all") || (day == "weekday") || (day == "weekend"));
+
+            for (uint8_t slot = fromSlot; (valid == true) && (slot != toSlot); slot = (slot + 1) % TARIFF_SLOTS_PER_DAY) {
+                if (day != "weekend")
+                    updatedConfig.schedule[tariffDayWeekday][slot] = rate;
+
+                if (day != "weekday")
+                    updatedConfig.schedule[tariffDayWeekend][slot] = rate;
+
+                // 24:00 ends with the last slot
+                if ((toSlot == TARIFF_SLOTS_PER_DAY) && (slot == (TARIFF_SLOTS_PER_DAY - 1)))
+                    break;
+            }
+        }
+
+        if (valid == false) {
+            httpServer.send(400, "text/plain", "Invalid tariff configuration");
+            return;
+        }
+
+        updatedConfig.rates[rate].name[TARIFF_RATE_NAME_MAX - 1] = '\0';
+        *tariffConfig = updatedConfig;
+
+        if (configStore.Save() == false) {
+            httpServer.send(500, "text/plain", "Unable to save tariff configuration");
+            return;
+        }
+    }
+
+    // History ends at the newest booked day, today once the time is known
+    uint32_t lastDay = tariffLedger.GetLastDay();
+    bool synced = timeService.IsSynced();
+
+    if (synced == true)
+        lastDay = max(lastDay, TariffLedger::GetDayNumber(timeService.GetEpoch()));
+
+    String tariffData = String();
+
+    tariffData = "{";
+    tariffData += "\"rate\":" + ((synced == true) ? String(tariffLedger.GetRate(timeService.GetEpoch())) : String("null")) + ",";
+    tariffData += "\"pendingPulses\":" + String(tariffLedger.GetPendingPulses()) + ",";
+    tariffData += "\"rates\":[";
+
+    for (uint8_t i = 0; i < TARIFF_RATES_MAX; i++) {
+        if (i > 0)
+            tariffData += ",";
+
+        tariffData += "{\"name\":\"" + escapeJson(tariffConfig->rates[i].name) + "\",";
+        tariffData += "\"price\":" + String((double)tariffConfig->rates[i].price / TARIFF_PRICE_SCALE, 4) + "}";
+    }
+
+    // One rate digit per half hour from midnight
+    tariffData += "],\"schedule\":{";
+
+    for (uint8_t dayType = 0; dayType < TARIFF_DAY_TYPES; dayType++) {
+        tariffData += (dayType == tariffDayWeekday) ? "\"weekday\":\"" : ",\"weekend\":\"";
+
+        for (uint8_t slot = 0; slot < TARIFF_SLOTS_PER_DAY; slot++) {
+            tariffData += String(tariffConfig->schedule[dayType][slot]);
+        }
+
+        tariffData += "\"";
+    }
+
+    tariffData += "},\"days\":[";
+
+    for (uint32_t day = lastDay - min<uint32_t>(lastDay, TARIFF_DAYS_KEPT - 1), listed = 0; (lastDay > 0) && (day <= lastDay); day++) {
+        const tariffTotal_s *total = tariffLedger.GetDay(day);
+        uint16_t year;
+        uint8_t month;
+        uint8_t dayOfMonth;
+        char date[16];
+
+        if (total == NULL)
+            continue;
+
+        TariffLedger::GetDate(day, &year, &month, &dayOfMonth);
+        snprintf(date, sizeof(date), "%04u-%02u-%02u", year, month, dayOfMonth);
+
+        if (listed++ > 0)
+            tariffData += ",";
+
+        tariffData += "{\"date\":\"" + String(date) + "\"," + formatTariffTotal(total) + "}";
+    }
+
+    tariffData += "],\"months\":[";
+
+    uint32_t lastMonth = TariffLedger::GetMonthNumber(lastDay);
+
+    for (uint32_t month = lastMonth - min<uint32_t>(lastMonth, TARIFF_MONTHS_KEPT - 1), listed = 0; (lastDay > 0) && (month <= lastMonth); month++) {
+        const tariffTotal_s *total = tariffLedger.GetMonth(month);
+        char date[16];
+
+        if (total == NULL)
+            continue;
+
+        snprintf(date, sizeof(date), "%04u-%02u", month / 12, (month % 12) + 1);
+
+        if (listed++ > 0)
+            tariffData += ",";
+
+        tariffData += "{\"month\":\"" + String(date) + "\"," + formatTariffTotal(total) + "}";
+    }
+
+    tariffData += "]}";
+
+    httpServer.send(200, "text/plain", tariffData);
+}
+
+void handleAppliances(void) {
+    // curl -X POST ACCESSORY_NAME.local/appliances -d "signature=2&name=kettle"
+
+    applianceConfig_s *applianceConfig = configStore.GetApplianceConfig();
+    uint32_t since = 0;
+
+    if (httpServer.method() == HTTP_POST) {
+        long minimumStep = applianceConfig->minimumStep;
+        long signature = 0;
+        bool naming = httpServer.hasArg("signature") || httpServer.hasArg("name");
+        bool clear = (httpServer.arg("clear").toInt() != 0);
+        bool valid = true;
+
+        // Every argument is checked before anything is changed or saved
+        if (httpServer.hasArg("minimumStep"))
+            minimumStep = httpServer.arg("minimumStep").toInt();
+
+        valid = (minimumStep >= APPLIANCE_MATCH_WATTS) && (minimumStep <= MAXIMUM_WATT_SUPPORTED);
+
+        if ((valid == true) && (naming == true)) {
+            signature = httpServer.arg("signature").toInt();
+
+            valid = httpServer.hasArg("signature") &&
+                    (signature >= 0) && (signature < APPLIANCE_SIGNATURES_MAX) &&
+                    (applianceDetector.GetSignature(signature)->count > 0) &&
+                    isValidName(httpServer.arg("name"), APPLIANCE_NAME_MAX);
+        }
+
+        if (valid == false) {
+            httpServer.send(400, "text/plain", "Invalid appliance request");
+            return;
+        }
+
+        if (minimumStep != applianceConfig->minimumStep) {
+            applianceConfig->minimumStep = minimumStep;
+            applianceDetector.SetMinimumStep(minimumStep);
+            valid = configStore.Save();
+        }
+
+        if ((valid == true) && (naming == true))
+            valid = applianceDetector.SetSignatureName(signature, httpServer.arg("name").c_str());
+
+        if ((valid == true) && (clear == true))
+            valid = applianceDetector.ClearSignatures();
+
+        if (valid == false) {
+            httpServer.send(500, "text/plain", "Unable to save appliances");
+            return;
+        }
+    }
+
+    // Clients poll with the sequence of the last response to get only new events
+    if (httpServer.hasArg("since"))
+        since = strtoul(httpServer.arg("since").c_str(), NULL, 10);
+
+    since = max(since, applianceDetector.GetSequence() - min<uint32_t>(applianceDetector.GetSequence(), APPLIANCE_EVENTS_MAX));
+
+    String applianceData = String();
+
+    applianceData = "{";
+    applianceData += "\"minimumStep\":" + String(applianceConfig->minimumStep) + ",";
+    applianceData += "\"level\":" + String(applianceDetector.GetLevel()) + ",";
+    applianceData += "\"running\":" + String(applianceDetector.GetRunningCount()) + ",";
+    applianceData += "\"signatures\":[";
+
+    for (uint8_t i = 0, listed = 0; i < APPLIANCE_SIGNATURES_MAX; i++) {
+        const applianceSignature_s *signature = applianceDetector.GetSignature(i);
+
+        if (signature->count == 0)
+            continue;
+
+        if (listed++ > 0)
+            applianceData += ",";
+
+        applianceData += "{\"signature\":" + String(i) + ",";
+        applianceData += "\"name\":\"" + escapeJson(signature->name) + "\",";
+        applianceData += "\"watts\":" + String(signature->watts) + ",";
+        applianceData += "\"count\":" + String(signature->count) + ",";
+        applianceData += "\"onSeconds\":" + String(signature->onSeconds) + ",";
+        applianceData += "\"last\":" + String(signature->lastEpoch) + "}";
+    }
+
+    applianceData += "],\"sequence\":" + String(applianceDetector.GetSequence()) + ",";
+    applianceData += "\"events\":[";
+
+    for (uint32_t sequence = since, listed = 0; sequence < applianceDetector.GetSequence(); sequence++) {
+        const applianceEvent_s *event = applianceDetector.GetEvent(sequence);
+
+        if (listed++ > 0)
+            applianceData += ",";
+
+        applianceData += "{\"seq\":" + String(event->sequence) + ",";
+        applianceData += "\"t\":" + String(event->epoch) + ",";
+        applianceData += "\"step\":" + String(event->step) + ",";
+        applianceData += "\"level\":" + String(event->level) + ",";
+        applianceData += "\"duration\":" + String(event->duration) + ",";
+        applianceData += "\"signature\":" + ((event->signature != APPLIANCE_SIGNATURE_NONE) ? String(event->signature) : String("null")) + "}";
+    }
+
+    applianceData += "]}";
+
+    httpServer.send(200, "text/plain", applianceData);
+}
+
+void handleLoadProfile(void) {
+    // curl ACCESSORY_NAME.local/loadprofile?day=0
+
+    bool synced = timeService.IsSynced();
+    uint32_t today = (synced == true) ? (timeService.GetEpoch() / LOAD_PROFILE_SECONDS_PER_DAY) : 0;
+    uint8_t firstHour = 0;
+    uint8_t lastHour = LOAD_PROFILE_HOURS - 1;
+
+    // A single day, Monday is 0, keeps the response small
+    if (httpServer.hasArg("day")) {
+        uint32_t day = httpServer.arg("day").toInt();
+
+        if (day >= 7) {
+            httpServer.send(400, "text/plain", "Invalid day");
+            return;
+        }
+
+        firstHour = day * 24;
+        lastHour = firstHour + 23;
+    }
+
+    String profileData = String();
+
+    profileData = "{";
+    profileData += "\"hour\":" + ((synced == true) ? String(LoadProfile::GetHourOfWeek(timeService.GetEpoch())) : String("null")) + ",";
+    profileData += "\"baseload\":" + (((synced == true) && (loadProfile.GetBaseload(today) > 0)) ? String(loadProfile.GetBaseload(today)) : String("null")) + ",";
+    profileData += "\"nights\":[";
+
+    for (uint32_t day = today - min<uint32_t>(today, LOAD_PROFILE_NIGHTS_KEPT - 1), listed = 0; (synced == true) && (day <= today); day++) {
+        const loadProfileNight_s *night = loadProfile.GetNight(day);
+        uint16_t year;
+        uint8_t month;
+        uint8_t dayOfMonth;
+        char date[16];
 
-    File dataFile = LittleFS.open(path.c_str(), "r");
+        if (night == NULL)
+            continue;
 
-    if (!dataFile) {
-        return fileTransferStatus;
+        TariffLedger::GetDate(day, &year, &month, &dayOfMonth);
+        snprintf(date, sizeof(date), "%04u-%02u-%02u", year, month, dayOfMonth);
+
+        if (listed++ > 0)
+            profileData += ",";
+
+        profileData += "{\"date\":\"" + String(date) + "\",\"minimum\":" + String(night->minimum) + "}";
     }
-    else {
-        if (httpServer.streamFile(dataFile, dataType) == dataFile.size()) {
-            fileTransferStatus = true;
+
+    // Samples, mean and the percentiles of each hour from Monday 00:00
+    profileData += "],\"fields\":[\"samples\",\"mean\"";
+
+    for (uint8_t i = 0; i < LOAD_PROFILE_QUANTILES; i++) {
+        profileData += ",\"p" + String(LoadProfile::GetQuantilePercent(i)) + "\"";
+    }
+
+    profileData += "],\"first\":" + String(firstHour) + ",\"hours\":[";
+
+    for (uint8_t hour = firstHour; hour <= lastHour; hour++) {
+        const loadProfileBin_s *bin = loadProfile.GetBin(hour);
+
+        if (hour > firstHour)
+            profileData += ",";
+
+        profileData += "[" + String(bin->count) + "," + String((bin->mean + (LOAD_PROFILE_MEAN_SCALE / 2)) / LOAD_PROFILE_MEAN_SCALE);
+
+        for (uint8_t i = 0; i < LOAD_PROFILE_QUANTILES; i++) {
+            profileData += "," + String((bin->quantiles[i] + (LOAD_PROFILE_QUANTILE_SCALE / 2)) / LOAD_PROFILE_QUANTILE_SCALE);
         }
+
+        profileData += "]";
     }
 
-    dataFile.close();
-    return fileTransferStatus;
+    profileData += "]}";
+
+    httpServer.send(200, "text/plain", profileData);
 }
 
-//=============================================================================
-// Webserver event handlers
-//=============================================================================
-void handleRoot(void) {
-    httpServer.sendHeader("Location", "/index.html", true);
+void handleImpulse(void) {
+    // curl -X GET ACCESSORY_NAME.local/impulse?channel=0&estimator=average&pulses=8&decay=1
 
-    // Redirect to our index.html web page
-    httpServer.send(302, "text/plain", "");
-}
+    String impulseData = String();
+    uint8_t firstChannel = 0;
+    uint8_t lastChannel = impulseChannelCount - 1;
 
-void handleFileList(void) {
-    // curl -X GET ACCESSORY_NAME.local/list
+    // Estimator selection applies to one channel or, without channel, to all
+    if (httpServer.hasArg("channel")) {
+        firstChannel = constrain(httpServer.arg("channel").toInt(), 0, impulseChannelCount - 1);
+        lastChannel = firstChannel;
+    }
 
-    String path = "/";
-    String directoryList = "[";
-    Dir directoryEntry = LittleFS.openDir(path);
+    if (httpServer.hasArg("estimator") || httpServer.hasArg("pulses") || httpServer.hasArg("decay")) {
+        for (uint8_t i = firstChannel; i <= lastChannel; i++) {
+            impulseEstimator_e estimator = impulseChannels[i].GetEstimator();
+            uint8_t averagePulses = impulseChannels[i].GetAveragePulses();
+            bool decay = impulseChannels[i].GetDecay();
 
-    while (directoryEntry.next()) {
-        File fileElement = directoryEntry.openFile("r");
+            if (httpServer.hasArg("estimator"))
+                estimator = (httpServer.arg("estimator") == "average") ? impulseEstimatorAverage : impulseEstimatorInstant;
 
-        if (directoryList != "[")
-            directoryList += ", ";
+            if (httpServer.hasArg("pulses"))
+                averagePulses = httpServer.arg("pulses").toInt();
 
-        directoryList += String(fileElement.name()).substring(0);
-        fileElement.close();
+            if (httpServer.hasArg("decay"))
+                decay = (httpServer.arg("decay").toInt() != 0);
+
+            impulseChannels[i].SetEstimator(estimator, averagePulses, decay);
+        }
     }
 
-    directoryList += "]";
-    httpServer.send(200, "text/plain", directoryList);
-}
+    impulseData = "{\"channels\":[";
 
-void handleFileUpload(void) {
-    // curl -X POST -F "file=@SomeFile.EXT" ACCESSORY_NAME.local/upload
+    for (uint8_t i = 0; i < impulseChannelCount; i++) {
+        ImpulseCapture *channel = &impulseChannels[i];
 
-    HTTPUpload& upload = httpServer.upload();
+        if (i > 0)
+            impulseData += ",";
 
-    if (upload.status == UPLOAD_FILE_START) {
-        String filename = upload.filename;
+        impulseData += "{\"name\":\"" + escapeJson(channel->GetName()) + "\",";
+        impulseData += "\"pulsesPerKwh\":" + String(channel->GetPulsesPerKilowattHour()) + ",";
+        impulseData += "\"count\":" + String(channel->GetImpulseCount()) + ",";
+        impulseData += "\"rejectedWidth\":" + String(channel->GetRejectedWidthCount()) + ",";
+        impulseData += "\"rejectedInterval\":" + String(channel->GetRejectedIntervalCount()) + ",";
+        impulseData += "\"minimumInterval\":" + String(channel->GetMinimumInterval()) + ",";
+        impulseData += "\"estimator\":\"" + String((channel->GetEstimator() == impulseEstimatorAverage) ? "average" : "instant") + "\",";
+        impulseData += "\"pulses\":" + String(channel->GetAveragePulses()) + ",";
+        impulseData += "\"decay\":" + String(channel->GetDecay() ? "true" : "false") + "}";
+    }
 
-        if (!filename.startsWith("/"))
-            filename = "/" + filename;
+    impulseData += "]}";
 
-        fsUploadFile = LittleFS.open(filename, "w");
+    httpServer.send(200, "text/plain", impulseData);
+}
 
-    } else if (upload.status == UPLOAD_FILE_WRITE) {
+void handleScheduler(void) {
+    // curl -X GET ACCESSORY_NAME.local/scheduler
 
-        if(fsUploadFile)
-            fsUploadFile.write(upload.buf, upload.currentSize);
+    String schedulerData = String();
 
-    } else if (upload.status == UPLOAD_FILE_END) {
+    schedulerData = "[";
 
-        if(fsUploadFile)
-            fsUploadFile.close();
+    for (uint8_t i = 0; i < scheduler.GetTaskCount(); i++) {
+        const schedulerTask_s *task = scheduler.GetTask(i);
+
+        if (i > 0)
+            schedulerData += ",";
+
+        schedulerData += "{\"name\":\"" + String(task->name) + "\",";
+        schedulerData += "\"period\":" + String(task->period) + ",";
+        schedulerData += "\"priority\":" + String(task->priority) + ",";
+        schedulerData += "\"runs\":" + String(task->runCount) + ",";
+        schedulerData += "\"missed\":" + String(task->deadlineMissCount) + ",";
+        schedulerData += "\"overruns\":" + String(task->overrunCount) + ",";
+        schedulerData += "\"lastRuntimeUs\":" + String(task->lastRuntime) + ",";
+        schedulerData += "\"maxRuntimeUs\":" + String(task->maxObservedRuntime) + ",";
+        schedulerData += "\"maxLatenessMs\":" + String(task->maxLateness) + "}";
+    }
+
+    schedulerData += "]";
+
+    if (httpServer.hasArg("clear")) {
+        scheduler.ClearStatistics();
     }
+
+    httpServer.send(200, "text/plain", schedulerData);
 }
 
-void handleFileDelete(void) {
+String buildProfilerReport(void) {
+    String profilerData = String();
 
-    String fileDeleteResponse = String();
-    String fileName = httpServer.arg(0);
+    profilerData = "[";
 
-    if (LittleFS.exists(fileName)) {
-        if (LittleFS.remove(fileName)) {
-            fileDeleteResponse = "{\"success\":1}";
-        }
-        else {
-            fileDeleteResponse = "{\"file does not exist\":1}";
+    for (uint8_t i = 0; i < profiler.GetStageCount(); i++) {
+        const loopProfilerStage_s *stage = profiler.GetStage(i);
+
+        if (i > 0)
+            profilerData += ",";
+
+        profilerData += "{\"stage\":\"" + String(stage->name) + "\",";
+        profilerData += "\"count\":" + String(stage->count) + ",";
+        profilerData += "\"minUs\":" + String((stage->count > 0) ? profiler.CyclesToMicroSeconds(stage->minCycles) : 0) + ",";
+        profilerData += "\"meanUs\":" + String(profiler.GetMeanMicroSeconds(i)) + ",";
+        profilerData += "\"maxUs\":" + String(profiler.CyclesToMicroSeconds(stage->maxCycles)) + ",";
+        profilerData += "\"log2Us\":[";
+
+        for (uint8_t bucket = 0; bucket < LOOP_PROFILER_HISTOGRAM_BUCKETS; bucket++) {
+            if (bucket > 0)
+                profilerData += ",";
+
+            profilerData += String(stage->histogram[bucket]);
         }
-    }
-    else {
-        fileDeleteResponse = "{\"unable to open file\":1}";
+
+        profilerData += "]}";
     }
 
-    httpServer.send(200, "text/plain", fileDeleteResponse);
+    profilerData += "]";
+
+    return profilerData;
 }
 
-void handleWebRequests(void) {
-    String message = "File Not Detected\n\n";
+void handleProfiler(void) {
+    // curl -X GET ACCESSORY_NAME.local/profiler[?clear]
 
-    if (loadFromSpiffs(httpServer.uri()))
-        return;
+    httpServer.send(200, "text/plain", buildProfilerReport());
 
-    message += "URI: ";
-    message += httpServer.uri();
-    message += "\nMethod: ";
-    message += (httpServer.method() == HTTP_GET) ? "GET" : "POST";
-    message += "\nArguments: ";
-    message += httpServer.args();
-    message += "\n";
+    if (httpServer.hasArg("clear")) {
+        profiler.Clear();
+    }
+}
 
-    for (uint8_t i = 0; i < httpServer.args(); i++) {
-        message += " NAME:" + httpServer.argName(i);
-        message += "\n VALUE:" + httpServer.arg(i) + "\n";
+void handleDiagnostics(void) {
+    // curl -X GET ACCESSORY_NAME.local/diagnostics
+
+    String diagnosticsData = String();
+    const heapSnapshot_s *snapshot = heapMonitor.GetSnapshot();
+    const heapSnapshot_s *previousSnapshot = heapMonitor.GetPreviousSnapshot();
+
+    diagnosticsData = "{";
+    diagnosticsData += "\"bootCount\":" + String(snapshot->bootCount) + ",";
+    diagnosticsData += "\"resetReason\":\"" + ESP.getResetReason() + "\",";
+    diagnosticsData += "\"resetInfo\":\"" + ESP.getResetInfo() + "\",";
+    diagnosticsData += "\"uptime\":" + String(snapshot->uptime) + ",";
+    diagnosticsData += "\"freeHeap\":" + String(snapshot->freeHeap) + ",";
+    diagnosticsData += "\"minFreeHeap\":" + String(snapshot->minFreeHeap) + ",";
+    diagnosticsData += "\"maxFreeBlock\":" + String(snapshot->maxFreeBlock) + ",";
+    diagnosticsData += "\"fragmentation\":" + String(snapshot->fragmentation) + ",";
+    diagnosticsData += "\"maxFragmentation\":" + String(snapshot->maxFragmentation) + ",";
+
+    // Last snapshot written before the reset, only present after a warm reset
+    diagnosticsData += "\"previous\":";
+
+    if (previousSnapshot != NULL) {
+        diagnosticsData += "{\"uptime\":" + String(previousSnapshot->uptime) + ",";
+        diagnosticsData += "\"freeHeap\":" + String(previousSnapshot->freeHeap) + ",";
+        diagnosticsData += "\"minFreeHeap\":" + String(previousSnapshot->minFreeHeap) + ",";
+        diagnosticsData += "\"maxFreeBlock\":" + String(previousSnapshot->maxFreeBlock) + ",";
+        diagnosticsData += "\"fragmentation\":" + String(previousSnapshot->fragmentation) + ",";
+        diagnosticsData += "\"maxFragmentation\":" + String(previousSnapshot->maxFragmentation) + "},";
+    } else {
+        diagnosticsData += "null,";
     }
 
-    httpServer.send(404, "text/plain", message);
-}
+    diagnosticsData += "\"subsystems\":[";
 
-void handleBeeper() {
-    // curl -X POST ACCESSORY_NAME.local/beeper?count={BEEPS}"
+    for (uint8_t i = 0; i < heapMonitor.GetSubsystemCount(); i++) {
+        const heapSubsystem_s *subsystem = heapMonitor.GetSubsystem(i);
 
-    String beeperRequestResponse = String();
+        if (i > 0)
+            diagnosticsData += ",";
 
-    if (beeper.GetBeeperState() == beepHandlerIdle) {
-        if (httpServer.hasArg("count")) {
-            beeper.RequestBeeper(httpServer.arg("count").toInt());
+        diagnosticsData += "{\"name\":\"" + String(subsystem->name) + "\",";
+        diagnosticsData += "\"calls\":" + String(subsystem->calls) + ",";
+        diagnosticsData += "\"growthCalls\":" + String(subsystem->growthCalls) + ",";
+        diagnosticsData += "\"totalRetained\":" + String(subsystem->totalRetained) + ",";
+        diagnosticsData += "\"maxRetained\":" + String(subsystem->maxRetained);
 
-            beeperRequestResponse = "{\"success\":1}";
-        } else {
-            beeperRequestResponse = "{\"no count specified\":1}";
-        }
+        if (previousSnapshot != NULL)
+            diagnosticsData += ",\"previousRetained\":" + String(previousSnapshot->subsystemRetained[i]);
+
+        diagnosticsData += "}";
     }
-    else {
-        beeperRequestResponse = "{\"busy\":1}";
+
+    diagnosticsData += "],\"history\":[";
+
+    for (uint8_t i = 0; i < heapMonitor.GetSampleCount(); i++) {
+        const heapSample_s *sample = heapMonitor.GetSample(i);
+
+        if (i > 0)
+            diagnosticsData += ",";
+
+        diagnosticsData += "[" + String(sample->timestamp) + "," + String(sample->freeHeap) + ",";
+        diagnosticsData += String(sample->maxFreeBlock) + "," + String(sample->fragmentation) + "]";
     }
 
-    httpServer.send(200, "text/plain", beeperRequestResponse);
+    diagnosticsData += "]}";
+
+    httpServer.send(200, "text/plain", diagnosticsData);
 }
 
 //==============================================================
@@ -326,53 +2214,89 @@ void onConnected(const WiFiEventStationModeConnected& event) {
 void onGotIp(const WiFiEventStationModeGotIP& event) {
     Serial.printf("IP address: %s\n", WiFi.localIP().toString().c_str());
 
-    if (MDNS.begin(ACCESSORY_NAME)) {
-        Serial.printf("mDNS service running as: %s\n", ACCESSORY_NAME);
+    wifiFastConnectPending = false;
+    wifiCache.Store(WiFi.channel(), WiFi.BSSID(), (uint32_t)WiFi.localIP(), (uint32_t)WiFi.gatewayIP(),
+                    (uint32_t)WiFi.subnetMask(), (uint32_t)WiFi.dnsIP());
+
+    const char *hostname = configStore.GetNetworkConfig()->hostname;
+
+    if (MDNS.begin(hostname)) {
+        Serial.printf("mDNS service running as: %s\n", hostname);
     }
     else {
         Serial.printf("Could not start mDNS service\n");
     }
-    
-    // Attached to NTP Client
-    timeClient.begin();
 }
 
 void connectWiFi(void) {
     if (WiFi.getMode() == WIFI_AP)
         return;
     
-    if (WiFi.status() == WL_CONNECTED || millis() < reconnectionTime) {
+    if (WiFi.status() == WL_CONNECTED) {
         return;
     }
-    else {
-        reconnectionTime = millis() + RECONNECT_INTERVAL;
+
+    // Give the attempt in progress a full interval, setup() starts the first one
+    if ((wifiConnectStarted == true) && ((millis() - wifiConnectStartTime) < RECONNECT_INTERVAL))
+        return;
+
+    networkConfig_s *networkConfig = configStore.GetNetworkConfig();
+    wifiConnectStartTime = millis();
+    wifiConnectStarted = true;
+
+    // A fast connect still pending one interval later failed, the access point
+    // moved or the lease is gone; forget it and scan with DHCP from now on
+    if (wifiFastConnectPending == true) {
+        Serial.printf("WiFi fast connect failed\n");
+        wifiFastConnectPending = false;
+        wifiCache.Invalidate();
+
+        if (networkConfig->staticIp == 0)
+            WiFi.config(IPAddress((uint32_t)0), IPAddress((uint32_t)0), IPAddress((uint32_t)0));
     }
 
-    // Reconnect
-    Serial.printf("Connecting WiFi\n");
-    WiFi.begin(staSSID, staPassword);
+    // Reconnect, paced by the scheduler every RECONNECT_INTERVAL
+    if (wifiCache.IsValid() == true) {
+        const wifiCacheEntry_s *cacheEntry = wifiCache.GetEntry();
+
+        Serial.printf("Connecting WiFi on channel %u\n", cacheEntry->channel);
+
+        if (networkConfig->staticIp == 0) {
+            WiFi.config(IPAddress(cacheEntry->ipAddress), IPAddress(cacheEntry->gateway),
+                        IPAddress(cacheEntry->netmask), IPAddress(cacheEntry->dns));
+        }
+
+        wifiFastConnectPending = true;
+        WiFi.begin(networkConfig->ssid, networkConfig->password, cacheEntry->channel, cacheEntry->bssid);
+    } else {
+        Serial.printf("Connecting WiFi\n");
+        WiFi.begin(networkConfig->ssid, networkConfig->password);
+    }
 }
 
 //=============================================================================
 // Setup function
 //=============================================================================
 void setup() {
-    File fsWifiConfig;
-    bool apMode = false;
 
     // Initialise serial object
     Serial.begin(115200);
 
+    // Capture heap state and the snapshot persisted by the previous boot first
+    heapMonitor.Init();
+
     // Initialize deep sleep pin to allow for wakeup
     pinMode(DeepSleepPin, OUTPUT);
     digitalWrite(DeepSleepPin, HIGH);
 
+    // Button edges are time stamped in an interrupt, so clicks decode the
+    // same however late taskButtons gets to run
+    enterButton.EnableInterrupt();
+    menuButton.EnableInterrupt();
+
     // Initialise battery charge state GetBatteryHistogram
     battery.Init();
 
-    // Initialse impulse capturing
-    impulse.Init();
-
     // Initialise OLED display driver
     display.init();
     display.resetDisplay();
@@ -398,14 +2322,72 @@ void setup() {
     printf("BuildDetails: %s, %s\n", __DATE__, __TIME__ );
 
     // Initialize File System.
+    LittleFS.setTimeCallback(fileTimeCallback);
     LittleFS.begin();
 
-    // AP if no wifi.config file exists.
-    if (!LittleFS.exists("/wifi.conf")) {
-        apMode = true;
+    // Everything written from here on is booked; the log store keeps its
+    // minimum free, the file system is full for the trend at that point
+    flashMonitor.SetReserve(LOG_STORE_FREE_MIN);
+    flashMonitor.Begin();
+
+    // Device configuration, read once; /wifi.conf and /meter.cfg are imported
+    // into it when present
+    if (configStore.Load() == false) {
+        Serial.printf("Configuration defaults in use\n");
+    }
+
+    if (configStore.WasMigrated() == true) {
+        Serial.printf("Legacy configuration imported\n");
+    }
+
+    networkConfig_s *networkConfig = configStore.GetNetworkConfig();
+
+    // Initialse impulse capturing
+    meterConfig_s *meterConfig = configStore.GetMeterConfig();
+    impulseChannelCount = meterConfig->channelCount;
+
+    for (uint8_t i = 0; i < impulseChannelCount; i++) {
+        // Pins saved before they were checked are left unbound
+        uint8_t pin = (isImpulsePinFree(meterConfig, i) == true) ? meterConfig->channels[i].pin : IMPULSE_PIN_NONE;
+
+        impulseChannels[i].Configure(pin, meterConfig->channels[i].name);
+        impulseChannels[i].Init();
+    }
+
+    applyMeterConfig();
+
+    // Battery operation, a wake that only samples goes back to deep sleep
+    // from here; flush boots continue with WiFi
+    if (configStore.GetPowerConfig()->batchMode != 0) {
+        runBatchSample();
     }
 
-    if (apMode == true) {
+    timeService.Begin();
+    timeService.SetServer(networkConfig->ntpServer);
+    timeService.SetOffset(networkConfig->utcOffset);
+
+    logStore.Begin((impulseChannelCount * LOG_FIELDS_PER_CHANNEL) + LOG_FIELDS_RECORD);
+    importLegacyLog();
+
+    // Samples the broker did not get before the reset are replayed first
+    mqttOutbox.Begin();
+    applyMqttConfig();
+    applyAlertConfig();
+
+    // Pulses of a batch sample are booked with the batch
+    tariffLedger.SetSchedule(configStore.GetTariffConfig());
+    tariffLedger.Begin();
+    tariffImpulseCount = impulse.GetImpulseCount();
+
+    applianceDetector.SetMinimumStep(configStore.GetApplianceConfig()->minimumStep);
+    applianceDetector.Begin();
+
+    loadProfile.Begin();
+
+    restorePendingLog();
+
+    // AP until station credentials are configured
+    if (networkConfig->ssid[0] == '\0') {
         Serial.printf("WiFi AP mode active\n");
 
         WiFi.mode(WIFI_AP);
@@ -413,20 +2395,28 @@ void setup() {
         onAccessPointConnectedHandler = WiFi.onSoftAPModeStationConnected(onAccessPointConnected);
         WiFi.softAP(ACCESSORY_SETUP_NAME);
     } else {
-        fsWifiConfig = LittleFS.open("/wifi.conf", "r");
+        wifiCache.Init(networkConfig->ssid, networkConfig->password);
 
-        staSSID = fsWifiConfig.readStringUntil(',');
-        staPassword = fsWifiConfig.readStringUntil(',');
-        fsWifiConfig.close();
+        // Credentials come from the configuration store, keep the SDK from
+        // rewriting its own copy in flash on every connect
+        WiFi.persistent(false);
 
         onConnectedHandler = WiFi.onStationModeConnected(onConnected);
         onGotIpHandler = WiFi.onStationModeGotIP(onGotIp);
         WiFi.mode(WIFI_STA);
-        WiFi.hostname(ACCESSORY_NAME);
+        WiFi.hostname(networkConfig->hostname);
+
+        if (networkConfig->staticIp != 0) {
+            WiFi.config(IPAddress(networkConfig->ipAddress), IPAddress(networkConfig->gateway),
+                        IPAddress(networkConfig->netmask), IPAddress(networkConfig->dns));
+        }
+
+        // Start joining before the display and sensors are set up
+        connectWiFi();
     }
 
     // Setup UI
-    ui.setTargetFPS(10);
+    ui.setTargetFPS(UI_TARGET_FPS);
     ui.disableAllIndicators();
     ui.disableAutoTransition();
     ui.setOverlays(overlays, overlaysCount);
@@ -436,7 +2426,7 @@ void setup() {
     display.flipScreenVertically();
 
     // Setup DHT11 interface
-    dht.setup(dhtSensorPin, DHTesp::DHT11);
+    dhtReader.Init();
 
     // Assign server helper functions
     httpServer.on("/", handleRoot);
@@ -454,6 +2444,10 @@ void setup() {
     });
 
     httpServer.on("/reset", HTTP_POST, []() {
+        mqttOutbox.Persist();
+        tariffLedger.Save();
+        loadProfile.Save();
+        flashMonitor.Save();
         ESP.reset();
         httpServer.send(200, "text/plain", "{\"success\":1}");
     });
@@ -467,16 +2461,48 @@ void setup() {
         spiffsInfo += "\"NVMSize\":" + String(fsInfo.totalBytes) + ",";
         spiffsInfo += "\"UsedBytes\":" + String(fsInfo.usedBytes) + ",";
         spiffsInfo += "\"FlashSize\":" + String(ESP.getFlashChipRealSize()) + ",";
-        spiffsInfo += "\"CPUSpeed\":" + String(ESP.getCpuFreqMHz());
-        spiffsInfo += "}";
+        spiffsInfo += "\"CPUSpeed\":" + String(ESP.getCpuFreqMHz()) + ",";
+
+        // Flash wear since the first boot with a known time
+        uint32_t seconds = flashMonitor.GetSeconds();
+        int32_t daysUntilFull = flashMonitor.GetDaysUntilFull();
+        uint8_t listed = 0;
+
+        spiffsInfo += "\"AppBytesWritten\":" + String((unsigned long long)flashMonitor.GetAppBytes()) + ",";
+        spiffsInfo += "\"FlashBytesProgrammed\":" + String((unsigned long long)flashMonitor.GetProgrammedBytes()) + ",";
+        spiffsInfo += "\"BlocksErased\":" + String((unsigned long long)(flashMonitor.GetErasedBytes() / fsInfo.blockSize)) + ",";
+        spiffsInfo += "\"WriteAmplification\":" + String(flashMonitor.GetWriteAmplification(), 1) + ",";
+        spiffsInfo += "\"EraseCyclesPerBlock\":" + String(flashMonitor.GetEraseCyclesPerBlock(), 2) + ",";
+        spiffsInfo += "\"WearPercent\":" + String(flashMonitor.GetEraseCyclesPerBlock() * 100.0 / FLASH_MONITOR_RATED_CYCLES, 4) + ",";
+        spiffsInfo += "\"UsedBytesPerDay\":" + String(flashMonitor.GetUsedBytesPerDay()) + ",";
+        spiffsInfo += "\"DaysUntilFull\":" + ((daysUntilFull >= 0) ? String(daysUntilFull) : String("null")) + ",";
+        spiffsInfo += "\"FileWrites\":[";
+
+        for (uint8_t i = 0; i < FLASH_MONITOR_FILES_MAX; i++) {
+            const flashMonitorFile_s *file = flashMonitor.GetFile(i);
+
+            if (file == NULL)
+                continue;
+
+            if (listed++ > 0)
+                spiffsInfo += ",";
+
+            spiffsInfo += "{\"Name\":\"" + escapeJson(file->name) + "\",\"Bytes\":" + String(file->bytes);
+            spiffsInfo += ",\"BytesPerDay\":" + ((seconds > 0) ? String((uint32_t)(((uint64_t)file->bytes * 86400) / seconds)) : String("null")) + "}";
+        }
+
+        spiffsInfo += "]}";
         httpServer.send(200, "text/plain", spiffsInfo);
     });
 
     httpServer.on("/temperature", HTTP_GET, []() {
         String dht11TempData = String();
 
+        demandSensor();
+
         dht11TempData = "{";
-        dht11TempData += "\"temperature\":" + String(dhtTempAndHumidity.temperature);
+        dht11TempData += "\"temperature\":" + ((sensorCache.IsValid() == true) ? String(sensorCache.GetReading()->temperature) : String("null")) + ",";
+        dht11TempData += "\"stale\":" + String((sensorCache.IsStale() == true) ? "true" : "false");
         dht11TempData += "}";
         httpServer.send(200, "text/plain", dht11TempData.c_str());
     });
@@ -484,8 +2510,11 @@ void setup() {
     httpServer.on("/humidity", HTTP_GET, []() {
         String dht11HumData = String();
 
+        demandSensor();
+
         dht11HumData = "{";
-        dht11HumData += "\"humidity\":" + String(dhtTempAndHumidity.humidity);
+        dht11HumData += "\"humidity\":" + ((sensorCache.IsValid() == true) ? String(sensorCache.GetReading()->humidity) : String("null")) + ",";
+        dht11HumData += "\"stale\":" + String((sensorCache.IsStale() == true) ? "true" : "false");
         dht11HumData += "}";
         httpServer.send(200, "text/plain", dht11HumData.c_str());
     });
@@ -494,31 +2523,92 @@ void setup() {
         String wattsData = String();
 
         wattsData = "{";
-        wattsData += "\"watts\":" + String(impulse.GetInstantWattUsgage());
-        wattsData += "}";
+        wattsData += "\"watts\":" + String(impulse.GetWattUsage()) + ",";
+        wattsData += "\"instant\":" + String(impulse.GetInstantWattUsgage()) + ",";
+        wattsData += "\"channels\":[";
+
+        for (uint8_t i = 0; i < impulseChannelCount; i++) {
+            if (i > 0)
+                wattsData += ",";
+
+            wattsData += "{\"name\":\"" + escapeJson(impulseChannels[i].GetName()) + "\",";
+            wattsData += "\"watts\":" + String(impulseChannels[i].GetWattUsage()) + ",";
+            wattsData += "\"instant\":" + String(impulseChannels[i].GetInstantWattUsgage()) + "}";
+        }
+
+        wattsData += "]}";
         httpServer.send(200, "text/plain", wattsData.c_str());
     });
 
+    httpServer.on("/impulse", HTTP_GET, handleImpulse);
+    httpServer.on("/config", HTTP_ANY, handleConfig);
+    httpServer.on("/network", HTTP_ANY, handleNetwork);
     httpServer.on("/beeper", HTTP_POST, handleBeeper);
+    httpServer.on("/scheduler", HTTP_GET, handleScheduler);
+    httpServer.on("/profiler", HTTP_GET, handleProfiler);
+    httpServer.on("/diagnostics", HTTP_GET, handleDiagnostics);
+    httpServer.on("/sensor", HTTP_GET, handleSensor);
+    httpServer.on("/time", HTTP_GET, handleTime);
+    httpServer.on("/log.csv", HTTP_GET, handleLog);
+    httpServer.on("/log/index", HTTP_GET, handleLogIndex);
+    httpServer.on("/mqtt", HTTP_ANY, handleMqtt);
+    httpServer.on("/alerts", HTTP_ANY, handleAlerts);
+    httpServer.on("/tariff", HTTP_ANY, handleTariff);
+    httpServer.on("/appliances", HTTP_ANY, handleAppliances);
+    httpServer.on("/loadprofile", HTTP_GET, handleLoadProfile);
 
     httpServer.onNotFound(handleWebRequests);
 
-    lastDhtUpdateTime = millis();
+    // Setup loop instrumentation
+    profiler.Init();
+    profilerStageLoop = profiler.AddStage("loop");
+    profilerStageHttp = profiler.AddStage("http");
+    profilerStageUi = profiler.AddStage("ui");
+    profilerStageLog = profiler.AddStage("log");
+    profilerStageDht = profiler.AddStage("dht");
+    profilerStageMqtt = profiler.AddStage("mqtt");
+
+    // Setup heap attribution
+    heapSubsystemHttp = heapMonitor.AddSubsystem("http");
+    heapSubsystemUi = heapMonitor.AddSubsystem("ui");
+    heapSubsystemLog = heapMonitor.AddSubsystem("log");
+    heapSubsystemMqtt = heapMonitor.AddSubsystem("mqtt");
+
+    // Setup scheduler, task name, callback, period (ms), priority, max runtime (ms)
+    scheduler.AddTask("network", taskNetwork, 0, 4, 50);
+    scheduler.AddTask("wifi", taskWiFi, RECONNECT_INTERVAL, 1, 20);
+    scheduler.AddTask("buttons", taskButtons, BUTTON_UPDATE_INTERVAL, 6, 5);
+    scheduler.AddTask("ui", taskUi, UI_UPDATE_INTERVAL, 5, 30);
+    scheduler.AddTask("beeper", taskBeeper, BEEPER_UPDATE_INTERVAL, 3, 2);
+    scheduler.AddTask("battery", taskBattery, ADC_SAMPLE_INTERVAL_DELAY_M_SECONDS, 2, 2);
+    scheduler.AddTask("impulse", taskImpulse, IMPULSE_UPDATE_INTERVAL, 2, 2);
+    logTaskId = scheduler.AddTask("log", taskLog, meterConfig->logInterval, 7, 100);
+    dhtTaskId = scheduler.AddTask("dht", taskDht, SENSOR_CACHE_INTERVAL_MIN_MS, 3, 2);
+    scheduler.AddTask("profiler", taskProfilerReport, PROFILER_REPORT_INTERVAL, 0, 20);
+    scheduler.AddTask("heap", taskHeapMonitor, HEAP_MONITOR_INTERVAL, 1, 2);
+    scheduler.AddTask("power", taskPower, POWER_UPDATE_INTERVAL, 0, 5);
+    scheduler.AddTask("time", taskTime, TIME_UPDATE_INTERVAL, 2, 5);
+    scheduler.AddTask("mqtt", taskMqtt, MQTT_UPDATE_INTERVAL, 1, 10);
 }
 
 //=============================================================================
-// Loop function
+// Scheduler tasks
 //=============================================================================
-void loop() {
+void taskNetwork(void) {
+    MDNS.update();
 
-    static bool displayState = true;
-    uint32_t currentTime = millis();
-    uint16_t uiRemainingBudget = 0;
+    heapMonitor.Begin(heapSubsystemHttp);
+    profiler.Begin(profilerStageHttp);
+    httpServer.handleClient();
+    profiler.End(profilerStageHttp);
+    heapMonitor.End(heapSubsystemHttp);
+}
 
+void taskWiFi(void) {
     connectWiFi();
-    MDNS.update();
-    httpServer.handleClient();
+}
 
+void taskButtons(void) {
     enterButton.Update();
     menuButton.Update();
 
@@ -539,45 +2629,246 @@ void loop() {
     }
     
     if (enterButton.clicks < 0) {
-        impulse.ClearInstantWattUsage();
-        if (LittleFS.exists("log.csv")) {
-            LittleFS.remove("log.csv");
-        }
-    }
-
-    uiRemainingBudget = ui.update();
-
-    if (uiRemainingBudget > 0) {
-        
-        beeper.Update();
-        battery.Update();
-        impulse.Update();
-        
-        if ((currentTime - lastLogUpdateTime) >=  LOG_INTERVAL) {
-            timeClient.update();
-
-            if (timeClient.isTimeSet() == true) {
-                File fsLog =  LittleFS.open("/log.csv", "a");
-                fsLog.printf("%s", String(timeClient.getEpochTime()).c_str());
-                fsLog.print(',');
-                fsLog.println(String(impulse.GetInstantWattUsgage()).c_str());
-                fsLog.close();
-            
-                logUpdate = true;
-                lastLogUpdateUiTime = currentTime;
-            }
-
-            lastLogUpdateTime = currentTime;
+        for (uint8_t i = 0; i < impulseChannelCount; i++) {
+            impulseChannels[i].ClearInstantWattUsage();
         }
 
-        if ((logUpdate == true) && ((currentTime - lastLogUpdateUiTime) > LOG_UI_DISPLAY_TIME)) {
-            logUpdate = false;
-        }
+        logStore.Clear();
+    }
+}
+
+void taskUi(void) {
+    if ((logUpdate == true) && ((millis() - lastLogUpdateUiTime) > LOG_UI_DISPLAY_TIME)) {
+        logUpdate = false;
+    }
+
+    heapMonitor.Begin(heapSubsystemUi);
+    profiler.Begin(profilerStageUi);
+    ui.update();
+    profiler.End(profilerStageUi);
+    heapMonitor.End(heapSubsystemUi);
+
+    if ((displayState == true) && (ui.getUiState()->currentFrame == UI_SENSOR_FRAME_INDEX)) {
+        demandSensor();
+    }
+}
+
+void taskBeeper(void) {
+    beeper.Update();
+}
+
+void taskBattery(void) {
+    battery.Update();
+}
+
+void taskImpulse(void) {
+    for (uint8_t i = 0; i < impulseChannelCount; i++) {
+        impulseChannels[i].Update();
+    }
+
+    evaluateAlerts();
+    accountTariff();
+    detectAppliances();
+}
+
+void taskLog(void) {
+    heapMonitor.Begin(heapSubsystemLog);
+    profiler.Begin(profilerStageLog);
+
+    bool synced = timeService.IsSynced();
 
-        if ((currentTime - lastDhtUpdateTime) >=  2000) {
-            dhtTempAndHumidity = dht.getTempAndHumidity();
+    // Samples and records kept while the time was unknown go first to keep
+    // the log in time order; batched samples predate this boot's records
+    if (synced == true) {
+        if (sampleBatch.GetCount() > 0)
+            flushSampleBatch();
 
-            lastDhtUpdateTime = currentTime;
+        if (LittleFS.exists(LOG_PENDING_FILE))
+            backfillLog();
+    }
+
+    // Mean watts, pulses, min watts, max watts per channel, the /log.csv columns.
+    // Pulses are those the glitch filter accepted, not the meter register:
+    // pulses recovered after a step up are booked to the record in which the
+    // step is recognised, and glitches outnumbering the meter pulses while the
+    // filter learns the interval can still count.
+    int32_t values[LOG_CODEC_FIELDS_MAX];
+
+    for (uint8_t i = 0; i < impulseChannelCount; i++) {
+        impulseInterval_s logInterval;
+        impulseChannels[i].GetIntervalStatistics(&logInterval);
+
+        values[(i * LOG_FIELDS_PER_CHANNEL) + 0] = logInterval.meanWatt;
+        values[(i * LOG_FIELDS_PER_CHANNEL) + 1] = logInterval.pulses;
+        values[(i * LOG_FIELDS_PER_CHANNEL) + 2] = logInterval.minimumWatt;
+        values[(i * LOG_FIELDS_PER_CHANNEL) + 3] = logInterval.maximumWatt;
+    }
+
+    values[impulseChannelCount * LOG_FIELDS_PER_CHANNEL] = 0;
+
+    // Behind records still pending this one queues too, the log stays in
+    // time order
+    if ((synced == true) && (LittleFS.exists(LOG_PENDING_FILE) == false)) {
+        logStore.Append(timeService.GetEpoch(), values);
+        queueMqttSample(timeService.GetEpoch(), values[0], values[1], false);
+        loadProfile.Add(timeService.GetEpoch(), values[0]);
+        loadProfile.Update();
+        flashMonitor.Update(timeService.GetEpoch());
+    } else {
+        appendPendingLog(values);
+    }
+
+    profiler.End(profilerStageLog);
+    heapMonitor.End(heapSubsystemLog);
+
+    logUpdate = true;
+    lastLogUpdateUiTime = millis();
+}
+
+void taskTime(void) {
+    if (timeService.Update(WiFi.status() == WL_CONNECTED) == true) {
+        Serial.printf("Time synchronised, epoch %u, correction %d ms\n", timeService.GetEpoch(), timeService.GetLastCorrection());
+    }
+}
+
+void taskMqtt(void) {
+    mqttConfig_s *mqttConfig = configStore.GetMqttConfig();
+    String topic = String(mqttConfig->topic);
+
+    heapMonitor.Begin(heapSubsystemMqtt);
+    profiler.Begin(profilerStageMqtt);
+
+    // A new session first replaces the will with a retained online status
+    if (mqttClient.Update(WiFi.status() == WL_CONNECTED) == true) {
+        mqttSamplesInFlight = 0;
+        mqttAlertInFlight = false;
+        mqttClient.Publish((topic + "/status").c_str(), (const uint8_t *)"online", 6, mqttConfig->qos, true);
+    }
+
+    // Samples leave the outbox only once delivered, a failed publish is
+    // sent again from the same samples after the reconnect
+    mqttPublishState_e publishState = mqttClient.GetPublishState();
+
+    if ((publishState == mqttPublishDelivered) && (mqttAlertInFlight == true)) {
+        mqttAlertSequence++;
+    } else if (publishState == mqttPublishDelivered) {
+        mqttOutbox.Pop(mqttSamplesInFlight);
+    }
+
+    if ((publishState == mqttPublishDelivered) || (publishState == mqttPublishFailed)) {
+        mqttSamplesInFlight = 0;
+        mqttAlertInFlight = false;
+        mqttClient.AcknowledgePublish();
+    }
+
+    // Alerts go ahead of the samples, those the event ring no longer holds
+    // are skipped
+    while ((mqttAlertSequence < alertEngine.GetSequence()) && (alertEngine.GetEvent(mqttAlertSequence) == NULL)) {
+        mqttAlertSequence++;
+    }
+
+    if ((mqttClient.CanPublish() == true) && (mqttAlertSequence < alertEngine.GetSequence())) {
+        const alertEvent_s *event = alertEngine.GetEvent(mqttAlertSequence);
+        String payload = String();
+
+        payload = "{\"seq\":" + String(event->sequence);
+        payload += ",\"t\":" + String(event->epoch);
+        payload += ",\"rule\":" + String(event->rule);
+        payload += ",\"type\":\"" + String(alertRuleNames[event->type]) + "\"";
+        payload += ",\"raised\":" + String((event->raised != 0) ? "true" : "false");
+        payload += ",\"w\":" + String(event->watts) + "}";
+
+        if (mqttClient.Publish((topic + "/alert").c_str(), (const uint8_t *)payload.c_str(), payload.length(), mqttConfig->qos, false) == true)
+            mqttAlertInFlight = true;
+    }
+
+    // Full batches while live, anything stored during an outage right away
+    if ((mqttClient.CanPublish() == true) &&
+        ((mqttOutbox.GetCount() >= mqttConfig->batchSize) || (mqttOutbox.GetStoredCount() > 0))) {
+        mqttSample_s samples[CONFIG_MAXIMUM_MQTT_BATCH];
+        uint16_t count = mqttOutbox.Peek(samples, mqttConfig->batchSize);
+        String payload = "[";
+
+        for (uint16_t i = 0; i < count; i++) {
+            if (i > 0)
+                payload += ",";
+
+            payload += "{\"t\":" + String(samples[i].epoch);
+            payload += ",\"w\":" + String(samples[i].watts);
+            payload += ",\"wh\":" + String(samples[i].energy / 1000.0, 3);
+            payload += ",\"c\":" + ((samples[i].temperature != MQTT_SAMPLE_TEMPERATURE_NONE) ? String(samples[i].temperature / 10.0, 1) : String("null"));
+            payload += ",\"rh\":" + ((samples[i].humidity != MQTT_SAMPLE_HUMIDITY_NONE) ? String(samples[i].humidity / 10.0, 1) : String("null"));
+            payload += ",\"bat\":" + String(samples[i].battery);
+
+            if ((samples[i].flags & MQTT_SAMPLE_ESTIMATED) != 0)
+                payload += ",\"est\":true";
+
+            payload += "}";
         }
+
+        payload += "]";
+
+        if ((count > 0) && (mqttClient.Publish((topic + "/samples").c_str(), (const uint8_t *)payload.c_str(), payload.length(), mqttConfig->qos, false) == true))
+            mqttSamplesInFlight = count;
+    }
+
+    profiler.End(profilerStageMqtt);
+    heapMonitor.End(heapSubsystemMqtt);
+}
+
+void taskDht(void) {
+    profiler.Begin(profilerStageDht);
+
+    // One read spans the start signal and the capture, the task comes back
+    // for each step instead of waiting on the bus
+    if (dhtReader.IsBusy() == false)
+        dhtReader.StartRead();
+
+    uint32_t nextUpdate = dhtReader.Update();
+
+    // A failed read leaves the last good values in the cache
+    if (dhtReader.IsBusy() == false) {
+        sensorCache.Update(dhtReader.GetLastResult(), dhtReader.GetReading());
+        nextUpdate = sensorCache.GetPollInterval();
+    }
+
+    scheduler.SetNextDeadline(dhtTaskId, nextUpdate);
+    profiler.End(profilerStageDht);
+}
+
+void taskProfilerReport(void) {
+    Serial.printf("Profiler: %s\n", buildProfilerReport().c_str());
+}
+
+void taskHeapMonitor(void) {
+    heapMonitor.Update();
+}
+
+void taskPower(void) {
+    powerConfig_s *powerConfig = configStore.GetPowerConfig();
+
+    if (powerConfig->batchMode == 0)
+        return;
+
+    // Serve for the awake window; a batch still waiting for the time gets a
+    // few windows more before it is carried into the next cycle
+    if (millis() < (powerConfig->awakeWindow * 1000UL))
+        return;
+
+    if ((sampleBatch.GetCount() > 0) && (millis() < (powerConfig->awakeWindow * 1000UL * BATCH_FLUSH_WINDOW_FACTOR)))
+        return;
+
+    Serial.printf("Entering batched deep sleep\n");
+    enterBatchSleep();
+}
+
+//=============================================================================
+// Loop function
+//=============================================================================
+void loop() {
+    profiler.Begin(profilerStageLoop);
+
+    if (scheduler.Update() == true) {
+        profiler.End(profilerStageLoop);
     }
 }
@@ -2,17 +2,23 @@
 #include "uiFrameSensor.h"
 
 #include <ESP8266WiFi.h>
-#include <DHTesp.h>
 
 void uiFrameSensor(OLEDDisplay *display, OLEDDisplayUiState* state, int16_t x, int16_t y) {
     String sensorText = String();
+    SensorCache *sensor = (*(uiGlobalObject_s *)(state->userData)).sensor_p;
 
     display->setTextAlignment(TEXT_ALIGN_LEFT);
     display->setFont(ArialMT_Plain_16);
 
-    sensorText = "T: ";
-    sensorText += (*(uiGlobalObject_s *)(state->userData)).dhtTempAndHumidity_p->temperature;
-    sensorText += ", H: ";
-    sensorText += (*(uiGlobalObject_s *)(state->userData)).dhtTempAndHumidity_p->humidity;
+    // Last good values are kept on a failed read, a star marks them as stale
+    if (sensor->IsValid() == false) {
+        sensorText = "T: --, H: --";
+    } else {
+        sensorText = (sensor->IsStale() == true) ? "T*: " : "T: ";
+        sensorText += sensor->GetReading()->temperature;
+        sensorText += ", H: ";
+        sensorText += sensor->GetReading()->humidity;
+    }
+
     display->drawString(0 + x, 16 + y, sensorText);
 }
@@ -25,6 +25,6 @@ void uiFrameStatus(OLEDDisplay *display, OLEDDisplayUiState* state, int16_t x, i
     display->drawString(0 + x, 11 + y, statusText);
 
     statusText = "CNT: " + String((*(uiGlobalObject_s *)(state->userData)).impulse_p->GetImpulseCount());
-    statusText += " W: " + String((*(uiGlobalObject_s *)(state->userData)).impulse_p->GetInstantWattUsgage());
+    statusText += " W: " + String((*(uiGlobalObject_s *)(state->userData)).impulse_p->GetWattUsage());
     display->drawString(0 + x, 22 + y, statusText);
 }
@@ -0,0 +1,37 @@
+#include "uiGlobal.h"
+#include "uiFrameTariff.h"
+
+//=============================================================================
+// Tariff rate now and the energy and cost of today
+//=============================================================================
+
+void uiFrameTariff(OLEDDisplay *display, OLEDDisplayUiState* state, int16_t x, int16_t y) {
+    String tariffText = String();
+    TariffLedger *tariff = (*(uiGlobalObject_s *)(state->userData)).tariff_p;
+    TimeService *timeSource = (*(uiGlobalObject_s *)(state->userData)).time_p;
+
+    display->setTextAlignment(TEXT_ALIGN_LEFT);
+    display->setFont(ArialMT_Plain_10);
+
+    // Rates depend on the local time, nothing to show before the first sync
+    if ((timeSource->IsSynced() == false) || (tariff->GetSchedule() == NULL)) {
+        display->drawString(0 + x, 11 + y, "Tariff: no time");
+        return;
+    }
+
+    uint32_t epoch = timeSource->GetEpoch();
+    const tariffRate_s *rate = &tariff->GetSchedule()->rates[tariff->GetRate(epoch)];
+    const tariffTotal_s *today = tariff->GetDay(TariffLedger::GetDayNumber(epoch));
+    uint32_t energy = 0;
+
+    tariffText = String(rate->name) + ": " + String((float)rate->price / TARIFF_PRICE_SCALE, 4) + "/kWh";
+    display->drawString(0 + x, 11 + y, tariffText);
+
+    for (uint8_t i = 0; (today != NULL) && (i < TARIFF_RATES_MAX); i++) {
+        energy += today->energy[i];
+    }
+
+    tariffText = "Today: " + String(energy / 1000000.0, 2) + " kWh ";
+    tariffText += String((today != NULL) ? ((double)today->cost / TARIFF_COST_SCALE) : 0.0, 2);
+    display->drawString(0 + x, 22 + y, tariffText);
+}